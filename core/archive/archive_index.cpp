@@ -3,6 +3,8 @@
 #include "archive_index.h"
 #include "storage.h"
 #include "options.h"
+#include "../tools/tlv_stream.h"
+#include "../tools/system.h"
 #include "core.h"
 
 #include <limits>
@@ -47,6 +49,7 @@ archive_index::archive_index(const std::wstring& _file_name, const std::string&
     , loaded_from_local_(false)
     , aimid_(_aimid)
 {
+    storage_->set_write_behind(true);
 }
 
 
@@ -191,21 +194,26 @@ bool archive_index::update(const archive::history_block& _data, /*out*/ headers_
     return save_block(_headers);
 }
 
-void archive_index::serialize_block(const headers_list& _headers, core::tools::binary_stream& _data) const
+bool archive_index::has_pending_writes() const
+{
+    return storage_->has_pending();
+}
+
+bool archive_index::commit_pending_writes()
 {
-    core::tools::tlvpack tlv_headers;
+    return storage_->commit_pending();
+}
 
-    core::tools::binary_stream header_data;
+void archive_index::serialize_block(const headers_list& _headers, core::tools::binary_stream& _data) const
+{
+    core::tools::tlv_writer headers_writer(_data);
 
     for (const auto& hdr : _headers)
     {
-        header_data.reset();
-        hdr.serialize(header_data);
-
-        tlv_headers.push_child(core::tools::tlv(archive_index_types::header, header_data));
+        const auto header_offset = headers_writer.begin_pack(archive_index_types::header);
+        hdr.serialize(_data);
+        headers_writer.end_pack(header_offset);
     }
-
-    tlv_headers.serialize(_data);
 }
 
 bool archive_index::unserialize_block(core::tools::binary_stream& _data)
@@ -513,6 +521,84 @@ int64_t archive_index::validate_hole_request(const archive_hole& _hole, const in
     return ret_from;
 }
 
+void archive_index::get_data_offsets(Out std::vector<int64_t>& _offsets) const
+{
+    _offsets.reserve(headers_index_.size());
+
+    for (const auto &iter_header : headers_index_)
+        iter_header.second.get_data_offsets(Out _offsets);
+
+    std::sort(_offsets.begin(), _offsets.end());
+    _offsets.erase(std::unique(_offsets.begin(), _offsets.end()), _offsets.end());
+}
+
+int64_t archive_index::get_uncompressed_data_size() const
+{
+    int64_t size = 0;
+
+    for (const auto &iter_header : headers_index_)
+    {
+        const auto &header = iter_header.second;
+        if (header.get_data_offset() != -1 && !storage::is_frame_offset(header.get_data_offset()))
+            size += header.get_data_size();
+    }
+
+    return size;
+}
+
+bool archive_index::save_remapped(const std::wstring& _file_name, const data_offsets_map& _remap) const
+{
+    {
+        storage remapped(_file_name);
+
+        archive::storage_mode mode;
+        mode.flags_.write_ = true;
+        mode.flags_.truncate_ = true;
+        if (!remapped.open(mode))
+            return false;
+
+        auto p_remapped = &remapped;
+        core::tools::auto_scope lb([p_remapped]{p_remapped->close();});
+
+        std::list<message_header> headers;
+
+        const auto end = headers_index_.cend();
+
+        for (auto iter_header = headers_index_.cbegin(); iter_header != end; ++iter_header)
+        {
+            headers.emplace_back(iter_header->second);
+            headers.back().remap_data_offsets(_remap);
+
+            // the modifications are merged back on load, they moved with the data and must not be lost
+            for (auto modification : headers.back().get_modifications())
+            {
+                modification.set_prev_msgid(-1);
+                headers.emplace_back(std::move(modification));
+            }
+
+            if (headers.size() >= history_block_size || std::next(iter_header) == end)
+            {
+                core::tools::binary_stream block_data;
+                serialize_block(headers, block_data);
+
+                int64_t offset = 0;
+                if (!remapped.write_data_block(block_data, offset))
+                    return false;
+
+                headers.clear();
+            }
+        }
+    }
+
+    return tools::system::sync_file(_file_name);
+}
+
+void archive_index::remap_data_offsets(const data_offsets_map& _remap)
+{
+    for (auto &iter_header : headers_index_)
+        iter_header.second.remap_data_offsets(_remap);
+}
+
 bool archive_index::need_optimize() const
 {
     return (headers_index_.size() > index_size_need_optimize);
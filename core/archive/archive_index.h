@@ -81,11 +81,19 @@ namespace core
             void optimize();
             bool need_optimize() const;
 
+            void get_data_offsets(Out std::vector<int64_t>& _offsets) const;
+            int64_t get_uncompressed_data_size() const;
+            // writes the index with _remap applied to _file_name and syncs it, the index itself is not changed
+            bool save_remapped(const std::wstring& _file_name, const data_offsets_map& _remap) const;
+            void remap_data_offsets(const data_offsets_map& _remap);
+
             bool load_from_local();
 
             void serialize(headers_list& _list) const;
             bool serialize_from(int64_t _from, int64_t _count_early, int64_t _count_later, headers_list& _list) const;
             bool update(const archive::history_block& _data, /*out*/ headers_list& _headers);
+            bool has_pending_writes() const;
+            bool commit_pending_writes();
 
             void delete_up_to(const int64_t _to);
 
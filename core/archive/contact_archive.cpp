@@ -9,9 +9,19 @@
 #include "image_cache.h"
 #include "mentions_me.h"
 
+#include "../tools/system.h"
+
 using namespace core;
 using namespace archive;
 
+// raw messages worth packing into frames, a few frames at least
+const int64_t uncompressed_size_need_compact = (256 * 1024);
+
+// compaction writes the new db and index next to the old ones, the index is renamed
+// from the tmp name to the compacted name once both are synced: that commits the compaction
+const wchar_t* const compacted_suffix = L".compacted";
+const wchar_t* const compacted_tmp_suffix = L".compacted.tmp";
+
 contact_archive::contact_archive(const std::wstring& _archive_path, const std::string& _contact_id)
     : path_(_archive_path)
     , index_(std::make_unique<archive_index>(_archive_path + L'/' + index_filename(), _contact_id))
@@ -20,6 +30,7 @@ contact_archive::contact_archive(const std::wstring& _archive_path, const std::s
     , images_(std::make_unique<image_cache>(_archive_path + L'/' + image_cache_filename()))
     , mentions_(std::make_unique<mentions_me>(_archive_path + L'/' + mentions_filename()))
     , local_loaded_(false)
+    , compact_checked_(false)
 {
 }
 
@@ -217,6 +228,8 @@ void contact_archive::insert_history_block(
     {
         std::lock_guard<std::mutex> lock(mutex_);
 
+        compact_checked_ = false;
+
         if (!data_->update(insert_data))
         {
             assert(!"update data error");
@@ -237,6 +250,39 @@ void contact_archive::insert_history_block(
     }
 }
 
+bool contact_archive::commit_pending_writes(Out int32_t& _appends)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Out _appends = 0;
+
+    // data first, so the index never points past the end of the data file:
+    // if the data can not be written, the index stays pending as well
+    if (data_->has_pending_writes())
+    {
+        ++_appends;
+
+        if (!data_->commit_pending_writes())
+        {
+            assert(!"commit data error");
+            return false;
+        }
+    }
+
+    if (index_->has_pending_writes())
+    {
+        ++_appends;
+
+        if (!index_->commit_pending_writes())
+        {
+            assert(!"commit index error");
+            return false;
+        }
+    }
+
+    return true;
+}
+
 int32_t contact_archive::load_from_local()
 {
     if (local_loaded_)
@@ -244,6 +290,8 @@ int32_t contact_archive::load_from_local()
 
     local_loaded_ = true;
 
+    finish_compaction();
+
     if (!index_->load_from_local())
     {
         if (index_->get_last_error() != archive::error::file_not_exist)
@@ -284,6 +332,92 @@ void contact_archive::optimize()
     }
 }
 
+bool contact_archive::need_compact() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (compact_checked_)
+        return false;
+
+    compact_checked_ = true;
+
+    return (index_->get_uncompressed_data_size() >= uncompressed_size_need_compact);
+}
+
+bool contact_archive::compact()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // the compacted file is built from the index, so both have to be complete
+    if (data_->has_pending_writes() && !data_->commit_pending_writes())
+        return false;
+
+    if (index_->has_pending_writes() && !index_->commit_pending_writes())
+        return false;
+
+    std::vector<int64_t> offsets;
+    index_->get_data_offsets(Out offsets);
+    if (offsets.empty())
+        return false;
+
+    const auto db_file_name = path_ + L'/' + db_filename();
+    const auto index_file_name = path_ + L'/' + index_filename();
+
+    data_offsets_map remap;
+    if (!data_->compact(offsets, db_file_name + compacted_suffix, Out remap))
+        return false;
+
+    if (!index_->save_remapped(index_file_name + compacted_tmp_suffix, remap) ||
+        !tools::system::move_file(index_file_name + compacted_tmp_suffix, index_file_name + compacted_suffix))
+    {
+        tools::system::delete_file(db_file_name + compacted_suffix);
+        tools::system::delete_file(index_file_name + compacted_tmp_suffix);
+        return false;
+    }
+
+    // the old files are still in place, so the compaction can be rolled back until the db is replaced
+    if (!data_->replace_file(db_file_name + compacted_suffix))
+    {
+        tools::system::delete_file(db_file_name + compacted_suffix);
+        tools::system::delete_file(index_file_name + compacted_suffix);
+        return false;
+    }
+
+    index_->remap_data_offsets(remap);
+
+    // if this fails, the next load_from_local finishes it
+    return tools::system::move_file(index_file_name + compacted_suffix, index_file_name);
+}
+
+void contact_archive::finish_compaction()
+{
+    const auto db_file_name = path_ + L'/' + db_filename();
+    const auto index_file_name = path_ + L'/' + index_filename();
+
+    if (!tools::system::is_exist(index_file_name + compacted_suffix))
+    {
+        // not committed, the old db and index are intact
+        if (tools::system::is_exist(db_file_name + compacted_suffix))
+            tools::system::delete_file(db_file_name + compacted_suffix);
+
+        if (tools::system::is_exist(index_file_name + compacted_tmp_suffix))
+            tools::system::delete_file(index_file_name + compacted_tmp_suffix);
+
+        return;
+    }
+
+    if (tools::system::is_exist(db_file_name + compacted_suffix) && !data_->replace_file(db_file_name + compacted_suffix))
+    {
+        assert(!"compacted db was not moved");
+        return;
+    }
+
+    if (!tools::system::move_file(index_file_name + compacted_suffix, index_file_name))
+    {
+        assert(!"compacted index was not moved");
+    }
+}
+
 void contact_archive::delete_messages_up_to(const int64_t _up_to)
 {
     assert(_up_to > -1);
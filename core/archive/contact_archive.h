@@ -37,10 +37,16 @@ namespace core
 
             bool local_loaded_;
 
+            // set once the uncompressed data size was checked, reset by inserts
+            mutable bool compact_checked_;
+
             mutable std::mutex mutex_;
 
             std::thread image_cache_thread_;
 
+            // completes a compaction interrupted after its commit, or drops the files of an unfinished one
+            void finish_compaction();
+
         public:
 
             void get_images(int64_t _from, int64_t _count, image_list& _images) const;
@@ -71,11 +77,17 @@ namespace core
                 Out dlg_state& _updated_state,
                 Out dlg_state_changes& _state_changes);
 
+            // false if a write failed, the rest stays pending for the next commit
+            bool commit_pending_writes(Out int32_t& _appends);
+
             int32_t load_from_local();
 
             bool need_optimize() const;
             void optimize();
 
+            bool need_compact() const;
+            bool compact();
+
             void delete_messages_up_to(const int64_t _up_to);
 
             contact_archive(const std::wstring& _archive_path, const std::string& _contact_id);
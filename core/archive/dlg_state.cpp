@@ -9,6 +9,7 @@
 
 #include "history_message.h"
 #include "storage.h"
+#include "../tools/tlv_stream.h"
 
 #include "dlg_state.h"
 
@@ -231,120 +232,122 @@ void dlg_state::serialize(icollection* _collection, const time_t _offset, const
 
 void dlg_state::serialize(core::tools::binary_stream& _data) const
 {
-    core::tools::tlvpack state_pack;
-
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::unreads_count, get_unread_count()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::last_msg_id, get_last_msgid()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::yours_last_read, get_yours_last_read()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::theirs_last_read, get_theirs_last_read()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::theirs_last_delivered, get_theirs_last_delivered()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::visible, get_visible()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::last_message_friendly, get_last_message_friendly()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::friendly, get_friendly()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::official, get_official()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::fake, get_fake()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::hidden_msg_id, get_hidden_msg_id()));
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::unread_mentions_count, get_unread_mentions_count()));
+    core::tools::tlv_writer state_writer(_data);
+
+    state_writer.write(dlg_state_fields::unreads_count, get_unread_count());
+    state_writer.write(dlg_state_fields::last_msg_id, get_last_msgid());
+    state_writer.write(dlg_state_fields::yours_last_read, get_yours_last_read());
+    state_writer.write(dlg_state_fields::theirs_last_read, get_theirs_last_read());
+    state_writer.write(dlg_state_fields::theirs_last_delivered, get_theirs_last_delivered());
+    state_writer.write(dlg_state_fields::visible, get_visible());
+    state_writer.write(dlg_state_fields::last_message_friendly, get_last_message_friendly());
+    state_writer.write(dlg_state_fields::friendly, get_friendly());
+    state_writer.write(dlg_state_fields::official, get_official());
+    state_writer.write(dlg_state_fields::fake, get_fake());
+    state_writer.write(dlg_state_fields::hidden_msg_id, get_hidden_msg_id());
+    state_writer.write(dlg_state_fields::unread_mentions_count, get_unread_mentions_count());
 
     if (has_history_patch_version())
     {
-        state_pack.push_child(core::tools::tlv(
+        state_writer.write(
             dlg_state_fields::patch_version,
             get_history_patch_version()
-            ));
+            );
     }
 
     if (has_del_up_to())
     {
-        state_pack.push_child(core::tools::tlv(
+        state_writer.write(
             dlg_state_fields::del_up_to,
             get_del_up_to()
-            ));
+            );
     }
 
-    core::tools::binary_stream bs_message;
-    get_last_message().serialize(bs_message);
-    state_pack.push_child(core::tools::tlv(dlg_state_fields::last_message, bs_message));
-
-    state_pack.serialize(_data);
+    const auto message_offset = state_writer.begin_pack(dlg_state_fields::last_message);
+    get_last_message().serialize(_data);
+    state_writer.end_pack(message_offset);
 }
 
 bool dlg_state::unserialize(core::tools::binary_stream& _data)
 {
-    core::tools::tlvpack state_pack;
-    if (!state_pack.unserialize(_data))
+    const auto size = _data.available();
+    if (!size)
+        return false;
+
+    const core::tools::tlv_reader state_reader(_data.read(size), size);
+    if (!state_reader.validate())
         return false;
 
-    auto tlv_unreads_count = state_pack.get_item(dlg_state_fields::unreads_count);
-    auto tlv_last_msg_id = state_pack.get_item(dlg_state_fields::last_msg_id);
-    auto tlv_yours_last_read = state_pack.get_item(dlg_state_fields::yours_last_read);
-    auto tlv_theirs_last_read = state_pack.get_item(dlg_state_fields::theirs_last_read);
-    auto tlv_theirs_last_delivered = state_pack.get_item(dlg_state_fields::theirs_last_delivered);
-    auto tlv_last_message = state_pack.get_item(dlg_state_fields::last_message);
-    auto tlv_visible = state_pack.get_item(dlg_state_fields::visible);
-    auto tlv_last_message_friendly = state_pack.get_item(dlg_state_fields::last_message_friendly);
-    auto tlv_friendly = state_pack.get_item(dlg_state_fields::friendly);
-    auto tlv_official = state_pack.get_item(dlg_state_fields::official);
-    auto tlv_fake = state_pack.get_item(dlg_state_fields::fake);
-    auto tlv_hidden_msg_id = state_pack.get_item(dlg_state_fields::hidden_msg_id);
-    auto tlv_mention_me_count = state_pack.get_item(dlg_state_fields::unread_mentions_count);
-
-    if (!tlv_unreads_count || !tlv_last_msg_id || !tlv_yours_last_read || !tlv_theirs_last_read ||
-        !tlv_theirs_last_delivered || !tlv_last_message || !tlv_visible)
+    core::tools::tlv_view tlv_unreads_count, tlv_last_msg_id, tlv_yours_last_read, tlv_theirs_last_read,
+        tlv_theirs_last_delivered, tlv_last_message, tlv_visible;
+
+    const auto has_required_fields = (
+        state_reader.find(dlg_state_fields::unreads_count, Out tlv_unreads_count) &&
+        state_reader.find(dlg_state_fields::last_msg_id, Out tlv_last_msg_id) &&
+        state_reader.find(dlg_state_fields::yours_last_read, Out tlv_yours_last_read) &&
+        state_reader.find(dlg_state_fields::theirs_last_read, Out tlv_theirs_last_read) &&
+        state_reader.find(dlg_state_fields::theirs_last_delivered, Out tlv_theirs_last_delivered) &&
+        state_reader.find(dlg_state_fields::last_message, Out tlv_last_message) &&
+        state_reader.find(dlg_state_fields::visible, Out tlv_visible));
+
+    if (!has_required_fields)
     {
         return false;
     }
 
-    set_unread_count(tlv_unreads_count->get_value<uint32_t>(0));
-    set_last_msgid(tlv_last_msg_id->get_value<int64_t>(0));
-    set_yours_last_read(tlv_yours_last_read->get_value<int64_t>(0));
-    set_theirs_last_read(tlv_theirs_last_read->get_value<int64_t>(0));
-    set_theirs_last_delivered(tlv_theirs_last_delivered->get_value<int64_t>(0));
-    set_visible(tlv_visible->get_value<bool>(true));
+    set_unread_count(tlv_unreads_count.get_value<uint32_t>(0));
+    set_last_msgid(tlv_last_msg_id.get_value<int64_t>(0));
+    set_yours_last_read(tlv_yours_last_read.get_value<int64_t>(0));
+    set_theirs_last_read(tlv_theirs_last_read.get_value<int64_t>(0));
+    set_theirs_last_delivered(tlv_theirs_last_delivered.get_value<int64_t>(0));
+    set_visible(tlv_visible.get_value<bool>(true));
+
+    core::tools::tlv_view tlv_field;
 
-    if (tlv_last_message_friendly)
+    if (state_reader.find(dlg_state_fields::last_message_friendly, Out tlv_field))
     {
-        set_last_message_friendly(tlv_last_message_friendly->get_value<std::string>());
+        set_last_message_friendly(tlv_field.get_string());
     }
 
-    if (tlv_friendly)
+    if (state_reader.find(dlg_state_fields::friendly, Out tlv_field))
     {
-        set_friendly(tlv_friendly->get_value<std::string>());
+        set_friendly(tlv_field.get_string());
     }
 
-    auto tlv_patch_version = state_pack.get_item(dlg_state_fields::patch_version);
-    if (tlv_patch_version)
+    if (state_reader.find(dlg_state_fields::patch_version, Out tlv_field))
     {
-        set_history_patch_version(tlv_patch_version->get_value<std::string>());
+        set_history_patch_version(tlv_field.get_string());
     }
 
-    auto tlv_del_up_to = state_pack.get_item(dlg_state_fields::del_up_to);
-    if (tlv_del_up_to)
+    if (state_reader.find(dlg_state_fields::del_up_to, Out tlv_field))
     {
-        set_del_up_to(tlv_del_up_to->get_value<int64_t>());
+        set_del_up_to(tlv_field.get_value<int64_t>(-1));
     }
 
-    if (tlv_official)
+    if (state_reader.find(dlg_state_fields::official, Out tlv_field))
     {
-        set_official(tlv_official->get_value<bool>());
+        set_official(tlv_field.get_value<bool>(false));
     }
 
-    if (tlv_fake)
+    if (state_reader.find(dlg_state_fields::fake, Out tlv_field))
     {
-        set_fake(tlv_fake->get_value<bool>());
+        set_fake(tlv_field.get_value<bool>(false));
     }
 
-    if (tlv_hidden_msg_id)
+    if (state_reader.find(dlg_state_fields::hidden_msg_id, Out tlv_field))
     {
-        set_hidden_msg_id(tlv_hidden_msg_id->get_value<int64_t>());
+        set_hidden_msg_id(tlv_field.get_value<int64_t>(-1));
     }
 
-    if (tlv_mention_me_count)
+    if (state_reader.find(dlg_state_fields::unread_mentions_count, Out tlv_field))
     {
-        set_unread_mentions_count(tlv_mention_me_count->get_value<int32_t>(0));
+        set_unread_mentions_count(tlv_field.get_value<int32_t>(0));
     }
 
-    core::tools::binary_stream bs_message = tlv_last_message->get_value<core::tools::binary_stream>();
+    core::tools::binary_stream bs_message;
+    if (tlv_last_message.get_size())
+        bs_message.write(tlv_last_message.get_data(), tlv_last_message.get_size());
+
     last_message_->unserialize(bs_message);
 
     return true;
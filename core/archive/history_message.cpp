@@ -10,6 +10,7 @@
 #include "../tools/file_sharing.h"
 
 #include "../tools/system.h"
+#include "../tools/tlv_stream.h"
 
 #include "history_patch.h"
 
@@ -159,6 +160,10 @@ uint32_t message_header::data_sizeof() const
 
 void message_header::serialize(core::tools::binary_stream& _data) const
 {
+#ifdef _DEBUG
+    const auto available_before = _data.available();
+#endif
+
     _data.write<uint8_t>(version_);
     _data.write<uint32_t>(flags_.value_);
     _data.write<uint64_t>(time_);
@@ -168,7 +173,7 @@ void message_header::serialize(core::tools::binary_stream& _data) const
     _data.write<uint32_t>(data_size_);
 
 #ifdef _DEBUG
-    if (_data.available() != data_sizeof())
+    if ((_data.available() - available_before) != data_sizeof())
     {
         assert(!"invalid data size");
     }
@@ -257,6 +262,25 @@ void message_header::merge_with(const message_header &rhs)
     }
 }
 
+void message_header::get_data_offsets(Out std::vector<int64_t>& _offsets) const
+{
+    if (data_offset_ != -1)
+        _offsets.push_back(data_offset_);
+
+    for (const auto& modification : modifications_)
+        modification.get_data_offsets(Out _offsets);
+}
+
+void message_header::remap_data_offsets(const data_offsets_map& _remap)
+{
+    const auto iter = _remap.find(data_offset_);
+    if (iter != _remap.end())
+        data_offset_ = iter->second;
+
+    for (auto& modification : modifications_)
+        modification.remap_data_offsets(_remap);
+}
+
 bool message_header::is_deleted() const
 {
     return flags_.flags_.deleted_;
@@ -1485,6 +1509,8 @@ void history_message::init_default()
 
 void history_message::init_file_sharing_from_local_path(const std::string &_local_path)
 {
+    parse_nested_data();
+
     assert(core::tools::system::is_exist(
         core::tools::from_utf8(_local_path)
         ));
@@ -1495,6 +1521,8 @@ void history_message::init_file_sharing_from_local_path(const std::string &_loca
 
 void history_message::init_file_sharing_from_link(const std::string &_uri)
 {
+    parse_nested_data();
+
     file_sharing_ = std::make_unique<core::archive::file_sharing_data>(std::string(), _uri);
 }
 
@@ -1502,21 +1530,29 @@ void history_message::init_sticker_from_text(const std::string &_text)
 {
     assert(boost::starts_with(_text, "ext:"));
 
+    parse_nested_data();
+
     sticker_ = std::make_unique<core::archive::sticker_data>(_text);
 }
 
 const file_sharing_data_uptr& history_message::get_file_sharing_data() const
 {
+    parse_nested_data();
+
     return file_sharing_;
 }
 
 chat_event_data_uptr& history_message::get_chat_event_data()
 {
+    parse_nested_data();
+
     return chat_event_;
 }
 
 voip_data_uptr& history_message::get_voip_data()
 {
+    parse_nested_data();
+
     return voip_;
 }
 
@@ -1534,6 +1570,7 @@ void history_message::copy(const history_message& _message)
     sender_friendly_ = _message.sender_friendly_;
     quotes_ = _message.quotes_;
     mentions_ = _message.mentions_;
+    nested_data_ = _message.nested_data_;
 
     sticker_.reset();
     mult_.reset();
@@ -1576,11 +1613,15 @@ void history_message::copy(const history_message& _message)
 
 archive::chat_data* history_message::get_chat_data()
 {
+    parse_nested_data();
+
     return chat_.get();
 }
 
 void history_message::set_chat_data(const chat_data& _data)
 {
+    parse_nested_data();
+
     if (!chat_)
     {
         chat_ = std::make_unique<core::archive::chat_data>(_data);
@@ -1593,6 +1634,8 @@ void history_message::set_chat_data(const chat_data& _data)
 
 const archive::chat_data* history_message::get_chat_data() const
 {
+    parse_nested_data();
+
     if (!chat_)
         return nullptr;
 
@@ -1609,6 +1652,8 @@ void history_message::set_prev_msgid(int64_t _value)
 
 void history_message::serialize(icollection* _collection, const time_t _offset, bool _serialize_message) const
 {
+    parse_nested_data();
+
     coll_helper coll(_collection, false);
 
     coll.set_value_as_int64("id", msgid_);
@@ -1711,136 +1756,195 @@ void history_message::serialize(icollection* _collection, const time_t _offset,
 
 void history_message::serialize(core::tools::binary_stream& _data) const
 {
-    core::tools::tlvpack msg_pack;
+    core::tools::tlv_writer msg_writer(_data);
 
     // text is the first for fast searching
-    msg_pack.push_child(core::tools::tlv(mf_text, (std::string) text_));
-    msg_pack.push_child(core::tools::tlv(mf_msg_id, (int64_t) msgid_));
-    msg_pack.push_child(core::tools::tlv(mf_prev_msg_id, (int64_t) prev_msg_id_));
-    msg_pack.push_child(core::tools::tlv(mf_flags, (uint32_t) flags_.value_));
-    msg_pack.push_child(core::tools::tlv(mf_time, (uint64_t) time_));
-    msg_pack.push_child(core::tools::tlv(mf_wimid, (std::string) wimid_));
-    msg_pack.push_child(core::tools::tlv(mf_internal_id, (std::string) internal_id_));
-    msg_pack.push_child(core::tools::tlv(mf_sender_friendly, (std::string) sender_friendly_));
+    msg_writer.write(mf_text, text_);
+    msg_writer.write<int64_t>(mf_msg_id, msgid_);
+    msg_writer.write<int64_t>(mf_prev_msg_id, prev_msg_id_);
+    msg_writer.write<uint32_t>(mf_flags, flags_.value_);
+    msg_writer.write<uint64_t>(mf_time, time_);
+    msg_writer.write(mf_wimid, wimid_);
+    msg_writer.write(mf_internal_id, internal_id_);
+    msg_writer.write(mf_sender_friendly, sender_friendly_);
+
+    // nested data is rare, it keeps its tlvpack serialization;
+    // not parsed yet, it goes back as it was read
+    if (!nested_data_.empty())
+        _data.write(nested_data_.data(), (uint32_t) nested_data_.size());
 
     if (chat_)
     {
         core::tools::tlvpack chat_pack;
         chat_->serialize(chat_pack);
-        msg_pack.push_child(core::tools::tlv(mf_chat, chat_pack));
+        msg_writer.write(mf_chat, chat_pack);
     }
 
     if (sticker_)
     {
         core::tools::tlvpack sticker_pack;
         sticker_->serialize(sticker_pack);
-        msg_pack.push_child(core::tools::tlv(mf_sticker, sticker_pack));
+        msg_writer.write(mf_sticker, sticker_pack);
     }
 
     if (mult_)
     {
         core::tools::tlvpack mult_pack;
         mult_->serialize(mult_pack);
-        msg_pack.push_child(core::tools::tlv(mf_mult, mult_pack));
+        msg_writer.write(mf_mult, mult_pack);
     }
 
     if (voip_)
     {
-        msg_pack.push_child(core::tools::tlv(mf_voip, *voip_));
+        core::tools::tlvpack voip_pack;
+        voip_->serialize(Out voip_pack);
+        msg_writer.write(mf_voip, voip_pack);
     }
 
     if (file_sharing_)
     {
         core::tools::tlvpack file_sharing_pack;
         file_sharing_->serialize(Out file_sharing_pack);
-        msg_pack.push_child(core::tools::tlv(mf_file_sharing, file_sharing_pack));
+        msg_writer.write(mf_file_sharing, file_sharing_pack);
     }
 
     if (chat_event_)
     {
         core::tools::tlvpack chat_event_pack;
         chat_event_->serialize(Out chat_event_pack);
-        msg_pack.push_child(core::tools::tlv(mf_chat_event, chat_event_pack));
+        msg_writer.write(mf_chat_event, chat_event_pack);
     }
 
     for (const auto& q : quotes_)
     {
         core::tools::tlvpack quote_pack;
         q.serialize(quote_pack);
-        msg_pack.push_child(core::tools::tlv(mf_quote, quote_pack));
+        msg_writer.write(mf_quote, quote_pack);
     }
 
     for (const auto& p: mentions_)
     {
-        core::tools::tlvpack pack;
-        pack.push_child(core::tools::tlv(message_fields::mf_mention_sn, p.first));
-        pack.push_child(core::tools::tlv(message_fields::mf_mention_friendly, p.second));
-        msg_pack.push_child(core::tools::tlv(mf_mention, pack));
+        const auto pack_offset = msg_writer.begin_pack(mf_mention);
+        msg_writer.write(message_fields::mf_mention_sn, p.first);
+        msg_writer.write(message_fields::mf_mention_friendly, p.second);
+        msg_writer.end_pack(pack_offset);
     }
-
-    msg_pack.serialize(_data);
 }
 
 int32_t history_message::unserialize(core::tools::binary_stream& _data)
 {
-    core::tools::tlvpack msg_pack;
+    const auto size = _data.available();
+    if (!size)
+        return 0;
+
+    core::tools::tlv_reader msg_reader(_data.read(size), size);
 
-    if (!msg_pack.unserialize(_data))
+    if (!msg_reader.validate())
         return -1;
 
-    for (auto tlv_field = msg_pack.get_first(); tlv_field; tlv_field = msg_pack.get_next())
+    core::tools::tlv_view tlv_field;
+    while (msg_reader.next(Out tlv_field))
     {
-        switch ((message_fields) tlv_field->get_type())
+        switch ((message_fields) tlv_field.get_type())
         {
         case message_fields::mf_msg_id:
-            msgid_ = tlv_field->get_value<int64_t>(msgid_);
+            msgid_ = tlv_field.get_value<int64_t>(msgid_);
             break;
         case message_fields::mf_prev_msg_id:
-            prev_msg_id_ = tlv_field->get_value<int64_t>(prev_msg_id_);
+            prev_msg_id_ = tlv_field.get_value<int64_t>(prev_msg_id_);
             break;
         case message_fields::mf_flags:
-            flags_.value_ = tlv_field->get_value<uint32_t>(0);
+            flags_.value_ = tlv_field.get_value<uint32_t>(0);
             break;
         case message_fields::mf_time:
-            time_ = tlv_field->get_value<uint64_t>(0);
+            time_ = tlv_field.get_value<uint64_t>(0);
             break;
         case message_fields::mf_wimid:
-            wimid_ = tlv_field->get_value<std::string>(std::string());
+            wimid_.assign(tlv_field.get_data(), tlv_field.get_size());
             break;
         case message_fields::mf_internal_id:
-            internal_id_ = tlv_field->get_value<std::string>(std::string());
+            internal_id_.assign(tlv_field.get_data(), tlv_field.get_size());
             break;
         case message_fields::mf_sender_friendly:
-            sender_friendly_ = tlv_field->get_value<std::string>(std::string());
+            sender_friendly_.assign(tlv_field.get_data(), tlv_field.get_size());
             break;
         case message_fields::mf_text:
-            text_ = tlv_field->get_value<std::string>(std::string());
+            text_.assign(tlv_field.get_data(), tlv_field.get_size());
             break;
+        case message_fields::mf_chat:
+        case message_fields::mf_sticker:
+        case message_fields::mf_mult:
+        case message_fields::mf_voip:
+        case message_fields::mf_file_sharing:
+        case message_fields::mf_chat_event:
+        case message_fields::mf_quote:
+            {
+                // kept as is, most loaded messages are never shown and do not need them parsed
+                const uint32_t header[] = { tlv_field.get_type(), tlv_field.get_size() };
+                nested_data_.append((const char*) header, sizeof(header));
+                nested_data_.append(tlv_field.get_data(), tlv_field.get_size());
+            }
+            break;
+        case message_fields::mf_mention:
+            {
+                const auto pack = tlv_field.get_pack();
+
+                core::tools::tlv_view sn, fr;
+                if (pack.find(mf_mention_sn, Out sn) && pack.find(mf_mention_friendly, Out fr))
+                {
+                    if (sn.get_size() && fr.get_size())
+                        mentions_.emplace(sn.get_string(), fr.get_string());
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return 0;
+}
+
+void history_message::parse_nested_data() const
+{
+    if (nested_data_.empty())
+        return;
+
+    std::string data;
+    data.swap(nested_data_);
+
+    core::tools::tlv_reader reader(data.data(), (uint32_t) data.size());
+
+    core::tools::tlv_view tlv_field;
+    while (reader.next(Out tlv_field))
+    {
+        switch ((message_fields) tlv_field.get_type())
+        {
         case message_fields::mf_chat:
             {
                 chat_ = std::make_unique<core::archive::chat_data>();
-                core::tools::tlvpack pack = tlv_field->get_value<core::tools::tlvpack>();
+                core::tools::tlvpack pack = tlv_field.to_pack();
                 chat_->unserialize(pack);
             }
             break;
         case message_fields::mf_sticker:
             {
                 sticker_ = std::make_unique<core::archive::sticker_data>();
-                core::tools::tlvpack pack = tlv_field->get_value<core::tools::tlvpack>();
+                core::tools::tlvpack pack = tlv_field.to_pack();
                 sticker_->unserialize(pack);
             }
             break;
         case message_fields::mf_mult:
             {
                 mult_ = std::make_unique<core::archive::mult_data>();
-                core::tools::tlvpack pack = tlv_field->get_value<core::tools::tlvpack>();
+                core::tools::tlvpack pack = tlv_field.to_pack();
                 mult_->unserialize(pack);
             }
             break;
         case message_fields::mf_voip:
             {
                 voip_ = std::make_unique<core::archive::voip_data>();
-                const auto pack = tlv_field->get_value<core::tools::tlvpack>();
+                const auto pack = tlv_field.to_pack();
                 if (!voip_->unserialize(pack))
                 {
                     assert(!"voip unserialization failed");
@@ -1850,44 +1954,46 @@ int32_t history_message::unserialize(core::tools::binary_stream& _data)
             break;
         case message_fields::mf_file_sharing:
             {
-                const auto pack = tlv_field->get_value<core::tools::tlvpack>();
+                const auto pack = tlv_field.to_pack();
                 file_sharing_ = std::make_unique<core::archive::file_sharing_data>(pack);
             }
             break;
         case message_fields::mf_chat_event:
             {
-                const auto pack = tlv_field->get_value<core::tools::tlvpack>();
+                const auto pack = tlv_field.to_pack();
                 chat_event_ = chat_event_data::make_from_tlv(pack);
             }
             break;
         case message_fields::mf_quote:
             {
                 quote q;
-                const auto pack = tlv_field->get_value<core::tools::tlvpack>();
+                const auto pack = tlv_field.to_pack();
                 q.unserialize(pack);
                 quotes_.push_back(std::move(q));
             }
             break;
-        case message_fields::mf_mention:
-            {
-                const auto pack = tlv_field->get_value<core::tools::tlvpack>();
-                const auto sn = pack.get_item(mf_mention_sn);
-                const auto fr = pack.get_item(mf_mention_friendly);
-                if (sn && fr)
-                {
-                    const auto sn_str = sn->get_value<std::string>();
-                    const auto fr_str = fr->get_value<std::string>();
-                    if (!sn_str.empty() && !fr_str.empty())
-                        mentions_.emplace(sn_str, fr_str);
-                }
-            }
-            break;
         default:
+            assert(!"unexpected nested field");
             break;
         }
     }
+}
 
-    return 0;
+bool history_message::has_nested_field(const uint32_t _type) const
+{
+    if (nested_data_.empty())
+        return false;
+
+    core::tools::tlv_reader reader(nested_data_.data(), (uint32_t) nested_data_.size());
+
+    core::tools::tlv_view tlv_field;
+    while (reader.next(Out tlv_field))
+    {
+        if (tlv_field.get_type() == _type)
+            return true;
+    }
+
+    return false;
 }
 
 int32_t history_message::unserialize(const rapidjson::Value& _node,
@@ -2142,6 +2248,8 @@ bool history_message::is_deleted() const
 
 bool history_message::is_chat_event_deleted() const
 {
+    parse_nested_data();
+
     return chat_event_ && chat_event_->is_type_deleted();
 }
 
@@ -2152,6 +2260,9 @@ bool history_message::is_modified() const
 
 void history_message::reset_extended_data()
 {
+    // chat data and quotes are kept
+    parse_nested_data();
+
     sticker_.reset();
     mult_.reset();
     voip_.reset();
@@ -2221,11 +2332,15 @@ void history_message::apply_modifications(const history_block &_modifications)
 
 const quotes_vec& history_message::get_quotes() const
 {
+    parse_nested_data();
+
     return quotes_;
 }
 
 void history_message::attach_quotes(const quotes_vec& _quotes)
 {
+    parse_nested_data();
+
     quotes_ = _quotes;
 }
 
@@ -2244,6 +2359,30 @@ message_flags history_message::get_flags() const
     return flags_;
 }
 
+bool history_message::is_sticker() const
+{
+    return (sticker_ || has_nested_field(mf_sticker));
+}
+
+bool history_message::is_file_sharing() const
+{
+    return (file_sharing_ || has_nested_field(mf_file_sharing));
+}
+
+bool history_message::is_chat_event() const
+{
+    return (chat_event_ || has_nested_field(mf_chat_event));
+}
+
+bool history_message::is_voip_event() const
+{
+    // a voip field that fails to parse leaves no voip data
+    if (!voip_ && has_nested_field(mf_voip))
+        parse_nested_data();
+
+    return (bool) voip_;
+}
+
 message_type history_message::get_type() const
 {
     if (is_sms())
@@ -2276,6 +2415,9 @@ message_type history_message::get_type() const
 
 bool history_message::contents_equal(const history_message& _msg) const
 {
+    parse_nested_data();
+    _msg.parse_nested_data();
+
     if (get_type() != _msg.get_type())
     {
         return false;
@@ -2305,6 +2447,8 @@ bool history_message::contents_equal(const history_message& _msg) const
 
 void history_message::apply_persons_to_quotes(const archive::persons_map & _persons)
 {
+    parse_nested_data();
+
     for (auto& q : quotes_)
     {
         const auto iter_p = _persons.find(q.get_sender());
@@ -2329,6 +2473,8 @@ const std::string& history_message::get_text() const
 {
     if (is_sticker())
     {
+        parse_nested_data();
+
         assert(sticker_);
         if (sticker_)
             return sticker_->get_id();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "message_flags.h"
+#include "storage.h"
 
 #include "../../corelib/iserializable.h"
 
@@ -93,6 +94,9 @@ namespace core
 
             void merge_with(const message_header &rhs);
 
+            void get_data_offsets(Out std::vector<int64_t>& _offsets) const;
+            void remap_data_offsets(const data_offsets_map& _remap);
+
             bool is_deleted() const;
             bool is_modified() const;
             bool is_patch() const;
@@ -324,15 +328,23 @@ namespace core
             std::string		internal_id_;
             std::string		sender_friendly_;
 
-            std::unique_ptr<sticker_data>		sticker_;
-            std::unique_ptr<mult_data>			mult_;
-            voip_data_uptr			            voip_;
-            std::unique_ptr<chat_data>			chat_;
-            file_sharing_data_uptr				file_sharing_;
-            chat_event_data_uptr				chat_event_;
-            quotes_vec                          quotes_;
+            // the nested fields are parsed from nested_data_ on the first access
+            mutable std::unique_ptr<sticker_data>		sticker_;
+            mutable std::unique_ptr<mult_data>			mult_;
+            mutable voip_data_uptr			            voip_;
+            mutable std::unique_ptr<chat_data>			chat_;
+            mutable file_sharing_data_uptr				file_sharing_;
+            mutable chat_event_data_uptr				chat_event_;
+            mutable quotes_vec                          quotes_;
             mentions_map                        mentions_;
 
+            // tlv fields of the nested data as read from the archive, empty once parsed
+            mutable std::string nested_data_;
+
+            void parse_nested_data() const;
+
+            bool has_nested_field(const uint32_t _type) const;
+
             void copy(const history_message& _message);
 
             void init_default();
@@ -422,10 +434,10 @@ namespace core
             void set_mentions(const mentions_map& _mentions);
 
             bool is_sms() const { return false; }
-            bool is_sticker() const { return (bool)sticker_; }
-            bool is_file_sharing() const { return (bool)file_sharing_; }
-            bool is_chat_event() const { return (bool)chat_event_; }
-            bool is_voip_event() const { return (bool)voip_; }
+            bool is_sticker() const;
+            bool is_file_sharing() const;
+            bool is_chat_event() const;
+            bool is_voip_event() const;
 
             void init_file_sharing_from_local_path(const std::string &_local_path);
             void init_file_sharing_from_link(const std::string &_uri);
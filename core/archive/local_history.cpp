@@ -5,6 +5,9 @@
 #include "../../corelib/collection_helper.h"
 
 #include "../log/log.h"
+#include "../profiling/metrics.h"
+#include "../configuration/app_config.h"
+#include "../tools/system.h"
 
 #include "image_cache.h"
 #include "history_message.h"
@@ -26,6 +29,7 @@ local_history::local_history(const std::wstring& _archive_path)
 
 local_history::~local_history()
 {
+    commit_pending_writes();
 }
 
 std::shared_ptr<contact_archive> local_history::get_contact_archive(const std::string& _contact)
@@ -52,7 +56,64 @@ void local_history::update_history(
     Out dlg_state& _state,
     Out dlg_state_changes& _state_changes)
 {
+    drop_prefetched_page(_contact);
+
+    if (pending_commit_contacts_.empty())
+        pending_commit_since_ = std::chrono::steady_clock::now();
+
     get_contact_archive(_contact)->insert_history_block(_data, Out _inserted_messages, Out _state, Out _state_changes);
+
+    pending_commit_contacts_.insert(_contact);
+
+    ++group_commit_stats_.updates_;
+}
+
+void local_history::commit_pending_writes()
+{
+    if (pending_commit_contacts_.empty())
+        return;
+
+    for (auto iter = pending_commit_contacts_.begin(); iter != pending_commit_contacts_.end();)
+    {
+        const auto iter_arch = archives_.find(*iter);
+        if (iter_arch == archives_.end())
+        {
+            iter = pending_commit_contacts_.erase(iter);
+            continue;
+        }
+
+        auto appends = 0;
+        const auto committed = iter_arch->second->commit_pending_writes(Out appends);
+
+        group_commit_stats_.appends_ += appends;
+
+        // retried by the next commit
+        if (!committed)
+        {
+            ++iter;
+            continue;
+        }
+
+        iter = pending_commit_contacts_.erase(iter);
+    }
+
+    ++group_commit_stats_.commits_;
+    group_commit_stats_.latency_ += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pending_commit_since_);
+
+    if ((group_commit_stats_.commits_ % 100) != 0)
+        return;
+
+    __TRACE(
+        "archive",
+        "group commit\n"
+        "    updates=<%1%>\n"
+        "    commits=<%2%>\n"
+        "    file_appends=<%3%>\n"
+        "    appends_per_update=<%4%>\n"
+        "    avg_commit_latency_us=<%5%>",
+        group_commit_stats_.updates_ % group_commit_stats_.commits_ % group_commit_stats_.appends_ %
+        ((double)group_commit_stats_.appends_ / (double)std::max<int64_t>(group_commit_stats_.updates_, 1)) %
+        (group_commit_stats_.latency_.count() / group_commit_stats_.commits_));
 }
 
 void local_history::get_images(const std::string& _contact, int64_t _from, int64_t _count, /*out*/ image_list& _images)
@@ -64,6 +125,8 @@ void local_history::get_images(const std::string& _contact, int64_t _from, int64
 
 bool local_history::repair_images(const std::string& _contact)
 {
+    drop_prefetched_page(_contact);
+
     return get_contact_archive(_contact)->repair_images();
 }
 
@@ -75,6 +138,122 @@ void local_history::get_messages_index(const std::string& _contact, int64_t _fro
 }
 
 bool local_history::get_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, /*out*/ std::shared_ptr<history_block> _messages)
+{
+    if (take_prefetched_page(_contact, _from, _count_early, _count_later, _messages))
+        return true;
+
+    return load_messages(_contact, _from, _count_early, _count_later, _messages);
+}
+
+void local_history::prefetch_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later)
+{
+    assert(!_contact.empty());
+
+    const auto it = prefetched_pages_.find(_contact);
+    if (it != prefetched_pages_.end() &&
+        it->second.from_ == _from &&
+        it->second.count_early_ == _count_early &&
+        it->second.count_later_ == _count_later)
+    {
+        return;
+    }
+
+    auto messages = std::make_shared<history_block>();
+    if (!load_messages(_contact, _from, _count_early, _count_later, messages) || messages->empty())
+    {
+        drop_prefetched_page(_contact);
+        return;
+    }
+
+    prefetched_page page;
+    page.from_ = _from;
+    page.count_early_ = _count_early;
+    page.count_later_ = _count_later;
+    page.messages_ = messages;
+
+    prefetched_pages_[_contact] = std::move(page);
+
+    ++prefetch_stats_.issued_;
+}
+
+void local_history::drop_prefetched_pages(const std::string& _except_contact)
+{
+    for (auto it = prefetched_pages_.begin(); it != prefetched_pages_.end();)
+    {
+        if (it->first == _except_contact)
+        {
+            ++it;
+            continue;
+        }
+
+        ++prefetch_stats_.cancelled_;
+        it = prefetched_pages_.erase(it);
+    }
+}
+
+bool local_history::take_prefetched_page(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, /*out*/ std::shared_ptr<history_block> _messages)
+{
+    // only a page towards older messages from a known message could have been prefetched
+    const auto is_older_page = (_from > 0 && _count_early > 0 && _count_later <= 0);
+
+    const auto it = prefetched_pages_.find(_contact);
+    const auto had_page = (it != prefetched_pages_.end());
+
+    auto is_hit = false;
+
+    if (had_page)
+    {
+        const auto &page = it->second;
+
+        is_hit = (
+            page.from_ == _from &&
+            page.count_early_ == _count_early &&
+            page.count_later_ == _count_later);
+
+        if (is_hit)
+            _messages->insert(_messages->end(), page.messages_->begin(), page.messages_->end());
+
+        // a consumed page is not needed anymore, a page for another position is stale
+        prefetched_pages_.erase(it);
+    }
+
+    if (is_hit)
+    {
+        ++prefetch_stats_.hits_;
+    }
+    else if (is_older_page)
+    {
+        // the prefetch was absent or stale
+        ++prefetch_stats_.misses_;
+    }
+    else
+    {
+        // the other requests are neither hits nor misses, the page they drop is cancelled
+        if (had_page)
+            ++prefetch_stats_.cancelled_;
+
+        return false;
+    }
+
+    __TRACE(
+        "prefetch",
+        "history page prefetch %1%\n"
+        "    contact=<%2%>\n"
+        "    issued=<%3%>\n"
+        "    hits=<%4%>\n"
+        "    misses=<%5%>\n"
+        "    cancelled=<%6%>",
+        (is_hit ? "hit" : "miss") % _contact % prefetch_stats_.issued_ % prefetch_stats_.hits_ % prefetch_stats_.misses_ % prefetch_stats_.cancelled_);
+
+    return is_hit;
+}
+
+void local_history::drop_prefetched_page(const std::string& _contact)
+{
+    prefetched_pages_.erase(_contact);
+}
+
+bool local_history::load_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, /*out*/ std::shared_ptr<history_block> _messages)
 {
     headers_list headers;
 
@@ -98,11 +277,10 @@ bool local_history::get_messages(const std::string& _contact, int64_t _from, int
 bool local_history::get_history_file(const std::string& _contact, /*out*/ core::tools::binary_stream& _history_archive
     , std::shared_ptr<int64_t> _offset, std::shared_ptr<int64_t> _remaining_size, int64_t& _cur_index, std::shared_ptr<int64_t> _mode)
 {
-    std::wstring contact_folder = core::tools::from_utf8(_contact);
-    std::replace(contact_folder.begin(), contact_folder.end(), L'|', L'_');
-    std::wstring file_name = archive_path_ + L'/' + contact_folder + L'/' + db_filename();
+    // the file is read directly, bypassing the contact storages
+    commit_pending_writes();
 
-    contact_archive::get_history_file(file_name, _history_archive, _offset, _remaining_size, _cur_index, _mode);
+    contact_archive::get_history_file(get_db_file_name(_contact), _history_archive, _offset, _remaining_size, _cur_index, _mode);
     return true;
 }
 
@@ -130,6 +308,9 @@ std::vector<dlg_state> local_history::get_dlg_states(const std::vector<std::stri
 
 void local_history::set_dlg_state(const std::string& _contact, const dlg_state& _state, Out dlg_state& _result, Out dlg_state_changes& _changes)
 {
+    // a new history patch version means the messages of the page may have been repaired
+    drop_prefetched_page(_contact);
+
     get_contact_archive(_contact)->set_dlg_state(_state, Out _changes);
 
     Out _result = get_contact_archive(_contact)->get_dlg_state();
@@ -138,6 +319,8 @@ void local_history::set_dlg_state(const std::string& _contact, const dlg_state&
 
 bool local_history::clear_dlg_state(const std::string& _contact)
 {
+    drop_prefetched_page(_contact);
+
     get_contact_archive(_contact)->clear_dlg_state();
 
     return true;
@@ -264,6 +447,8 @@ void local_history::delete_messages_up_to(const std::string& _contact, const int
         _contact % _id
     );
 
+    drop_prefetched_page(_contact);
+
     return get_contact_archive(_contact)->delete_messages_up_to(_id);
 }
 
@@ -324,7 +509,41 @@ void local_history::get_not_sent_messages(const std::string& _contact, /*out*/ s
 
 void local_history::optimize_contact_archive(const std::string& _contact)
 {
-    get_contact_archive(_contact)->optimize();
+    auto archive = get_contact_archive(_contact);
+
+    archive->optimize();
+
+    if (core::configuration::get_app_config().is_archive_compression_enabled_ && archive->need_compact())
+        compact_contact_archive(_contact, *archive);
+}
+
+void local_history::compact_contact_archive(const std::string& _contact, contact_archive& _archive)
+{
+    const auto file_name = get_db_file_name(_contact);
+    const auto size_before = core::tools::system::get_file_size(file_name);
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto compacted = _archive.compact();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    __INFO(
+        "archive",
+        "db compaction\n"
+        "    contact=<%1%>\n"
+        "    result=<%2%>\n"
+        "    size-before=<%3%>\n"
+        "    size-after=<%4%>\n"
+        "    duration=<%5%ms>",
+        _contact % logutils::yn(compacted) % size_before % core::tools::system::get_file_size(file_name) % elapsed.count());
+}
+
+std::wstring local_history::get_db_file_name(const std::string& _contact) const
+{
+    std::wstring contact_folder = core::tools::from_utf8(_contact);
+    std::replace(contact_folder.begin(), contact_folder.end(), L'|', L'_');
+
+    return archive_path_ + L'/' + contact_folder + L'/' + db_filename();
 }
 
 void local_history::add_mention(const std::string& _contact, std::shared_ptr<archive::history_message> _message)
@@ -337,7 +556,9 @@ void local_history::add_mention(const std::string& _contact, std::shared_ptr<arc
 
 face::face(const std::wstring& _archive_path)
     : history_cache_(std::make_shared<local_history>(_archive_path))
-    , thread_(std::make_shared<core::async_executer>())
+    , thread_(std::make_shared<core::async_executer>(1, "archive"))
+    , prefetch_generation_(std::make_shared<std::atomic<int64_t>>(0))
+    , queued_updates_(std::make_shared<std::atomic<int32_t>>(0))
 {
 }
 
@@ -353,11 +574,20 @@ std::shared_ptr<update_history_handler> face::update_history(const std::string&
     auto ids = std::make_shared<headers_list>();
     auto state = std::make_shared<dlg_state>();
     auto state_changes = std::make_shared<dlg_state_changes>();
+    auto queued_updates = queued_updates_;
+
+    ++(*queued_updates);
 
     thread_->run_async_function(
-        [history_cache, _data, _contact, ids, state, state_changes]
+        [history_cache, _data, _contact, ids, state, state_changes, queued_updates]
         {
+            const auto is_last_queued = (--(*queued_updates) == 0);
+
             history_cache->update_history(_contact, _data, Out *ids, Out *state, Out *state_changes);
+
+            if (is_last_queued)
+                history_cache->commit_pending_writes();
+
             return 0;
         }
     )->on_result_ =
@@ -494,13 +724,18 @@ std::shared_ptr<request_buddies_handler> face::get_messages(const std::string& _
     auto handler = std::make_shared<request_buddies_handler>();
     auto out_messages = std::make_shared<history_block>();
     std::weak_ptr<face> wr_this = shared_from_this();
+    const auto requested = std::chrono::steady_clock::now();
 
     thread_->run_async_function([_contact, out_messages, _from, _count_early, _count_later, history_cache]()->int32_t
     {
         return (history_cache->get_messages(_contact, _from, _count_early, _count_later, out_messages) ? 0 : -1);
 
-    })->on_result_ = [wr_this, handler, out_messages, _contact, history_cache](int32_t _error)
+    })->on_result_ = [wr_this, handler, out_messages, _contact, history_cache, requested](int32_t _error)
     {
+        // the queue of the archive thread, the read and the way back to the core thread
+        static auto& read_latency = metrics::get_histogram("archive/get_messages_us");
+        read_latency.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - requested).count());
+
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
             return;
@@ -518,6 +753,53 @@ std::shared_ptr<request_buddies_handler> face::get_messages(const std::string& _
     return handler;
 }
 
+std::shared_ptr<async_task_handlers> face::prefetch_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later)
+{
+    assert(!_contact.empty());
+
+    auto handler = std::make_shared<async_task_handlers>();
+    auto history_cache = history_cache_;
+    auto generation = prefetch_generation_;
+    const auto scheduled_generation = generation->load();
+
+    thread_->run_async_function([history_cache, generation, scheduled_generation, _contact, _from, _count_early, _count_later]()->int32_t
+    {
+        if (generation->load() != scheduled_generation)
+            return -1;
+
+        history_cache->prefetch_messages(_contact, _from, _count_early, _count_later);
+        return 0;
+
+    })->on_result_ = [handler](int32_t _error)
+    {
+        if (handler->on_result_)
+            handler->on_result_(_error);
+    };
+
+    return handler;
+}
+
+std::shared_ptr<async_task_handlers> face::contact_switched(const std::string& _contact)
+{
+    auto handler = std::make_shared<async_task_handlers>();
+    auto history_cache = history_cache_;
+
+    ++(*prefetch_generation_);
+
+    thread_->run_async_function([history_cache, _contact]()->int32_t
+    {
+        history_cache->drop_prefetched_pages(_contact);
+        return 0;
+
+    })->on_result_ = [handler](int32_t _error)
+    {
+        if (handler->on_result_)
+            handler->on_result_(_error);
+    };
+
+    return handler;
+}
+
 std::shared_ptr<request_history_file_handler> face::get_history_block(std::shared_ptr<contact_and_offsets> _contacts
                                                                      , std::shared_ptr<contact_and_msgs> _archive, std::shared_ptr<tools::binary_stream> _data)
 {
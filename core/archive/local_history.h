@@ -194,11 +194,55 @@ namespace core
 
         class local_history : public std::enable_shared_from_this<local_history>
         {
+            // next older page of a dialog, loaded ahead of the gui request
+            struct prefetched_page
+            {
+                int64_t from_;
+                int64_t count_early_;
+                int64_t count_later_;
+                history_block_sptr messages_;
+            };
+
+            struct prefetch_stats
+            {
+                int64_t issued_;
+                int64_t hits_;
+                int64_t misses_;
+                int64_t cancelled_;
+
+                prefetch_stats() : issued_(0), hits_(0), misses_(0), cancelled_(0) {}
+            };
+
+            struct group_commit_stats
+            {
+                int64_t updates_;
+                int64_t commits_;
+                int64_t appends_;
+                std::chrono::microseconds latency_;
+
+                group_commit_stats() : updates_(0), commits_(0), appends_(0), latency_(0) {}
+            };
+
             archives_map archives_;
             const std::wstring archive_path_;
             std::unique_ptr<not_sent_messages> not_sent_messages_;
 
+            std::unordered_map<std::string, prefetched_page> prefetched_pages_;
+            prefetch_stats prefetch_stats_;
+
+            // contacts with appends not written to disk yet
+            std::unordered_set<std::string> pending_commit_contacts_;
+            std::chrono::steady_clock::time_point pending_commit_since_;
+            group_commit_stats group_commit_stats_;
+
             std::shared_ptr<contact_archive> get_contact_archive(const std::string& _contact);
+            std::wstring get_db_file_name(const std::string& _contact) const;
+
+            void compact_contact_archive(const std::string& _contact, contact_archive& _archive);
+
+            bool load_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, /*out*/ std::shared_ptr<history_block> _messages);
+            bool take_prefetched_page(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, /*out*/ std::shared_ptr<history_block> _messages);
+            void drop_prefetched_page(const std::string& _contact);
 
             not_sent_messages& get_pending_messages();
 
@@ -209,11 +253,15 @@ namespace core
 
             void optimize_contact_archive(const std::string& _contact);
 
+            void commit_pending_writes();
+
             void get_images(const std::string& _contact, int64_t _from, int64_t _count, /*out*/ image_list& _images);
             bool repair_images(const std::string& _contact);
             void get_messages_index(const std::string& _contact, int64_t _from, int64_t _count, /*out*/ headers_list& _headers);
             void get_messages_buddies(const std::string& _contact, std::shared_ptr<archive::msgids_list> _ids, /*out*/ std::shared_ptr<history_block> _messages);
             bool get_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, /*out*/ std::shared_ptr<history_block> _messages);
+            void prefetch_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later);
+            void drop_prefetched_pages(const std::string& _except_contact);
             bool get_history_file(const std::string& _contact, /*out*/ core::tools::binary_stream& _history_archive
                 , std::shared_ptr<int64_t> _offset, std::shared_ptr<int64_t> _remaining_size, int64_t& _cur_index, std::shared_ptr<int64_t> _mode);
 
@@ -275,6 +323,12 @@ namespace core
             std::shared_ptr<local_history> history_cache_;
             std::shared_ptr<core::async_executer> thread_;
 
+            // bumped on every dialog switch, queued prefetches of the previous dialog are skipped
+            std::shared_ptr<std::atomic<int64_t>> prefetch_generation_;
+
+            // update_history tasks posted but not started, the last one of a burst commits the writes
+            std::shared_ptr<std::atomic<int32_t>> queued_updates_;
+
         public:
 
             explicit face(const std::wstring& _archive_path);
@@ -285,6 +339,8 @@ namespace core
             std::shared_ptr<request_headers_handler> get_messages_index(const std::string& _contact, int64_t _from, int64_t _count);
             std::shared_ptr<request_buddies_handler> get_messages_buddies(const std::string& _contact, std::shared_ptr<archive::msgids_list> _ids);
             std::shared_ptr<request_buddies_handler> get_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later);
+            std::shared_ptr<async_task_handlers> prefetch_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later);
+            std::shared_ptr<async_task_handlers> contact_switched(const std::string& _contact);
 
             std::shared_ptr<request_history_file_handler> get_history_block(std::shared_ptr<contact_and_offsets> _contacts
                 , std::shared_ptr<contact_and_msgs> _archive, std::shared_ptr<tools::binary_stream> _data);
@@ -11,6 +11,7 @@ using namespace archive;
 messages_data::messages_data(const std::wstring& _file_name)
     :	storage_(std::make_unique<storage>(_file_name))
 {
+    storage_->set_write_behind(true);
 }
 
 
@@ -163,16 +164,14 @@ void messages_data::search_in_archive(std::shared_ptr<contact_and_offsets> _cont
         auto _offset = (*_contacts_and_offsets)[contact_i].second;
         auto _contact = (*_archive)[contact_i].first;
 
-        int64_t begin_of_block;
-
-        while (storage::fast_read_data_block((*_data), current_pos, begin_of_block, end_pos))
+        auto search_in_message = [&top_ids, &messages_ids, &_cterm, &_contact, _min_id](tools::binary_stream& _stream, uint32_t _begin)
         {
-            _data->set_output(begin_of_block);
-            auto mess_id = history_message::get_id_field(*_data);
+            _stream.set_output(_begin);
+            auto mess_id = history_message::get_id_field(_stream);
 
             if ((mess_id != -1 && top_ids.count(mess_id) != 0) || mess_id == -1 || mess_id <= _min_id)
             {
-                continue;
+                return;
             }
 
             if (top_ids.size() > ::common::get_limit_search_results())
@@ -187,32 +186,32 @@ void messages_data::search_in_archive(std::shared_ptr<contact_and_offsets> _cont
                 }
                 else
                 {
-                    continue;
+                    return;
                 }
             }
 
             uint32_t text_length = 0;
 
-            _data->set_output(begin_of_block);
+            _stream.set_output(_begin);
 
-            if (history_message::is_sticker(*_data))
+            if (history_message::is_sticker(_stream))
             {
-                continue;
+                return;
             }
 
-            _data->set_output(begin_of_block);
+            _stream.set_output(_begin);
 
-            history_message::jump_to_text_field(*_data, text_length);
+            history_message::jump_to_text_field(_stream, text_length);
 
             if (!text_length)
             {
-                continue;
+                return;
             }
 
             char* pointer = nullptr;
-            if (_data->available())
+            if (_stream.available())
             {
-                pointer = _data->read_available();
+                pointer = _stream.read_available();
             }
 
             if (kmp_strstr(pointer, text_length, _cterm->coded_string, _cterm->prefix, _cterm->symbs, _cterm->symb_indexes) != -1)
@@ -226,6 +225,38 @@ void messages_data::search_in_archive(std::shared_ptr<contact_and_offsets> _cont
                 search_msg->contact = _contact;
                 messages_ids.push_back(std::move(search_msg));
             }
+        };
+
+        tools::binary_stream frame;
+        std::vector<char> frame_raw;
+        std::vector<uint32_t> frame_slots;
+
+        int64_t begin_of_block;
+
+        while (storage::fast_read_data_block((*_data), current_pos, begin_of_block, end_pos))
+        {
+            const auto block_size = _data->available();
+
+            if (!storage::is_frame_block(_data->get_data_for_write() + begin_of_block, block_size))
+            {
+                search_in_message(*_data, (uint32_t) begin_of_block);
+                continue;
+            }
+
+            // messages packed by the db compaction are searched in the inflated frame
+            if (!storage::unpack_frame_block(_data->get_data_for_write() + begin_of_block, block_size, frame_raw, frame_slots))
+                continue;
+
+            frame.reset();
+            frame.write(frame_raw.data(), (uint32_t) frame_raw.size());
+
+            uint32_t slot_begin = 0;
+            for (const auto slot_end : frame_slots)
+            {
+                frame.set_input(slot_end);
+                search_in_message(frame, slot_begin);
+                slot_begin = slot_end;
+            }
         }
 
         if (current_pos == (*_archive)[contact_i].second && !((*_archive)[contact_i].first.empty()))
@@ -278,6 +309,65 @@ history_block messages_data::get_message_modifications(const message_header& _he
     return modifications;
 }
 
+bool messages_data::has_pending_writes() const
+{
+    return storage_->has_pending();
+}
+
+bool messages_data::commit_pending_writes()
+{
+    return storage_->commit_pending();
+}
+
+bool messages_data::compact(const std::vector<int64_t>& _offsets, const std::wstring& _compacted_file_name, Out data_offsets_map& _remap)
+{
+    if (!storage_->commit_pending())
+        return false;
+
+    auto result = false;
+
+    {
+        storage compacted(_compacted_file_name);
+
+        archive::storage_mode mode;
+        mode.flags_.write_ = mode.flags_.truncate_ = true;
+        if (!compacted.open(mode))
+            return false;
+
+        auto p_compacted = &compacted;
+        core::tools::auto_scope lbc([p_compacted]{p_compacted->close();});
+
+        mode.value_ = 0;
+        mode.flags_.read_ = true;
+        if (!storage_->open(mode))
+            return false;
+
+        auto p_storage = storage_.get();
+        core::tools::auto_scope lb([p_storage]{p_storage->close();});
+
+        result = storage_->compact_to(compacted, _offsets, Out _remap);
+    }
+
+    if (!result || !tools::system::sync_file(_compacted_file_name))
+    {
+        tools::system::delete_file(_compacted_file_name);
+        _remap.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool messages_data::replace_file(const std::wstring& _file_name)
+{
+    if (!tools::system::move_file(_file_name, storage_->get_file_name()))
+        return false;
+
+    storage_->clear();
+
+    return true;
+}
+
 bool messages_data::update(const archive::history_block& _data)
 {
     auto p_storage = storage_.get();
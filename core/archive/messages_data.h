@@ -47,6 +47,11 @@ namespace core
             virtual ~messages_data();
 
             bool update(const history_block& _data);
+            bool has_pending_writes() const;
+            bool commit_pending_writes();
+            // writes the blocks at _offsets packed into frames to _compacted_file_name and syncs it
+            bool compact(const std::vector<int64_t>& _offsets, const std::wstring& _compacted_file_name, Out data_offsets_map& _remap);
+            bool replace_file(const std::wstring& _file_name);
             bool get_messages(headers_list& _headers, history_block& _messages) const;
 
             static void search_in_archive(std::shared_ptr<contact_and_offsets> _contacts, std::shared_ptr<coded_term> _cterm
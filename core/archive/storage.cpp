@@ -3,30 +3,167 @@
 #include "history_message.h"
 #include "../tools/system.h"
 
+#include <zlib.h>
+
 using namespace core;
 using namespace archive;
 
 const int32_t max_data_block_size = (1024 * 1024);
 
+namespace
+{
+    // frame block payload:
+    // magic        - uint32_t
+    // raw size     - uint32_t
+    // slots count  - uint32_t
+    // slot ends    - uint32_t[slots count], offsets inside the raw data
+    // zlib stream of the raw data (slots one after another)
+    const uint32_t frame_magic = 0x6d72667a; // "zfrm"
+
+    const uint32_t frame_raw_size = (64 * 1024);
+    const uint32_t frame_max_slot_size = (frame_raw_size / 2);
+    const uint32_t frame_max_slots = 0xffff;
+
+    // frame offset: flag | (file offset of the frame block << frame_slot_bits) | slot
+    const int64_t frame_offset_flag = (1ll << 62);
+    const int32_t frame_slot_bits = 16;
+    const int64_t frame_slot_mask = ((1ll << frame_slot_bits) - 1);
+
+    int64_t make_frame_offset(int64_t _frame_offset, uint32_t _slot)
+    {
+        assert(_frame_offset >= 0 && _frame_offset < (frame_offset_flag >> frame_slot_bits));
+        assert(_slot <= frame_max_slots);
+
+        return (frame_offset_flag | (_frame_offset << frame_slot_bits) | _slot);
+    }
+
+    int64_t get_frame_block_offset(int64_t _offset)
+    {
+        return ((_offset & ~frame_offset_flag) >> frame_slot_bits);
+    }
+
+    uint32_t get_frame_slot(int64_t _offset)
+    {
+        return (uint32_t)(_offset & frame_slot_mask);
+    }
+
+    class frame_builder
+    {
+        std::vector<char> raw_;
+        std::vector<uint32_t> slots_;
+        std::vector<int64_t> sources_;
+
+    public:
+
+        bool empty() const { return slots_.empty(); }
+
+        bool is_full() const
+        {
+            return (raw_.size() >= frame_raw_size || slots_.size() >= frame_max_slots);
+        }
+
+        void add(int64_t _source_offset, const char* _data, uint32_t _size)
+        {
+            raw_.insert(raw_.end(), _data, _data + _size);
+            slots_.push_back((uint32_t) raw_.size());
+            sources_.push_back(_source_offset);
+        }
+
+        bool flush(storage& _target, Out data_offsets_map& _remap)
+        {
+            if (empty())
+                return true;
+
+            const auto raw_size = (uLong) raw_.size();
+            auto compressed_size = compressBound(raw_size);
+
+            core::tools::binary_stream block;
+            block.write<uint32_t>(frame_magic);
+            block.write<uint32_t>((uint32_t) raw_size);
+            block.write<uint32_t>((uint32_t) slots_.size());
+            for (const auto slot_end : slots_)
+                block.write<uint32_t>(slot_end);
+
+            const auto header_size = block.available();
+
+            auto compressed = (Bytef*) block.alloc_buffer((uint32_t) compressed_size);
+            if (compress2(compressed, &compressed_size, (const Bytef*) raw_.data(), raw_size, Z_BEST_COMPRESSION) != Z_OK)
+                return false;
+
+            block.set_input(header_size + (uint32_t) compressed_size);
+
+            int64_t frame_offset = 0;
+            if (!_target.write_data_block(block, frame_offset))
+                return false;
+
+            for (uint32_t slot = 0; slot < sources_.size(); ++slot)
+                _remap[sources_[slot]] = make_frame_offset(frame_offset, slot);
+
+            raw_.clear();
+            slots_.clear();
+            sources_.clear();
+
+            return true;
+        }
+    };
+}
+
 storage::storage(const std::wstring& _file_name)
     :	file_name_(_file_name), last_error_(archive::error::ok)
+    ,	write_behind_(false)
+    ,	pending_opened_(false)
+    ,	pending_offset_(-1)
+    ,	frame_cache_offset_(-1)
 {
 }
 
 
 storage::~storage()
 {
+    commit_pending();
 }
 
 void storage::clear()
 {
-
+    frame_cache_offset_ = -1;
+    frame_cache_.clear();
+    frame_cache_slots_.clear();
 }
 
 bool storage::open(storage_mode _mode)
 {
     last_error_ = archive::error::ok;
 
+    if (pending_opened_)
+    {
+        assert(!"file stream already opened");
+        return false;
+    }
+
+    const auto is_append_only = (
+        _mode.flags_.write_ &&
+        _mode.flags_.append_ &&
+        !_mode.flags_.read_ &&
+        !_mode.flags_.truncate_);
+
+    if (write_behind_ && is_append_only)
+    {
+        if (pending_offset_ == -1)
+            pending_offset_ = (int64_t) core::tools::system::get_file_size(file_name_);
+
+        pending_opened_ = true;
+        return true;
+    }
+
+    // readers and rewriters must see everything appended so far
+    if (!commit_pending())
+        return false;
+
+    return open_file(_mode);
+}
+
+bool storage::open_file(storage_mode _mode)
+{
     if (active_file_stream_)
     {
         assert(!"file stream already opened");
@@ -51,6 +188,9 @@ bool storage::open(storage_mode _mode)
         }
     }
 
+    if (_mode.flags_.truncate_)
+        clear();
+
     std::ios_base::openmode open_mode = std::fstream::binary;
 
     if (_mode.flags_.read_)
@@ -83,6 +223,12 @@ bool storage::open(storage_mode _mode)
 
 void storage::close()
 {
+    if (pending_opened_)
+    {
+        pending_opened_ = false;
+        return;
+    }
+
     if (!active_file_stream_)
     {
         assert(!"file stream not opened");
@@ -93,8 +239,87 @@ void storage::close()
     active_file_stream_.reset();
 }
 
+void storage::set_write_behind(bool _enabled)
+{
+    if (!_enabled)
+        commit_pending();
+
+    write_behind_ = _enabled;
+}
+
+bool storage::has_pending() const
+{
+    return (pending_data_.available() != 0);
+}
+
+bool storage::commit_pending()
+{
+    if (!has_pending())
+        return true;
+
+    assert(!pending_opened_);
+
+    const auto size = pending_data_.available();
+    const auto output = (pending_data_.get_input() - size);
+
+    archive::storage_mode mode;
+    mode.flags_.write_ = mode.flags_.append_ = true;
+
+    auto result = open_file(mode);
+    if (result)
+    {
+        assert(active_file_stream_->tellp() == pending_offset_);
+
+        active_file_stream_->write(pending_data_.read(size), size);
+        active_file_stream_->flush();
+
+        result = active_file_stream_->good();
+
+        active_file_stream_->close();
+        active_file_stream_.reset();
+    }
+
+    if (!result)
+    {
+        // the buffered blocks stay for the next flush; a partly written tail is cut off,
+        // so they are appended at the offsets already handed out
+        if ((int64_t) core::tools::system::get_file_size(file_name_) > pending_offset_)
+        {
+            boost::system::error_code error;
+            boost::filesystem::resize_file(boost::filesystem::wpath(file_name_), (uintmax_t) pending_offset_, error);
+        }
+
+        pending_data_.set_output(output);
+
+        return false;
+    }
+
+    pending_data_.reset();
+    pending_offset_ = -1;
+
+    return true;
+}
+
 bool storage::write_data_block(core::tools::binary_stream& _data, int64_t& _offset)
 {
+    uint32_t data_size = _data.available();
+
+    if (pending_opened_)
+    {
+        _offset = pending_offset_ + pending_data_.available();
+
+        pending_data_.write<uint32_t>(data_size);
+        pending_data_.write<uint32_t>(data_size);
+
+        if (data_size)
+            pending_data_.write(_data.read(data_size), data_size);
+
+        pending_data_.write<uint32_t>(data_size);
+        pending_data_.write<uint32_t>(data_size);
+
+        return true;
+    }
+
     if (!active_file_stream_)
     {
         assert(!"file stream not opened");
@@ -103,8 +328,6 @@ bool storage::write_data_block(core::tools::binary_stream& _data, int64_t& _offs
 
     _offset = active_file_stream_->tellp();
 
-    uint32_t data_size = _data.available();
-
     active_file_stream_->write((const char*) &data_size, sizeof(data_size));
     active_file_stream_->write((const char*) &data_size, sizeof(data_size));
 
@@ -119,6 +342,9 @@ bool storage::write_data_block(core::tools::binary_stream& _data, int64_t& _offs
 
 bool storage::read_data_block(int64_t _offset, core::tools::binary_stream& _data)
 {
+    if (is_frame_offset(_offset))
+        return read_frame_slot(_offset, _data);
+
     if (_offset != -1)
         active_file_stream_->seekp(_offset);
 
@@ -227,3 +453,163 @@ bool storage::fast_read_data_block(core::tools::binary_stream& buffer, int64_t&
 
     return !is_small_file;
 }
+
+bool storage::is_frame_offset(int64_t _offset)
+{
+    return (_offset != -1 && (_offset & frame_offset_flag) != 0);
+}
+
+bool storage::is_frame_block(const char* _data, uint32_t _size)
+{
+    if (_size < 3 * sizeof(uint32_t))
+        return false;
+
+    uint32_t magic = 0;
+    memcpy(&magic, _data, sizeof(magic));
+
+    return (magic == frame_magic);
+}
+
+bool storage::unpack_frame_block(const char* _data, uint32_t _size, Out std::vector<char>& _raw, Out std::vector<uint32_t>& _slots)
+{
+    if (!is_frame_block(_data, _size))
+        return false;
+
+    uint32_t header[3];
+    memcpy(header, _data, sizeof(header));
+
+    const auto raw_size = header[1];
+    const auto slots_count = header[2];
+
+    const auto header_size = (uint64_t) sizeof(header) + (uint64_t) slots_count * sizeof(uint32_t);
+    if (raw_size > max_data_block_size || slots_count == 0 || header_size > _size)
+        return false;
+
+    _slots.resize(slots_count);
+    memcpy(_slots.data(), _data + sizeof(header), slots_count * sizeof(uint32_t));
+
+    if (_slots.back() != raw_size)
+        return false;
+
+    _raw.resize(raw_size);
+
+    auto inflated_size = (uLongf) raw_size;
+    if (uncompress((Bytef*) _raw.data(), &inflated_size, (const Bytef*) _data + header_size, (uLong)(_size - header_size)) != Z_OK ||
+        inflated_size != raw_size)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool storage::read_frame_slot(int64_t _offset, core::tools::binary_stream& _data)
+{
+    const auto frame_offset = get_frame_block_offset(_offset);
+
+    if (frame_offset != frame_cache_offset_)
+    {
+        clear();
+
+        core::tools::binary_stream frame;
+        if (!read_data_block(frame_offset, frame))
+            return false;
+
+        const auto size = frame.available();
+        if (size == 0 || !unpack_frame_block(frame.read(size), size, frame_cache_, frame_cache_slots_))
+        {
+            assert(!"invalid frame block");
+            clear();
+            return false;
+        }
+
+        frame_cache_offset_ = frame_offset;
+    }
+
+    const auto slot = get_frame_slot(_offset);
+    if (slot >= frame_cache_slots_.size())
+    {
+        assert(!"invalid frame slot");
+        return false;
+    }
+
+    const auto begin = (slot == 0 ? 0 : frame_cache_slots_[slot - 1]);
+    const auto end = frame_cache_slots_[slot];
+    if (begin > end)
+        return false;
+
+    _data.write(frame_cache_.data() + begin, end - begin);
+
+    return true;
+}
+
+bool storage::compact_to(storage& _target, const std::vector<int64_t>& _offsets, Out data_offsets_map& _remap)
+{
+    frame_builder builder;
+
+    // frames that are already full are moved as they are
+    data_offsets_map moved_frames;
+
+    core::tools::binary_stream block;
+
+    for (const auto offset : _offsets)
+    {
+        if (_remap.count(offset))
+            continue;
+
+        block.reset();
+
+        if (is_frame_offset(offset))
+        {
+            const auto frame_offset = get_frame_block_offset(offset);
+
+            auto iter_moved = moved_frames.find(frame_offset);
+            if (iter_moved != moved_frames.end())
+            {
+                _remap[offset] = make_frame_offset(iter_moved->second, get_frame_slot(offset));
+                continue;
+            }
+
+            if (!read_frame_slot(offset, block))
+                return false;
+
+            if (frame_cache_.size() >= frame_raw_size / 2)
+            {
+                core::tools::binary_stream frame;
+                if (!read_data_block(frame_offset, frame))
+                    return false;
+
+                int64_t new_frame_offset = 0;
+                if (!_target.write_data_block(frame, new_frame_offset))
+                    return false;
+
+                moved_frames[frame_offset] = new_frame_offset;
+                _remap[offset] = make_frame_offset(new_frame_offset, get_frame_slot(offset));
+                continue;
+            }
+        }
+        else if (!read_data_block(offset, block))
+        {
+            return false;
+        }
+
+        const auto size = block.available();
+
+        if (size >= frame_max_slot_size || size == 0)
+        {
+            int64_t new_offset = 0;
+            if (!_target.write_data_block(block, new_offset))
+                return false;
+
+            _remap[offset] = new_offset;
+            continue;
+        }
+
+        builder.add(offset, block.read(size), size);
+
+        if (builder.is_full() && !builder.flush(_target, _remap))
+            return false;
+    }
+
+    return builder.flush(_target, _remap);
+}
@@ -9,6 +9,8 @@ namespace core
 {
     namespace archive
     {
+        typedef std::map<int64_t, int64_t> data_offsets_map;
+
         class storage_data_block
         {
             core::tools::binary_stream	data_;
@@ -44,6 +46,21 @@ namespace core
 
             archive::error last_error_;
 
+            // write-behind: appends are kept in memory and reach the file with one append in commit_pending
+            bool write_behind_;
+            bool pending_opened_;
+            core::tools::binary_stream pending_data_;
+            int64_t pending_offset_;
+
+            // inflated payload of the last frame block read, random access hits the same frame in a row
+            int64_t frame_cache_offset_;
+            std::vector<char> frame_cache_;
+            std::vector<uint32_t> frame_cache_slots_;
+
+            bool open_file(storage_mode _mode);
+
+            bool read_frame_slot(int64_t _offset, core::tools::binary_stream& _data);
+
         public:
 
             void clear();
@@ -51,10 +68,23 @@ namespace core
             bool open(storage_mode _mode);
             void close();
 
+            void set_write_behind(bool _enabled);
+            bool has_pending() const;
+            bool commit_pending();
+
             bool write_data_block(core::tools::binary_stream& _data, int64_t& _offset);
             bool read_data_block(int64_t _offset, core::tools::binary_stream& _data);
             static bool fast_read_data_block(core::tools::binary_stream& buffer, int64_t& current_pos, int64_t& _begin, int64_t _end_position);
 
+            // frame blocks: zlib compressed groups of small blocks, addressed as (frame offset, slot)
+            static bool is_frame_offset(int64_t _offset);
+            static bool is_frame_block(const char* _data, uint32_t _size);
+            static bool unpack_frame_block(const char* _data, uint32_t _size, Out std::vector<char>& _raw, Out std::vector<uint32_t>& _slots);
+
+            // copies the blocks at _offsets into _target packing the small ones into frame blocks,
+            // both storages must be opened; _remap receives new offsets for every copied block
+            bool compact_to(storage& _target, const std::vector<int64_t>& _offsets, Out data_offsets_map& _remap);
+
             archive::error get_last_error() const { return last_error_; }
 
             const std::wstring& get_file_name() const { return file_name_; }
@@ -22,11 +22,11 @@ async_task::~async_task()
 //////////////////////////////////////////////////////////////////////////
 // async_executer
 //////////////////////////////////////////////////////////////////////////
-async_executer::async_executer(unsigned long _count)
+async_executer::async_executer(unsigned long _count, const std::string& _name)
     : threadpool((uint32_t)_count, []()
 {
     g_core->on_thread_finish();
-})
+}, _name)
 {
 
 }
@@ -67,7 +67,7 @@ namespace core
     class async_executer : core::tools::threadpool
     {
     public:
-        explicit async_executer(unsigned long _count = 1);
+        explicit async_executer(unsigned long _count = 1, const std::string& _name = "async");
         virtual ~async_executer();
 
         virtual std::shared_ptr<async_task_handlers> run_async_task(std::shared_ptr<async_task> task);
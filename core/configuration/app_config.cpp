@@ -22,6 +22,7 @@ app_config::app_config()
     , is_crash_enabled_(false)
     , full_log_(false)
     , unlock_context_menu_features_(false)
+    , is_archive_compression_enabled_(false)
 {
 
 }
@@ -31,12 +32,14 @@ app_config::app_config(
     const int32_t _forced_dpi,
     const bool _is_crash_enabled,
     const bool _full_log,
-    const bool _unlock_context_menu_features)
+    const bool _unlock_context_menu_features,
+    const bool _is_archive_compression_enabled)
     : is_server_history_enabled_(_is_server_history_enabled)
     , forced_dpi_(_forced_dpi)
     , is_crash_enabled_(_is_crash_enabled)
     , full_log_(_full_log)
     , unlock_context_menu_features_(_unlock_context_menu_features)
+    , is_archive_compression_enabled_(_is_archive_compression_enabled)
 {
     assert(valid_dpi_values().count(forced_dpi_) > 0);
 }
@@ -98,13 +101,15 @@ void load_app_config(const boost::filesystem::wpath &_path)
     const auto enable_crash = options.get<bool>("enable_crash", false);
     const auto full_log = options.get<bool>("fulllog", false);
     const auto unlock_context_menu_features = options.get<bool>("dev.unlock_context_menu_features", ::build::is_debug());
+    const auto compress_archive = options.get<bool>("history.compress_archive", false);
 
     config_ = std::make_unique<app_config>(
         !disable_server_history,
         forced_dpi,
         enable_crash,
         full_log,
-        unlock_context_menu_features);
+        unlock_context_menu_features,
+        compress_archive);
 }
 
 namespace
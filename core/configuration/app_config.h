@@ -13,7 +13,8 @@ struct app_config
         const int32_t _forced_dpi,
         const bool _is_crash_enabled,
         const bool _full_log,
-        const bool _unlock_context_menu_features);
+        const bool _unlock_context_menu_features,
+        const bool _is_archive_compression_enabled);
 
     void serialize(Out core::coll_helper &_collection) const;
 
@@ -26,6 +27,8 @@ struct app_config
     const bool full_log_;
 
     const bool unlock_context_menu_features_;
+
+    const bool is_archive_compression_enabled_;
 };
 
 const app_config& get_app_config();
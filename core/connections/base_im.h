@@ -158,6 +158,7 @@ namespace core
         virtual void get_archive_messages(int64_t _seq_, const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, bool _need_prefetch, bool _first_request, std::function<void(int64_t)> last_message_catcher) = 0;
         virtual void get_archive_index(int64_t _seq_, const std::string& _contact, int64_t _from, int64_t _count, std::function<void(int64_t)> last_message_catcher) = 0;
         virtual void get_archive_messages_buddies(int64_t _seq_, const std::string& _contact, std::shared_ptr<archive::msgids_list> _ids) = 0;
+        virtual void prefetch_archive_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later) = 0;
         virtual void set_last_read(const std::string& _contact, int64_t _message) = 0;
         virtual void hide_dlg_state(const std::string& _contact) = 0;
         virtual void delete_archive_messages(const int64_t _seq, const std::string &_contact_aimid, const std::vector<int64_t> &_ids, const bool _for_all) = 0;
@@ -212,6 +213,7 @@ namespace core
         virtual void spam_contact(int64_t _seq, const std::string& _aimid) = 0;
         virtual void ignore_contact(int64_t _seq, const std::string& _aimid, bool ignore) = 0;
         virtual void get_ignore_list(int64_t _seq) = 0;
+        virtual void get_contact_list(int64_t _seq) = 0;
         virtual void favorite(const std::string& _contact) = 0;
         virtual void unfavorite(const std::string& _contact) = 0;
         virtual void update_outgoing_msg_count(const std::string& _aimid, int _count) = 0;
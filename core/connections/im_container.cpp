@@ -55,6 +55,7 @@ im_container::im_container(const std::shared_ptr<voip_manager::VoipManager>& voi
     REGISTER_IM_MESSAGE("archive/index/get", on_get_archive_index);
     REGISTER_IM_MESSAGE("archive/buddies/get", on_get_archive_messages_buddies);
     REGISTER_IM_MESSAGE("archive/messages/get", on_get_archive_messages);
+    REGISTER_IM_MESSAGE("archive/messages/prefetch", on_prefetch_archive_messages);
     REGISTER_IM_MESSAGE("archive/messages/delete", on_delete_archive_messages);
     REGISTER_IM_MESSAGE("archive/messages/delete_from", on_delete_archive_messages_from);
 
@@ -98,6 +99,7 @@ im_container::im_container(const std::shared_ptr<voip_manager::VoipManager>& voi
     REGISTER_IM_MESSAGE("contacts/block", on_spam_contact);
     REGISTER_IM_MESSAGE("contacts/ignore", on_ignore_contact);
     REGISTER_IM_MESSAGE("contacts/get_ignore", on_get_ignore_contacts);
+    REGISTER_IM_MESSAGE("contactlist/get", on_get_contact_list);
     REGISTER_IM_MESSAGE("contact/switched", on_contact_switched);
     REGISTER_IM_MESSAGE("dlg_state/hide", on_hide_dlg_state);
     REGISTER_IM_MESSAGE("remove_members", on_remove_members);
@@ -194,16 +196,16 @@ std::string core::im_container::get_first_login() const
     return login.get_login();
 }
 
-void core::im_container::on_message_from_gui(const char * _message, int64_t _seq, coll_helper& _params)
+void core::im_container::on_message_from_gui(message_id _message, int64_t _seq, coll_helper& _params)
 {
-    auto iter_handler = messages_map_.find(_message);
-    if (iter_handler == messages_map_.end())
+    const auto handler = messages_map_.find(_message);
+    if (!handler)
     {
         assert(!"unknown message type");
         return;
     }
 
-    iter_handler->second(_seq, _params);
+    (*handler)(_seq, _params);
 }
 
 void core::im_container::fromInternalProxySettings2Voip(const core::proxy_settings& proxySettings, voip_manager::VoipProxySettings& voipProxySettings) {
@@ -582,6 +584,19 @@ void im_container::on_get_archive_messages(int64_t _seq, coll_helper& _params)
 		last_message_catcher);
 }
 
+void im_container::on_prefetch_archive_messages(int64_t _seq, coll_helper& _params)
+{
+    auto im = get_im(_params);
+    if (!im)
+        return;
+
+    im->prefetch_archive_messages(
+        _params.get_value_as_string("contact"),
+        _params.get_value_as_int64("from"),
+        _params.get_value_as_int64("count_early"),
+        _params.get_value_as_int64("count_later"));
+}
+
 void core::im_container::on_message_typing(int64_t _seq, coll_helper& _params)
 {
     auto im = get_im(_params);
@@ -1624,6 +1639,15 @@ void im_container::on_get_ignore_contacts(int64_t _seq, coll_helper& _params)
     im->get_ignore_list(_seq);
 }
 
+void im_container::on_get_contact_list(int64_t _seq, coll_helper& _params)
+{
+    auto im = get_im(_params);
+    if (!im)
+        return;
+
+    im->get_contact_list(_seq);
+}
+
 void im_container::on_favorite(int64_t _seq, core::coll_helper &_params)
 {
     auto im = get_im(_params);
@@ -4,6 +4,8 @@
 #pragma once
 #include <memory>
 
+#include "../../corelib/message_table.h"
+
 namespace voip_manager {
     struct VoipProxySettings;
     class VoipManager;
@@ -27,13 +29,13 @@ namespace core
     typedef std::function<void(int64_t, coll_helper&)> message_function;
 
     #define REGISTER_IM_MESSAGE(_message_string, _callback)                                             \
-        messages_map_.emplace(                                                                          \
+        messages_map_.add(                                                                              \
             _message_string,                                                                            \
             std::bind(&im_container::_callback, this, std::placeholders::_1, std::placeholders::_2));
 
     class im_container : public std::enable_shared_from_this<im_container>
     {
-        std::unordered_map<std::string, message_function> messages_map_;
+        message_table<message_function> messages_map_;
 
         std::unique_ptr<im_login_list> logins_;
         ims_list ims_;
@@ -67,6 +69,7 @@ namespace core
         void on_get_archive_index(int64_t _seq, coll_helper& _params);
         void on_get_archive_messages_buddies(int64_t _seq, coll_helper& _params);
         void on_get_archive_messages(int64_t _seq, coll_helper& _params);
+        void on_prefetch_archive_messages(int64_t _seq, coll_helper& _params);
         void on_delete_archive_messages(int64_t _seq, coll_helper& _params);
         void on_delete_archive_messages_from(int64_t _seq, coll_helper& _params);
         void on_add_opened_dialog(int64_t _seq, coll_helper& _params);
@@ -113,6 +116,7 @@ namespace core
         void on_speech_to_text(int64_t _seq, coll_helper& _params);
         void on_ignore_contact(int64_t _seq, coll_helper& _params);
         void on_get_ignore_contacts(int64_t _seq, coll_helper& _params);
+        void on_get_contact_list(int64_t _seq, coll_helper& _params);
         void on_favorite(int64_t _seq, coll_helper& _params);
         void on_unfavorite(int64_t _seq, coll_helper& _params);
 
@@ -169,7 +173,7 @@ namespace core
 
     public:
 
-        void on_message_from_gui(const char * _message, int64_t _seq, coll_helper& _params);
+        void on_message_from_gui(message_id _message, int64_t _seq, coll_helper& _params);
         std::shared_ptr<base_im> get_im_by_id(int32_t _id) const;
         bool update_login(im_login_id& _login);
         void replace_uin_in_login(im_login_id& old_login, im_login_id& new_login);
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+
+#include "dialog_holes.h"
+
+using namespace core;
+using namespace wim;
+using namespace holes;
+
+sync_queue::sync_queue(const int32_t _max_in_flight, const std::chrono::milliseconds _min_request_interval)
+    : max_in_flight_(_max_in_flight)
+    , min_request_interval_(_min_request_interval)
+    , in_flight_(0)
+    , dialogs_queued_(0)
+    , dialogs_completed_(0)
+    , requests_completed_(0)
+    , requests_failed_(0)
+{
+    assert(max_in_flight_ > 0);
+}
+
+bool sync_queue::add(const request& _request)
+{
+    assert(!_request.get_contact().empty());
+
+    if (!active_contacts_.insert(_request.get_contact()).second)
+        return false;
+
+    if (is_idle())
+    {
+        // a new sync round, progress is reported per round
+        started_time_ = std::chrono::steady_clock::now();
+
+        dialogs_queued_ = 0;
+        dialogs_completed_ = 0;
+        requests_completed_ = 0;
+        requests_failed_ = 0;
+    }
+
+    queue_.push_back(_request);
+
+    ++dialogs_queued_;
+
+    return true;
+}
+
+std::shared_ptr<request> sync_queue::get(Out std::chrono::milliseconds& _retry_in)
+{
+    _retry_in = std::chrono::milliseconds(0);
+
+    if (queue_.empty() || in_flight_ >= max_in_flight_)
+        return nullptr;
+
+    const auto now = std::chrono::steady_clock::now();
+
+    const auto since_last_request = (now - last_request_time_);
+    if (since_last_request < min_request_interval_)
+    {
+        _retry_in = std::chrono::duration_cast<std::chrono::milliseconds>(min_request_interval_ - since_last_request);
+        if (_retry_in.count() <= 0)
+            _retry_in = std::chrono::milliseconds(1);
+
+        return nullptr;
+    }
+
+    auto next = std::make_shared<request>(queue_.front());
+    queue_.pop_front();
+
+    last_request_time_ = now;
+    ++in_flight_;
+
+    return next;
+}
+
+void sync_queue::on_request_completed(const request& _request, const int32_t _error, const std::shared_ptr<request>& _next)
+{
+    assert(in_flight_ > 0);
+    assert(active_contacts_.count(_request.get_contact()));
+
+    --in_flight_;
+
+    ++requests_completed_;
+
+    if (_error != 0)
+        ++requests_failed_;
+
+    if (_next)
+    {
+        // continue the dialog ahead of the dialogs not started yet, so the started ones finish first
+        queue_.push_front(*_next);
+        return;
+    }
+
+    active_contacts_.erase(_request.get_contact());
+
+    ++dialogs_completed_;
+}
+
+bool sync_queue::is_idle() const
+{
+    return (queue_.empty() && in_flight_ == 0);
+}
+
+double sync_queue::get_requests_per_second() const
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_time_);
+    if (elapsed.count() <= 0)
+        return 0;
+
+    return ((double)requests_completed_ * 1000.0 / (double)elapsed.count());
+}
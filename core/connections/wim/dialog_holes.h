@@ -75,6 +75,49 @@ namespace core
                 }
 
             };
+
+            struct download_hole_handler
+            {
+                // _next is the continuation of the same dialog, empty when the dialog has no more holes
+                std::function<void(int32_t _error, std::shared_ptr<request> _next)> on_result_;
+            };
+
+            // background history sync across dialogs: one chain of hole requests per dialog,
+            // at most max_in_flight requests on the wire and a global request rate limit
+            class sync_queue
+            {
+                const int32_t max_in_flight_;
+                const std::chrono::milliseconds min_request_interval_;
+
+                std::deque<request> queue_;
+                std::set<std::string> active_contacts_;
+
+                int32_t in_flight_;
+                std::chrono::steady_clock::time_point last_request_time_;
+                std::chrono::steady_clock::time_point started_time_;
+
+                int64_t dialogs_queued_;
+                int64_t dialogs_completed_;
+                int64_t requests_completed_;
+                int64_t requests_failed_;
+
+            public:
+                sync_queue(const int32_t _max_in_flight, const std::chrono::milliseconds _min_request_interval);
+
+                bool add(const request& _request);
+
+                std::shared_ptr<request> get(Out std::chrono::milliseconds& _retry_in);
+
+                void on_request_completed(const request& _request, const int32_t _error, const std::shared_ptr<request>& _next);
+
+                bool is_idle() const;
+
+                int64_t get_dialogs_queued() const { return dialogs_queued_; }
+                int64_t get_dialogs_completed() const { return dialogs_completed_; }
+                int64_t get_requests_completed() const { return requests_completed_; }
+                int64_t get_requests_failed() const { return requests_failed_; }
+                double get_requests_per_second() const;
+            };
         }
     }
 }
@@ -69,7 +69,7 @@ int32_t fetch_event_presence::parse(const rapidjson::Value& _node_event_data)
         if (iter_capabilities != _node_event_data.MemberEnd() && iter_capabilities->value.IsArray())
         {
             for (auto iter = iter_capabilities->value.Begin(); iter != iter_capabilities->value.End(); ++iter)
-                presense_->capabilities_.insert(rapidjson_get_string(*iter));
+                presense_->add_capability(rapidjson_get_string(*iter));
         }
 
         auto iter_official = _node_event_data.FindMember("official");
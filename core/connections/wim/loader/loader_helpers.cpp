@@ -4,6 +4,7 @@
 #include "../../../tools/md5.h"
 
 #include "../wim_packet.h"
+#include "../signed_request_builder.h"
 
 #include "preview_proxy.h"
 
@@ -121,21 +122,25 @@ std::string sign_loader_uri(const std::string &_host, const wim_packet_params &_
 
     const time_t ts = (std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) - _params.time_offset_);
 
-    str_2_str_map p;
-    p["a"] = _params.a_token_;
-    p["k"] = _params.dev_id_;
-    p["ts"] = tools::from_int64(ts);
-    p["client"] = "icq";
+    // every preview and file of a chat is signed here, the loader threads reuse their builders
+    thread_local signed_request_builder builder;
+    builder.clear();
 
-    p.insert(_extra.begin(), _extra.end());
+    builder.set_param("a", _params.a_token_);
+    builder.set_param("k", _params.dev_id_);
+    builder.set_param("ts", (int64_t)ts);
+    builder.set_param("client", "icq");
 
-    const auto sha256 = wim_packet::escape_symbols(wim_packet::get_url_sign(_host, p, _params, false));
-    p["sig_sha256"] = sha256;
+    // the extra params do not override the common ones, as with the map insert
+    for (const auto& param : _extra)
+    {
+        if (param.first != "a" && param.first != "k" && param.first != "ts" && param.first != "client")
+            builder.set_param(param.first.c_str(), param.second);
+    }
 
-    std::stringstream ss_url;
-    ss_url << _host << '?' << wim_packet::format_get_params(p);
+    builder.sign(_host, _params.session_key_, false);
 
-    return ss_url.str();
+    return builder.get_url(_host);
 }
 
 namespace
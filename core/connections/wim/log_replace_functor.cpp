@@ -0,0 +1,149 @@
+#include "stdafx.h"
+
+#include "log_replace_functor.h"
+
+#include "wim_packet.h"
+#include "../../tools/aho_corasick.h"
+#include "../../tools/binary_stream.h"
+
+using namespace core;
+
+namespace
+{
+    std::shared_ptr<const tools::aho_corasick> get_markers_matcher(const std::vector<std::string>& _markers)
+    {
+        static std::mutex mutex;
+        static std::map<std::vector<std::string>, std::shared_ptr<const tools::aho_corasick>> matchers;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto& matcher = matchers[_markers];
+        if (!matcher)
+            matcher = std::make_shared<tools::aho_corasick>(_markers);
+
+        return matcher;
+    }
+
+    // something has to follow a marker to be masked
+    bool is_marker_at(const char* _data, const size_t _size, const size_t _pos, const std::string& _marker)
+    {
+        return (_size - _pos > _marker.size() && memcmp(_data + _pos, _marker.c_str(), _marker.size()) == 0);
+    }
+}
+
+void log_replace_functor::add_marker(const std::string& marker)
+{
+    markers_.push_back(marker + '=');
+}
+
+void log_replace_functor::add_json_marker(const std::string& marker)
+{
+    static std::string json_delimeter = "\":\"";
+    static std::string json_delimeter_with_space = "\": \"";
+    markers_json_.push_back(marker + json_delimeter);
+    markers_json_.push_back(marker + json_delimeter_with_space);
+
+    static std::string json_delimeter_escaped = wim::wim_packet::escape_symbols("\":\"");
+    markers_json_escaped_.push_back(marker + json_delimeter_escaped);
+}
+
+void log_replace_functor::operator()(tools::binary_stream& _bs)
+{
+    const auto sz = (size_t)_bs.available();
+    auto data = _bs.get_data();
+
+    if (sz < 2 || (markers_.empty() && markers_json_.empty()))
+        return;
+
+    if (!matcher_)
+    {
+        std::vector<std::string> all_markers(markers_);
+        all_markers.insert(all_markers.end(), markers_json_.begin(), markers_json_.end());
+        all_markers.insert(all_markers.end(), markers_json_escaped_.begin(), markers_json_escaped_.end());
+
+        matcher_ = get_markers_matcher(all_markers);
+    }
+
+    static const std::string json_value_end = "\"";
+    static const auto json_value_end_escaped = wim::wim_packet::escape_symbols("\"");
+
+    // a url marker wins over a json one at the same position; we have to check both escaped and not escaped json markers,
+    // because everything is possible
+    const auto find_marker = [this, data, sz](const size_t _pos, const std::string*& _value_end) -> const std::string*
+    {
+        for (const auto& m : markers_)
+        {
+            if (is_marker_at(data, sz, _pos, m))
+            {
+                _value_end = nullptr;
+                return &m;
+            }
+        }
+
+        for (const auto& m : markers_json_)
+        {
+            if (is_marker_at(data, sz, _pos, m))
+            {
+                _value_end = &json_value_end;
+                return &m;
+            }
+        }
+
+        for (const auto& m : markers_json_escaped_)
+        {
+            if (is_marker_at(data, sz, _pos, m))
+            {
+                _value_end = &json_value_end_escaped;
+                return &m;
+            }
+        }
+
+        return nullptr;
+    };
+
+    size_t i = 0;
+    while (i < sz - 1) // -1 because a marker has to be followed by its value
+    {
+        int32_t pattern = -1;
+        const auto match_end = i + matcher_->find(data + i, sz - 1 - i, pattern);
+        if (pattern == -1)
+            break;
+
+        // the automaton stops at the marker that ends first, the value is masked after the one that starts first,
+        // which starts at most the longest marker back
+        const auto match_start = match_end - matcher_->get_pattern(pattern).size();
+        const auto max_size = matcher_->get_max_pattern_size();
+
+        const std::string* marker = nullptr;
+        const std::string* value_end = nullptr;
+
+        auto pos = std::max(i, (match_end > max_size ? match_end - max_size : 0));
+        for (; pos <= match_start; ++pos)
+        {
+            marker = find_marker(pos, value_end);
+            if (marker)
+                break;
+        }
+
+        if (!marker)
+        {
+            assert(!"a marker is expected at the match");
+            i = match_end;
+            continue;
+        }
+
+        i = pos + marker->size();
+
+        if (!value_end)
+        {
+            for (; i < sz && data[i] != '&'; ++i)
+                data[i] = '*';
+        }
+        else
+        {
+            const auto end = std::search(data + i, data + sz, value_end->begin(), value_end->end());
+            std::fill(data + i, end, '*');
+            i = (size_t)(end - data);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef __LOG_REPLACE_FUNCTOR_H_
+#define __LOG_REPLACE_FUNCTOR_H_
+
+#pragma once
+
+namespace core
+{
+    namespace tools
+    {
+        class binary_stream;
+        class aho_corasick;
+    }
+}
+
+namespace core
+{
+    // masks the values of the given markers, such as aimsid=... or "authToken":"...", in the logged http data
+    class log_replace_functor
+    {
+        public:
+            void add_marker(const std::string& marker);
+            void add_json_marker(const std::string &marker);
+            void operator()(tools::binary_stream& _bs);
+
+        private:
+            std::vector<std::string> markers_;
+            std::vector<std::string> markers_json_;
+            std::vector<std::string> markers_json_escaped_;
+
+            // all the markers in one automaton, shared by the functors with the same markers
+            std::shared_ptr<const tools::aho_corasick> matcher_;
+    };
+}
+
+#endif //__LOG_REPLACE_FUNCTOR_H_
@@ -4,6 +4,7 @@
 #include <sstream>
 
 #include "../../../http_request.h"
+#include "../../../profiling/metrics.h"
 #include "../events/fetch_event.h"
 
 #include "../events/fetch_event_buddy_list.h"
@@ -101,8 +102,19 @@ int32_t fetch::execute_request(std::shared_ptr<core::http_request_simple> _reque
 
     execute_time_ = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
+    // the server holds the request up to timeout_ when there are no events
+    static auto& round_trip = metrics::get_histogram("fetch/round_trip_ms");
+    static auto& failures = metrics::get_counter("fetch/network_errors");
+
+    const auto sent = std::chrono::steady_clock::now();
+
     if (!_request->get(request_time_))
+    {
+        failures.add();
         return wpie_network_error;
+    }
+
+    round_trip.record(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sent).count());
 
     http_code_ = (uint32_t)_request->get_response_code();
 
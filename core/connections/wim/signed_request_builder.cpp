@@ -0,0 +1,145 @@
+#include "stdafx.h"
+
+#include "signed_request_builder.h"
+
+#include "../../tools/hmac_sha_base64.h"
+#include "../../tools/url.h"
+
+using namespace core;
+using namespace wim;
+
+signed_request_builder::signed_request_builder()
+    : params_count_(0)
+{
+}
+
+void signed_request_builder::clear()
+{
+    params_count_ = 0;
+}
+
+void signed_request_builder::set_param(const char* _name, const std::string& _value)
+{
+    get_value(_name).assign(_value);
+}
+
+void signed_request_builder::set_param(const char* _name, const int64_t _value)
+{
+    char buffer[24];
+    const auto size = snprintf(buffer, sizeof(buffer), "%lld", (long long)_value);
+
+    get_value(_name).assign(buffer, size);
+}
+
+void signed_request_builder::set_param_escaped(const char* _name, const std::string& _value)
+{
+    auto& value = get_value(_name);
+
+    value.clear();
+    tools::escape_url_symbols(_value.data(), _value.size(), value);
+}
+
+void signed_request_builder::sign(const std::string& _host, const std::string& _session_key, const bool _post_method)
+{
+    assert(!_session_key.empty());
+
+    remove_param("sig_sha256");
+
+    build_query();
+
+    hashed_.assign(_post_method ? "POST&" : "GET&");
+    tools::escape_url_symbols(_host.data(), _host.size(), hashed_);
+    hashed_ += '&';
+    tools::escape_url_symbols(query_.data(), query_.size(), hashed_);
+
+    tools::hmac_sha256 hmac(_session_key.data(), _session_key.size());
+    hmac.update(hashed_.data(), hashed_.size());
+
+    sign_.clear();
+    hmac.final_base64(sign_);
+
+    auto& value = get_value("sig_sha256");
+
+    value.clear();
+    tools::escape_url_symbols(sign_.data(), sign_.size(), value);
+}
+
+const std::string& signed_request_builder::get_url(const std::string& _host)
+{
+    build_query();
+
+    url_.assign(_host);
+    url_ += '?';
+    url_ += query_;
+
+    return url_;
+}
+
+const std::string& signed_request_builder::get_query()
+{
+    build_query();
+
+    return query_;
+}
+
+std::string& signed_request_builder::get_value(const char* _name)
+{
+    const auto end = params_.begin() + params_count_;
+
+    const auto it = std::lower_bound(params_.begin(), end, _name, [](const std::pair<std::string, std::string>& _param, const char* _name)
+    {
+        return (_param.first.compare(_name) < 0);
+    });
+
+    if (it != end && it->first == _name)
+        return it->second;
+
+    const auto index = (size_t)(it - params_.begin());
+
+    if (params_count_ == params_.size())
+        params_.emplace_back();
+
+    // the spare entry is moved into its place, the strings swap their buffers rather than copy
+    auto& spare = params_[params_count_];
+    spare.first.assign(_name);
+    spare.second.clear();
+
+    std::rotate(params_.begin() + index, params_.begin() + params_count_, params_.begin() + params_count_ + 1);
+
+    ++params_count_;
+
+    return params_[index].second;
+}
+
+void signed_request_builder::remove_param(const char* _name)
+{
+    const auto end = params_.begin() + params_count_;
+
+    const auto it = std::find_if(params_.begin(), end, [_name](const std::pair<std::string, std::string>& _param)
+    {
+        return (_param.first == _name);
+    });
+
+    if (it == end)
+        return;
+
+    // the entry goes behind the live ones and stays as a spare
+    std::rotate(it, it + 1, end);
+
+    --params_count_;
+}
+
+void signed_request_builder::build_query()
+{
+    query_.clear();
+
+    for (size_t i = 0; i < params_count_; ++i)
+    {
+        if (i != 0)
+            query_ += '&';
+
+        query_ += params_[i].first;
+        query_ += '=';
+        query_ += params_[i].second;
+    }
+}
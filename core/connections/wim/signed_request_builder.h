@@ -0,0 +1,64 @@
+#ifndef __SIGNED_REQUEST_BUILDER_H_
+#define __SIGNED_REQUEST_BUILDER_H_
+
+#pragma once
+
+namespace core
+{
+    namespace wim
+    {
+        // Builds the url of a signed wim/robusto request, the same as get_url_sign + format_get_params do.
+        // The params are kept sorted in a flat vector and every string keeps its capacity after clear(),
+        // so a builder reused by a thread signs requests without allocating once it has warmed up.
+        class signed_request_builder : boost::noncopyable
+        {
+        public:
+
+            signed_request_builder();
+
+            void clear();
+
+            // the value goes to the query as is
+            void set_param(const char* _name, const std::string& _value);
+
+            void set_param(const char* _name, const int64_t _value);
+
+            // the value is percent-encoded
+            void set_param_escaped(const char* _name, const std::string& _value);
+
+            // adds sig_sha256: the hmac-sha256 by the session key of "method&escaped host&escaped query",
+            // a sig_sha256 left from an earlier sign() is not hashed
+            void sign(const std::string& _host, const std::string& _session_key, const bool _post_method);
+
+            // host?query; valid until the builder is changed
+            const std::string& get_url(const std::string& _host);
+
+            const std::string& get_query();
+
+            size_t get_params_count() const { return params_count_; }
+
+        private:
+
+            std::string& get_value(const char* _name);
+
+            void remove_param(const char* _name);
+
+            void build_query();
+
+            // the live params are the first params_count_, the rest are kept for their buffers
+            std::vector<std::pair<std::string, std::string>> params_;
+
+            size_t params_count_;
+
+            std::string query_;
+
+            std::string hashed_;
+
+            std::string sign_;
+
+            std::string url_;
+        };
+    }
+}
+
+#endif //__SIGNED_REQUEST_BUILDER_H_
@@ -17,6 +17,13 @@ namespace
     {
         return first.find(second) != std::string::npos;
     }
+
+    void push_collection(iarray* _array, icollection* _coll, coll_helper& _value)
+    {
+        ifptr<ivalue> val(_coll->create_value());
+        val->set_as_collection(_value.get());
+        _array->push_back(val.get());
+    }
 }
 
 void cl_presence::serialize(icollection* _coll)
@@ -41,10 +48,38 @@ void cl_presence::serialize(icollection* _coll)
 }
 
 
+size_t cl_presence::get_hash() const
+{
+    size_t hash = 0;
+
+    const auto combine = [&hash](const size_t _value)
+    {
+        hash ^= _value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+
+    const std::hash<std::string> hash_string;
+
+    combine(hash_string(state_.str()));
+    combine(hash_string(usertype_.str()));
+    combine(hash_string(status_msg_));
+    combine(hash_string(other_number_));
+    combine(hash_string(sms_number_));
+    combine(hash_string(friendly_));
+    combine(hash_string(ab_contact_name_));
+    combine(hash_string(icon_id_));
+    combine(hash_string(big_icon_id_));
+    combine(hash_string(large_icon_id_));
+    combine(std::hash<int32_t>()(lastseen_));
+    combine(std::hash<int32_t>()(outgoing_msg_count_));
+    combine((is_chat_ ? 1 : 0) | (muted_ ? 2 : 0) | (is_live_chat_ ? 4 : 0) | (official_ ? 8 : 0));
+
+    return hash;
+}
+
 void cl_presence::serialize(rapidjson::Value& _node, rapidjson_allocator& _a)
 {
-    _node.AddMember("state",  state_, _a);
-    _node.AddMember("userType",  usertype_, _a);
+    _node.AddMember("state",  state_.str(), _a);
+    _node.AddMember("userType",  usertype_.str(), _a);
     _node.AddMember("statusMsg",  status_msg_, _a);
     _node.AddMember("otherNumber",  other_number_, _a);
     _node.AddMember("smsNumber", sms_number_, _a);
@@ -66,7 +101,7 @@ void cl_presence::serialize(rapidjson::Value& _node, rapidjson_allocator& _a)
         for (const auto& x : capabilities_)
         {
             rapidjson::Value capa;
-            capa.SetString(x, _a);
+            capa.SetString(x.str(), _a);
 
             node_capabilities.PushBack(std::move(capa), _a);
         }
@@ -77,8 +112,6 @@ void cl_presence::serialize(rapidjson::Value& _node, rapidjson_allocator& _a)
 
 void cl_presence::unserialize(const rapidjson::Value& _node)
 {
-    search_cache_.clear();
-
     const auto end = _node.MemberEnd();
 
     const auto iter_state = _node.FindMember("state");
@@ -128,7 +161,7 @@ void cl_presence::unserialize(const rapidjson::Value& _node)
     if (iter_capabilities != end && iter_capabilities->value.IsArray())
     {
         for (auto iter = iter_capabilities->value.Begin(), iter_end = iter_capabilities->value.End(); iter != iter_end; ++iter)
-            capabilities_.insert(rapidjson_get_string(*iter));
+            add_capability(rapidjson_get_string(*iter));
     }
 
     if (iter_mute != end)
@@ -159,9 +192,97 @@ void cl_presence::unserialize(const rapidjson::Value& _node)
         large_icon_id_ = rapidjson_get_string(iter_largeIconId->value);
 }
 
+void cl_presence::add_capability(const std::string& _capability)
+{
+    const tools::interned_string capability(_capability);
+
+    const auto iter = std::lower_bound(capabilities_.begin(), capabilities_.end(), capability);
+    if (iter == capabilities_.end() || *iter != capability)
+        capabilities_.insert(iter, capability);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// class search_texts
+//////////////////////////////////////////////////////////////////////////
+int32_t search_texts::get(cl_buddy& _buddy)
+{
+    if (_buddy.search_slot_ >= 0 && _buddy.search_slot_ < (int32_t) aimid_.size())
+        return _buddy.search_slot_;
+
+    int32_t slot = 0;
+    if (free_slots_.empty())
+    {
+        slot = (int32_t) aimid_.size();
+
+        aimid_.emplace_back();
+        friendly_.emplace_back();
+        ab_.emplace_back();
+        sms_number_.emplace_back();
+        friendly_words_.emplace_back();
+        ab_words_.emplace_back();
+    }
+    else
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    const auto& presence = *_buddy.presence_;
+
+    aimid_[slot] = tools::system::to_upper(_buddy.aimid_);
+    friendly_[slot] = tools::system::to_upper(presence.friendly_);
+    ab_[slot] = tools::system::to_upper(presence.ab_contact_name_);
+    sms_number_[slot] = presence.sms_number_;
+    friendly_words_[slot] = tools::get_words(friendly_[slot]);
+    ab_words_[slot] = tools::get_words(ab_[slot]);
+
+    _buddy.search_slot_ = slot;
+
+    return slot;
+}
+
+void search_texts::release(cl_buddy& _buddy)
+{
+    const auto slot = _buddy.search_slot_;
+    if (slot < 0 || slot >= (int32_t) aimid_.size())
+        return;
+
+    _buddy.search_slot_ = -1;
+
+    std::string().swap(aimid_[slot]);
+    std::string().swap(friendly_[slot]);
+    std::string().swap(ab_[slot]);
+    std::string().swap(sms_number_[slot]);
+    std::vector<std::string>().swap(friendly_words_[slot]);
+    std::vector<std::string>().swap(ab_words_[slot]);
+
+    free_slots_.push_back(slot);
+}
+
+void search_texts::clear()
+{
+    aimid_.clear();
+    friendly_.clear();
+    ab_.clear();
+    sms_number_.clear();
+    friendly_words_.clear();
+    ab_words_.clear();
+    free_slots_.clear();
+}
+
+void contactlist::reset_search_texts()
+{
+    for (auto& contact : contacts_index_)
+        contact.second->search_slot_ = -1;
+
+    search_texts_.clear();
+}
 
 void contactlist::update_cl(const contactlist& _cl)
 {
+    // the buddies get replaced, so do their search texts
+    reset_search_texts();
+
     groups_ = _cl.groups_;
 
     std::map<std::string, int32_t> out_counts;
@@ -217,7 +338,9 @@ void contactlist::update_presence(const std::string& _aimid, const std::shared_p
     if (_presence->friendly_ != contact_presence->friendly_ ||
         _presence->ab_contact_name_ != contact_presence->ab_contact_name_)
     {
-        contact_presence->search_cache_.clear();
+        const auto iter_buddy = contacts_index_.find(_aimid);
+        if (iter_buddy != contacts_index_.end())
+            search_texts_.release(*iter_buddy->second);
     }
 
     contact_presence->state_ = _presence->state_;
@@ -369,22 +492,14 @@ std::vector<std::string> core::wim::contactlist::search(const std::vector<std::v
             continue;
         }
 
-        if (iter->second->presence_->search_cache_.is_empty())
-        {
-            iter->second->presence_->search_cache_.aimid_ = tools::system::to_upper(iter->second->aimid_);
-            iter->second->presence_->search_cache_.friendly_ = tools::system::to_upper(iter->second->presence_->friendly_);
-            iter->second->presence_->search_cache_.ab_ = tools::system::to_upper(iter->second->presence_->ab_contact_name_);
-            iter->second->presence_->search_cache_.sms_number_ = iter->second->presence_->sms_number_;
-            iter->second->presence_->search_cache_.friendly_words_ = tools::get_words(iter->second->presence_->search_cache_.friendly_);
-            iter->second->presence_->search_cache_.ab_words_ = tools::get_words(iter->second->presence_->search_cache_.ab_);
-        }
+        const auto slot = search_texts_.get(*iter->second);
 
-        const auto& aimId = iter->second->presence_->search_cache_.aimid_;
-        const auto& friendly = iter->second->presence_->search_cache_.friendly_;
-        const auto& ab = iter->second->presence_->search_cache_.ab_;
-        const auto& number = iter->second->presence_->search_cache_.sms_number_;
-        const auto& friendly_words = iter->second->presence_->search_cache_.friendly_words_;
-        const auto& ab_words = iter->second->presence_->search_cache_.ab_words_;
+        const auto& aimId = search_texts_.aimid(slot);
+        const auto& friendly = search_texts_.friendly(slot);
+        const auto& ab = search_texts_.ab(slot);
+        const auto& number = search_texts_.sms_number(slot);
+        const auto& friendly_words = search_texts_.friendly_words(slot);
+        const auto& ab_words = search_texts_.ab_words(slot);
 
         auto check = [this, &result_cache, &result](std::map< std::string, std::shared_ptr<cl_buddy> >::const_iterator iter,
                                                        const std::vector<std::vector<std::string>>& search_patterns,
@@ -567,6 +682,10 @@ std::vector<std::string> core::wim::contactlist::search(const std::string& searc
     {
         if (last_search_patterns_.empty() || base_word.find(last_search_patterns_.c_str()) == std::string::npos || last_search_patterns_[last_search_patterns_.length() - 1] == ' ' || need_update_search_cache_)
         {
+            // the buddies have been replaced, their texts get built again on the way
+            if (need_update_search_cache_)
+                reset_search_texts();
+
             tmp_cache_ = contacts_index_;
             set_need_update_cache(false);
             search_cache_.clear();
@@ -599,22 +718,14 @@ std::vector<std::string> core::wim::contactlist::search(const std::string& searc
             continue;
         }
 
-        if (iter->second->presence_->search_cache_.is_empty())
-        {
-            iter->second->presence_->search_cache_.aimid_ = tools::system::to_upper(iter->second->aimid_);
-            iter->second->presence_->search_cache_.friendly_ = tools::system::to_upper(iter->second->presence_->friendly_);
-            iter->second->presence_->search_cache_.ab_ = tools::system::to_upper(iter->second->presence_->ab_contact_name_);
-            iter->second->presence_->search_cache_.sms_number_ = iter->second->presence_->sms_number_;
-            iter->second->presence_->search_cache_.friendly_words_ = tools::get_words(iter->second->presence_->search_cache_.friendly_);
-            iter->second->presence_->search_cache_.ab_words_ = tools::get_words(iter->second->presence_->search_cache_.ab_);
-        }
+        const auto slot = search_texts_.get(*iter->second);
 
-        const auto& aimId = iter->second->presence_->search_cache_.aimid_;
-        const auto& friendly = iter->second->presence_->search_cache_.friendly_;
-        const auto& ab = iter->second->presence_->search_cache_.ab_;
-        const auto& number = iter->second->presence_->search_cache_.sms_number_;
-        const auto& friendly_words = iter->second->presence_->search_cache_.friendly_words_;
-        const auto& ab_words = iter->second->presence_->search_cache_.ab_words_;
+        const auto& aimId = search_texts_.aimid(slot);
+        const auto& friendly = search_texts_.friendly(slot);
+        const auto& ab = search_texts_.ab(slot);
+        const auto& number = search_texts_.sms_number(slot);
+        const auto& friendly_words = search_texts_.friendly_words(slot);
+        const auto& ab_words = search_texts_.ab_words(slot);
 
         auto check = [this, &result_cache, &result, search_priority](std::map< std::string, std::shared_ptr<cl_buddy> >::const_iterator iter,
             const std::string& search_pattern,
@@ -1106,7 +1217,12 @@ void contactlist::merge_from_diff(const std::string& _type, const std::shared_pt
         {
             if (c.second.count == 1)
             {
-                contacts_index_.erase(c.first);
+                const auto iter_buddy = contacts_index_.find(c.first);
+                if (iter_buddy != contacts_index_.end())
+                {
+                    search_texts_.release(*iter_buddy->second);
+                    contacts_index_.erase(iter_buddy);
+                }
                 removedContacts->push_back(c.first);
             }
         }
@@ -1194,3 +1310,167 @@ void contactlist::set_need_update_cache(bool _need_update_search_cache)
 {
     need_update_search_cache_ = _need_update_search_cache;
 }
+
+//////////////////////////////////////////////////////////////////////////
+// class contactlist_gui_state
+//////////////////////////////////////////////////////////////////////////
+contactlist_gui_state::contactlist_gui_state()
+    : revision_(0)
+    , pass_(0)
+    , sent_(false)
+{
+}
+
+void contactlist_gui_state::serialize_full(const contactlist& _cl, icollection* _coll)
+{
+    _cl.serialize(_coll, std::string());
+
+    ++pass_;
+
+    buddies_.clear();
+    groups_.clear();
+
+    for (const auto& group : _cl.get_groups())
+    {
+        groups_[group->id_] = group->name_;
+
+        for (const auto& buddy : group->buddies_)
+        {
+            if (_cl.is_ignored(buddy->aimid_))
+                continue;
+
+            auto& sent = buddies_[buddy->aimid_];
+            sent.group_id_ = group->id_;
+            sent.presence_hash_ = buddy->presence_->get_hash();
+            sent.pass_ = pass_;
+        }
+    }
+
+    sent_ = true;
+
+    coll_helper cl(_coll, false);
+    cl.set_value_as_int64("revision", ++revision_);
+}
+
+bool contactlist_gui_state::serialize_delta(const contactlist& _cl, icollection* _coll)
+{
+    assert(sent_);
+
+    const auto pass = ++pass_;
+
+    ifptr<iarray> groups_array(_coll->create_array());
+    ifptr<iarray> added_array(_coll->create_array());
+    ifptr<iarray> changed_array(_coll->create_array());
+    ifptr<iarray> removed_array(_coll->create_array());
+    ifptr<iarray> removed_groups_array(_coll->create_array());
+
+    std::set<uint32_t> groups;
+
+    for (const auto& group : _cl.get_groups())
+    {
+        groups.insert(group->id_);
+
+        const auto iter_group = groups_.find(group->id_);
+        if (iter_group == groups_.end() || iter_group->second != group->name_)
+        {
+            groups_[group->id_] = group->name_;
+
+            coll_helper group_coll(_coll->create_collection(), true);
+            group_coll.set_value_as_int("group_id", group->id_);
+            group_coll.set_value_as_string("group_name", group->name_);
+            push_collection(groups_array.get(), _coll, group_coll);
+        }
+
+        for (const auto& buddy : group->buddies_)
+        {
+            if (_cl.is_ignored(buddy->aimid_))
+                continue;
+
+            auto iter_sent = buddies_.find(buddy->aimid_);
+            if (iter_sent == buddies_.end())
+            {
+                coll_helper contact_coll(_coll->create_collection(), true);
+                contact_coll.set_value_as_string("aimId", buddy->aimid_);
+                contact_coll.set_value_as_int("group_id", group->id_);
+                buddy->presence_->serialize(contact_coll.get());
+                push_collection(added_array.get(), _coll, contact_coll);
+
+                iter_sent = buddies_.emplace(buddy->aimid_, sent_buddy()).first;
+            }
+            else
+            {
+                // the same buddy in one more group
+                if (iter_sent->second.pass_ == pass)
+                    continue;
+
+                const auto presence_hash = buddy->presence_->get_hash();
+                const auto presence_changed = iter_sent->second.presence_hash_ != presence_hash;
+                const auto group_changed = iter_sent->second.group_id_ != group->id_;
+
+                if (!presence_changed && !group_changed)
+                {
+                    iter_sent->second.pass_ = pass;
+                    continue;
+                }
+
+                // the sent fields are not kept, so a changed buddy goes with the whole presence
+                coll_helper contact_coll(_coll->create_collection(), true);
+                contact_coll.set_value_as_string("aimId", buddy->aimid_);
+                if (presence_changed)
+                    buddy->presence_->serialize(contact_coll.get());
+                if (group_changed)
+                    contact_coll.set_value_as_int("group_id", group->id_);
+                push_collection(changed_array.get(), _coll, contact_coll);
+            }
+
+            auto& sent = iter_sent->second;
+            sent.group_id_ = group->id_;
+            sent.presence_hash_ = buddy->presence_->get_hash();
+            sent.pass_ = pass;
+        }
+    }
+
+    for (auto iter = groups_.begin(); iter != groups_.end();)
+    {
+        if (groups.find(iter->first) != groups.end())
+        {
+            ++iter;
+            continue;
+        }
+
+        ifptr<ivalue> val(_coll->create_value());
+        val->set_as_int(iter->first);
+        removed_groups_array->push_back(val.get());
+
+        iter = groups_.erase(iter);
+    }
+
+    for (auto iter = buddies_.begin(); iter != buddies_.end();)
+    {
+        if (iter->second.pass_ == pass)
+        {
+            ++iter;
+            continue;
+        }
+
+        ifptr<ivalue> val(_coll->create_value());
+        val->set_as_string(iter->first.c_str(), (int32_t) iter->first.length());
+        removed_array->push_back(val.get());
+
+        iter = buddies_.erase(iter);
+    }
+
+    if (groups_array->empty() && added_array->empty() && changed_array->empty() && removed_array->empty() && removed_groups_array->empty())
+        return false;
+
+    coll_helper cl(_coll, false);
+    cl.set_value_as_int64("base_revision", revision_);
+    cl.set_value_as_int64("revision", ++revision_);
+    cl.set_value_as_array("groups", groups_array.get());
+    cl.set_value_as_array("added", added_array.get());
+    cl.set_value_as_array("changed", changed_array.get());
+    cl.set_value_as_array("removed", removed_array.get());
+    cl.set_value_as_array("removed_groups", removed_groups_array.get());
+
+    return true;
+}
@@ -3,7 +3,7 @@
 
 #pragma once
 
-
+#include "../../tools/string_pool.h"
 
 namespace core
 {
@@ -18,12 +18,14 @@ namespace core
 
         struct cl_presence
         {
-            std::string state_;
-            std::string usertype_;
+            // a few distinct values across the whole roster, so pooled
+            tools::interned_string state_;
+            tools::interned_string usertype_;
             std::string status_msg_;
             std::string other_number_;
             std::string sms_number_;
-            std::set<std::string> capabilities_;
+            // sorted, without duplicates
+            std::vector<tools::interned_string> capabilities_;
             std::string ab_contact_name_;
             std::string friendly_;
             int32_t lastseen_;
@@ -36,21 +38,6 @@ namespace core
             std::string big_icon_id_;
             std::string large_icon_id_;
 
-            struct search_cache
-            {
-                std::string aimid_;
-                std::string friendly_;
-                std::string ab_;
-                std::string sms_number_;
-
-                std::vector<std::string> friendly_words_;
-                std::vector<std::string> ab_words_;
-
-                bool is_empty() const { return aimid_.empty(); }
-                void clear() { aimid_.clear(); friendly_.clear(); ab_.clear(); sms_number_.clear();  }
-
-            } search_cache_;
-
             cl_presence()
                 : lastseen_(-1), outgoing_msg_count_(0), is_chat_(false), muted_(false), is_live_chat_(false), official_(false)
             {
@@ -59,6 +46,11 @@ namespace core
             void serialize(icollection* _coll);
             void serialize(rapidjson::Value& _node, rapidjson_allocator& _a);
             void unserialize(const rapidjson::Value& _node);
+
+            void add_capability(const std::string& _capability);
+
+            // over the fields the gui gets, to see a change without keeping a copy
+            size_t get_hash() const;
         };
 
         struct cl_buddy
@@ -66,8 +58,10 @@ namespace core
             uint32_t id_;
             std::string aimid_;
             std::shared_ptr<cl_presence> presence_;
+            // row in contactlist::search_texts, -1 until the first search
+            int32_t search_slot_;
 
-            cl_buddy() : id_(0), presence_(new cl_presence()) {}
+            cl_buddy() : id_(0), presence_(new cl_presence()), search_slot_(-1) {}
         };
 
 
@@ -84,6 +78,40 @@ namespace core
 
         typedef std::unordered_set<std::string> ignorelist_cache;
 
+        //////////////////////////////////////////////////////////////////////////
+        // search_texts: upper-cased names and their words the search matches against,
+        // kept column-wise for the searched buddies only instead of in every presence
+        //////////////////////////////////////////////////////////////////////////
+        class search_texts
+        {
+            std::vector<std::string> aimid_;
+            std::vector<std::string> friendly_;
+            std::vector<std::string> ab_;
+            std::vector<std::string> sms_number_;
+            std::vector<std::vector<std::string>> friendly_words_;
+            std::vector<std::vector<std::string>> ab_words_;
+
+            std::vector<int32_t> free_slots_;
+
+        public:
+
+            // the slot of the buddy, built from its presence if it has none
+            int32_t get(cl_buddy& _buddy);
+            void release(cl_buddy& _buddy);
+
+            // forgets all the slots; the buddies of the list must be released first
+            void clear();
+
+            size_t size() const { return aimid_.size() - free_slots_.size(); }
+
+            const std::string& aimid(int32_t _slot) const { return aimid_[_slot]; }
+            const std::string& friendly(int32_t _slot) const { return friendly_[_slot]; }
+            const std::string& ab(int32_t _slot) const { return ab_[_slot]; }
+            const std::string& sms_number(int32_t _slot) const { return sms_number_[_slot]; }
+            const std::vector<std::string>& friendly_words(int32_t _slot) const { return friendly_words_[_slot]; }
+            const std::vector<std::string>& ab_words(int32_t _slot) const { return ab_words_[_slot]; }
+        };
+
         class contactlist
         {
         public:
@@ -104,6 +132,9 @@ namespace core
 
             ignorelist_cache ignorelist_;
 
+            search_texts search_texts_;
+            void reset_search_texts();
+
         public:
 
             // TODO : make it private
@@ -157,8 +188,43 @@ namespace core
             void set_outgoing_msg_count(const std::string& _contact, int32_t _count);
 
             std::shared_ptr<cl_group> get_first_group() const;
+            const std::list<std::shared_ptr<cl_group>>& get_groups() const { return groups_; }
             bool is_ignored(const std::string& _aimid) const;
         };
+
+        //////////////////////////////////////////////////////////////////////////
+        // contactlist_gui_state: what the gui has got of the contact list,
+        // so an update carries only the difference
+        //////////////////////////////////////////////////////////////////////////
+        class contactlist_gui_state
+        {
+            struct sent_buddy
+            {
+                uint32_t group_id_;
+                size_t presence_hash_;
+                uint64_t pass_;
+            };
+
+            int64_t revision_;
+            uint64_t pass_;
+            bool sent_;
+
+            std::unordered_map<std::string, sent_buddy> buddies_;
+            std::map<uint32_t, std::string> groups_;
+
+        public:
+
+            contactlist_gui_state();
+
+            int64_t get_revision() const { return revision_; }
+            bool is_sent() const { return sent_; }
+
+            // the whole list, with a new revision
+            void serialize_full(const contactlist& _cl, icollection* _coll);
+
+            // added, changed and removed since the last serialize, false if nothing has changed
+            bool serialize_delta(const contactlist& _cl, icollection* _coll);
+        };
     }
 }
 
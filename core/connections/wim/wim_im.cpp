@@ -129,6 +129,7 @@
 #include "../../configuration/hosts_config.h"
 
 #include "../../log/log.h"
+#include "../../profiling/profiler.h"
 
 #include "../../configuration/app_config.h"
 #include "../../../common.shared/url_parser/url_parser.h"
@@ -166,6 +167,24 @@ namespace
 
     const auto dlg_state_agregate_start_timeout = std::chrono::minutes(3);
     const auto dlg_state_agregate_period = std::chrono::seconds(60);
+
+    const int32_t holes_sync_max_in_flight = 4;
+    const auto holes_sync_min_request_interval = std::chrono::milliseconds(100);
+    const int64_t holes_sync_progress_period = 50;
+
+    // the last few server pages of a dialog, the older history is fetched once the dialog is opened
+    const int64_t holes_sync_depth = (3 * archive::history_block_size);
+
+    // the join of the cached snapshots loaded at login:
+    // the contact list, the favorites, the mailboxes, my info and the active dialogs
+    struct cached_objects_barrier
+    {
+        int32_t pending_ = 5;
+
+        bool contact_list_ = false;
+        bool my_info_ = false;
+        bool active_dialogs_ = false;
+    };
 }
 
 void write_offset_in_log(time_t offset)
@@ -376,6 +395,7 @@ std::shared_ptr<async_task_handlers> remove_messages_from_not_sent(
     const std::shared_ptr<archive::history_block>& _intro_messages);
 
 const auto search_threads_count = 3;
+const auto cached_objects_threads_count = 4;
 const auto sending_search_results_interval = std::chrono::milliseconds(500);
 
 //////////////////////////////////////////////////////////////////////////
@@ -385,6 +405,7 @@ im::im(const im_login_id& _login, std::shared_ptr<voip_manager::VoipManager> _vo
     : base_im(_login, _voip_manager),
     stop_objects_(std::make_shared<stop_objects>()),
     contact_list_(std::make_shared<contactlist>()),
+    contact_list_gui_state_(std::make_shared<contactlist_gui_state>()),
     active_dialogs_(std::make_shared<active_dialogs>()),
     my_info_cache_(std::make_shared<my_info_cache>()),
     favorites_(std::make_shared<favorites>()),
@@ -394,7 +415,7 @@ im::im(const im_login_id& _login, std::shared_ptr<voip_manager::VoipManager> _vo
     fetch_params_(std::make_shared<fetch_parameters>()),
     wim_send_thread_(std::make_shared<wim_send_thread>()),
     fetch_thread_(std::make_shared<fetch_thread>()),
-    async_tasks_(std::make_shared<async_executer>()),
+    async_tasks_(std::make_shared<async_executer>(1, "im")),
     robusto_threads_(std::make_shared<robusto_thread>()),
 
     store_timer_id_(0),
@@ -403,9 +424,12 @@ im::im(const im_login_id& _login, std::shared_ptr<voip_manager::VoipManager> _vo
     dlg_state_timer_(0),
     im_created_(false),
     failed_holes_requests_(std::make_shared<holes::failed_requests>()),
+    holes_sync_queue_(std::make_shared<holes::sync_queue>(holes_sync_max_in_flight, holes_sync_min_request_interval)),
+    holes_sync_timer_(empty_timer_id),
+    holes_sync_seeded_(false),
     sent_pending_messages_active_(false),
     imstat_(std::make_unique<statistic::imstat>()),
-    history_searcher_(std::make_shared<async_executer>(search_threads_count)),
+    history_searcher_(std::make_shared<async_executer>(search_threads_count, "history_search")),
     start_session_time_(std::chrono::system_clock::now() - std::chrono::milliseconds(start_session_timeout)),
     prefetch_uid_(std::numeric_limits<int64_t>::max()),
     post_messages_timer_(-1),
@@ -427,6 +451,9 @@ im::~im()
     stop_waiters();
     stop_stat_timer();
     stop_hosts_config_timer();
+
+    if (holes_sync_timer_ != empty_timer_id && g_core)
+        g_core->stop_timer(holes_sync_timer_);
 }
 
 void im::schedule_store_timer()
@@ -949,7 +976,7 @@ void im::store_fetch_parameters()
     });
 }
 
-std::shared_ptr<async_task_handlers> im::load_active_dialogs()
+std::shared_ptr<async_task_handlers> im::load_active_dialogs(async_executer& _executer)
 {
     auto handler = std::make_shared<async_task_handlers>();
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
@@ -957,8 +984,10 @@ std::shared_ptr<async_task_handlers> im::load_active_dialogs()
     const std::wstring active_dialogs_file = get_active_dilaogs_file_name();
     auto active_dlgs = std::make_shared<active_dialogs>();
 
-    async_tasks_->run_async_function([active_dialogs_file, active_dlgs]
+    _executer.run_async_function([active_dialogs_file, active_dlgs]
     {
+        profiler::auto_stop_watch watch("startup/load_active_dialogs");
+
         core::tools::binary_stream bstream;
         if (!bstream.load_from_file(active_dialogs_file))
             return -1;
@@ -993,7 +1022,7 @@ std::shared_ptr<async_task_handlers> im::load_active_dialogs()
     return handler;
 }
 
-std::shared_ptr<async_task_handlers> im::load_contact_list()
+std::shared_ptr<async_task_handlers> im::load_contact_list(async_executer& _executer)
 {
     auto handler = std::make_shared<async_task_handlers>();
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
@@ -1001,8 +1030,10 @@ std::shared_ptr<async_task_handlers> im::load_contact_list()
     const std::wstring contact_list_file = get_contactlist_file_name();
     auto contact_list = std::make_shared<contactlist>();
 
-    async_tasks_->run_async_function([contact_list_file, contact_list]
+    _executer.run_async_function([contact_list_file, contact_list]
     {
+        profiler::auto_stop_watch watch("startup/load_contact_list");
+
         core::tools::binary_stream bstream;
         if (!bstream.load_from_file(contact_list_file))
             return -1;
@@ -1034,7 +1065,7 @@ std::shared_ptr<async_task_handlers> im::load_contact_list()
     return handler;
 }
 
-std::shared_ptr<async_task_handlers> im::load_favorites()
+std::shared_ptr<async_task_handlers> im::load_favorites(async_executer& _executer)
 {
     auto handler = std::make_shared<async_task_handlers>();
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
@@ -1042,8 +1073,10 @@ std::shared_ptr<async_task_handlers> im::load_favorites()
     const std::wstring favorites_file = get_favorites_file_name();
     auto fvrts = std::make_shared<favorites>();
 
-    async_tasks_->run_async_function([favorites_file, fvrts]
+    _executer.run_async_function([favorites_file, fvrts]
     {
+        profiler::auto_stop_watch watch("startup/load_favorites");
+
         core::tools::binary_stream bstream;
         if (!bstream.load_from_file(favorites_file))
             return -1;
@@ -1087,7 +1120,7 @@ std::shared_ptr<async_task_handlers> im::load_favorites()
 
 }
 
-std::shared_ptr<async_task_handlers> im::load_mailboxes()
+std::shared_ptr<async_task_handlers> im::load_mailboxes(async_executer& _executer)
 {
     auto handler = std::make_shared<async_task_handlers>();
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
@@ -1095,8 +1128,10 @@ std::shared_ptr<async_task_handlers> im::load_mailboxes()
     const std::wstring mailboxes_file = get_mailboxes_file_name();
     auto mailboxes = std::make_shared<mailbox_storage>();
 
-    async_tasks_->run_async_function([mailboxes_file, mailboxes]
+    _executer.run_async_function([mailboxes_file, mailboxes]
     {
+        profiler::auto_stop_watch watch("startup/load_mailboxes");
+
         return mailboxes->load(mailboxes_file);
     })->on_result_ = [wr_this, mailboxes, handler](int32_t _error)
     {
@@ -1120,15 +1155,17 @@ std::shared_ptr<async_task_handlers> im::load_mailboxes()
     return handler;
 }
 
-std::shared_ptr<async_task_handlers> im::load_my_info()
+std::shared_ptr<async_task_handlers> im::load_my_info(async_executer& _executer)
 {
     auto handler = std::make_shared<async_task_handlers>();
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
 
     const auto file_name = get_my_info_file_name();
 
-    async_tasks_->run_async_function([wr_this, file_name]
+    _executer.run_async_function([wr_this, file_name]
     {
+        profiler::auto_stop_watch watch("startup/load_my_info");
+
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
             return 1;
@@ -1297,7 +1334,7 @@ void post_sticker_fail_2_gui(int64_t _seq, int32_t _set_id, int32_t _sticker_id,
 }
 
 
-void post_sticker_2_gui(int64_t _seq, int32_t _set_id, int32_t _sticker_id, core::sticker_size _size, tools::binary_stream& _data)
+void post_sticker_2_gui(int64_t _seq, int32_t _set_id, int32_t _sticker_id, core::sticker_size _size, const stickers::image_data& _data)
 {
     assert(_size > sticker_size::min);
     assert(_size < sticker_size::max);
@@ -1309,16 +1346,14 @@ void post_sticker_2_gui(int64_t _seq, int32_t _set_id, int32_t _sticker_id, core
     coll.set_value_as_int("error", 0);
 
     const auto write_data =
-        [&coll](tools::binary_stream &_data, const char *id)
+        [&coll](const stickers::image_data &_data, const char *id)
     {
-        if (_data.available() == 0)
+        if (_data.empty())
         {
             return;
         }
 
-        ifptr<istream> sticker_data(coll->create_stream(), true);
-        const auto data_size = _data.available();
-        sticker_data->write((const uint8_t*)_data.read(data_size), data_size);
+        ifptr<istream> sticker_data(_data.create_stream(), true);
 
         coll.set_value_as_stream(id, sticker_data.get());
     };
@@ -1347,23 +1382,19 @@ void post_sticker_2_gui(int64_t _seq, int32_t _set_id, int32_t _sticker_id, core
     g_core->post_message_to_gui("stickers/sticker/get/result", _seq, coll.get());
 }
 
-void post_set_icon_2_gui(int64_t _seq, int32_t _set_id, tools::binary_stream& _data)
+void post_set_icon_2_gui(int64_t _seq, int32_t _set_id, const stickers::image_data& _data)
 {
     coll_helper coll(g_core->create_collection(), true);
 
     coll.set_value_as_int("set_id", _set_id);
     coll.set_value_as_int("error", 0);
 
-    if (_data.available() == 0)
+    if (_data.empty())
     {
         return;
     }
 
-    ifptr<istream> icon_data(coll->create_stream(), true);
-
-    const auto data_size = _data.available();
-
-    icon_data->write((const uint8_t*)_data.read(data_size), data_size);
+    ifptr<istream> icon_data(_data.create_stream(), true);
 
     coll.set_value_as_stream("icon", icon_data.get());
 
@@ -1454,71 +1485,94 @@ void im::load_cached_objects()
         return;
     }
 
-    load_contact_list()->on_result_ = [wr_this, call_on_exit](int32_t _error)
+    // the snapshots are independent files, so they are parsed at once and posted to the gui as each one comes;
+    // the favorites wait for the contact list, they are checked against the ignore list
+    cached_objects_loader_ = std::make_shared<async_executer>(cached_objects_threads_count);
+
+    auto barrier = std::make_shared<cached_objects_barrier>();
+
+    const auto load_span = profiler::process_started("startup/cached_objects");
+
+    const std::function<void()> on_loaded = [wr_this, barrier, call_on_exit, load_span]
     {
+        if (--barrier->pending_ > 0)
+            return;
+
+        profiler::process_stopped(load_span);
+
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
             return;
 
-        if (_error != 0)
+        ptr_this->cached_objects_loader_.reset();
+
+        if (!barrier->contact_list_ || !barrier->my_info_ || !barrier->active_dialogs_)
             return;
 
-        ptr_this->load_mailboxes()->on_result_ = [wr_this, call_on_exit](int32_t _error)
+        call_on_exit->set_success();
+
+        auto avatar_size = g_core->get_core_gui_settings().recents_avatars_size_;
+
+        ptr_this->active_dialogs_->enumerate([wr_this, avatar_size](const active_dialog& _dlg)
         {
             auto ptr_this = wr_this.lock();
             if (!ptr_this)
                 return;
 
-            ptr_this->load_my_info()->on_result_ = [wr_this, call_on_exit](int32_t _error)
+            const auto &dlg_aimid = _dlg.get_aimid();
+
+            if (!ptr_this->contact_list_->is_ignored(dlg_aimid))
             {
-                auto ptr_this = wr_this.lock();
-                if (!ptr_this)
-                    return;
+                if (avatar_size > 0)
+                    ptr_this->get_contact_avatar(-1, _dlg.get_aimid(), avatar_size, false);
 
-                if (_error != 0)
-                    return;
+                ptr_this->post_dlg_state_to_gui(dlg_aimid);
+            }
+        });
 
-                ptr_this->load_favorites()->on_result_ = [wr_this, call_on_exit](int32_t _error)
-                {
-                    auto ptr_this = wr_this.lock();
-                    if (!ptr_this)
-                        return;
+        ptr_this->post_ignorelist_to_gui(0);
 
-                    ptr_this->load_active_dialogs()->on_result_ = [wr_this, call_on_exit](int32_t _error)
-                    {
-                        auto ptr_this = wr_this.lock();
-                        if (!ptr_this)
-                            return;
+        profiler::startup_phase("recents");
+    };
 
-                        if (_error == 0)
-                        {
-                            call_on_exit->set_success();
+    load_contact_list(*cached_objects_loader_)->on_result_ = [wr_this, barrier, on_loaded](int32_t _error)
+    {
+        barrier->contact_list_ = (_error == 0);
+
+        auto ptr_this = wr_this.lock();
+        if (ptr_this && barrier->contact_list_)
+        {
+            ptr_this->load_favorites(*ptr_this->cached_objects_loader_)->on_result_ = [on_loaded](int32_t _error)
+            {
+                on_loaded();
+            };
+        }
+        else
+        {
+            // no favorites without the contact list
+            --barrier->pending_;
+        }
 
-                            auto avatar_size = g_core->get_core_gui_settings().recents_avatars_size_;
+        on_loaded();
+    };
 
-                            ptr_this->active_dialogs_->enumerate([wr_this, avatar_size](const active_dialog& _dlg)
-                            {
-                                auto ptr_this = wr_this.lock();
-                                if (!ptr_this)
-                                    return;
+    load_mailboxes(*cached_objects_loader_)->on_result_ = [on_loaded](int32_t _error)
+    {
+        on_loaded();
+    };
 
-                                const auto &dlg_aimid = _dlg.get_aimid();
+    load_my_info(*cached_objects_loader_)->on_result_ = [barrier, on_loaded](int32_t _error)
+    {
+        barrier->my_info_ = (_error == 0);
 
-                                if (!ptr_this->contact_list_->is_ignored(dlg_aimid))
-                                {
-                                    if (avatar_size > 0)
-                                        ptr_this->get_contact_avatar(-1, _dlg.get_aimid(), avatar_size, false);
+        on_loaded();
+    };
 
-                                    ptr_this->post_dlg_state_to_gui(dlg_aimid);
-                                }
-                            });
+    load_active_dialogs(*cached_objects_loader_)->on_result_ = [barrier, on_loaded](int32_t _error)
+    {
+        barrier->active_dialogs_ = (_error == 0);
 
-                            ptr_this->post_ignorelist_to_gui(0);
-                        }
-                    };
-                };
-            };
-        };
+        on_loaded();
     };
 }
 
@@ -1770,13 +1824,13 @@ void im::get_set_icon_big(const int64_t _seq, const int32_t _set_id)
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
 
     get_stickers()->get_set_icon_big(_seq, _set_id)->on_result_ =
-        [_seq, _set_id, wr_this](tools::binary_stream& _icon_data)
+        [_seq, _set_id, wr_this](const stickers::image_data& _icon_data)
     {
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
             return;
 
-        if (_icon_data.available())
+        if (!_icon_data.empty())
         {
             post_set_icon_2_gui(_seq, _set_id, _icon_data);
 
@@ -1844,7 +1898,7 @@ void im::download_stickers(const bool _recursive)
                         // big icon
                         if (sticker_id == -1)
                         {
-                            ptr_this->get_stickers()->get_set_icon_big(0, set_id)->on_result_ = [_requests, set_id](tools::binary_stream& _data)
+                            ptr_this->get_stickers()->get_set_icon_big(0, set_id)->on_result_ = [_requests, set_id](const stickers::image_data& _data)
                             {
                                 for (auto seq : _requests)
                                     post_set_icon_2_gui(seq, set_id, _data);
@@ -1856,7 +1910,7 @@ void im::download_stickers(const bool _recursive)
                                 0,
                                 set_id,
                                 sticker_id,
-                                sz)->on_result_ = [_requests, set_id, sticker_id, sz](tools::binary_stream& _data)
+                                sz)->on_result_ = [_requests, set_id, sticker_id, sz](const stickers::image_data& _data)
                             {
                                 for (auto seq : _requests)
                                     post_sticker_2_gui(seq, set_id, sticker_id, sz, _data);
@@ -1885,13 +1939,13 @@ void im::get_sticker(const int64_t _seq, const int32_t _set_id, const int32_t _s
     std::weak_ptr<core::wim::im> wr_this = shared_from_this();
 
     get_stickers()->get_sticker(_seq, _set_id, _sticker_id, _size)->on_result_ =
-        [_seq, _set_id, _sticker_id, _size, wr_this](tools::binary_stream& _sticker_data)
+        [_seq, _set_id, _sticker_id, _size, wr_this](const stickers::image_data& _sticker_data)
     {
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
             return;
 
-        if (_sticker_data.available())
+        if (!_sticker_data.empty())
         {
             post_sticker_2_gui(_seq, _set_id, _sticker_id, _size, _sticker_data);
 
@@ -2446,7 +2500,7 @@ void im::start_session(bool _is_ping)
                 return;
             }
 
-            ptr_this->load_favorites()->on_result_ = [wr_this](int32_t _error)
+            ptr_this->load_favorites(*ptr_this->async_tasks_)->on_result_ = [wr_this](int32_t _error)
             {
                 auto ptr_this = wr_this.lock();
                 if (!ptr_this)
@@ -2716,6 +2770,8 @@ void im::poll(bool _is_first, poll_reason _reason, int32_t _failed_network_error
                     g_core->post_message_to_gui("login/complete", 0, nullptr);
 
                     ptr_this->send_timezone();
+
+                    ptr_this->seed_holes_sync();
                 }
             });
         }
@@ -3154,10 +3210,22 @@ std::string im::get_contact_friendly_name(const std::string& contact_login) {
 void im::post_contact_list_to_gui()
 {
     ifptr<icollection> cl_coll(g_core->create_collection(), true);
-    contact_list_->serialize(cl_coll.get(), std::string());
+
+    if (contact_list_gui_state_->is_sent())
+    {
+        // cl_load is counted for the whole list only, not for each server diff
+        if (contact_list_gui_state_->serialize_delta(*contact_list_, cl_coll.get()))
+            g_core->post_message_to_gui("contactlist/delta", 0, cl_coll.get());
+
+        return;
+    }
+
+    contact_list_gui_state_->serialize_full(*contact_list_, cl_coll.get());
 
     g_core->post_message_to_gui("contactlist", 0, cl_coll.get());
 
+    profiler::startup_phase("roster");
+
     core::stats::event_props_type props;
 
     int32_t group_count = contact_list_->get_groupchat_contacts_count();
@@ -3233,7 +3301,7 @@ void im::on_event_buddies_list(fetch_event_buddy_list* _event, std::shared_ptr<a
             };
 
             if (ptr_this->contact_list_->contacts_index_.empty())
-                ptr_this->load_contact_list()->on_result_ = update_cl;
+                ptr_this->load_contact_list(*ptr_this->async_tasks_)->on_result_ = update_cl;
             else
                 update_cl(0);
         };
@@ -3258,9 +3326,6 @@ void im::on_event_diff(fetch_event_diff* _event, std::shared_ptr<auto_callback>
             ptr_this->contact_list_->merge_from_diff(iter.first, iter.second, removed);
             ptr_this->need_update_search_cache();
 
-            if (iter.first == "deleted" && removed->empty())
-                continue;
-
             for (const auto& contact : *removed)
             {
                 ptr_this->active_dialogs_->remove(contact);
@@ -3273,12 +3338,11 @@ void im::on_event_diff(fetch_event_diff* _event, std::shared_ptr<auto_callback>
                     g_core->post_message_to_gui("active_dialogs_hide", 0, cl_coll.get());
                 };
             }
-
-            ifptr<icollection> cl_coll(g_core->create_collection(), true);
-            iter.second->serialize(cl_coll.get(), iter.first);
-            g_core->post_message_to_gui("contactlist/diff", 0, cl_coll.get());
         }
 
+        // one delta against what the gui already has, for all the diffs
+        ptr_this->post_contact_list_to_gui();
+
         on_created_groupchat(diff);
 
         _on_complete->callback(_error);
@@ -3764,10 +3828,15 @@ void im::get_archive_messages(int64_t _seq, const std::string& _contact, int64_t
 
     add_opened_dialog(_contact);
 
+    // opening a dialog, up to the first page read from the local history
+    const auto open_span = ((_first_request && _recursion == 0) ? profiler::process_started("dialog/open") : -1);
+
     get_archive_messages_get_messages(_seq, _contact, _from, _count_early, _count_later, _recursion, _need_prefetch, _first_request, last_message_catcher)->on_result_ =
-        [_seq, wr_this, _contact, _recursion, _from, _count_early, _count_later, _first_request, last_message_catcher]
+        [_seq, wr_this, _contact, _recursion, _from, _count_early, _count_later, _first_request, last_message_catcher, open_span]
         (int32_t _error)
         {
+            profiler::process_stopped(open_span);
+
             auto ptr_this = wr_this.lock();
             if (!ptr_this)
             {
@@ -3910,6 +3979,15 @@ void im::get_archive_messages(int64_t _seq, const std::string& _contact, int64_t
 	get_archive_messages(_seq, _contact, _from, _count_early, _count_later, 0, _need_prefetch, _first_request, last_message_catcher);
 }
 
+void im::prefetch_archive_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later)
+{
+    assert(!_contact.empty());
+
+    // the gui asks for it once the viewport is a few items from the oldest loaded message,
+    // that is after the pages it shows have been delivered, so it does not delay them on the archive thread
+    get_archive()->prefetch_messages(_contact, _from, _count_early, _count_later);
+}
+
 void im::get_archive_messages_buddies(int64_t _seq, const std::string& _contact, std::shared_ptr<archive::msgids_list> _ids)
 {
     __LOG(core::log::info("archive", boost::format("get messages buddies, contact=%1% messages count=%2%") % _contact % _ids->size());)
@@ -4153,10 +4231,39 @@ void im::download_holes(const std::string& _contact, int64_t _from, int64_t _dep
 
     std::weak_ptr<im> wr_this = shared_from_this();
 
+    download_hole(_contact, _from, _depth, _recursion, last_message_catcher)->on_result_ =
+        [wr_this, last_message_catcher](int32_t _error, std::shared_ptr<holes::request> _next)
+        {
+            auto ptr_this = wr_this.lock();
+            if (!ptr_this)
+                return;
+
+            if (!_next)
+                return;
+
+            ptr_this->download_holes(_next->get_contact(), _next->get_from(), _next->get_depth(), _next->get_recursion(), last_message_catcher);
+        };
+}
+
+std::shared_ptr<holes::download_hole_handler> im::download_hole(const std::string& _contact, int64_t _from, int64_t _depth, int32_t _recursion, std::function<void(int64_t)> last_message_catcher)
+{
+    auto out_handler = std::make_shared<holes::download_hole_handler>();
+    auto out_error = std::make_shared<int32_t>(0);
+    auto out_next = std::make_shared<std::shared_ptr<holes::request>>();
+
+    // fires once the whole chain below is released, whichever branch it left by
+    const auto auto_handler = std::make_shared<tools::auto_scope>([out_handler, out_error, out_next]
+    {
+        if (out_handler->on_result_)
+            out_handler->on_result_(*out_error, *out_next);
+    });
+
+    std::weak_ptr<im> wr_this = shared_from_this();
+
     holes::request hole_request(_contact, _from, _depth, _recursion);
 
     get_archive()->get_next_hole(_contact, _from, _depth)->on_result =
-    	[wr_this, _contact, _depth, _recursion, hole_request, last_message_catcher](std::shared_ptr<archive::archive_hole> _hole)
+    	[wr_this, _contact, _depth, _recursion, hole_request, last_message_catcher, auto_handler, out_error, out_next](std::shared_ptr<archive::archive_hole> _hole)
     {
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
@@ -4177,7 +4284,7 @@ void im::download_holes(const std::string& _contact, int64_t _from, int64_t _dep
             return;
         }
 
-        ptr_this->get_archive()->get_dlg_state(_contact)->on_result = [wr_this, _hole, _contact, _depth, _recursion, hole_request, last_message_catcher](const archive::dlg_state& _state)
+        ptr_this->get_archive()->get_dlg_state(_contact)->on_result = [wr_this, _hole, _contact, _depth, _recursion, hole_request, last_message_catcher, auto_handler, out_error, out_next](const archive::dlg_state& _state)
         {
             auto ptr_this = wr_this.lock();
             if (!ptr_this)
@@ -4226,23 +4333,19 @@ void im::download_holes(const std::string& _contact, int64_t _from, int64_t _dep
                     return;
             }
 
-            ptr_this->get_history_from_server(hist_params, last_message_catcher)->on_result_ = [wr_this, _contact, _hole, depth_tail, _recursion, hole_request, count, last_message_catcher](int32_t _error)
+            ptr_this->get_history_from_server(hist_params, last_message_catcher)->on_result_ = [wr_this, _contact, _hole, depth_tail, _recursion, hole_request, count, auto_handler, out_error, out_next](int32_t _error)
             {
                 auto ptr_this = wr_this.lock();
                 if (!ptr_this)
                     return;
 
+                *out_error = _error;
+
                 if (_error == 0)
                 {
-                    ptr_this->get_archive()->validate_hole_request(_contact, *_hole, count)->on_result = [wr_this, _contact, depth_tail, _recursion, last_message_catcher](int64_t _from)
+                    ptr_this->get_archive()->validate_hole_request(_contact, *_hole, count)->on_result = [_contact, depth_tail, _recursion, auto_handler, out_next](int64_t _from)
                     {
-                        auto ptr_this = wr_this.lock();
-                        if (!ptr_this)
-                            return;
-
-                        ptr_this->download_holes(_contact, _from, depth_tail, (_recursion + 1), last_message_catcher);
-
-                        return;
+                        *out_next = std::make_shared<holes::request>(_contact, _from, depth_tail, (_recursion + 1));
 
                     }; // validate_hole_request
                 }
@@ -4258,6 +4361,124 @@ void im::download_holes(const std::string& _contact, int64_t _from, int64_t _dep
         }; // get_dlg_state
 
     }; // get_next_hole
+
+    return out_handler;
+}
+
+void im::sync_holes_in_background(const std::string& _contact, int64_t _from)
+{
+    assert(!_contact.empty());
+
+    if (!core::configuration::get_app_config().is_server_history_enabled_)
+    {
+        return;
+    }
+
+    if (!holes_sync_queue_->add(holes::request(_contact, _from, holes_sync_depth, 0)))
+    {
+        return;
+    }
+
+    run_holes_sync();
+}
+
+void im::seed_holes_sync()
+{
+    if (holes_sync_seeded_)
+    {
+        return;
+    }
+
+    holes_sync_seeded_ = true;
+
+    // the dialogs idle since the archive was lost (a reinstall or a cold archive) get no events to sync them,
+    // so every known dialog is queued once per session, the most recent ones first
+    std::weak_ptr<im> wr_this = shared_from_this();
+
+    active_dialogs_->enumerate([wr_this](const active_dialog& _dlg)
+    {
+        auto ptr_this = wr_this.lock();
+        if (!ptr_this)
+            return;
+
+        const auto aimid = _dlg.get_aimid();
+
+        // opened dialogs fetch their holes directly
+        if (ptr_this->has_opened_dialogs(aimid))
+            return;
+
+        ptr_this->get_archive()->get_dlg_state(aimid)->on_result = [wr_this, aimid](const archive::dlg_state& _state)
+        {
+            auto ptr_this = wr_this.lock();
+            if (!ptr_this)
+                return;
+
+            if (_state.get_last_msgid() > 0)
+                ptr_this->sync_holes_in_background(aimid, _state.get_last_msgid());
+        };
+    });
+}
+
+void im::run_holes_sync()
+{
+    if (holes_sync_timer_ != empty_timer_id)
+    {
+        g_core->stop_timer(holes_sync_timer_);
+
+        holes_sync_timer_ = empty_timer_id;
+    }
+
+    std::weak_ptr<im> wr_this = shared_from_this();
+
+    std::chrono::milliseconds retry_in(0);
+
+    while (auto request = holes_sync_queue_->get(Out retry_in))
+    {
+        download_hole(request->get_contact(), request->get_from(), request->get_depth(), request->get_recursion(), [](int64_t){})->on_result_ =
+            [wr_this, request](int32_t _error, std::shared_ptr<holes::request> _next)
+            {
+                auto ptr_this = wr_this.lock();
+                if (!ptr_this)
+                    return;
+
+                auto &queue = *ptr_this->holes_sync_queue_;
+
+                queue.on_request_completed(*request, _error, _next);
+
+                const auto report_progress = (
+                    queue.is_idle() ||
+                    (queue.get_requests_completed() % holes_sync_progress_period) == 0);
+
+                if (report_progress)
+                {
+                    __INFO(
+                        "history_sync",
+                        "background history sync progress\n"
+                        "    dialogs=<%1%/%2%>\n"
+                        "    requests=<%3%>\n"
+                        "    failed=<%4%>\n"
+                        "    requests_per_second=<%5%>",
+                        queue.get_dialogs_completed() % queue.get_dialogs_queued() %
+                        queue.get_requests_completed() % queue.get_requests_failed() %
+                        queue.get_requests_per_second());
+                }
+
+                ptr_this->run_holes_sync();
+            };
+    }
+
+    if (retry_in.count() > 0)
+    {
+        holes_sync_timer_ = g_core->add_timer([wr_this]
+        {
+            auto ptr_this = wr_this.lock();
+            if (!ptr_this)
+                return;
+
+            ptr_this->run_holes_sync();
+
+        }, retry_in);
+    }
 }
 
 void im::update_active_dialogs(const std::string& _aimid, archive::dlg_state& _state)
@@ -4836,6 +5057,12 @@ void im::on_event_dlg_state_history_updated(
                 return;
             }
 
+            // dialogs nobody looks at are synced in the background, throttled by the holes sync queue
+            if (_count && _last_message_id > 0)
+            {
+                ptr_this->sync_holes_in_background(_aimid, _last_message_id);
+            }
+
             if (_patch_version_changed)
             {
                 ptr_this->on_history_patch_version_changed(
@@ -5057,6 +5284,12 @@ void im::history_search_one_batch(std::shared_ptr<archive::coded_term> _cterm, s
                             else
                             {
                                 ++ptr_this->search_data_.count_of_free_threads;
+
+                                if (ptr_this->search_data_.count_of_free_threads == search_threads_count)
+                                {
+                                    profiler::process_stopped(ptr_this->search_data_.profiler_span);
+                                    ptr_this->search_data_.profiler_span = -1;
+                                }
                             }
 
                             for (const auto& item : messages_ids)
@@ -5220,6 +5453,10 @@ void im::history_search_in_cl(const std::vector<std::vector<std::string>>& searc
 
 void im::setup_search_params(int64_t _req_id)
 {
+    // a search still running is superseded or cancelled here
+    profiler::process_stopped(search_data_.profiler_span);
+    search_data_.profiler_span = -1;
+
     search_data_.start_time = std::chrono::system_clock::now();
     search_data_.last_send_time = std::chrono::system_clock::now() - 2 * sending_search_results_interval;
     search_data_.req_id = _req_id;
@@ -5267,6 +5504,11 @@ void im::history_search_in_history(const std::string& term, const std::vector<st
     cterm->prefix = std::vector<int32_t>(tools::build_prefix(cterm->coded_string));
 
     auto started_contact_count = std::min<int64_t>(search_threads_count, search_data_.contact_and_offset.size());
+    if (started_contact_count > 0)
+    {
+        search_data_.profiler_span = profiler::process_started("history/search");
+    }
+
     for (auto i = 0; i < started_contact_count; ++i)
     {
         auto thread_archive = std::make_shared<archive::contact_and_msgs>();
@@ -6383,8 +6625,12 @@ void im::upload_file_sharing_internal(const archive::not_sent_message_sptr& _not
 
     const auto uploading_id = _not_sent->get_internal_id();
 
-    handler->on_result = [wr_this, _not_sent, time, uploading_id](int32_t _error, const web_file_info& _info)
+    const auto upload_span = profiler::process_started("file_sharing/upload");
+
+    handler->on_result = [wr_this, _not_sent, time, uploading_id, upload_span](int32_t _error, const web_file_info& _info)
     {
+        profiler::process_stopped(upload_span);
+
         auto ptr_this = wr_this.lock();
         if (!ptr_this)
         {
@@ -6621,9 +6867,13 @@ void im::download_file_sharing(const int64_t _seq, const std::string& _contact,
         g_core->post_message_to_gui("files/download/progress", _seq, coll.get());
     });
 
+    const auto download_span = profiler::process_started("file_sharing/download");
+
     auto completion_callback = file_info_handler_t::completion_callback_t(
-        [_seq, _file_url](loader_errors _error, const file_info_data_t& _data)
+        [_seq, _file_url, download_span](loader_errors _error, const file_info_data_t& _data)
         {
+            profiler::process_stopped(download_span);
+
             coll_helper coll(g_core->create_collection(), true);
 
             if (_error != loader_errors::success)
@@ -6838,6 +7088,8 @@ void im::raise_download_priority(const int64_t _task_id)
 void im::contact_switched(const std::string &_contact_aimid)
 {
     get_async_loader().contact_switched(_contact_aimid);
+
+    get_archive()->contact_switched(_contact_aimid);
 }
 
 void im::abort_file_sharing_upload(
@@ -7224,6 +7476,14 @@ void im::get_ignore_list(int64_t _seq)
     post_ignorelist_to_gui(_seq);
 }
 
+void im::get_contact_list(int64_t _seq)
+{
+    ifptr<icollection> cl_coll(g_core->create_collection(), true);
+    contact_list_gui_state_->serialize_full(*contact_list_, cl_coll.get());
+
+    g_core->post_message_to_gui("contactlist", _seq, cl_coll.get());
+}
+
 void im::favorite(const std::string& _contact)
 {
     core::wim::favorite fvrt(_contact, std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) - auth_params_->time_offset_);
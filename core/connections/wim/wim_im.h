@@ -108,6 +108,7 @@ namespace core
         struct wim_packet_params;
         struct robusto_packet_params;
         class contactlist;
+        class contactlist_gui_state;
         class avatar_loader;
         class wim_packet;
         class robusto_packet;
@@ -127,6 +128,8 @@ namespace core
         {
             class request;
             class failed_requests;
+            class sync_queue;
+            struct download_hole_handler;
         }
 
 
@@ -261,6 +264,7 @@ namespace core
             search_data()
                 : req_id(0)
                 , count_of_free_threads(0)
+                , profiler_span(-1)
             {
             }
 
@@ -273,6 +277,7 @@ namespace core
             int32_t count_of_sent_msgs;
             std::vector<std::shared_ptr<::core::archive::searched_msg>> top_messages;
             int32_t count_of_yet_no_sent_msgs;
+            int64_t profiler_span;
         };
 
         class gui_message
@@ -326,6 +331,7 @@ namespace core
 
             std::shared_ptr<stop_objects> stop_objects_;
             std::shared_ptr<wim::contactlist> contact_list_;
+            std::shared_ptr<wim::contactlist_gui_state> contact_list_gui_state_;
             std::shared_ptr<wim::active_dialogs> active_dialogs_;
             std::shared_ptr<wim::my_info_cache> my_info_cache_;
             std::shared_ptr<wim::favorites> favorites_;
@@ -346,6 +352,9 @@ namespace core
             std::shared_ptr<wim_send_thread> wim_send_thread_;
             std::shared_ptr<fetch_thread> fetch_thread_;
             std::shared_ptr<async_executer> async_tasks_;
+
+            // parses the cached snapshots at login, lives until all of them are in
+            std::shared_ptr<async_executer> cached_objects_loader_;
             std::shared_ptr<robusto_thread> robusto_threads_;
 
             // files loader/uploader
@@ -374,6 +383,10 @@ namespace core
 
             std::shared_ptr<holes::failed_requests> failed_holes_requests_;
 
+            std::shared_ptr<holes::sync_queue> holes_sync_queue_;
+            uint32_t holes_sync_timer_;
+            bool holes_sync_seeded_;
+
             bool sent_pending_messages_active_;
 
             // statistic
@@ -428,11 +441,11 @@ namespace core
             void save_favorites();
             void save_mailboxes();
 
-            std::shared_ptr<async_task_handlers> load_active_dialogs();
-            std::shared_ptr<async_task_handlers> load_contact_list();
-            std::shared_ptr<async_task_handlers> load_my_info();
-            std::shared_ptr<async_task_handlers> load_favorites();
-            std::shared_ptr<async_task_handlers> load_mailboxes();
+            std::shared_ptr<async_task_handlers> load_active_dialogs(async_executer& _executer);
+            std::shared_ptr<async_task_handlers> load_contact_list(async_executer& _executer);
+            std::shared_ptr<async_task_handlers> load_my_info(async_executer& _executer);
+            std::shared_ptr<async_task_handlers> load_favorites(async_executer& _executer);
+            std::shared_ptr<async_task_handlers> load_mailboxes(async_executer& _executer);
 
             // stickers
             void load_stickers_data(int64_t _seq, const std::string _size, const bool _up_to_date);
@@ -605,6 +618,7 @@ namespace core
             virtual void get_archive_messages(int64_t _seq, const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later, bool _need_prefetch, bool _first_request, std::function<void(int64_t)> last_message_catcher) override;
             virtual void get_archive_index(int64_t _seq_, const std::string& _contact, int64_t _from, int64_t _count, std::function<void(int64_t)> last_message_catcher) override;
             virtual void get_archive_messages_buddies(int64_t _seq, const std::string& _contact, std::shared_ptr<archive::msgids_list> _ids) override;
+            virtual void prefetch_archive_messages(const std::string& _contact, int64_t _from, int64_t _count_early, int64_t _count_later) override;
 
             std::shared_ptr<async_task_handlers> get_history_from_server(const get_history_params& _params, std::function<void(int64_t)> last_message_catcher);
             std::shared_ptr<async_task_handlers> set_dlg_state(set_dlg_state_params _params);
@@ -627,6 +641,10 @@ namespace core
             void download_holes(const std::string& _contact, std::function<void(int64_t)> last_message_catcher);
             void download_holes(const std::string& _contact, int64_t _depth = -1, std::function<void(int64_t)> last_message_catcher = [](int64_t) {});
             void download_holes(const std::string& _contact, int64_t _from, int64_t _depth = -1, int32_t _recursion = 0, std::function<void(int64_t)> last_message_catcher = [](int64_t){});
+            std::shared_ptr<holes::download_hole_handler> download_hole(const std::string& _contact, int64_t _from, int64_t _depth, int32_t _recursion, std::function<void(int64_t)> last_message_catcher);
+            void sync_holes_in_background(const std::string& _contact, int64_t _from);
+            void seed_holes_sync();
+            void run_holes_sync();
 
             virtual std::string _get_protocol_uid() override;
 
@@ -642,6 +660,7 @@ namespace core
             virtual void spam_contact(int64_t _seq, const std::string& _aimid) override;
             virtual void ignore_contact(int64_t _seq, const std::string& _aimid, bool ignore) override;
             virtual void get_ignore_list(int64_t _seq) override;
+            virtual void get_contact_list(int64_t _seq) override;
             virtual void favorite(const std::string& _contact) override;
             virtual void unfavorite(const std::string& _contact) override;
             virtual void update_outgoing_msg_count(const std::string& _aimid, int _count) override;
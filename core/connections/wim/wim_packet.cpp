@@ -4,6 +4,7 @@
 
 #include "../../http_request.h"
 #include "../../tools/hmac_sha_base64.h"
+#include "../../tools/url.h"
 #include "../../log/log.h"
 #include "../../utils.h"
 
@@ -320,28 +321,10 @@ int32_t wim_packet::on_empty_data()
 
 std::string wim_packet::escape_symbols(const std::string& _data)
 {
-    std::stringstream ss_out;
-
-    std::array<char, 100> buffer;
+    std::string result;
+    core::tools::escape_url_symbols(_data.data(), _data.size(), result);
 
-    for (auto sym : _data)
-    {
-        if (core::tools::is_latin(sym) || core::tools::is_digit(sym) || strchr("-._~", sym))
-        {
-            ss_out << sym;
-        }
-        else
-        {
-#ifdef _WIN32
-            sprintf_s(buffer.data(), buffer.size(), "%%%.2X", (unsigned char) sym);
-#else
-            sprintf(buffer.data(), "%%%.2X", (unsigned char) sym);
-#endif
-            ss_out << buffer.data();
-        }
-    }
-
-    return ss_out.str();
+    return result;
 }
 
 std::string wim_packet::escape_symbols_data(const char* _data, uint32_t _len)
@@ -374,7 +357,12 @@ std::string wim_packet::escape_symbols_data(const char* _data, uint32_t _len)
 
 std::string wim_packet::create_query_from_map(const str_2_str_map& _params)
 {
+    size_t query_size = 0;
+    for (const auto& iter : _params)
+        query_size += iter.first.size() + iter.second.size() + 2;
+
     std::string query;
+    query.reserve(query_size);
 
     for (const auto& iter : _params)
     {
@@ -398,45 +386,44 @@ std::string wim_packet::detect_digest(const std::string& hashed_data, const std:
         return std::string();
     }
 
-    std::vector<uint8_t> hash_data_vector(hashed_data.size());
-    memcpy(&hash_data_vector[0], hashed_data.c_str(), hashed_data.size());
+    core::tools::hmac_sha256 hmac(session_key.data(), session_key.size());
+    hmac.update(hashed_data.data(), hashed_data.size());
 
-    std::vector<uint8_t> session_key_vector(session_key.size());
-    memcpy(&session_key_vector[0], session_key.c_str(), session_key.size());
+    std::string digest;
+    hmac.final_base64(digest);
 
-    return core::tools::base64::hmac_base64(hash_data_vector, session_key_vector);
+    return digest;
 }
 
 
 std::string wim_packet::get_url_sign(const std::string& _host, const str_2_str_map& _params, const wim_packet_params& _wim_params,  bool _post_method, bool make_escape_symbols/* = true*/)
 {
-    std::string http_method = _post_method ? "POST" : "GET";
-    std::string query_string = create_query_from_map(_params);
+    const std::string query_string = create_query_from_map(_params);
 
-    std::string hash_data = http_method + '&' + (make_escape_symbols ? escape_symbols(_host) : _host) + '&' + (make_escape_symbols ? escape_symbols(query_string) : query_string);
+    std::string hash_data;
+    hash_data.reserve(4 + 3 * (_host.size() + query_string.size()) + 2);
+
+    hash_data += (_post_method ? "POST&" : "GET&");
+
+    if (make_escape_symbols)
+    {
+        core::tools::escape_url_symbols(_host.data(), _host.size(), hash_data);
+        hash_data += '&';
+        core::tools::escape_url_symbols(query_string.data(), query_string.size(), hash_data);
+    }
+    else
+    {
+        hash_data += _host;
+        hash_data += '&';
+        hash_data += query_string;
+    }
 
     return detect_digest(hash_data, _wim_params.session_key_);
 }
 
 std::string wim_packet::format_get_params(const std::map<std::string, std::string>& _params)
 {
-    std::stringstream ss_out;
-
-    auto first = true;
-
-    for (const auto& it : _params)
-    {
-        if (!first)
-        {
-            ss_out << '&';
-        }
-
-        first = false;
-
-        ss_out << it.first.c_str() << '=' << it.second.c_str();
-    }
-
-    return ss_out.str();
+    return create_query_from_map(_params);
 }
 
 int32_t wim_packet::parse_response_data(const rapidjson::Value& _data)
@@ -554,97 +541,3 @@ const hosts_map& wim_packet::get_hosts_scheme() const
 {
     return params_.hosts_;
 }
-
-void log_replace_functor::add_marker(const std::string& marker)
-{
-    markers_.push_back(marker + '=');
-}
-
-void log_replace_functor::add_json_marker(const std::string& marker)
-{
-    static std::string json_delimeter = "\":\"";
-    static std::string json_delimeter_with_space = "\": \"";
-    markers_json_.push_back(marker + json_delimeter);
-    markers_json_.push_back(marker + json_delimeter_with_space);
-
-    static std::string json_delimeter_escaped = wim::wim_packet::escape_symbols("\":\"");
-    markers_json_escaped_.push_back(marker + json_delimeter_escaped);
-}
-
-void log_replace_functor::operator()(tools::binary_stream& _bs)
-{
-    auto sz = _bs.available();
-    auto data = _bs.get_data();
-
-    std::string json_value_end;
-
-	decltype(sz) i = 0;
-    while (i < sz - 1) // -1 because there is no need to check last character
-    {
-        bool found = false;
-        bool found_json = false;
-        auto n = markers_.size();
-        for (decltype(n) j = 0; j < n; j++)
-        {
-            auto & m = markers_[j];
-            if (sz - i > m.size() && strncmp(data + i, m.c_str(), m.size()) == 0)
-            {
-                i += m.size();
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-        {
-            n = markers_json_.size();
-            for (decltype(n) j = 0; j < n; j++) // we have to check both escaped and not escaped json markers, because everything is possible
-            {
-                auto & m = markers_json_[j];
-                if (sz - i > m.size() && strncmp(data + i, m.c_str(), m.size()) == 0)
-                {
-                    i += m.size();
-                    found_json = true;
-                    static std::string json_value_end_not_escaped = "\"";
-                    json_value_end = json_value_end_not_escaped;
-                    break;
-                }
-            }
-            if (!found_json)
-            {
-                n = markers_json_escaped_.size();
-                for (decltype(n) j = 0; j < n; j++)
-                {
-                    auto & m = markers_json_escaped_[j];
-                    if (sz - i > m.size() && strncmp(data + i, m.c_str(), m.size()) == 0)
-                    {
-                        i += m.size();
-                        found_json = true;
-                        static auto json_value_end_escaped = wim::wim_packet::escape_symbols("\"");
-                        json_value_end = json_value_end_escaped;
-                        break;
-                    }
-                }
-            }
-        }
-        if (found)
-        {
-            while (i <= sz && *(data + i) != '&')
-            {
-                *(data + i) = '*';
-                ++i;
-            }
-        }
-        else if (found_json)
-        {
-            while (i <= (sz - json_value_end.size()) && strncmp(data + i, json_value_end.c_str(), json_value_end.size()) != 0)
-            {
-                *(data + i) = '*';
-                ++i;
-            }
-        }
-        else
-        {
-            ++i;
-        }
-    }
-}
@@ -7,6 +7,8 @@
 #include "../../proxy_settings.h"
 #include "../../configuration/hosts_config.h"
 
+#include "log_replace_functor.h"
+
 namespace core
 {
     class http_request_simple;
@@ -298,18 +300,6 @@ namespace core
 
     }
 
-    class log_replace_functor
-    {
-        public:
-            void add_marker(const std::string& marker);
-            void add_json_marker(const std::string &marker);
-            void operator()(tools::binary_stream& _bs);
-
-        private:
-            std::vector<std::string> markers_;
-            std::vector<std::string> markers_json_;
-            std::vector<std::string> markers_json_escaped_;
-    };
 }
 
 
@@ -25,6 +25,7 @@
 #include "archive/local_history.h"
 #include "log/log.h"
 #include "profiling/profiler.h"
+#include "profiling/metrics.h"
 #include "updater/updater.h"
 #include "crash_sender.h"
 #include "statistics.h"
@@ -60,6 +61,14 @@ std::unique_ptr<core::core_dispatcher>	core::g_core;
 
 int32_t build::is_core_icq = 0;
 
+namespace
+{
+    // a burst above this goes to the locked overflow of the channel
+    const size_t gui_channel_capacity = 4096;
+
+    const auto metrics_dump_interval = std::chrono::minutes(1);
+}
+
 core_dispatcher::core_dispatcher()
     : core_thread_(nullptr)
     , gui_connector_(nullptr)
@@ -83,6 +92,11 @@ core_dispatcher::core_dispatcher()
 
 core_dispatcher::~core_dispatcher()
 {
+    if (profiler::is_enabled())
+    {
+        profiler::export_trace((utils::get_logs_path() / L"trace.json").wstring());
+    }
+
     profiler::flush_logs();
 
     __LOG(log::shutdown();)
@@ -153,6 +167,17 @@ void core::core_dispatcher::link_gui(icore_interface* _core_face, const common::
     core_factory_ = _core_face->get_factory();
     core_thread_ = new main_thread();
 
+    gui_messages_ = std::make_unique<spsc_channel<channel_message>>(gui_channel_capacity, [this]
+    {
+        execute_core_context([this]
+        {
+            drain_gui_messages();
+        });
+    });
+
+    // the gui thread is the one that links
+    gui_messages_->bind_producer();
+
     execute_core_context([this, _settings]
     {
         start(_settings);
@@ -161,8 +186,19 @@ void core::core_dispatcher::link_gui(icore_interface* _core_face, const common::
 
 void core::core_dispatcher::start(const common::core_gui_settings& _settings)
 {
+    // the core thread is the producer of the core->gui channel
+    gui_connector_->link(nullptr, _settings);
+
     __LOG(log::init(utils::get_logs_path(), false);)
 
+    // release builds record the timeline on demand, when the logs folder holds a "!trace" file
+    if (tools::system::is_exist(utils::get_logs_path() / L"!trace"))
+    {
+        profiler::enable(true);
+    }
+
+    profiler::auto_stop_watch start_watch("startup/core_start");
+
     core_gui_settings_ = _settings;
 
     boost::system::error_code error_code;
@@ -217,6 +253,15 @@ void core::core_dispatcher::start(const common::core_gui_settings& _settings)
 #endif
 
     load_statistics();
+
+    add_timer([this]
+    {
+        save_async([this]
+        {
+            write_metrics();
+            return 0;
+        });
+    }, metrics_dump_interval);
 }
 
 
@@ -237,6 +282,8 @@ void core::core_dispatcher::unlink_gui()
         save_thread_.reset();
         updater_.reset();
         report_sender_.reset();
+        write_gui_channel_stats();
+        write_metrics();
         network_log_.reset();
         proxy_settings_manager_.reset();
         theme_settings_.reset();
@@ -245,6 +292,14 @@ void core::core_dispatcher::unlink_gui()
     delete core_thread_;
     core_thread_ = nullptr;
 
+    // the messages posted after the last drain
+    gui_messages_->drain([](channel_message& _message)
+    {
+        if (_message.data_)
+            _message.data_->release();
+    });
+    gui_messages_.reset();
+
     gui_connector_->release();
     gui_connector_ = nullptr;
 
@@ -554,9 +609,27 @@ void core::core_dispatcher::on_message_profiler_proc_stop(coll_helper _params) c
     profiler::process_stopped(id, ts);
 }
 
+void core::core_dispatcher::on_message_profiler_startup_phase(coll_helper _params) const
+{
+    const auto name = _params.get_value_as_string("name");
+
+    profiler::startup_phase(name);
+}
+
+void core::core_dispatcher::on_message_core_metrics(int64_t _seq) const
+{
+    coll_helper coll(g_core->create_collection(), true);
+    metrics::serialize(coll.get());
+
+    g_core->post_message_to_gui("core/metrics/result", _seq, coll.get());
+}
+
 void core::core_dispatcher::receive_message_from_gui(const char * _message, int64_t _seq, icollection* _message_data)
 {
     // called from main thread
+    const auto message_id = get_message_id(_message);
+
+    // the name is only for the network log
     std::string message_string = _message;
 
 //     __LOG(
@@ -568,82 +641,128 @@ void core::core_dispatcher::receive_message_from_gui(const char * _message, int6
     if (_message_data)
         _message_data->addref();
 
-    if (message_string == "history_search")
+    if (message_id == get_message_id("history_search"))
     {
         begin_search();
         begin_history_search();
     }
 
-    execute_core_context([this, message_string, _seq, _message_data]
+    if (gui_messages_ && gui_messages_->push(channel_message(_message, _seq, _message_data)))
+        return;
+
+    // not the gui thread
+    execute_core_context([this, message_id, message_string, _seq, _message_data]
+    {
+        process_message_from_gui(message_id, message_string.c_str(), _seq, _message_data);
+    });
+}
+
+void core::core_dispatcher::drain_gui_messages()
+{
+    gui_messages_->drain([this](channel_message& _message)
     {
-        coll_helper params(_message_data, true);
-        if (message_string != "log")
+        process_message_from_gui(_message.id_, _message.name_, _message.seq_, _message.data_);
+    });
+}
+
+void core::core_dispatcher::write_gui_channel_stats()
+{
+    if (!gui_messages_ || !network_log_)
+        return;
+
+    const auto& stats = gui_messages_->get_stats();
+
+    std::stringstream s;
+    s << "GUI->CORE channel: messages=" << stats.count()
+        << " max_depth=" << stats.max_depth()
+        << " latency_us p50<" << stats.latency_percentile(0.5)
+        << " p99<" << stats.latency_percentile(0.99)
+        << "\r\n";
+
+    tools::binary_stream bs;
+    bs.write<std::string>(s.str());
+    get_network_log().write_data(bs);
+}
+
+// the metrics of the whole session so far, rewritten every time, so the file shows the latest state
+void core::core_dispatcher::write_metrics() const
+{
+    tools::binary_stream bs;
+    bs.write<std::string>(metrics::format());
+    bs.save_2_file((utils::get_logs_path() / L"metrics.txt").wstring());
+}
+
+void core::core_dispatcher::process_message_from_gui(message_id _message_id, const char* _message, int64_t _seq, icollection* _message_data)
+{
+    coll_helper params(_message_data, true);
+    if (_message_id != get_message_id("log"))
+    {
+        tools::binary_stream bs;
+        bs.write<std::string>("GUI->CORE: message=");
+        bs.write<std::string>(_message);
+        bs.write<std::string>("\r\n");
+        if (_message_id == get_message_id("archive/messages/get"))
         {
-            tools::binary_stream bs;
-            bs.write<std::string>("GUI->CORE: message=");
-            bs.write<std::string>(message_string);
+            std::stringstream s;
+            s << "for: ";
+            s << params.get_value_as_string("contact");
+            s << " from: ";
+            s << params.get_value_as_int64("from");
+            s << " count_early: ";
+            s << params.get_value_as_int64("count_early");
+            s << " count_later: ";
+            s << params.get_value_as_int64("count_later");
+
+            bs.write<std::string>(s.str());
             bs.write<std::string>("\r\n");
-            if (message_string == "archive/messages/get")
-            {
-                std::stringstream s;
-                s << "for: ";
-                s << params.get_value_as_string("contact");
-                s << " from: ";
-                s << params.get_value_as_int64("from");
-                s << " count_early: ";
-                s << params.get_value_as_int64("count_early");
-                s << " count_later: ";
-                s << params.get_value_as_int64("count_later");
-
-                bs.write<std::string>(s.str());
-                bs.write<std::string>("\r\n");
-            }
-			// Added type of voip call to log.
-			if (message_string == "voip_call")
-			{
-				std::stringstream s;
-				s << "type: ";
-				s << params.get_value_as_string("type");
-
-				bs.write<std::string>(s.str());
-				bs.write<std::string>("\r\n");
-			}
-        /*    if (_message_data)
-            {
-                bs.write<std::string>(_message_data->log());
-            }*/
-            get_network_log().write_data(bs);
         }
+		// Added type of voip call to log.
+		if (_message_id == get_message_id("voip_call"))
+		{
+			std::stringstream s;
+			s << "type: ";
+			s << params.get_value_as_string("type");
 
-        if (message_string == "settings/value/set")
-        {
-            on_message_update_gui_settings_value(_seq, params);
-        }
-        else if (message_string == "log")
-        {
-            on_message_log(params);
-        }
-        else if (message_string == "profiler/proc/start")
-        {
-            on_message_profiler_proc_start(params);
-        }
-        else if (message_string == "profiler/proc/stop")
-        {
-            on_message_profiler_proc_stop(params);
-        }
-        else if (message_string == "themes/settings/set")
-        {
-            on_message_update_theme_settings_value(_seq, params);
-        }
-        else if (message_string == "themes/default/id")
-        {
-            on_message_set_default_theme_id(_seq, params);
-        }
-        else
+			bs.write<std::string>(s.str());
+			bs.write<std::string>("\r\n");
+		}
+    /*    if (_message_data)
         {
-            im_container_->on_message_from_gui(message_string.c_str(), _seq, params);
-        }
-    });
+            bs.write<std::string>(_message_data->log());
+        }*/
+        get_network_log().write_data(bs);
+    }
+
+    switch (_message_id)
+    {
+    case get_message_id("settings/value/set"):
+        on_message_update_gui_settings_value(_seq, params);
+        break;
+    case get_message_id("log"):
+        on_message_log(params);
+        break;
+    case get_message_id("profiler/proc/start"):
+        on_message_profiler_proc_start(params);
+        break;
+    case get_message_id("profiler/proc/stop"):
+        on_message_profiler_proc_stop(params);
+        break;
+    case get_message_id("profiler/startup_phase"):
+        on_message_profiler_startup_phase(params);
+        break;
+    case get_message_id("core/metrics"):
+        on_message_core_metrics(_seq);
+        break;
+    case get_message_id("themes/settings/set"):
+        on_message_update_theme_settings_value(_seq, params);
+        break;
+    case get_message_id("themes/default/id"):
+        on_message_set_default_theme_id(_seq, params);
+        break;
+    default:
+        im_container_->on_message_from_gui(_message_id, _seq, params);
+        break;
+    }
 }
 
 const common::core_gui_settings& core::core_dispatcher::get_core_gui_settings() const
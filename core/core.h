@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../corelib/core_face.h"
+#include "../corelib/spsc_channel.h"
 #include "../common.shared/common_defs.h"
 #include "Voip/VoipManagerDefines.h"
 
@@ -77,6 +78,9 @@ namespace core
         // gui interfaces
         iconnector* gui_connector_;
         icore_factory* core_factory_;
+
+        // messages from the gui thread, drained on the core thread
+        std::unique_ptr<spsc_channel<channel_message>> gui_messages_;
         std::unique_ptr<async_executer> save_thread_;
 
         // updater
@@ -98,6 +102,8 @@ namespace core
         void on_message_log(coll_helper _params) const;
         void on_message_profiler_proc_start(coll_helper _params) const;
         void on_message_profiler_proc_stop(coll_helper _params) const;
+        void on_message_profiler_startup_phase(coll_helper _params) const;
+        void on_message_core_metrics(int64_t _seq) const;
 
         void post_data_path();
         void load_theme_settings();
@@ -109,6 +115,11 @@ namespace core
 
         void post_user_proxy_to_gui();
 
+        void process_message_from_gui(message_id _message_id, const char* _message, int64_t _seq, icollection* _message_data);
+        void drain_gui_messages();
+        void write_gui_channel_stats();
+        void write_metrics() const;
+
     public:
 
         core_dispatcher();
@@ -5,6 +5,7 @@
 #include "core.h"
 #include "curl_context.h"
 #include "network_log.h"
+#include "profiling/metrics.h"
 
 #include "curl_handler.h"
 
@@ -13,6 +14,11 @@ namespace
     const int MAX_NORMAL_TRANSMISSIONS = 4;
     const int MAX_HIGH_TRANSMISSIONS = 6;
     const int MAX_HIGHEST_TRANSMISSIONS = 8;
+
+    auto& pending_jobs_metric = core::metrics::get_gauge("curl/pending_jobs");
+    auto& connections_metric = core::metrics::get_gauge("curl/connections");
+    auto& queue_wait_metric = core::metrics::get_histogram("curl/queue_wait_us");
+    auto& transfer_time_metric = core::metrics::get_histogram("curl/transfer_ms");
 }
 
 namespace core
@@ -34,9 +40,13 @@ namespace core
         {
             auto connection = it->second.get();
 
+            transfer_time_metric.record(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connection->started_).count());
+
             boost::apply_visitor(curl_handler::completion_visitor(_result), connection->completion_handler_);
 
             _curl_handler->connections_.erase(it);
+
+            connections_metric.set((int64_t)_curl_handler->connections_.size());
         }
     }
 
@@ -205,11 +215,15 @@ namespace core
                 const auto timeout = job.timeout_;
                 const auto easy_handle = job.handle_;
 
+                queue_wait_metric.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - job.queued_).count());
+
                 auto connection = std::make_unique<curl_handler::connection_context>(timeout, handler, easy_handle, completion_handler);
                 to_process.push_back(std::move(connection));
 
                 handler->pending_jobs_.pop();
             }
+
+            pending_jobs_metric.set((int64_t)handler->pending_jobs_.size());
         }
 
         for (auto&& connection : to_process)
@@ -218,6 +232,8 @@ namespace core
 
             handler->connections_[easy_handle] = std::move(connection);
 
+            connections_metric.set((int64_t)handler->connections_.size());
+
             const auto result = curl_multi_add_handle(handler->multi_handle_, easy_handle);
 
             if (result != CURLM_OK)
@@ -367,6 +383,8 @@ void core::curl_handler::add_task(priority_t _priority, milliseconds_t _timeout,
         boost::lock_guard<boost::mutex> lock(jobs_mutex_);
 
         pending_jobs_.emplace(_priority, _timeout, _handle, _completion_handler);
+
+        pending_jobs_metric.set((int64_t)pending_jobs_.size());
     }
 
     event_active(start_task_event_, 0, 0);
@@ -379,6 +397,7 @@ core::curl_handler::connection_context::connection_context(milliseconds_t _timeo
     , completion_handler_(_completion_handler)
     , socket_(0)
     , event_(nullptr)
+    , started_(std::chrono::steady_clock::now())
 {
     const auto tv = make_timeval(timeout_);
     timeout_event_ = evtimer_new(curl_handler_->event_base_, event_timeout_callback, this);
@@ -459,6 +478,7 @@ core::curl_handler::job::job(priority_t _priority, milliseconds_t _timeout, CURL
     , timeout_(_timeout)
     , handle_(_handle)
     , completion_(_completion)
+    , queued_(std::chrono::steady_clock::now())
 {
 }
 
@@ -96,6 +96,8 @@ namespace core
             curl_socket_t socket_;
 
             event* event_;
+
+            std::chrono::steady_clock::time_point started_;
         };
 
         CURLM* multi_handle_;
@@ -117,6 +119,7 @@ namespace core
             milliseconds_t timeout_;
             CURL* handle_;
             completion_handler_t completion_;
+            std::chrono::steady_clock::time_point queued_;
         };
 
         struct job_priority_comparer
@@ -60,6 +60,12 @@ namespace
 
     boost::condition_variable logging_thread_cond_;
 
+    // under logging_thread_mutex_, a flush waits for the logging thread to write what was logged before it
+    uint64_t flush_requests_ = 0;
+    uint64_t flushed_requests_ = 0;
+
+    boost::condition_variable flushed_cond_;
+
     format_record_fn record_formatter_;
 
     fs::path logs_dir_;
@@ -72,8 +78,73 @@ namespace
 
     std::set<std::string> enabled_log_areas_;
 
+    // the enabled areas by the hash of the name, replaced as a whole when an area is switched;
+    // the replaced filters are kept, a writer may still be reading one
+    struct area_filter
+    {
+        std::vector<std::pair<uint32_t, std::string>> areas_;
+    };
+
+    std::mutex area_filters_mutex_;
+
+    std::vector<std::unique_ptr<area_filter>> area_filters_;
+
+    std::atomic<const area_filter*> area_filter_(nullptr);
+
+    // the records of one thread: written by it, read by the logging thread
+    class thread_ring : boost::noncopyable
+    {
+        std::vector<char> data_;
+        const uint64_t mask_;
+
+        std::atomic<uint64_t> head_;
+        std::atomic<uint64_t> tail_;
+
+        void copy_in(const uint64_t _pos, const char* _data, const size_t _size);
+        void copy_out(const uint64_t _pos, char* _data, const size_t _size) const;
+
+    public:
+
+        // set when the thread exits, the logging thread frees the ring once it is drained
+        std::atomic<bool> retired_;
+
+        explicit thread_ring(const size_t _capacity);
+
+        bool write(const char* _record, const uint32_t _size);
+        bool read(Out std::vector<char> &_record);
+
+        size_t size() const;
+        size_t capacity() const;
+    };
+
+    const size_t thread_ring_capacity = 64 * 1024;
+
+    std::mutex thread_rings_mutex_;
+
+    std::vector<std::shared_ptr<thread_ring>> thread_rings_;
+
+    // what a record starts with, the area and the tagged arguments follow
+    struct record_header
+    {
+        const log::record_format* format_;
+        int64_t ts_;
+        uint16_t area_size_;
+    };
+
     void enqueue_record(const record_type type_, const std::string &area_, const std::string &text_);
 
+    void enqueue_record(log_record_uptr _record);
+
+    log_record_uptr decode_record(const char* _data, const size_t _size);
+
+    thread_ring& get_thread_ring();
+
+    void drain_thread_rings(Out std::list<log_record_uptr> &_records);
+
+    bool is_area_enabled(const log::level _level, const char* _area, const size_t _size);
+
+    void update_area_filter();
+
     void format_html(const log_record &_record, Out std::stringstream &_wss);
 
     void format_plain(const log_record &_record, Out std::stringstream &_wss);
@@ -145,6 +216,143 @@ namespace core
             trace_data_enabled_ = _is_enabled;
         }
 
+        bool is_enabled(const level _level, const char* _area)
+        {
+            return is_area_enabled(_level, _area, ::strlen(_area));
+        }
+
+        bool is_enabled(const level _level, const std::string& _area)
+        {
+            return is_area_enabled(_level, _area.c_str(), _area.size());
+        }
+
+        void enable_area(const std::string& _area, const bool _is_enabled)
+        {
+            assert(!_area.empty());
+
+            std::lock_guard<std::mutex> lock(area_filters_mutex_);
+
+            if (_is_enabled)
+                enabled_log_areas_.insert(_area);
+            else
+                enabled_log_areas_.erase(_area);
+
+            update_area_filter();
+        }
+
+        record_writer::record_writer(const record_format& _format, const char* _area)
+            : format_(_format)
+            , size_(0)
+        {
+            const auto area_size = ::strlen(_area);
+            assert(area_size > 0 && area_size <= UINT16_MAX);
+
+            record_header header = { &_format, time_point_cast<milliseconds>(system_clock::now()).time_since_epoch().count(), (uint16_t)area_size };
+            write(&header, sizeof(header));
+            write(_area, area_size);
+        }
+
+        record_writer::record_writer(const record_format& _format, const std::string& _area)
+            : record_writer(_format, _area.c_str())
+        {
+        }
+
+        record_writer::~record_writer()
+        {
+            const auto data = (heap_.empty() ? inline_ : heap_.data());
+
+            auto& ring = get_thread_ring();
+
+            // a big record or a full ring: formatted here and queued under the lock, as all records were before
+            const auto is_big = (size_ > thread_ring_capacity / 4);
+            const auto half = (ring.capacity() / 2);
+            const auto was_below_half = (ring.size() < half);
+
+            if (is_big || !ring.write(data, (uint32_t)size_))
+            {
+                enqueue_record(decode_record(data, size_));
+                return;
+            }
+
+            // the logging thread polls the rings, it is woken only when one fills up
+            if (was_below_half && ring.size() >= half)
+                logging_thread_cond_.notify_one();
+        }
+
+        void record_writer::write(const void* _data, size_t _size)
+        {
+            if (heap_.empty() && (size_ + _size) <= inline_size)
+            {
+                ::memcpy(inline_ + size_, _data, _size);
+            }
+            else
+            {
+                if (heap_.empty())
+                    heap_.assign(inline_, inline_ + size_);
+
+                const auto data = static_cast<const char*>(_data);
+                heap_.insert(heap_.end(), data, data + _size);
+            }
+
+            size_ += _size;
+        }
+
+        void record_writer::write_tag(const char _tag)
+        {
+            write(&_tag, sizeof(_tag));
+        }
+
+        void record_writer::write_string(const char* _value, size_t _size)
+        {
+            const auto size = (uint32_t)_size;
+
+            write_tag('s');
+            write(&size, sizeof(size));
+            write(_value, size);
+        }
+
+        record_writer& record_writer::operator%(const bool _value)
+        {
+            write_value('b', _value);
+            return *this;
+        }
+
+        record_writer& record_writer::operator%(const char _value)
+        {
+            write_value('c', _value);
+            return *this;
+        }
+
+        record_writer& record_writer::operator%(const signed char _value)
+        {
+            write_value('c', (char)_value);
+            return *this;
+        }
+
+        record_writer& record_writer::operator%(const unsigned char _value)
+        {
+            write_value('c', (char)_value);
+            return *this;
+        }
+
+        record_writer& record_writer::operator%(const double _value)
+        {
+            write_value('d', _value);
+            return *this;
+        }
+
+        record_writer& record_writer::operator%(const char* _value)
+        {
+            write_string(_value, ::strlen(_value));
+            return *this;
+        }
+
+        record_writer& record_writer::operator%(const std::string& _value)
+        {
+            write_string(_value.c_str(), _value.size());
+            return *this;
+        }
+
         void init(const fs::wpath &_logs_dir, const bool _is_html)
         {
             assert(!logging_thread_);
@@ -179,8 +387,31 @@ namespace core
             logging_thread_ = std::make_unique<std::thread>(logging_thread_proc);
         }
 
+        void flush()
+        {
+            if (!logging_thread_)
+            {
+                return;
+            }
+
+            boost::unique_lock<boost::mutex> lock(logging_thread_mutex_);
+
+            const auto request = ++flush_requests_;
+            logging_thread_cond_.notify_all();
+
+            flushed_cond_.wait(lock, [request]
+            {
+                return (stop_signal_ || flushed_requests_ >= request);
+            });
+        }
+
         void shutdown()
         {
+            if (!logging_thread_)
+            {
+                return;
+            }
+
             stop_signal_ = true;
             logging_thread_cond_.notify_all();
 
@@ -222,16 +453,10 @@ namespace
         assert(!_area.empty());
         assert(!_text.empty());
 
-        const auto skip_trace_record = ((_type == record_type::trace) && !trace_data_enabled_);
-        if (skip_trace_record)
-        {
-            return;
-        }
-
         const auto is_net_record_type = (_type == record_type::net);
         const auto is_log_area_enabled = (
             is_net_record_type ||
-            (enabled_log_areas_.count(_area) > 0)
+            is_area_enabled((log::level)((int)_type - (int)record_type::min), _area.c_str(), _area.size())
             );
         if (!is_log_area_enabled)
         {
@@ -239,15 +464,277 @@ namespace
         }
 
         const auto now = time_point_cast<milliseconds>(system_clock::now());
-        auto new_record = std::make_unique<log_record>(_type, _area, _text, now);
+        enqueue_record(std::make_unique<log_record>(_type, _area, _text, now));
+    }
 
+    void enqueue_record(log_record_uptr _record)
+    {
         boost::unique_lock<boost::mutex> lock(logging_thread_mutex_);
-        log_records_.push_back(std::move(new_record));
+        log_records_.push_back(std::move(_record));
         lock.unlock();
 
         logging_thread_cond_.notify_one();
     }
 
+    uint32_t get_area_hash(const char* _area, const size_t _size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < _size; ++i)
+        {
+            hash = (hash ^ (uint8_t)_area[i]) * 16777619u;
+        }
+
+        return hash;
+    }
+
+    bool is_area_enabled(const log::level _level, const char* _area, const size_t _size)
+    {
+        if ((_level == log::level::trace) && !trace_data_enabled_)
+        {
+            return false;
+        }
+
+        const auto filter = area_filter_.load(std::memory_order_acquire);
+        if (!filter)
+        {
+            return false;
+        }
+
+        const auto hash = get_area_hash(_area, _size);
+
+        for (const auto &area : filter->areas_)
+        {
+            if (area.first == hash && area.second.size() == _size && ::memcmp(area.second.c_str(), _area, _size) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void update_area_filter()
+    {
+        auto filter = std::make_unique<area_filter>();
+
+        for (const auto &area : enabled_log_areas_)
+        {
+            filter->areas_.emplace_back(get_area_hash(area.c_str(), area.size()), area);
+        }
+
+        area_filter_.store(filter.get(), std::memory_order_release);
+        area_filters_.push_back(std::move(filter));
+    }
+
+    thread_ring::thread_ring(const size_t _capacity)
+        : data_(_capacity)
+        , mask_(_capacity - 1)
+        , head_(0)
+        , tail_(0)
+        , retired_(false)
+    {
+        assert((_capacity & mask_) == 0);
+    }
+
+    void thread_ring::copy_in(const uint64_t _pos, const char* _data, const size_t _size)
+    {
+        const auto offset = (size_t)(_pos & mask_);
+        const auto first = std::min(_size, data_.size() - offset);
+
+        ::memcpy(&data_[offset], _data, first);
+        ::memcpy(&data_[0], _data + first, _size - first);
+    }
+
+    void thread_ring::copy_out(const uint64_t _pos, char* _data, const size_t _size) const
+    {
+        const auto offset = (size_t)(_pos & mask_);
+        const auto first = std::min(_size, data_.size() - offset);
+
+        ::memcpy(_data, &data_[offset], first);
+        ::memcpy(_data + first, &data_[0], _size - first);
+    }
+
+    bool thread_ring::write(const char* _record, const uint32_t _size)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        const auto used = (tail - head_.load(std::memory_order_acquire));
+
+        if (used + sizeof(_size) + _size > data_.size())
+        {
+            return false;
+        }
+
+        copy_in(tail, (const char*)&_size, sizeof(_size));
+        copy_in(tail + sizeof(_size), _record, _size);
+
+        tail_.store(tail + sizeof(_size) + _size, std::memory_order_release);
+
+        return true;
+    }
+
+    bool thread_ring::read(Out std::vector<char> &_record)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        uint32_t size = 0;
+        copy_out(head, (char*)&size, sizeof(size));
+
+        _record.resize(size);
+        copy_out(head + sizeof(size), _record.data(), size);
+
+        head_.store(head + sizeof(size) + size, std::memory_order_release);
+
+        return true;
+    }
+
+    size_t thread_ring::size() const
+    {
+        return (size_t)(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+    }
+
+    size_t thread_ring::capacity() const
+    {
+        return data_.size();
+    }
+
+    struct thread_ring_holder
+    {
+        std::shared_ptr<thread_ring> ring_;
+
+        ~thread_ring_holder()
+        {
+            if (ring_)
+            {
+                ring_->retired_ = true;
+            }
+        }
+    };
+
+    thread_ring& get_thread_ring()
+    {
+        thread_local thread_ring_holder holder;
+
+        if (!holder.ring_)
+        {
+            holder.ring_ = std::make_shared<thread_ring>(thread_ring_capacity);
+
+            std::lock_guard<std::mutex> lock(thread_rings_mutex_);
+            thread_rings_.push_back(holder.ring_);
+        }
+
+        return *holder.ring_;
+    }
+
+    template <class t_>
+    t_ read_value(const char* _data, Out size_t &_pos)
+    {
+        t_ value;
+        ::memcpy(&value, _data + _pos, sizeof(value));
+        _pos += sizeof(value);
+
+        return value;
+    }
+
+    log_record_uptr decode_record(const char* _data, const size_t _size)
+    {
+        size_t pos = 0;
+
+        const auto header = read_value<record_header>(_data, Out pos);
+        assert(header.format_);
+
+        const std::string area(_data + pos, header.area_size_);
+        pos += header.area_size_;
+
+        const auto &format = *header.format_;
+
+        boost::format text(format.text_);
+        text.exceptions(boost::io::no_error_bits);
+
+        while (pos < _size)
+        {
+            const auto tag = _data[pos++];
+
+            switch (tag)
+            {
+            case 'b':
+                text % read_value<bool>(_data, Out pos);
+                break;
+
+            case 'c':
+                text % read_value<char>(_data, Out pos);
+                break;
+
+            case 'i':
+                text % read_value<int64_t>(_data, Out pos);
+                break;
+
+            case 'u':
+                text % read_value<uint64_t>(_data, Out pos);
+                break;
+
+            case 'd':
+                text % read_value<double>(_data, Out pos);
+                break;
+
+            case 's':
+            {
+                const auto size = read_value<uint32_t>(_data, Out pos);
+                text % std::string(_data + pos, size);
+                pos += size;
+                break;
+            }
+
+            default:
+                assert(!"unknown argument tag");
+                pos = _size;
+            }
+        }
+
+        std::string body;
+        body.reserve(512);
+        body += format.function_;
+        body += ", ";
+        body += format.location_;
+        body += '\n';
+        body += text.str();
+
+        const auto type = (record_type)((int)format.level_ + (int)record_type::min);
+
+        return std::make_unique<log_record>(type, area, body, ms_time_point(milliseconds(header.ts_)));
+    }
+
+    void drain_thread_rings(Out std::list<log_record_uptr> &_records)
+    {
+        std::vector<char> record;
+
+        std::lock_guard<std::mutex> lock(thread_rings_mutex_);
+
+        for (auto iter = thread_rings_.begin(); iter != thread_rings_.end();)
+        {
+            auto &ring = **iter;
+
+            // checked first, the thread writes nothing after it is retired
+            const auto is_retired = ring.retired_.load();
+
+            while (ring.read(Out record))
+            {
+                _records.push_back(decode_record(record.data(), record.size()));
+            }
+
+            if (is_retired)
+            {
+                iter = thread_rings_.erase(iter);
+                continue;
+            }
+
+            ++iter;
+        }
+    }
+
     void format_footer_html(const log_record &_record, std::stringstream &_wss)
     {
         _wss << "<br><br>\n";
@@ -488,6 +975,14 @@ namespace
 
         _lock.unlock();
 
+        drain_thread_rings(Out records);
+
+        // the rings and the queue are filled by many threads
+        records.sort([](const log_record_uptr &_left, const log_record_uptr &_right)
+        {
+            return (_left->ts_ < _right->ts_);
+        });
+
         flush_records(records);
 
         return !records.empty();
@@ -501,10 +996,14 @@ namespace
 
             const auto stop_or_record = []
             {
-                return (stop_signal_ || !log_records_.empty());
+                return (stop_signal_ || !log_records_.empty() || flush_requests_ != flushed_requests_);
             };
 
-            logging_thread_cond_.wait(lock, stop_or_record);
+            // the thread rings do not notify on every record
+            logging_thread_cond_.timed_wait(lock, boost::posix_time::milliseconds(100), stop_or_record);
+
+            // whatever was logged before these requests is written by the loop below
+            const auto flush_requests = flush_requests_;
 
             for (;;)
             {
@@ -522,6 +1021,17 @@ namespace
                 std::this_thread::sleep_for(std::chrono::milliseconds(0));
             }
 
+            if (flush_requests != flushed_requests_)
+            {
+                if (!lock.owns_lock())
+                {
+                    lock.lock();
+                }
+
+                flushed_requests_ = flush_requests;
+                flushed_cond_.notify_all();
+            }
+
             if (stop_signal_)
             {
                 return;
@@ -548,6 +1058,8 @@ namespace
 
         binary_stream_reader reader(input);
 
+        std::lock_guard<std::mutex> lock(area_filters_mutex_);
+
         while (!reader.eof())
         {
             auto line = reader.readline();
@@ -567,6 +1079,8 @@ namespace
 
             enabled_log_areas_.emplace(std::move(line));
         }
+
+        update_area_filter();
     }
 }
 
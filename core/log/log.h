@@ -10,11 +10,16 @@
 
 #ifdef __ENABLE_LOG
 #define __LOG(x) { x }
+// the arguments are stored raw and formatted on the logging thread,
+// a disabled area costs a hash of its name
 #define __WRITE_LOG(type, area, fncname, fmt, params)								\
 {																					\
-    boost::format format(fncname ", " __FILE__ ", line " __LINEA__"\n" fmt);		\
-    format % params;																\
-    core::log::type((area), format);												\
+    if (core::log::is_enabled(core::log::level::type, (area)))						\
+    {																				\
+        static const core::log::record_format record_format =						\
+            { core::log::level::type, fncname, __FILE__ ", line " __LINEA__, fmt };	\
+        core::log::record_writer(record_format, (area)) % params;					\
+    }																				\
 }
 #else
 #define __LOG(x) {}
@@ -24,7 +29,7 @@
 #define __TRACE(area, fmt, params) __WRITE_LOG(trace, (area), __FUNCTION__, fmt, params)
 #define __INFO(area, fmt, params) __WRITE_LOG(info, (area), __FUNCTION__, fmt, params)
 #define __WARN(area, fmt, params) __WRITE_LOG(warn, (area), __FUNCTION__, fmt, params)
-#define __ERR(area, fmt, params) __WRITE_LOG(err, (area), __FUNCTION__, fmt, params)
+#define __ERR(area, fmt, params) __WRITE_LOG(error, (area), __FUNCTION__, fmt, params)
 
 #define __NET(fmt, params)                  \
 {											\
@@ -37,6 +42,90 @@ namespace core
 {
     namespace log
     {
+        enum class level
+        {
+            trace,
+            info,
+            warn,
+            error
+        };
+
+        // a static of the call site, the records refer to it instead of carrying the texts
+        struct record_format
+        {
+            const level level_;
+            const char* function_;
+            const char* location_;
+            const char* text_;
+        };
+
+        // the trace switch and the area filter, checked before anything is captured
+        bool is_enabled(const level _level, const char* _area);
+        bool is_enabled(const level _level, const std::string& _area);
+
+        void enable_area(const std::string& _area, const bool _is_enabled);
+
+        // captures the arguments of one record and hands them to the logging thread on destruction;
+        // numbers and strings are stored raw, other types are streamed into a string on the spot
+        class record_writer : boost::noncopyable
+        {
+            static const size_t inline_size = 512;
+
+            const record_format& format_;
+
+            char inline_[inline_size];
+            std::vector<char> heap_;
+            size_t size_;
+
+            void write(const void* _data, size_t _size);
+            void write_tag(const char _tag);
+
+            void write_string(const char* _value, size_t _size);
+
+            template <class t_>
+            void write_value(const char _tag, const t_ _value)
+            {
+                write_tag(_tag);
+                write(&_value, sizeof(_value));
+            }
+
+        public:
+
+            record_writer(const record_format& _format, const char* _area);
+            record_writer(const record_format& _format, const std::string& _area);
+            ~record_writer();
+
+            record_writer& operator%(const bool _value);
+            record_writer& operator%(const char _value);
+            record_writer& operator%(const signed char _value);
+            record_writer& operator%(const unsigned char _value);
+            record_writer& operator%(const double _value);
+            record_writer& operator%(const char* _value);
+            record_writer& operator%(const std::string& _value);
+
+            template <class t_>
+            typename std::enable_if<std::is_integral<t_>::value && std::is_signed<t_>::value, record_writer&>::type operator%(const t_ _value)
+            {
+                write_value('i', (int64_t)_value);
+                return *this;
+            }
+
+            template <class t_>
+            typename std::enable_if<std::is_integral<t_>::value && std::is_unsigned<t_>::value, record_writer&>::type operator%(const t_ _value)
+            {
+                write_value('u', (uint64_t)_value);
+                return *this;
+            }
+
+            template <class t_>
+            typename std::enable_if<!std::is_arithmetic<t_>::value, record_writer&>::type operator%(const t_& _value)
+            {
+                std::stringstream value;
+                value << _value;
+                return (*this % value.str());
+            }
+        };
+
         void enable_trace_data(const bool _is_enabled);
 
         void init(const boost::filesystem::wpath &_logs_dir, const bool _is_html);
@@ -49,6 +138,9 @@ namespace core
         void net(const boost::format &_format);
         boost::filesystem::wpath get_net_file_path();
 
+        // blocks until the records logged before the call are written to the files
+        void flush();
+
         void shutdown();
 
     }
@@ -0,0 +1,303 @@
+#include "stdafx.h"
+
+#include "metrics.h"
+
+#include "../../corelib/collection_helper.h"
+#include "../../corelib/core_face.h"
+
+using namespace core;
+using namespace metrics;
+
+namespace
+{
+    struct registry
+    {
+        std::map<std::string, std::unique_ptr<counter>> counters_;
+
+        std::map<std::string, std::unique_ptr<gauge>> gauges_;
+
+        std::map<std::string, std::unique_ptr<histogram>> histograms_;
+
+        boost::mutex mutex_;
+    };
+
+    // never destroyed: the thread pools hold their metrics until the very exit of the process
+    registry& get_registry()
+    {
+        static auto instance = new registry();
+        return *instance;
+    }
+
+    template <class t_>
+    t_& find_or_create(std::map<std::string, std::unique_ptr<t_>> &_metrics, const std::string &_name)
+    {
+        assert(!_name.empty());
+
+        boost::unique_lock<boost::mutex> lock(get_registry().mutex_);
+
+        auto &metric = _metrics[_name];
+        if (!metric)
+        {
+            metric = std::make_unique<t_>();
+        }
+
+        return *metric;
+    }
+
+    int32_t most_significant_bit(uint64_t _value)
+    {
+        int32_t bit = 0;
+
+        for (auto shift = 32; shift > 0; shift /= 2)
+        {
+            if (_value >> shift)
+            {
+                _value >>= shift;
+                bit += shift;
+            }
+        }
+
+        return bit;
+    }
+
+    void add_to_array(icollection *_coll, iarray *_array, coll_helper &_metric)
+    {
+        ifptr<ivalue> value(_coll->create_value());
+        value->set_as_collection(_metric.get());
+        _array->push_back(value.get());
+    }
+}
+
+namespace core
+{
+    namespace metrics
+    {
+
+        counter::counter()
+            : value_(0)
+        {
+        }
+
+        int64_t counter::get() const
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+        gauge::gauge()
+            : value_(0)
+            , max_(0)
+        {
+        }
+
+        int64_t gauge::get() const
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+        int64_t gauge::get_max() const
+        {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+        histogram::histogram()
+            : count_(0)
+            , sum_(0)
+            , max_(0)
+        {
+            for (auto &bucket : buckets_)
+            {
+                bucket = 0;
+            }
+        }
+
+        void histogram::record(int64_t _value)
+        {
+            if (_value < 0)
+            {
+                _value = 0;
+            }
+
+            buckets_[get_bucket(_value)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(_value, std::memory_order_relaxed);
+
+            auto max = max_.load(std::memory_order_relaxed);
+            while (_value > max && !max_.compare_exchange_weak(max, _value, std::memory_order_relaxed));
+        }
+
+        int64_t histogram::count() const
+        {
+            return count_.load(std::memory_order_relaxed);
+        }
+
+        int64_t histogram::get_sum() const
+        {
+            return sum_.load(std::memory_order_relaxed);
+        }
+
+        int64_t histogram::get_max() const
+        {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+        int64_t histogram::percentile(const double _share) const
+        {
+            const auto total = count();
+            if (total == 0)
+            {
+                return 0;
+            }
+
+            int64_t sum = 0;
+            for (auto bucket = 0; bucket < buckets_count; ++bucket)
+            {
+                sum += buckets_[bucket].load(std::memory_order_relaxed);
+                if (sum >= _share * total)
+                {
+                    return std::min(get_bucket_upper_bound(bucket), get_max());
+                }
+            }
+
+            return get_max();
+        }
+
+        int32_t histogram::get_bucket(const int64_t _value)
+        {
+            assert(_value >= 0);
+
+            if (_value < sub_buckets_count)
+            {
+                return (int32_t)_value;
+            }
+
+            // 8..15 -> 8..15, 16..17 -> 16, 18..19 -> 17 and so on
+            const auto exponent = most_significant_bit((uint64_t)_value);
+            const auto sub_bucket = (int32_t)((_value >> (exponent - 3)) & (sub_buckets_count - 1));
+
+            return std::min((exponent - 2) * sub_buckets_count + sub_bucket, buckets_count - 1);
+        }
+
+        int64_t histogram::get_bucket_upper_bound(const int32_t _bucket)
+        {
+            assert(_bucket >= 0);
+            assert(_bucket < buckets_count);
+
+            if (_bucket < sub_buckets_count)
+            {
+                return _bucket;
+            }
+
+            const auto exponent = (_bucket / sub_buckets_count) + 2;
+            const auto sub_bucket = (_bucket % sub_buckets_count);
+
+            return (((int64_t)(sub_buckets_count + sub_bucket + 1) << (exponent - 3)) - 1);
+        }
+
+        counter& get_counter(const std::string &_name)
+        {
+            return find_or_create(get_registry().counters_, _name);
+        }
+
+        gauge& get_gauge(const std::string &_name)
+        {
+            return find_or_create(get_registry().gauges_, _name);
+        }
+
+        histogram& get_histogram(const std::string &_name)
+        {
+            return find_or_create(get_registry().histograms_, _name);
+        }
+
+        std::string format()
+        {
+            auto &reg = get_registry();
+
+            boost::unique_lock<boost::mutex> lock(reg.mutex_);
+
+            std::stringstream text;
+
+            for (const auto &metric : reg.counters_)
+            {
+                text << "counter " << metric.first << " = " << metric.second->get() << "\n";
+            }
+
+            for (const auto &metric : reg.gauges_)
+            {
+                text << "gauge " << metric.first << " = " << metric.second->get() << " max=" << metric.second->get_max() << "\n";
+            }
+
+            for (const auto &metric : reg.histograms_)
+            {
+                const auto &values = *metric.second;
+
+                text << "histogram " << metric.first << " count=" << values.count();
+
+                if (values.count() > 0)
+                {
+                    text << " avg=" << (values.get_sum() / values.count())
+                        << " p50<=" << values.percentile(0.5)
+                        << " p90<=" << values.percentile(0.9)
+                        << " p99<=" << values.percentile(0.99)
+                        << " max=" << values.get_max();
+                }
+
+                text << "\n";
+            }
+
+            return text.str();
+        }
+
+        void serialize(icollection *_coll)
+        {
+            coll_helper coll(_coll, false);
+
+            auto &reg = get_registry();
+
+            boost::unique_lock<boost::mutex> lock(reg.mutex_);
+
+            ifptr<iarray> metrics_array(_coll->create_array());
+            metrics_array->reserve((int32_t)(reg.counters_.size() + reg.gauges_.size() + reg.histograms_.size()));
+
+            for (const auto &metric : reg.counters_)
+            {
+                coll_helper metric_coll(_coll->create_collection(), true);
+                metric_coll.set_value_as_string("name", metric.first);
+                metric_coll.set_value_as_string("type", "counter");
+                metric_coll.set_value_as_int64("value", metric.second->get());
+
+                add_to_array(_coll, metrics_array.get(), metric_coll);
+            }
+
+            for (const auto &metric : reg.gauges_)
+            {
+                coll_helper metric_coll(_coll->create_collection(), true);
+                metric_coll.set_value_as_string("name", metric.first);
+                metric_coll.set_value_as_string("type", "gauge");
+                metric_coll.set_value_as_int64("value", metric.second->get());
+                metric_coll.set_value_as_int64("max", metric.second->get_max());
+
+                add_to_array(_coll, metrics_array.get(), metric_coll);
+            }
+
+            for (const auto &metric : reg.histograms_)
+            {
+                const auto &values = *metric.second;
+
+                coll_helper metric_coll(_coll->create_collection(), true);
+                metric_coll.set_value_as_string("name", metric.first);
+                metric_coll.set_value_as_string("type", "histogram");
+                metric_coll.set_value_as_int64("count", values.count());
+                metric_coll.set_value_as_int64("sum", values.get_sum());
+                metric_coll.set_value_as_int64("p50", values.percentile(0.5));
+                metric_coll.set_value_as_int64("p90", values.percentile(0.9));
+                metric_coll.set_value_as_int64("p99", values.percentile(0.99));
+                metric_coll.set_value_as_int64("max", values.get_max());
+
+                add_to_array(_coll, metrics_array.get(), metric_coll);
+            }
+
+            coll.set_value_as_array("metrics", metrics_array.get());
+        }
+
+    }
+}
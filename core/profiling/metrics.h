@@ -0,0 +1,114 @@
+#pragma once
+
+namespace core
+{
+    class icollection;
+
+    // counters, gauges and latency histograms of the hot paths, cheap enough to stay on in release builds;
+    // a metric is looked up by name once and then updated with relaxed atomics, no locks
+    namespace metrics
+    {
+
+        class counter : boost::noncopyable
+        {
+        public:
+            counter();
+
+            void add(const int64_t _value = 1)
+            {
+                value_.fetch_add(_value, std::memory_order_relaxed);
+            }
+
+            int64_t get() const;
+
+        private:
+            std::atomic<int64_t> value_;
+
+        };
+
+        // a level, such as the depth of a queue; the highest level seen is kept as well
+        class gauge : boost::noncopyable
+        {
+        public:
+            gauge();
+
+            void set(const int64_t _value)
+            {
+                value_.store(_value, std::memory_order_relaxed);
+                update_max(_value);
+            }
+
+            void add(const int64_t _delta)
+            {
+                update_max(value_.fetch_add(_delta, std::memory_order_relaxed) + _delta);
+            }
+
+            int64_t get() const;
+
+            int64_t get_max() const;
+
+        private:
+            void update_max(const int64_t _value)
+            {
+                auto max = max_.load(std::memory_order_relaxed);
+                while (_value > max && !max_.compare_exchange_weak(max, _value, std::memory_order_relaxed));
+            }
+
+            std::atomic<int64_t> value_;
+
+            std::atomic<int64_t> max_;
+
+        };
+
+        // HDR-style buckets: 8 linear sub-buckets to every power of two,
+        // so a percentile is off by 12.5% at most at any scale; values from 2^41 on share the last bucket
+        class histogram : boost::noncopyable
+        {
+        public:
+            static const int32_t sub_buckets_count = 8;
+
+            static const int32_t buckets_count = 312;
+
+            histogram();
+
+            void record(int64_t _value);
+
+            int64_t count() const;
+
+            int64_t get_sum() const;
+
+            int64_t get_max() const;
+
+            // upper bound of the bucket holding the given share of the values
+            int64_t percentile(const double _share) const;
+
+            static int32_t get_bucket(const int64_t _value);
+
+            static int64_t get_bucket_upper_bound(const int32_t _bucket);
+
+        private:
+            std::atomic<int64_t> buckets_[buckets_count];
+
+            std::atomic<int64_t> count_;
+
+            std::atomic<int64_t> sum_;
+
+            std::atomic<int64_t> max_;
+
+        };
+
+        // the metric is created on the first call and lives as long as the process,
+        // so the reference may be kept in a static or in a member
+        counter& get_counter(const std::string &_name);
+
+        gauge& get_gauge(const std::string &_name);
+
+        histogram& get_histogram(const std::string &_name);
+
+        // one line a metric, sorted by name
+        std::string format();
+
+        void serialize(icollection *_coll);
+
+    }
+}
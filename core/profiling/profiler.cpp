@@ -2,7 +2,9 @@
 
 #include "profiler.h"
 
+#include "../../corelib/spsc_channel.h"
 #include "../log/log.h"
+#include "../tools/binary_stream.h"
 #include "../tools/coretime.h"
 
 using namespace core;
@@ -10,17 +12,39 @@ using namespace tools;
 
 namespace
 {
-    struct process_info
+    enum class event_type : uint8_t
     {
-        process_info(const std::string &_name, const int64_t _time_started);
+        span,
+        async_begin,
+        async_end,
+        instant
+    };
+
+    // the pids of the trace
+    enum class event_process : uint8_t
+    {
+        core = 1,
+        gui = 2
+    };
+
+    // microseconds since the start of the process
+    struct trace_event
+    {
+        trace_event();
+
+        const char *name_;
+
+        int64_t ts_;
 
-        int64_t get_duration() const;
+        int64_t duration_;
 
-        const std::string name_;
+        int64_t id_;
 
-        const int64_t time_started_;
+        uint32_t tid_;
 
-        int64_t time_ended_;
+        event_type type_;
+
+        event_process process_;
     };
 
     struct process_stat
@@ -38,17 +62,64 @@ namespace
         int64_t times_hit_;
     };
 
-    void start_process(const char*_name, const int64_t _process_id, const int64_t _ts);
+    // written by its thread only, read under timeline_mutex_
+    struct thread_buffer
+    {
+        thread_buffer(const uint32_t _tid);
+
+        const uint32_t tid_;
+
+        spsc_ring<trace_event> ring_;
+    };
+
+    const size_t thread_buffer_capacity = 1024;
+
+    // 48 bytes an event, a dozen of megabytes at most
+    const size_t max_timeline_size = 256 * 1024;
+
+    int64_t now_us();
+
+    void record(trace_event &_event);
+
+    void drain(thread_buffer &_buffer);
+
+    void drain_all();
+
+    const char* intern(const std::string &_name);
 
-    void stop_process(const int64_t _process_id, const int64_t _ts);
+    std::string escape(const char *_text);
 
     std::atomic<int64_t> process_uid_(0);
 
-    std::map<int64_t, process_info> process_info_accum_;
+    std::atomic<bool> is_profiling_enabled_(false);
 
-    boost::mutex process_info_accum_mutex_;
+    // taken as the core library is loaded, close enough to the start of the process
+    const int64_t process_start_ts_ = time::now_ms();
 
-    bool is_profiling_enabled_ = false;
+    const auto process_start_steady_ = std::chrono::steady_clock::now();
+
+    // the gui stamps its spans with the wall clock
+    const int64_t process_start_epoch_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::atomic<uint32_t> thread_uid_(0);
+
+    thread_local std::shared_ptr<thread_buffer> thread_buffer_;
+
+    // the buffers outlive their threads, so the events of a finished thread are still exported
+    std::vector<std::shared_ptr<thread_buffer>> thread_buffers_;
+
+    std::vector<trace_event> timeline_;
+
+    int64_t dropped_events_ = 0;
+
+    std::set<std::string> interned_names_;
+
+    boost::mutex timeline_mutex_;
+
+    std::map<std::string, int64_t> startup_phases_;
+
+    boost::mutex startup_phases_mutex_;
 }
 
 namespace core
@@ -59,21 +130,42 @@ namespace core
         using namespace std::chrono;
 
         auto_stop_watch::auto_stop_watch(const char *_process_name)
+            : name_(_process_name)
+            , started_(-1)
         {
             assert(_process_name);
             assert(::strlen(_process_name));
 
-            id_ = process_started(_process_name);
+            if (is_enabled())
+            {
+                started_ = now_us();
+            }
         }
 
         auto_stop_watch::~auto_stop_watch()
         {
-            process_stopped(id_);
+            if (started_ < 0 || !is_enabled())
+            {
+                return;
+            }
+
+            trace_event event;
+            event.name_ = name_;
+            event.ts_ = started_;
+            event.duration_ = (now_us() - started_);
+            event.type_ = event_type::span;
+
+            record(event);
         }
 
         void enable(const bool _enable)
         {
-            is_profiling_enabled_ = _enable;
+            is_profiling_enabled_.store(_enable, std::memory_order_relaxed);
+        }
+
+        bool is_enabled()
+        {
+            return is_profiling_enabled_.load(std::memory_order_relaxed);
         }
 
         int64_t process_started(const char *_name)
@@ -81,14 +173,20 @@ namespace core
             assert(_name);
             assert(::strlen(_name));
 
-            if (!is_profiling_enabled_)
+            if (!is_enabled())
             {
                 return -1;
             }
 
             const auto process_id = ++process_uid_;
 
-            start_process(_name, process_id, time::now_ms());
+            trace_event event;
+            event.name_ = _name;
+            event.ts_ = now_us();
+            event.id_ = process_id;
+            event.type_ = event_type::async_begin;
+
+            record(event);
 
             return process_id;
         }
@@ -100,24 +198,35 @@ namespace core
             assert(_process_id > INT32_MAX);
             assert(_ts > 0);
 
-            if (!is_profiling_enabled_)
+            if (!is_enabled())
             {
                 return;
             }
 
-            start_process(_name, _process_id, _ts);
+            trace_event event;
+            event.name_ = intern(_name);
+            event.ts_ = (_ts - process_start_epoch_ms_) * 1000;
+            event.id_ = _process_id;
+            event.type_ = event_type::async_begin;
+            event.process_ = event_process::gui;
+
+            record(event);
         }
 
         void process_stopped(const int64_t _process_id)
         {
-            assert(_process_id > 0);
-
-            if (!is_profiling_enabled_)
+            // -1 comes from a process started while the profiler was off
+            if (_process_id <= 0 || !is_enabled())
             {
                 return;
             }
 
-            stop_process(_process_id, time::now_ms());
+            trace_event event;
+            event.ts_ = now_us();
+            event.id_ = _process_id;
+            event.type_ = event_type::async_end;
+
+            record(event);
         }
 
         void process_stopped(const int64_t _process_id, const int64_t _ts)
@@ -125,44 +234,160 @@ namespace core
             assert(_process_id > INT32_MAX);
             assert(_ts > 0);
 
-            if (!is_profiling_enabled_)
+            if (!is_enabled())
             {
                 return;
             }
 
-            stop_process(_process_id, _ts);
+            trace_event event;
+            event.ts_ = (_ts - process_start_epoch_ms_) * 1000;
+            event.id_ = _process_id;
+            event.type_ = event_type::async_end;
+            event.process_ = event_process::gui;
+
+            record(event);
+        }
+
+        bool export_trace(const std::wstring &_file_name)
+        {
+            assert(!_file_name.empty());
+
+            boost::unique_lock<boost::mutex> lock(timeline_mutex_);
+
+            drain_all();
+
+            std::map<int64_t, const trace_event*> begins;
+            for (const auto &event : timeline_)
+            {
+                if (event.type_ == event_type::async_begin)
+                {
+                    begins.emplace(event.id_, &event);
+                }
+            }
+
+            std::stringstream json;
+            json << "{\"traceEvents\":[\n";
+            json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << (int32_t)event_process::core << ",\"tid\":0,\"args\":{\"name\":\"core\"}},\n";
+            json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << (int32_t)event_process::gui << ",\"tid\":0,\"args\":{\"name\":\"gui\"}}";
+
+            for (const auto &event : timeline_)
+            {
+                const auto pid = (int32_t)event.process_;
+
+                switch (event.type_)
+                {
+                    case event_type::span:
+                        json << ",\n{\"name\":\"" << escape(event.name_) << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << event.tid_
+                            << ",\"ts\":" << event.ts_ << ",\"dur\":" << event.duration_ << "}";
+                        break;
+
+                    case event_type::instant:
+                        json << ",\n{\"name\":\"" << escape(event.name_) << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":" << pid << ",\"tid\":" << event.tid_
+                            << ",\"ts\":" << event.ts_ << "}";
+                        break;
+
+                    case event_type::async_begin:
+                        // the gui stop watches are scoped to its main thread and nest as the plain spans do
+                        if (event.process_ == event_process::gui)
+                        {
+                            break;
+                        }
+
+                        json << ",\n{\"name\":\"" << escape(event.name_) << "\",\"cat\":\"async\",\"ph\":\"b\",\"id\":" << event.id_
+                            << ",\"pid\":" << pid << ",\"tid\":" << event.tid_ << ",\"ts\":" << event.ts_ << "}";
+                        break;
+
+                    case event_type::async_end:
+                    {
+                        const auto begin = begins.find(event.id_);
+                        if (begin == begins.end())
+                        {
+                            break;
+                        }
+
+                        const auto &started = *begin->second;
+
+                        if (event.process_ == event_process::gui)
+                        {
+                            json << ",\n{\"name\":\"" << escape(started.name_) << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":1"
+                                << ",\"ts\":" << started.ts_ << ",\"dur\":" << (event.ts_ - started.ts_) << "}";
+                            break;
+                        }
+
+                        json << ",\n{\"name\":\"" << escape(started.name_) << "\",\"cat\":\"async\",\"ph\":\"e\",\"id\":" << event.id_
+                            << ",\"pid\":" << pid << ",\"tid\":" << event.tid_ << ",\"ts\":" << event.ts_ << "}";
+                        break;
+                    }
+
+                    default:
+                        assert(!"unknown trace event type");
+                }
+            }
+
+            json << "\n],\n\"otherData\":{\"dropped_events\":" << dropped_events_ << "}}\n";
+
+            lock.unlock();
+
+            binary_stream bs;
+            bs.write<std::string>(json.str());
+
+            return bs.save_2_file(_file_name);
         }
 
         void flush_logs()
         {
-            if (!is_profiling_enabled_)
+            if (!is_enabled())
             {
                 return;
             }
 
-            boost::unique_lock<boost::mutex> lock(process_info_accum_mutex_);
+            boost::unique_lock<boost::mutex> lock(timeline_mutex_);
+
+            drain_all();
+
+            std::map<int64_t, const trace_event*> begins;
 
             std::map<std::string, process_stat> stats;
 
-            for (const auto &pair : process_info_accum_)
+            const auto add_duration = [&stats](const char *_name, const int64_t _duration)
             {
-                const auto &info = pair.second;
+                auto &stat_entry = stats[_name];
+
+                ++stat_entry.times_hit_;
+                stat_entry.min_duration_ = std::min(stat_entry.min_duration_, _duration);
+                stat_entry.max_duration_ = std::max(stat_entry.max_duration_, _duration);
+                stat_entry.overall_duration_ += _duration;
+            };
 
-                auto stats_iter = stats.find(info.name_);
-                if (stats_iter == stats.end())
+            for (const auto &event : timeline_)
+            {
+                if (event.type_ == event_type::span)
                 {
-                    stats_iter = stats.emplace(info.name_, process_stat()).first;
+                    add_duration(event.name_, event.duration_);
+                    continue;
                 }
 
-                auto &stat_entry = stats_iter->second;
+                if (event.type_ == event_type::async_begin)
+                {
+                    begins.emplace(event.id_, &event);
+                    continue;
+                }
 
-                ++stat_entry.times_hit_;
-                stat_entry.min_duration_ = std::min(stat_entry.min_duration_, info.get_duration());
-                stat_entry.max_duration_ = std::max(stat_entry.max_duration_, info.get_duration());
-                stat_entry.overall_duration_ += info.get_duration();
+                if (event.type_ == event_type::async_end)
+                {
+                    const auto begin = begins.find(event.id_);
+                    if (begin != begins.end())
+                    {
+                        add_duration(begin->second->name_, (event.ts_ - begin->second->ts_));
+                    }
+                }
             }
 
-            process_info_accum_.clear();
+            const auto dropped_events = dropped_events_;
+
+            begins.clear();
+            timeline_.clear();
+            dropped_events_ = 0;
 
             lock.unlock();
 
@@ -195,10 +420,10 @@ namespace core
                     "process stats\n"
                     "	name = <%s>\n"
                     "	times-hit = <%d>\n"
-                    "	min-duration=<%d>\n"
-                    "	max-duration=<%d>\n"
-                    "	avg-duration=<%d>\n"
-                    "	overall-duration=<%d>\n");
+                    "	min-duration-us=<%d>\n"
+                    "	max-duration-us=<%d>\n"
+                    "	avg-duration-us=<%d>\n"
+                    "	overall-duration-us=<%d>\n");
 
                 process_info_fmt
                     % process_name
@@ -210,6 +435,67 @@ namespace core
 
                 log::info("profiler", process_info_fmt);
             }
+
+            if (dropped_events > 0)
+            {
+                boost::format dropped_fmt(
+                    "timeline overflow\n"
+                    "	dropped-events = <%d>\n");
+
+                dropped_fmt % dropped_events;
+
+                log::warn("profiler", dropped_fmt);
+            }
+        }
+
+        void startup_phase(const char *_name)
+        {
+            assert(_name);
+            assert(::strlen(_name));
+
+            const auto elapsed = (time::now_ms() - process_start_ts_);
+
+            boost::unique_lock<boost::mutex> lock(startup_phases_mutex_);
+
+            const auto insertion_result = startup_phases_.emplace(_name, elapsed);
+            if (!insertion_result.second)
+            {
+                return;
+            }
+
+            // the phases are never erased, the key stays put for the timeline
+            const auto name = insertion_result.first->first.c_str();
+
+            lock.unlock();
+
+            if (is_enabled())
+            {
+                trace_event event;
+                event.name_ = name;
+                event.ts_ = now_us();
+                event.type_ = event_type::instant;
+
+                record(event);
+            }
+
+            boost::format phase_fmt(
+                "startup phase\n"
+                "	name = <%s>\n"
+                "	since-process-start = <%d>\n");
+
+            phase_fmt % _name % elapsed;
+
+            log::info("profiler", phase_fmt);
+        }
+
+        int64_t get_startup_phase(const char *_name)
+        {
+            assert(_name);
+
+            boost::unique_lock<boost::mutex> lock(startup_phases_mutex_);
+
+            const auto iter = startup_phases_.find(_name);
+            return (iter == startup_phases_.end() ? -1 : iter->second);
         }
 
     }
@@ -218,45 +504,126 @@ namespace core
 namespace
 {
 
-    void start_process(const char *_name, const int64_t _process_id, const int64_t _ts)
+    int64_t now_us()
     {
-        assert(_name);
-        assert(::strlen(_name));
-        assert(_process_id > 0);
-        assert(_ts > 0);
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - process_start_steady_).count();
+    }
+
+    // lock-free unless the ring of the thread is full
+    void record(trace_event &_event)
+    {
+        auto &buffer = thread_buffer_;
+        if (!buffer)
+        {
+            buffer = std::make_shared<thread_buffer>(++thread_uid_);
+
+            boost::unique_lock<boost::mutex> lock(timeline_mutex_);
+            thread_buffers_.push_back(buffer);
+        }
 
-        boost::unique_lock<boost::mutex> lock(process_info_accum_mutex_);
+        _event.tid_ = buffer->tid_;
 
-        const auto insertion_result = process_info_accum_.emplace(_process_id, process_info(_name, _ts));
-        assert(insertion_result.second);
+        if (buffer->ring_.push(_event))
+        {
+            return;
+        }
+
+        boost::unique_lock<boost::mutex> lock(timeline_mutex_);
+
+        drain(*buffer);
+
+        if (!buffer->ring_.push(_event))
+        {
+            ++dropped_events_;
+        }
+    }
+
+    // under timeline_mutex_
+    void drain(thread_buffer &_buffer)
+    {
+        trace_event event;
+        while (_buffer.ring_.pop(event))
+        {
+            if (timeline_.size() < max_timeline_size)
+            {
+                timeline_.push_back(event);
+            }
+            else
+            {
+                ++dropped_events_;
+            }
+        }
+    }
+
+    // under timeline_mutex_
+    void drain_all()
+    {
+        for (const auto &buffer : thread_buffers_)
+        {
+            drain(*buffer);
+        }
+
+        // the rings are drained one by one, the events of different threads come interleaved
+        std::stable_sort(
+            timeline_.begin(),
+            timeline_.end(),
+            [](const trace_event &l, const trace_event &r)
+        {
+            return (l.ts_ < r.ts_);
+        }
+        );
     }
 
-    void stop_process(const int64_t _process_id, const int64_t _ts)
+    const char* intern(const std::string &_name)
     {
-        assert(_process_id > 0);
-        assert(_ts > 0);
+        boost::unique_lock<boost::mutex> lock(timeline_mutex_);
 
-        boost::unique_lock<boost::mutex> lock(process_info_accum_mutex_);
+        return interned_names_.insert(_name).first->c_str();
+    }
+
+    std::string escape(const char *_text)
+    {
+        assert(_text);
 
-        auto iter = process_info_accum_.find(_process_id);
-        assert(iter != process_info_accum_.end());
+        std::string escaped;
+
+        for (auto iter = _text; *iter; ++iter)
+        {
+            const auto ch = *iter;
 
-        iter->second.time_ended_ = _ts;
+            if (ch == '"' || ch == '\\')
+            {
+                escaped += '\\';
+                escaped += ch;
+            }
+            else if ((unsigned char)ch < 0x20)
+            {
+                escaped += ' ';
+            }
+            else
+            {
+                escaped += ch;
+            }
+        }
+
+        return escaped;
     }
 
-    process_info::process_info(const std::string &_name, const int64_t _time_started)
-        : name_(_name)
-        , time_started_(_time_started)
-        , time_ended_(-1)
+    trace_event::trace_event()
+        : name_(nullptr)
+        , ts_(0)
+        , duration_(0)
+        , id_(0)
+        , tid_(0)
+        , type_(event_type::span)
+        , process_(event_process::core)
     {
-        assert(!_name.empty());
-        assert(_time_started > 0);
     }
 
-    int64_t process_info::get_duration() const
+    thread_buffer::thread_buffer(const uint32_t _tid)
+        : tid_(_tid)
+        , ring_(thread_buffer_capacity)
     {
-        assert(time_ended_ > 0);
-        return (time_ended_ - time_started_);
     }
 
     process_stat::process_stat()
@@ -274,4 +641,4 @@ namespace
         return (overall_duration_ / times_hit_);
     }
 
-}
\ No newline at end of file
+}
@@ -6,6 +6,8 @@ namespace core
     namespace profiler
     {
 
+        // a span on the timeline of the current thread, nested in the spans still open on it;
+        // _process_name must outlive the profiler, a string literal
         class auto_stop_watch : boost::noncopyable
         {
         public:
@@ -14,22 +16,41 @@ namespace core
             virtual ~auto_stop_watch();
 
         private:
-            int64_t id_;
+            const char *name_;
+
+            int64_t started_;
 
         };
 
         void enable(const bool _enable);
 
+        bool is_enabled();
+
+        // a span that may end on another thread, such as a request and its reply;
+        // _name must outlive the profiler, a string literal
         int64_t process_started(const char *_name);
 
         void process_stopped(const int64_t _process_id);
 
+        // a span of the gui, ms since the epoch
         void process_started(const char *_name, const int64_t _process_id, const int64_t _ts);
 
         void process_stopped(const int64_t _process_id, const int64_t _ts);
 
+        // the timeline recorded so far in the Chrome trace event format,
+        // to be opened in chrome://tracing or attached to a bug report
+        bool export_trace(const std::wstring &_file_name);
+
+        // logs the per-name durations and clears the timeline
         void flush_logs();
 
+        // a phase of the cold start is reached, such as "roster" or "recents";
+        // the time is taken from the start of the process, only the first hit of a phase counts
+        void startup_phase(const char *_name);
+
+        // ms from the start of the process to the phase, -1 if it is not reached yet
+        int64_t get_startup_phase(const char *_name);
+
     }
 
-}
\ No newline at end of file
+}
@@ -27,6 +27,7 @@ enum statistics_info_types
     last_sent_time = 7,
     event_time = 8,
     event_id = 9,
+    event_record = 10,
 };
 
 long long statistics::stats_event::session_event_id_ = 0;
@@ -34,7 +35,8 @@ std::shared_ptr<statistics::stop_objects> statistics::stop_objects_;
 
 statistics::statistics(const std::wstring& _file_name)
     : file_name_(_file_name)
-    , changed_(false)
+    , saved_events_count_(0)
+    , rewrite_file_(true)
     , stats_thread_(std::make_unique<async_executer>())
     , last_sent_time_(std::chrono::system_clock::now())
 {
@@ -66,13 +68,17 @@ void statistics::start_save()
 {
     std::weak_ptr<statistics> wr_this = shared_from_this();
 
+    // the events are inserted on the core thread
     save_timer_ =  g_core->add_timer([wr_this]
     {
-        auto ptr_this = wr_this.lock();
-        if (!ptr_this)
-            return;
+        g_core->execute_core_context([wr_this]
+        {
+            auto ptr_this = wr_this.lock();
+            if (!ptr_this)
+                return;
 
-        ptr_this->save_if_needed();
+            ptr_this->save_if_needed();
+        });
     }, save_to_file_interval);
 }
 
@@ -115,7 +121,15 @@ bool statistics::load()
     if (!bstream.load_from_file(file_name_))
         return false;
 
-    return unserialize(bstream);
+    rewrite_file_ = false;
+
+    const auto loaded = unserialize(bstream);
+    if (!loaded)
+        rewrite_file_ = true;
+
+    saved_events_count_ = events_.size();
+
+    return loaded;
 }
 
 void statistics::serialize(tools::binary_stream& _bs) const
@@ -133,37 +147,13 @@ void statistics::serialize(tools::binary_stream& _bs) const
         pack.push_child(tools::tlv(++counter, bs_value));
     }
 
-    for (auto stat_event = events_.begin(); stat_event != events_.end(); ++stat_event)
-    {
-        tools::tlvpack value_tlv;
-        // TODO : push id, time, ..
-        value_tlv.push_child(tools::tlv(statistics_info_types::event_name, stat_event->get_name()));
-        value_tlv.push_child(tools::tlv(statistics_info_types::event_time, (int64_t)std::chrono::system_clock::to_time_t(stat_event->get_time())));
-        value_tlv.push_child(tools::tlv(statistics_info_types::event_id, (int64_t)stat_event->get_id()));
-
-        tools::tlvpack props_pack;
-        int32_t prop_counter = 0;
-        auto props = stat_event->get_props();
-
-        for (auto prop : props)
-        {
-            tools::tlvpack value_tlv_prop;
-            value_tlv_prop.push_child(tools::tlv(statistics_info_types::event_prop_name, prop.first));
-            value_tlv_prop.push_child(tools::tlv(statistics_info_types::event_prop_value, prop.second));
-
-            tools::binary_stream bs_value;
-            value_tlv_prop.serialize(bs_value);
-            props_pack.push_child(tools::tlv(++prop_counter, bs_value));
-        }
-
-        value_tlv.push_child(tools::tlv(statistics_info_types::event_props, props_pack));
+    pack.serialize(_bs);
 
-        tools::binary_stream bs_value;
-        value_tlv.serialize(bs_value);
-        pack.push_child(tools::tlv(++counter, bs_value));
+    for (const auto& stat_event : events_)
+    {
+        const auto& record = stat_event.get_record();
+        _bs.write(record.data(), (uint32_t)record.size());
     }
-
-    pack.serialize(_bs);
 }
 
 bool unserialize_props(tools::tlvpack& prop_pack, event_props_type* props)
@@ -203,14 +193,18 @@ bool statistics::unserialize(tools::binary_stream& _bs)
         return false;
     }
 
-    tools::tlvpack pack;
-    if (!pack.unserialize(_bs))
-        return false;
-
     int32_t counter = 0;
-    for (auto tlv_val = pack.get_first(); tlv_val; tlv_val = pack.get_next())
+    while (_bs.available())
     {
-        tools::binary_stream val_data = tlv_val->get_value<tools::binary_stream>();
+        // the records are appended, a write cut short leaves a broken tail; the events before it are kept
+        tools::tlv tlv_val;
+        if (!tlv_val.unserialize(_bs))
+        {
+            rewrite_file_ = true;
+            return (counter > 0);
+        }
+
+        tools::binary_stream val_data = tlv_val.get_value<tools::binary_stream>();
 
         tools::tlvpack pack_val;
         if (!pack_val.unserialize(val_data))
@@ -272,20 +266,64 @@ bool statistics::unserialize(tools::binary_stream& _bs)
 
 void statistics::save_if_needed()
 {
-    if (changed_)
+    std::wstring file_name = file_name_;
+
+    if (rewrite_file_)
     {
-        changed_ = false;
+        rewrite_file_ = false;
+        saved_events_count_ = events_.size();
 
         auto bs_data = std::make_shared<tools::binary_stream>();
         serialize(*bs_data);
-        std::wstring file_name = file_name_;
 
         g_core->save_async([bs_data, file_name]
         {
             bs_data->save_2_file(file_name);
             return 0;
         });
+
+        return;
     }
+
+    if (saved_events_count_ == events_.size())
+        return;
+
+    // only the records of the new events, they were encoded on insertion
+    auto records = std::make_shared<std::string>();
+    for (auto stat_event = events_.begin() + saved_events_count_; stat_event != events_.end(); ++stat_event)
+        records->append(stat_event->get_record());
+
+    saved_events_count_ = events_.size();
+
+    // the save thread is one, so an append never overtakes the rewrite before it
+    g_core->save_async([records, file_name]
+    {
+        auto file = tools::system::open_file_for_write(file_name, std::ofstream::binary | std::ofstream::app);
+        if (!file.is_open())
+            return -1;
+
+        file.write(records->data(), records->size());
+        file.flush();
+
+        return (file.good() ? 0 : -1);
+    });
+}
+
+void statistics::drop_oldest_events()
+{
+    // the session starts are kept, they carry the user key of the events after them
+    auto to_drop = events_.size() - max_events_count * 3 / 4;
+
+    events_.erase(std::remove_if(events_.begin(), events_.end(), [&to_drop](const stats_event& _event)
+    {
+        if (to_drop == 0 || _event.get_name() == stats_event_names::service_session_start)
+            return false;
+
+        --to_drop;
+        return true;
+    }), events_.end());
+
+    rewrite_file_ = true;
 }
 
 void statistics::clear()
@@ -304,7 +342,7 @@ void statistics::clear()
     events_.clear();
     events_.push_back(last_service_event);
 
-    changed_ = true;
+    rewrite_file_ = true;
 
     // reset_session_event_id();
     // TODO : mb need save map with counts here?
@@ -349,7 +387,7 @@ std::string statistics::events_to_json(events_ci begin, events_ci end, time_t _s
     {
         if (stat_event != begin)
             data_stream << ",";
-        data_stream << stat_event->to_string(_start_time);
+        stat_event->to_string(_start_time, data_stream);
         ++events_and_count[stat_event->get_name()];
     }
 
@@ -478,7 +516,9 @@ void statistics::insert_event(stats_event_names _event_name, const event_props_t
                               std::chrono::system_clock::time_point _event_time, int32_t _event_id)
 {
     events_.emplace_back(_event_name, _event_time, _event_id, _props);
-    changed_ = true;
+
+    if (events_.size() > max_events_count)
+        drop_oldest_events();
 }
 
 void statistics::insert_event(stats_event_names _event_name, const event_props_type& _props)
@@ -507,29 +547,75 @@ statistics::stats_event::stats_event(stats_event_names _name,
         event_id_ = session_event_id_++; // started from 1
     else
         event_id_ = _event_id;
+
+    encode();
 }
 
-std::string statistics::stats_event::to_string(time_t _start_time) const
+void statistics::stats_event::encode()
 {
-    std::stringstream result;
+    tools::tlvpack value_tlv;
+    value_tlv.push_child(tools::tlv(statistics_info_types::event_name, name_));
+    value_tlv.push_child(tools::tlv(statistics_info_types::event_time, (int64_t)std::chrono::system_clock::to_time_t(event_time_)));
+    value_tlv.push_child(tools::tlv(statistics_info_types::event_id, (int64_t)event_id_));
+
+    tools::tlvpack props_pack;
+    int32_t prop_counter = 0;
+
+    for (const auto& prop : props_)
+    {
+        tools::tlvpack value_tlv_prop;
+        value_tlv_prop.push_child(tools::tlv(statistics_info_types::event_prop_name, prop.first));
+        value_tlv_prop.push_child(tools::tlv(statistics_info_types::event_prop_value, prop.second));
+
+        tools::binary_stream bs_value;
+        value_tlv_prop.serialize(bs_value);
+        props_pack.push_child(tools::tlv(++prop_counter, bs_value));
+    }
+
+    value_tlv.push_child(tools::tlv(statistics_info_types::event_props, props_pack));
+
+    tools::binary_stream bs_value;
+    value_tlv.serialize(bs_value);
+
+    // the type of a record is not read back, only the header must come first
+    tools::binary_stream bs_record;
+    tools::tlv(statistics_info_types::event_record, bs_value).serialize(bs_record);
+
+    const auto record_size = bs_record.available();
+    record_.assign(bs_record.read(record_size), record_size);
 
     // TODO : use actual params here
     auto br = 0;
 
-    std::stringstream params_in_json;
+    std::stringstream head;
+    head << "{\"ce\":" << event_id_
+        << ",\"bp\":\"" << name_
+        << "\",\"bq\":";
+    json_head_ = head.str();
+
+    std::stringstream tail;
+    tail << ",\"bs\":{";
     for (auto prop = props_.begin(); prop != props_.end(); ++prop)
     {
         if (prop != props_.begin())
-            params_in_json << ",";
-        params_in_json << "\"" << prop->first << "\":\"" << prop->second << "\"";
+            tail << ",";
+        tail << "\"" << prop->first << "\":\"" << prop->second << "\"";
     }
-
-    result << "{\"ce\":" << event_id_
-        << ",\"bp\":\"" << name_
-        << "\",\"bq\":" << std::chrono::system_clock::to_time_t(event_time_) * 1000 - _start_time// milliseconds
-        << ",\"bs\":{" << params_in_json.str() <<"},"
+    tail << "},"
         << "\"br\":" << br << "}";
-    return result.str();
+    json_tail_ = tail.str();
+}
+
+void statistics::stats_event::to_string(time_t _start_time, std::ostream& _out) const
+{
+    _out << json_head_
+        << std::chrono::system_clock::to_time_t(event_time_) * 1000 - _start_time // milliseconds
+        << json_tail_;
+}
+
+const std::string& statistics::stats_event::get_record() const
+{
+    return record_;
 }
 
 stats_event_names statistics::stats_event::get_name() const
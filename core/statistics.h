@@ -23,6 +23,9 @@ namespace core
     const static auto save_to_file_interval = std::chrono::seconds(10);
     const static auto delay_send_on_start = std::chrono::seconds(10);
 
+    // the oldest events are dropped above it, if the sending keeps failing
+    const static size_t max_events_count = 20000;
+
     namespace stats
     {
         enum class stats_event_names;
@@ -34,19 +37,28 @@ namespace core
             class stats_event
             {
             public:
-                std::string to_string(time_t _start_time) const;
+                void to_string(time_t _start_time, std::ostream& _out) const;
                 stats_event(stats_event_names _name, std::chrono::system_clock::time_point _event_time, int32_t _event_id, const event_props_type& props);
                 stats_event_names get_name() const;
                 event_props_type get_props() const;
                 static void reset_session_event_id();
                 std::chrono::system_clock::time_point get_time() const;
                 int32_t get_id() const;
+                const std::string& get_record() const;
             private:
+                void encode();
+
                 stats_event_names name_;
                 int32_t event_id_; // natural serial number, starting from 1
                 event_props_type props_;
                 static long long session_event_id_;
                 std::chrono::system_clock::time_point event_time_;
+
+                // encoded once, as the event is inserted:
+                // the tlv of the event in the file and its json around the time, which is relative to the session start
+                std::string record_;
+                std::string json_head_;
+                std::string json_tail_;
             };
 
             struct stop_objects
@@ -64,7 +76,10 @@ namespace core
             std::map<std::string, tools::binary_stream> values_;
             std::wstring file_name_;
 
-            bool changed_;
+            // the file is a header and then the records of the events, new records are appended to it;
+            // it is rewritten whole only when events are dropped: after a send or above max_events_count
+            size_t saved_events_count_;
+            bool rewrite_file_;
             uint32_t save_timer_;
             uint32_t send_timer_;
             uint32_t start_send_timer_;
@@ -78,6 +93,7 @@ namespace core
             void serialize(tools::binary_stream& _bs) const;
             bool unserialize(tools::binary_stream& _bs);
             void save_if_needed();
+            void drop_oldest_events();
             void send_async();
             bool load();
             void start_save();
@@ -0,0 +1,446 @@
+#include "stdafx.h"
+
+#include "sticker_pack.h"
+
+#include "../../corelib/core_face.h"
+#include "../../corelib/enumerations.h"
+
+#include "../tools/system.h"
+
+namespace core
+{
+    namespace stickers
+    {
+        namespace
+        {
+            const uint32_t pack_magic = 0x4b505453; // "STPK"
+            const uint32_t pack_version = 1;
+
+            const wchar_t pack_file_prefix[] = L"pack_";
+            const wchar_t pack_file_ext[] = L".stp";
+
+            const int32_t icon_item_id = -1;
+
+            //////////////////////////////////////////////////////////////////////////
+            // image_stream: read-only istream over image_data
+            //////////////////////////////////////////////////////////////////////////
+            class image_stream : public core::istream
+            {
+                std::atomic<int32_t> ref_count_;
+
+                image_data data_;
+                uint32_t cursor_;
+
+                virtual int32_t addref() override
+                {
+                    return ++ref_count_;
+                }
+
+                virtual int32_t release() override
+                {
+                    if (0 == (--ref_count_))
+                    {
+                        delete this;
+                        return 0;
+                    }
+
+                    return ref_count_;
+                }
+
+                virtual uint8_t* read(uint32_t _size) override
+                {
+                    if (_size == 0 || _size > size())
+                    {
+                        assert(!"read from invalid size");
+                        return nullptr;
+                    }
+
+                    auto out = (uint8_t*)(data_.data() + cursor_);
+                    cursor_ += _size;
+
+                    return out;
+                }
+
+                virtual void write(std::istream& _source) override
+                {
+                    assert(!"image stream is read-only");
+                }
+
+                virtual void write(const uint8_t* _buffer, uint32_t _size) override
+                {
+                    assert(!"image stream is read-only");
+                }
+
+                virtual bool empty() const override
+                {
+                    return (size() == 0);
+                }
+
+                virtual uint32_t size() const override
+                {
+                    return (data_.size() - cursor_);
+                }
+
+                virtual void reset() override
+                {
+                    cursor_ = data_.size();
+                }
+
+            public:
+
+                image_stream(const image_data& _data)
+                    : ref_count_(1)
+                    , data_(_data)
+                    , cursor_(0)
+                {
+                }
+            };
+
+            bool parse_generation(const std::wstring& _file_name, Out uint32_t& _generation)
+            {
+                const std::wstring prefix = pack_file_prefix;
+                const std::wstring ext = pack_file_ext;
+
+                if (_file_name.size() <= prefix.size() + ext.size() ||
+                    _file_name.compare(0, prefix.size(), prefix) != 0 ||
+                    _file_name.compare(_file_name.size() - ext.size(), ext.size(), ext) != 0)
+                {
+                    return false;
+                }
+
+                const auto number = _file_name.substr(prefix.size(), _file_name.size() - prefix.size() - ext.size());
+
+                try
+                {
+                    _generation = boost::lexical_cast<uint32_t>(number);
+                }
+                catch (const boost::bad_lexical_cast&)
+                {
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool parse_sticker_size(const std::wstring& _name, Out sticker_size& _size)
+            {
+                for (auto size = (int32_t) sticker_size::small; size < (int32_t) sticker_size::max; ++size)
+                {
+                    std::wstringstream ss_name;
+                    ss_name << (sticker_size) size << L".png";
+
+                    if (ss_name.str() == _name)
+                    {
+                        _size = (sticker_size) size;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // class image_data
+        //////////////////////////////////////////////////////////////////////////
+        image_data::image_data()
+            : data_(nullptr)
+            , size_(0)
+        {
+        }
+
+        image_data::image_data(std::shared_ptr<const pack> _pack, const char* _data, uint32_t _size)
+            : pack_(std::move(_pack))
+            , data_(_data)
+            , size_(_size)
+        {
+        }
+
+        image_data::image_data(std::shared_ptr<tools::binary_stream> _loaded)
+            : loaded_(std::move(_loaded))
+            , data_(nullptr)
+            , size_(0)
+        {
+            size_ = loaded_->available();
+
+            if (size_)
+                data_ = loaded_->read(size_);
+        }
+
+        istream* image_data::create_stream() const
+        {
+            return new image_stream(*this);
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // class pack
+        //////////////////////////////////////////////////////////////////////////
+        pack::pack(const std::wstring& _file_name, uint32_t _generation)
+            : file_name_(_file_name)
+            , generation_(_generation)
+            , index_(nullptr)
+            , count_(0)
+            , obsolete_(false)
+        {
+        }
+
+        pack::~pack()
+        {
+            file_.close();
+
+            if (obsolete_)
+                tools::system::delete_file(file_name_);
+        }
+
+        uint64_t pack::sticker_key(int32_t _sticker_id, sticker_size _size)
+        {
+            return ((uint64_t)(uint32_t) _sticker_id << 32) | (uint32_t) _size;
+        }
+
+        uint64_t pack::icon_key(int32_t _icon_size)
+        {
+            return ((uint64_t)(uint32_t) icon_item_id << 32) | (uint32_t) _icon_size;
+        }
+
+        uint64_t pack::big_icon_key()
+        {
+            return icon_key(0);
+        }
+
+        std::wstring pack::get_file_name(const std::wstring& _set_path, uint32_t _generation)
+        {
+            std::wstringstream ss_out;
+            ss_out << _set_path << L"/" << pack_file_prefix << _generation << pack_file_ext;
+
+            return ss_out.str();
+        }
+
+        std::shared_ptr<pack> pack::open_latest(const std::wstring& _set_path)
+        {
+            boost::system::error_code error;
+            if (!boost::filesystem::is_directory(_set_path, error))
+                return nullptr;
+
+            std::map<uint32_t, std::wstring> packs;
+
+            for (boost::filesystem::directory_iterator iter(_set_path, error), end; !error && iter != end; iter.increment(error))
+            {
+                uint32_t generation = 0;
+                if (parse_generation(iter->path().filename().wstring(), Out generation))
+                    packs.emplace(generation, iter->path().wstring());
+            }
+
+            std::shared_ptr<pack> latest;
+
+            for (auto iter = packs.rbegin(); iter != packs.rend(); ++iter)
+            {
+                if (latest)
+                {
+                    tools::system::delete_file(iter->second);
+                    continue;
+                }
+
+                auto candidate = std::make_shared<pack>(iter->second, iter->first);
+                if (candidate->open())
+                    latest = candidate;
+                else
+                    candidate->set_obsolete();
+            }
+
+            return latest;
+        }
+
+        bool pack::open()
+        {
+            if (!file_.open(file_name_))
+                return false;
+
+            const auto data = file_.data();
+            const auto size = file_.size();
+
+            uint32_t header[4];
+            if (size < sizeof(header))
+                return false;
+
+            memcpy(header, data, sizeof(header));
+
+            if (header[0] != pack_magic || header[1] != pack_version)
+                return false;
+
+            const auto index_end = sizeof(header) + (uint64_t) header[2] * sizeof(index_entry);
+            if (index_end > size)
+                return false;
+
+            index_ = (const index_entry*)(data + sizeof(header));
+            count_ = header[2];
+
+            for (uint32_t i = 0; i < count_; ++i)
+            {
+                const auto& entry = index_[i];
+                if (entry.offset_ < index_end || (uint64_t) entry.offset_ + entry.size_ > size)
+                    return false;
+            }
+
+            return true;
+        }
+
+        bool pack::contains(uint64_t _key) const
+        {
+            const auto end = index_ + count_;
+            const auto iter = std::lower_bound(index_, end, _key, [](const index_entry& _entry, uint64_t _key){ return _entry.key_ < _key; });
+
+            return (iter != end && iter->key_ == _key);
+        }
+
+        image_data pack::get_image(uint64_t _key) const
+        {
+            const auto end = index_ + count_;
+            const auto iter = std::lower_bound(index_, end, _key, [](const index_entry& _entry, uint64_t _key){ return _entry.key_ < _key; });
+
+            if (iter == end || iter->key_ != _key)
+                return image_data();
+
+            return image_data(shared_from_this(), file_.data() + iter->offset_, iter->size_);
+        }
+
+        void pack::enumerate(std::function<void(uint64_t _key, const char* _data, uint32_t _size)> _callback) const
+        {
+            for (uint32_t i = 0; i < count_; ++i)
+                _callback(index_[i].key_, file_.data() + index_[i].offset_, index_[i].size_);
+        }
+
+        void pack::set_obsolete()
+        {
+            obsolete_ = true;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // class pack_builder
+        //////////////////////////////////////////////////////////////////////////
+        void pack_builder::add_file(uint64_t _key, const std::wstring& _file)
+        {
+            auto& new_item = items_[_key];
+            new_item.file_ = _file;
+            new_item.data_ = nullptr;
+            new_item.size_ = 0;
+
+            files_.push_back(_file);
+        }
+
+        void pack_builder::add_data(uint64_t _key, const char* _data, uint32_t _size)
+        {
+            auto& new_item = items_[_key];
+            new_item.file_.clear();
+            new_item.data_ = _data;
+            new_item.size_ = _size;
+        }
+
+        void pack_builder::add_set_files(const std::wstring& _set_path)
+        {
+            boost::system::error_code error;
+
+            for (boost::filesystem::directory_iterator iter_dir(_set_path, error), end; !error && iter_dir != end; iter_dir.increment(error))
+            {
+                if (!boost::filesystem::is_directory(iter_dir->status()))
+                    continue;
+
+                const auto dir_name = iter_dir->path().filename().wstring();
+                const auto is_icons = (dir_name == L"icons");
+
+                int32_t sticker_id = 0;
+                if (!is_icons)
+                {
+                    try
+                    {
+                        sticker_id = boost::lexical_cast<int32_t>(dir_name);
+                    }
+                    catch (const boost::bad_lexical_cast&)
+                    {
+                        continue;
+                    }
+                }
+
+                boost::system::error_code file_error;
+
+                for (boost::filesystem::directory_iterator iter_file(iter_dir->path(), file_error); !file_error && iter_file != end; iter_file.increment(file_error))
+                {
+                    const auto file_name = iter_file->path().filename().wstring();
+
+                    if (is_icons)
+                    {
+                        if (file_name == L"_icon_xset.png")
+                        {
+                            add_file(pack::big_icon_key(), iter_file->path().wstring());
+                            continue;
+                        }
+
+                        int32_t icon_size = 0;
+                        if (swscanf(file_name.c_str(), L"_icon_%d.png", &icon_size) == 1 && icon_size > 0)
+                            add_file(pack::icon_key(icon_size), iter_file->path().wstring());
+
+                        continue;
+                    }
+
+                    sticker_size size = sticker_size::min;
+                    if (parse_sticker_size(file_name, Out size))
+                        add_file(pack::sticker_key(sticker_id, size), iter_file->path().wstring());
+                }
+            }
+        }
+
+        bool pack_builder::save(const std::wstring& _file_name) const
+        {
+            if (items_.empty())
+                return false;
+
+            // loose files are read up front, the index needs their sizes
+            std::map<uint64_t, tools::binary_stream> loaded;
+
+            for (const auto& iter : items_)
+            {
+                if (iter.second.file_.empty())
+                    continue;
+
+                if (!loaded[iter.first].load_from_file(iter.second.file_))
+                    return false;
+            }
+
+            const uint32_t header[4] = { pack_magic, pack_version, (uint32_t) items_.size(), 0 };
+
+            uint64_t offset = sizeof(header) + items_.size() * (sizeof(uint64_t) + 2 * sizeof(uint32_t));
+
+            tools::binary_stream out;
+            out.write((const char*) header, sizeof(header));
+
+            for (const auto& iter : items_)
+            {
+                const auto size = (iter.second.file_.empty() ? iter.second.size_ : loaded[iter.first].available());
+
+                if (offset + size > std::numeric_limits<uint32_t>::max())
+                    return false;
+
+                out.write<uint64_t>(iter.first);
+                out.write<uint32_t>((uint32_t) offset);
+                out.write<uint32_t>(size);
+
+                offset += size;
+            }
+
+            for (const auto& iter : items_)
+            {
+                if (iter.second.file_.empty())
+                {
+                    out.write(iter.second.data_, iter.second.size_);
+                    continue;
+                }
+
+                auto& data = loaded[iter.first];
+                const auto size = data.available();
+                if (size)
+                    out.write(data.read(size), size);
+            }
+
+            return out.save_2_file(_file_name);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "../tools/mapped_file.h"
+
+namespace core
+{
+    enum class sticker_size;
+    struct istream;
+
+    namespace stickers
+    {
+        class pack;
+
+        //////////////////////////////////////////////////////////////////////////
+        // image_data: bytes of a cached sticker or set icon,
+        // either a view into a mapped pack or a file loaded from the disk
+        //////////////////////////////////////////////////////////////////////////
+        class image_data
+        {
+            std::shared_ptr<const pack> pack_;
+            std::shared_ptr<tools::binary_stream> loaded_;
+
+            const char* data_;
+            uint32_t size_;
+
+        public:
+
+            image_data();
+            image_data(std::shared_ptr<const pack> _pack, const char* _data, uint32_t _size);
+            explicit image_data(std::shared_ptr<tools::binary_stream> _loaded);
+
+            bool empty() const { return (size_ == 0); }
+            uint32_t size() const { return size_; }
+            const char* data() const { return data_; }
+
+            // read-only stream for a collection, it does not copy the bytes
+            istream* create_stream() const;
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // pack: all cached images of a set in one file, mapped read-only
+        //
+        // file format
+        // magic        - uint32_t
+        // version      - uint32_t
+        // items count  - uint32_t
+        // reserved     - uint32_t
+        // index        - { key uint64_t, offset uint32_t, size uint32_t }[items count], sorted by key
+        // images one after another
+        //////////////////////////////////////////////////////////////////////////
+        class pack : public std::enable_shared_from_this<pack>, boost::noncopyable
+        {
+            struct index_entry
+            {
+                uint64_t key_;
+                uint32_t offset_;
+                uint32_t size_;
+            };
+
+            const std::wstring file_name_;
+            const uint32_t generation_;
+
+            tools::mapped_file file_;
+
+            const index_entry* index_;
+            uint32_t count_;
+
+            std::atomic<bool> obsolete_;
+
+            bool open();
+
+        public:
+
+            static uint64_t sticker_key(int32_t _sticker_id, sticker_size _size);
+            static uint64_t icon_key(int32_t _icon_size);
+            static uint64_t big_icon_key();
+
+            static std::wstring get_file_name(const std::wstring& _set_path, uint32_t _generation);
+
+            // opens the newest pack of the set folder and removes the obsolete ones
+            static std::shared_ptr<pack> open_latest(const std::wstring& _set_path);
+
+            pack(const std::wstring& _file_name, uint32_t _generation);
+            ~pack();
+
+            uint32_t get_generation() const { return generation_; }
+            uint32_t get_count() const { return count_; }
+
+            bool contains(uint64_t _key) const;
+            image_data get_image(uint64_t _key) const;
+
+            void enumerate(std::function<void(uint64_t _key, const char* _data, uint32_t _size)> _callback) const;
+
+            // the file is removed when the last image view is released
+            void set_obsolete();
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // pack_builder: collects images of a set and writes a new pack file
+        //////////////////////////////////////////////////////////////////////////
+        class pack_builder
+        {
+            struct item
+            {
+                std::wstring file_;
+                const char* data_;
+                uint32_t size_;
+
+                item() : data_(nullptr), size_(0) {}
+            };
+
+            std::map<uint64_t, item> items_;
+            std::list<std::wstring> files_;
+
+        public:
+
+            void add_file(uint64_t _key, const std::wstring& _file);
+            // _data must stay valid until save
+            void add_data(uint64_t _key, const char* _data, uint32_t _size);
+
+            // picks up the per-file cache of the set folder: <set>/<sticker>/<size>.png and <set>/icons/*.png
+            void add_set_files(const std::wstring& _set_path);
+
+            bool has_files() const { return !files_.empty(); }
+            const std::list<std::wstring>& get_files() const { return files_; }
+
+            bool save(const std::wstring& _file_name) const;
+        };
+    }
+}
@@ -5,6 +5,7 @@
 #include "../../../corelib/enumerations.h"
 
 #include "../tools/system.h"
+#include "../log/log.h"
 
 #include "../async_task.h"
 #include "../../common.shared/loader_errors.h"
@@ -37,6 +38,11 @@ namespace core
 
         const std::wstring stickers_meta_file_name = L"meta.js";
 
+        // a set with a pack is repacked once the files downloaded after the pack are a quarter of it,
+        // so stickers fetched one by one cost amortized linear io instead of a pack rewrite each
+        const int32_t min_files_to_repack = 16;
+        const int32_t repack_ratio = 4;
+
         //////////////////////////////////////////////////////////////////////////
         // class sticker_params
         //////////////////////////////////////////////////////////////////////////
@@ -525,7 +531,7 @@ namespace core
                 for (auto iter_icon = icons.cbegin(); iter_icon != icons.cend(); iter_icon++)
                 {
                     std::wstring icon_file = get_set_icon_path(*(*iter), iter_icon->second);
-                    if (!core::tools::system::is_exist(icon_file))
+                    if (!is_image_cached((*iter)->get_id(), pack::icon_key(iter_icon->first), icon_file))
                         return false;
                 }
             }
@@ -538,6 +544,14 @@ namespace core
             return g_stickers_path + L"/" + stickers_meta_file_name;
         }
 
+        std::wstring cache::get_set_path(const int32_t _set_id)
+        {
+            std::wstringstream ss_out;
+            ss_out << g_stickers_path << L"/" << _set_id;
+
+            return ss_out.str();
+        }
+
         std::wstring cache::get_set_icon_path(const set& _set, const set_icon& _icon)
         {
             std::wstringstream ss_out;
@@ -605,17 +619,17 @@ namespace core
 
                 auto icons = (*iter)->get_icons();
 
+                int32_t set_id = (*iter)->get_id();
+
                 for (auto iter_icon = icons.cbegin(); iter_icon != icons.cend(); iter_icon++)
                 {
                     std::wstring icon_file = get_set_icon_path(*(*iter), iter_icon->second);
-                    if (!core::tools::system::is_exist(icon_file))
-                        meta_tasks_.push_back(download_task(iter_icon->second.get_url(), icon_file));
+                    if (!is_image_cached(set_id, pack::icon_key(iter_icon->first), icon_file))
+                        meta_tasks_.push_back(download_task(iter_icon->second.get_url(), icon_file, set_id));
                 }
 
                 auto map_stickers = (*iter)->get_stickers();
 
-                int32_t set_id = (*iter)->get_id();
-
                 for (auto iter_sticker = map_stickers.cbegin(); iter_sticker != map_stickers.cend(); ++iter_sticker)
                 {
                     int32_t sticker_id = (*iter_sticker)->get_id();
@@ -624,7 +638,7 @@ namespace core
 
                     std::wstring file_name = get_sticker_path(*(*iter), *(*iter_sticker), string_size_2_size(_size));
 
-                    if (!core::tools::system::is_exist(file_name))
+                    if (!is_image_cached(set_id, pack::sticker_key(sticker_id, string_size_2_size(_size)), file_name))
                     {
                         if (has_gui_request(set_id, sticker_id))
                         {
@@ -639,7 +653,7 @@ namespace core
             }
         }
 
-        void cache::serialize_meta_set_sync(const stickers::set& _set, coll_helper _coll_set, const std::string& _size)
+        void cache::serialize_meta_set_sync(const stickers::set& _set, coll_helper _coll_set, const std::string& _size, std::shared_ptr<pack> _pack)
         {
             _coll_set.set_value_as_int("id", _set.get_id());
             _coll_set.set_value_as_string("name", _set.get_name());
@@ -659,17 +673,25 @@ namespace core
                 else if (_size == "large")
                     icon_size = set_icon_size::_64;
 
-                std::wstring file_name = get_set_icon_path(_set, _set.get_icon(icon_size));
+                if (!_pack)
+                    _pack = pack::open_latest(get_set_path(_set.get_id()));
+
+                image_data icon_data;
 
-                core::tools::binary_stream bs_icon;
+                if (_pack)
+                    icon_data = _pack->get_image(pack::icon_key(icon_size));
 
-                if (bs_icon.load_from_file(file_name))
+                if (icon_data.empty())
                 {
-                    ifptr<istream> icon(_coll_set->create_stream(), true);
+                    auto bs_icon = std::make_shared<core::tools::binary_stream>();
 
-                    uint32_t file_size = bs_icon.available();
+                    if (bs_icon->load_from_file(get_set_icon_path(_set, _set.get_icon(icon_size))))
+                        icon_data = image_data(bs_icon);
+                }
 
-                    icon->write((uint8_t*)bs_icon.read(file_size), file_size);
+                if (!icon_data.empty())
+                {
+                    ifptr<istream> icon(icon_data.create_stream(), true);
 
                     _coll_set.set_value_as_stream("icon", icon.get());
                 }
@@ -715,7 +737,7 @@ namespace core
 
                 sets_array->push_back(val_set.get());
 
-                serialize_meta_set_sync(*_set, coll_set, _size);
+                serialize_meta_set_sync(*_set, coll_set, _size, get_pack(_set->get_id()));
             }
 
             _coll.set_value_as_array("sets", sets_array.get());
@@ -771,7 +793,7 @@ namespace core
             return true;
         }
 
-        void cache::get_sticker(int64_t _seq, int32_t _set_id, int32_t _sticker_id, const sticker_size _size, tools::binary_stream& _data)
+        void cache::get_sticker(int64_t _seq, int32_t _set_id, int32_t _sticker_id, const sticker_size _size, image_data& _data)
         {
             gui_requests_[_set_id][_sticker_id].push_back(_seq);
 
@@ -787,7 +809,8 @@ namespace core
                 }
             }
 
-            if (!_data.load_from_file(get_sticker_path(_set_id, _sticker_id, _size)))
+            _data = load_image(_set_id, pack::sticker_key(_sticker_id, _size), get_sticker_path(_set_id, _sticker_id, _size));
+            if (_data.empty())
             {
                 const auto sticker_url = make_sticker_url(_set_id, _sticker_id, _size);
 
@@ -799,7 +822,7 @@ namespace core
             }
         }
 
-        void cache::get_set_icon_big(const int64_t _seq, const int32_t _set_id, tools::binary_stream& _data)
+        void cache::get_set_icon_big(const int64_t _seq, const int32_t _set_id, image_data& _data)
         {
             gui_requests_[_set_id][-1].push_back(_seq);
 
@@ -816,7 +839,8 @@ namespace core
             }
 
 
-            if (!_data.load_from_file(get_set_big_icon_path(_set_id)))
+            _data = load_image(_set_id, pack::big_icon_key(), get_set_big_icon_path(_set_id));
+            if (_data.empty())
             {
                 const auto sticker_url = make_big_icon_url(_set_id);
 
@@ -828,6 +852,163 @@ namespace core
             }
         }
 
+        std::shared_ptr<set> cache::find_set(int32_t _set_id) const
+        {
+            for (const auto& _set : sets_)
+            {
+                if (_set->get_id() == _set_id)
+                    return _set;
+            }
+
+            return nullptr;
+        }
+
+        bool cache::has_download_tasks(int32_t _set_id) const
+        {
+            const auto is_set_task = [_set_id](const download_task& _task)
+            {
+                return (_task.get_set_id() == _set_id);
+            };
+
+            return (
+                std::any_of(stickers_tasks_.cbegin(), stickers_tasks_.cend(), is_set_task) ||
+                std::any_of(meta_tasks_.cbegin(), meta_tasks_.cend(), is_set_task));
+        }
+
+        std::shared_ptr<pack> cache::get_pack(int32_t _set_id)
+        {
+            auto iter_pack = packs_.find(_set_id);
+            if (iter_pack != packs_.end())
+                return iter_pack->second;
+
+            packs_[_set_id] = pack::open_latest(get_set_path(_set_id));
+
+            // the per-file cache of older versions is packed on first use
+            if (find_set(_set_id) && !has_download_tasks(_set_id))
+                build_pack(_set_id);
+
+            return packs_[_set_id];
+        }
+
+        bool cache::build_pack(int32_t _set_id)
+        {
+            const auto set_path = get_set_path(_set_id);
+
+            pack_builder builder;
+
+            auto& current = packs_[_set_id];
+            if (current)
+            {
+                current->enumerate([&builder](uint64_t _key, const char* _data, uint32_t _size)
+                {
+                    builder.add_data(_key, _data, _size);
+                });
+            }
+
+            // downloaded files override the items of the current pack
+            builder.add_set_files(set_path);
+
+            if (!builder.has_files())
+                return false;
+
+            const auto generation = (current ? current->get_generation() + 1 : 0);
+            const auto file_name = pack::get_file_name(set_path, generation);
+
+            if (!builder.save(file_name))
+            {
+                __WARN(
+                    "stickers",
+                    "failed to save set pack\n"
+                    "    set=<%1%>",
+                    _set_id);
+
+                return false;
+            }
+
+            auto new_pack = pack::open_latest(set_path);
+            if (!new_pack || new_pack->get_generation() != generation)
+            {
+                assert(!"invalid set pack");
+                return false;
+            }
+
+            // streams handed out to the gui keep the old mapping alive until released
+            if (current)
+                current->set_obsolete();
+
+            current = new_pack;
+
+            unpacked_files_.erase(_set_id);
+
+            for (const auto& file : builder.get_files())
+            {
+                tools::system::delete_file(file);
+
+                boost::system::error_code error;
+                boost::filesystem::remove(boost::filesystem::wpath(file).parent_path(), error);
+            }
+
+            __INFO(
+                "stickers",
+                "set packed\n"
+                "    set=<%1%>\n"
+                "    items=<%2%>\n"
+                "    files=<%3%>",
+                _set_id % new_pack->get_count() % builder.get_files().size());
+
+            return true;
+        }
+
+        void cache::on_set_task_finished(int32_t _set_id)
+        {
+            if (_set_id == -1)
+                return;
+
+            const auto unpacked_files = ++unpacked_files_[_set_id];
+
+            if (has_download_tasks(_set_id) || !find_set(_set_id))
+                return;
+
+            const auto iter_pack = packs_.find(_set_id);
+            if (iter_pack == packs_.end())
+            {
+                get_pack(_set_id);
+                return;
+            }
+
+            const auto& current = iter_pack->second;
+            if (current && unpacked_files < std::max<int32_t>(min_files_to_repack, (int32_t) current->get_count() / repack_ratio))
+                return;
+
+            build_pack(_set_id);
+        }
+
+        bool cache::is_image_cached(int32_t _set_id, uint64_t _key, const std::wstring& _file_name)
+        {
+            const auto set_pack = get_pack(_set_id);
+            if (set_pack && set_pack->contains(_key))
+                return true;
+
+            return core::tools::system::is_exist(_file_name);
+        }
+
+        image_data cache::load_image(int32_t _set_id, uint64_t _key, const std::wstring& _file_name)
+        {
+            const auto set_pack = get_pack(_set_id);
+            if (set_pack)
+            {
+                auto data = set_pack->get_image(_key);
+                if (!data.empty())
+                    return data;
+            }
+
+            auto loaded = std::make_shared<core::tools::binary_stream>();
+            if (!loaded->load_from_file(_file_name))
+                return image_data();
+
+            return image_data(loaded);
+        }
+
         requests_list cache::get_sticker_gui_requests(int32_t _set_id, int32_t _sticker_id) const
         {
             auto iter_set = gui_requests_.find(_set_id);
@@ -883,6 +1064,8 @@ namespace core
 
                     stickers_tasks_.erase(iter);
 
+                    on_set_task_finished(_task.get_set_id());
+
                     return true;
                 }
             }
@@ -896,6 +1079,9 @@ namespace core
                 if (_task.get_source_url() == iter->get_source_url())
                 {
                     meta_tasks_.erase(iter);
+
+                    on_set_task_finished(_task.get_set_id());
+
                     return true;
                 }
             }
@@ -962,14 +1148,14 @@ namespace core
             return handler;
         }
 
-        std::shared_ptr<result_handler<tools::binary_stream&>> face::get_sticker(int64_t _seq, int32_t _set_id, int32_t _sticker_id, const core::sticker_size _size)
+        std::shared_ptr<result_handler<const image_data&>> face::get_sticker(int64_t _seq, int32_t _set_id, int32_t _sticker_id, const core::sticker_size _size)
         {
             assert(_size > core::sticker_size::min);
             assert(_size < core::sticker_size::max);
 
-            auto handler = std::make_shared<result_handler<tools::binary_stream&>>();
+            auto handler = std::make_shared<result_handler<const image_data&>>();
             auto stickers_cache = cache_;
-            auto sticker_data = std::make_shared<tools::binary_stream>();
+            auto sticker_data = std::make_shared<image_data>();
 
             thread_->run_async_function([stickers_cache, sticker_data, _set_id, _sticker_id, _size, _seq]
             {
@@ -986,11 +1172,11 @@ namespace core
             return handler;
         }
 
-        std::shared_ptr<result_handler<tools::binary_stream&>> face::get_set_icon_big(const int64_t _seq, const int32_t _set_id)
+        std::shared_ptr<result_handler<const image_data&>> face::get_set_icon_big(const int64_t _seq, const int32_t _set_id)
         {
-            auto handler = std::make_shared<result_handler<tools::binary_stream&>>();
+            auto handler = std::make_shared<result_handler<const image_data&>>();
             auto stickers_cache = cache_;
-            auto icon_data = std::make_shared<tools::binary_stream>();
+            auto icon_data = std::make_shared<image_data>();
 
             thread_->run_async_function([stickers_cache, icon_data, _set_id, _seq]
             {
@@ -1015,8 +1201,16 @@ namespace core
 
             thread_->run_async_function([stickers_cache, _coll, size]()->int32_t
             {
+                const auto start = std::chrono::steady_clock::now();
+
                 stickers_cache->serialize_meta_sync(_coll, size);
 
+                __INFO(
+                    "stickers",
+                    "meta serialized\n"
+                    "    duration=<%1%us>",
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
                 return 0;
 
             })->on_result_ = [handler, _coll](int32_t _error)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../corelib/collection_helper.h"
+#include "sticker_pack.h"
 enum class loader_errors;
 
 namespace core
@@ -239,6 +240,22 @@ namespace core
 
             stickers_sets_ids_list gui_requests_;
             //icons_request_sets_list icons_requests_;
+
+            // packs of the downloaded sets, nullptr when a set has no pack yet
+            std::map<int32_t, std::shared_ptr<pack>> packs_;
+
+            // files downloaded since the set was packed, they are read from the disk until the next pack
+            std::map<int32_t, int32_t> unpacked_files_;
+
+            std::shared_ptr<set> find_set(int32_t _set_id) const;
+            bool has_download_tasks(int32_t _set_id) const;
+
+            std::shared_ptr<pack> get_pack(int32_t _set_id);
+            bool build_pack(int32_t _set_id);
+            void on_set_task_finished(int32_t _set_id);
+
+            bool is_image_cached(int32_t _set_id, uint64_t _key, const std::wstring& _file_name);
+            image_data load_image(int32_t _set_id, uint64_t _key, const std::wstring& _file_name);
             
             requests_list get_sticker_gui_requests(int32_t _set_id, int32_t _sticker_id) const;
             void clear_sticker_gui_requests(int32_t _set_id, int32_t _sticker_id);
@@ -259,10 +276,11 @@ namespace core
             bool parse_store(core::tools::binary_stream& _data);
             bool is_meta_icons_exist();
 
-            static void serialize_meta_set_sync(const stickers::set& _set, coll_helper _coll_set, const std::string& _size);
+            static void serialize_meta_set_sync(const stickers::set& _set, coll_helper _coll_set, const std::string& _size, std::shared_ptr<pack> _pack = nullptr);
             void serialize_meta_sync(coll_helper _coll, const std::string& _size);
             void serialize_store_sync(coll_helper _coll);
 
+            static std::wstring get_set_path(const int32_t _set_id);
             static std::wstring get_set_icon_path(const set& _set, const set_icon& _icon);
             static std::wstring get_set_big_icon_path(const int32_t _set_id);
             static std::wstring get_sticker_path(const set& _set, const sticker& _sticker, sticker_size _size);
@@ -272,8 +290,8 @@ namespace core
 
             bool get_next_meta_task(download_task& _task);
             bool get_next_sticker_task(download_task& _task);
-            void get_sticker(int64_t _seq, int32_t _set_id, int32_t _sticker_id, const sticker_size _size, tools::binary_stream& _data);
-            void get_set_icon_big(const int64_t _seq, const int32_t _set_id, tools::binary_stream& _data);
+            void get_sticker(int64_t _seq, int32_t _set_id, int32_t _sticker_id, const sticker_size _size, image_data& _data);
+            void get_set_icon_big(const int64_t _seq, const int32_t _set_id, image_data& _data);
             std::string get_md5() const;
             bool sticker_loaded(const download_task& _task, /*out*/ requests_list&);
             bool meta_loaded(const download_task& _task);
@@ -326,13 +344,13 @@ namespace core
             std::shared_ptr<result_handler<bool>> make_download_tasks(const std::string& _size);
             std::shared_ptr<result_handler<coll_helper>> serialize_meta(coll_helper _coll, const std::string& _size);
             std::shared_ptr<result_handler<coll_helper>> serialize_store(coll_helper _coll);
-            std::shared_ptr<result_handler<tools::binary_stream&>> get_sticker(
+            std::shared_ptr<result_handler<const image_data&>> get_sticker(
                 int64_t _seq,
                 int32_t _set_id,
                 int32_t _sticker_id,
                 const core::sticker_size _size);
 
-            std::shared_ptr<result_handler<tools::binary_stream&>> get_set_icon_big(const int64_t _seq, const int32_t _set_id);
+            std::shared_ptr<result_handler<const image_data&>> get_set_icon_big(const int64_t _seq, const int32_t _set_id);
 
             std::shared_ptr<result_handler<bool, const download_task&>> get_next_meta_task();
             std::shared_ptr<result_handler<bool, const download_task&>> get_next_sticker_task();
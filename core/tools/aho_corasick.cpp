@@ -0,0 +1,121 @@
+#include "stdafx.h"
+
+#include "aho_corasick.h"
+
+namespace core
+{
+    namespace tools
+    {
+        aho_corasick::aho_corasick(const std::vector<std::string>& _patterns)
+            : patterns_(_patterns)
+            , max_pattern_size_(0)
+            , classes_count_(1)
+        {
+            classes_.fill(0);
+
+            for (const auto& pattern : patterns_)
+            {
+                assert(!pattern.empty());
+
+                max_pattern_size_ = std::max(max_pattern_size_, pattern.size());
+
+                for (const auto symbol : pattern)
+                {
+                    auto& symbol_class = classes_[(unsigned char)symbol];
+                    if (symbol_class == 0)
+                        symbol_class = (uint8_t)classes_count_++;
+                }
+            }
+
+            // the trie
+            transitions_.assign(classes_count_, -1);
+            matches_.assign(1, -1);
+
+            for (int32_t index = 0; index < (int32_t)patterns_.size(); ++index)
+            {
+                int32_t state = 0;
+
+                for (const auto symbol : patterns_[index])
+                {
+                    auto& next = transitions_[state * classes_count_ + classes_[(unsigned char)symbol]];
+                    if (next == -1)
+                    {
+                        next = (int32_t)matches_.size();
+                        matches_.push_back(-1);
+                        transitions_.resize(transitions_.size() + classes_count_, -1);
+                    }
+
+                    state = transitions_[state * classes_count_ + classes_[(unsigned char)symbol]];
+                }
+
+                if (matches_[state] == -1)
+                    matches_[state] = index;
+            }
+
+            // the failure links, breadth first, so a link always leads to a finished state
+            std::vector<int32_t> failures(matches_.size(), 0);
+            std::deque<int32_t> queue;
+
+            for (int32_t symbol_class = 0; symbol_class < classes_count_; ++symbol_class)
+            {
+                auto& next = transitions_[symbol_class];
+                if (next == -1)
+                {
+                    next = 0;
+                }
+                else
+                {
+                    failures[next] = 0;
+                    queue.push_back(next);
+                }
+            }
+
+            while (!queue.empty())
+            {
+                const auto state = queue.front();
+                queue.pop_front();
+
+                const auto failure = failures[state];
+
+                // a shorter pattern that is a suffix of the state ends here as well
+                if (matches_[state] == -1)
+                    matches_[state] = matches_[failure];
+
+                for (int32_t symbol_class = 0; symbol_class < classes_count_; ++symbol_class)
+                {
+                    auto& next = transitions_[state * classes_count_ + symbol_class];
+                    const auto failure_next = transitions_[failure * classes_count_ + symbol_class];
+
+                    if (next == -1)
+                    {
+                        next = failure_next;
+                    }
+                    else
+                    {
+                        failures[next] = failure_next;
+                        queue.push_back(next);
+                    }
+                }
+            }
+        }
+
+        size_t aho_corasick::find(const char* _data, const size_t _size, int32_t& _pattern) const
+        {
+            int32_t state = 0;
+
+            for (size_t i = 0; i < _size; ++i)
+            {
+                state = get_next(state, (unsigned char)_data[i]);
+
+                if (matches_[state] != -1)
+                {
+                    _pattern = matches_[state];
+                    return (i + 1);
+                }
+            }
+
+            _pattern = -1;
+            return _size;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef __AHO_CORASICK_H_
+#define __AHO_CORASICK_H_
+
+#pragma once
+
+namespace core
+{
+    namespace tools
+    {
+        // finds any of a fixed set of byte patterns in one pass over the data;
+        // built once, then read-only, so one automaton may be shared by threads
+        class aho_corasick : boost::noncopyable
+        {
+        public:
+
+            explicit aho_corasick(const std::vector<std::string>& _patterns);
+
+            // the first occurrence of a pattern in [_data, _data + _size), ordered by its end:
+            // returns the offset right after it and sets the longest pattern ending there,
+            // returns _size and -1 if there is none
+            size_t find(const char* _data, const size_t _size, int32_t& _pattern) const;
+
+            const std::string& get_pattern(const int32_t _pattern) const { return patterns_[_pattern]; }
+
+            size_t get_patterns_count() const { return patterns_.size(); }
+
+            size_t get_max_pattern_size() const { return max_pattern_size_; }
+
+            size_t get_states_count() const { return matches_.size(); }
+
+        private:
+
+            int32_t get_next(const int32_t _state, const unsigned char _symbol) const
+            {
+                return transitions_[_state * classes_count_ + classes_[_symbol]];
+            }
+
+            std::vector<std::string> patterns_;
+
+            size_t max_pattern_size_;
+
+            // the bytes met in no pattern share a class, so a row is a few dozen entries rather than 256
+            std::array<uint8_t, 256> classes_;
+
+            int32_t classes_count_;
+
+            // a complete transition table: the failure links are folded in while building
+            std::vector<int32_t> transitions_;
+
+            // the longest pattern that ends in the state, -1 if none
+            std::vector<int32_t> matches_;
+        };
+    }
+}
+
+#endif //__AHO_CORASICK_H_
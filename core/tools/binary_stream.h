@@ -235,6 +235,11 @@ namespace core
                 input_cursor_ = _value;
             }
 
+            uint32_t get_input() const
+            {
+                return input_cursor_;
+            }
+
             uint32_t all_size() const override
             {
                 return buffer_.size();
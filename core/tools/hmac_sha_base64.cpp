@@ -1,6 +1,5 @@
 #include "stdafx.h"
 #include "hmac_sha_base64.h"
-#include "openssl/sha.h"
 
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/base64_from_binary.hpp>
@@ -151,57 +150,66 @@ int32_t base64::base64_encode(uint8_t* source, int32_t length, uint8_t* dst)
 
 std::string base64::hmac_base64(std::vector<uint8_t>& data, std::vector<uint8_t>& secret)
 {
-    const unsigned SHA_BLOCKSIZE = 64;
+    hmac_sha256 hmac((const char*) secret.data(), secret.size());
+    hmac.update((const char*) data.data(), data.size());
 
-    uint8_t* text = &data[0];
-    uint32_t textlen = (uint32_t)data.size();
-    uint8_t* key = &secret[0];
-    uint32_t keylen = (uint32_t)secret.size();
+    std::string result;
+    hmac.final_base64(result);
 
-#define MIR_SHA256_HASH_SIZE 32
-
-    unsigned char mdkey[MIR_SHA256_HASH_SIZE];
-    unsigned char k_ipad[SHA_BLOCKSIZE], k_opad[SHA_BLOCKSIZE];
+    return result;
+}
 
-    SHA256_CTX ctx;
+hmac_sha256::hmac_sha256(const char* _key, const size_t _key_size)
+{
+    const auto* key = (const uint8_t*) _key;
+    auto key_size = _key_size;
 
-    uint8_t res[MIR_SHA256_HASH_SIZE];
+    uint8_t md_key[SHA256_DIGEST_LENGTH];
 
-    if ( keylen > SHA_BLOCKSIZE )
+    if (key_size > SHA256_CBLOCK)
     {
-        SHA256_Init( &ctx );
-        SHA256_Update( &ctx, key, keylen );
-        SHA256_Final( mdkey, &ctx );
+        SHA256_Init(&ctx_);
+        SHA256_Update(&ctx_, key, key_size);
+        SHA256_Final(md_key, &ctx_);
 
-        keylen = 32;
-        key = mdkey;
+        key = md_key;
+        key_size = SHA256_DIGEST_LENGTH;
     }
 
-    memcpy( k_ipad, key, keylen );
-    memcpy( k_opad, key, keylen );
-    memset( k_ipad+keylen, 0x36, SHA_BLOCKSIZE - keylen );
-    memset( k_opad+keylen, 0x5c, SHA_BLOCKSIZE - keylen );
+    uint8_t k_ipad[SHA256_CBLOCK];
 
-    for ( uint32_t i = 0; i < keylen; i++ ) 
+    memset(k_ipad, 0x36, SHA256_CBLOCK);
+    memset(k_opad_, 0x5c, SHA256_CBLOCK);
+
+    for (size_t i = 0; i < key_size; ++i)
     {
-        k_ipad[i] ^= 0x36;
-        k_opad[i] ^= 0x5c;
+        k_ipad[i] ^= key[i];
+        k_opad_[i] ^= key[i];
     }
 
-    SHA256_Init( &ctx );
-    SHA256_Update( &ctx, k_ipad, SHA_BLOCKSIZE );
-    SHA256_Update( &ctx, text, (int32_t) textlen );
-    SHA256_Final( res, &ctx );
+    SHA256_Init(&ctx_);
+    SHA256_Update(&ctx_, k_ipad, SHA256_CBLOCK);
+}
+
+void hmac_sha256::update(const char* _data, const size_t _size)
+{
+    SHA256_Update(&ctx_, _data, _size);
+}
+
+void hmac_sha256::final_base64(std::string& _out)
+{
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256_Final(digest, &ctx_);
 
-    SHA256_Init( &ctx );
-    SHA256_Update( &ctx, k_opad,SHA_BLOCKSIZE );
-    SHA256_Update( &ctx, res, (int32_t)MIR_SHA256_HASH_SIZE );
-    SHA256_Final( res, &ctx );
+    SHA256_Init(&ctx_);
+    SHA256_Update(&ctx_, k_opad_, SHA256_CBLOCK);
+    SHA256_Update(&ctx_, digest, SHA256_DIGEST_LENGTH);
+    SHA256_Final(digest, &ctx_);
 
-    std::vector<uint8_t> temp_buffer(MIR_SHA256_HASH_SIZE*2);
-    int32_t encoded = core::tools::base64::base64_encode((uint8_t*) res, MIR_SHA256_HASH_SIZE, &temp_buffer[0]);
+    uint8_t encoded[SHA256_DIGEST_LENGTH * 2];
+    const auto encoded_size = base64::base64_encode(digest, SHA256_DIGEST_LENGTH, encoded);
 
-    return std::string((char*) &temp_buffer[0], encoded);
+    _out.append((const char*) encoded, encoded_size);
 }
 
 using namespace boost::archive::iterators;
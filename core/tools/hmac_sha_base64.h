@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "openssl/sha.h"
 
 namespace core
 {
@@ -25,6 +26,25 @@ namespace core
             static std::string decode64(const std::string& val);
             static std::string encode64(const std::string& val);
         };
+
+        // hmac-sha256 over data fed in portions, so the signed string need not be copied into one buffer
+        class hmac_sha256
+        {
+        public:
+
+            hmac_sha256(const char* _key, const size_t _key_size);
+
+            void update(const char* _data, const size_t _size);
+
+            // appends the base64 of the digest; the object is spent afterwards
+            void final_base64(std::string& _out);
+
+        private:
+
+            SHA256_CTX ctx_;
+
+            uint8_t k_opad_[SHA256_CBLOCK];
+        };
     }
 }
 
@@ -1,6 +1,9 @@
 #include "stdafx.h"
 #include "../system.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 bool core::tools::system::is_dir_writable(const std::wstring &_dir_path_str)
 {
     return true;
@@ -50,6 +53,18 @@ bool core::tools::system::move_file(const std::wstring& _old_file, const std::ws
     }
 }
 
+bool core::tools::system::sync_file(const std::wstring& _file_name)
+{
+    const auto fd = ::open(boost::filesystem::path(_file_name).string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    const auto result = (::fsync(fd) == 0);
+    ::close(fd);
+
+    return result;
+}
+
 bool core::tools::system::copy_file(const std::wstring& _old_file, const std::wstring& _new_file)
 {
     boost::filesystem::path from(_old_file);
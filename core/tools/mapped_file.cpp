@@ -0,0 +1,127 @@
+#include "stdafx.h"
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace core;
+using namespace tools;
+
+mapped_file::mapped_file()
+    : data_(nullptr)
+    , size_(0)
+#ifdef _WIN32
+    , file_(INVALID_HANDLE_VALUE)
+    , mapping_(nullptr)
+#else
+    , file_(-1)
+#endif
+{
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool mapped_file::open(const std::wstring& _file_name)
+{
+    assert(!is_open());
+
+    file_ = ::CreateFileW(_file_name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    mapping_ = ::CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_)
+    {
+        close();
+        return false;
+    }
+
+    data_ = (const char*) ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (!data_)
+    {
+        close();
+        return false;
+    }
+
+    size_ = (uint64_t) size.QuadPart;
+
+    return true;
+}
+
+void mapped_file::close()
+{
+    if (data_)
+        ::UnmapViewOfFile(data_);
+
+    if (mapping_)
+        ::CloseHandle(mapping_);
+
+    if (file_ != INVALID_HANDLE_VALUE)
+        ::CloseHandle(file_);
+
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool mapped_file::open(const std::wstring& _file_name)
+{
+    assert(!is_open());
+
+    file_ = ::open(tools::from_utf16(_file_name).c_str(), O_RDONLY);
+    if (file_ == -1)
+        return false;
+
+    struct stat file_stat;
+    if (::fstat(file_, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        close();
+        return false;
+    }
+
+    auto data = ::mmap(nullptr, (size_t) file_stat.st_size, PROT_READ, MAP_SHARED, file_, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    data_ = (const char*) data;
+    size_ = (uint64_t) file_stat.st_size;
+
+    return true;
+}
+
+void mapped_file::close()
+{
+    if (data_)
+        ::munmap((void*) data_, (size_t) size_);
+
+    if (file_ != -1)
+        ::close(file_);
+
+    data_ = nullptr;
+    size_ = 0;
+    file_ = -1;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __MAPPED_FILE_H_
+#define __MAPPED_FILE_H_
+
+#pragma once
+
+namespace core
+{
+    namespace tools
+    {
+        // read-only memory mapping of a whole file
+        class mapped_file : boost::noncopyable
+        {
+            const char* data_;
+            uint64_t size_;
+
+#ifdef _WIN32
+            HANDLE file_;
+            HANDLE mapping_;
+#else
+            int file_;
+#endif
+
+        public:
+
+            mapped_file();
+            ~mapped_file();
+
+            bool open(const std::wstring& _file_name);
+            void close();
+
+            bool is_open() const { return (data_ != nullptr); }
+
+            const char* data() const { return data_; }
+            uint64_t size() const { return size_; }
+        };
+    }
+}
+
+#endif //__MAPPED_FILE_H_
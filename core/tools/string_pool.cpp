@@ -0,0 +1,62 @@
+#include "stdafx.h"
+
+#include "string_pool.h"
+
+namespace core
+{
+    namespace tools
+    {
+        string_pool& string_pool::instance()
+        {
+            static string_pool pool;
+            return pool;
+        }
+
+        const std::string* string_pool::intern(const std::string& _value)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // nodes never move, so the address stays valid after a rehash
+            return &(*strings_.insert(_value).first);
+        }
+
+        size_t string_pool::size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            return strings_.size();
+        }
+
+        size_t string_pool::memory_usage() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            size_t usage = strings_.bucket_count() * sizeof(void*);
+            for (const auto& value : strings_)
+                usage += sizeof(value) + 2 * sizeof(void*) + (value.capacity() > 15 ? value.capacity() + 1 : 0);
+
+            return usage;
+        }
+
+        const std::string* interned_string::intern(const std::string& _value)
+        {
+            return string_pool::instance().intern(_value);
+        }
+
+        interned_string::interned_string()
+        {
+            static const std::string* empty = intern(std::string());
+            value_ = empty;
+        }
+
+        interned_string::interned_string(const std::string& _value)
+            : value_(intern(_value))
+        {
+        }
+
+        interned_string::interned_string(const char* _value)
+            : value_(intern(_value))
+        {
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef __STRING_POOL_H_
+#define __STRING_POOL_H_
+
+#pragma once
+
+namespace core
+{
+    namespace tools
+    {
+        // one shared copy of each string that repeats across many objects,
+        // such as presence states, user types and capabilities;
+        // the copies live as long as the process, so do not intern unique strings
+        class string_pool : boost::noncopyable
+        {
+            std::unordered_set<std::string> strings_;
+            mutable std::mutex mutex_;
+
+        public:
+
+            static string_pool& instance();
+
+            const std::string* intern(const std::string& _value);
+
+            size_t size() const;
+
+            // heap bytes taken by the pooled strings
+            size_t memory_usage() const;
+        };
+
+        // pointer-sized handle to a pooled string, compared by address
+        class interned_string
+        {
+            const std::string* value_;
+
+            static const std::string* intern(const std::string& _value);
+
+        public:
+
+            interned_string();
+            interned_string(const std::string& _value);
+            interned_string(const char* _value);
+
+            const std::string& str() const { return *value_; }
+            operator const std::string&() const { return *value_; }
+
+            const char* c_str() const { return value_->c_str(); }
+            bool empty() const { return value_->empty(); }
+
+            bool operator==(const interned_string& _other) const { return value_ == _other.value_; }
+            bool operator!=(const interned_string& _other) const { return value_ != _other.value_; }
+            bool operator<(const interned_string& _other) const { return *value_ < *_other.value_; }
+
+            bool operator==(const std::string& _other) const { return *value_ == _other; }
+            bool operator!=(const std::string& _other) const { return *value_ != _other; }
+
+            bool operator==(const char* _other) const { return *value_ == _other; }
+            bool operator!=(const char* _other) const { return *value_ != _other; }
+        };
+    }
+}
+
+#endif //__STRING_POOL_H_
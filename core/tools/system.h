@@ -13,6 +13,9 @@ bool move_file(const std::wstring& _old_file, const std::wstring& _new_file);
 
 bool copy_file(const std::wstring& _old_file, const std::wstring& _new_file);
 
+// flushes the file contents to the disk, not just to the os cache
+bool sync_file(const std::wstring& _file_name);
+
 bool compare_dirs(const std::wstring& _dir1, const std::wstring& _dir2);
 
 std::wstring get_file_directory(const std::wstring& file);
@@ -3,6 +3,9 @@
 #import <Foundation/Foundation.h>
 #import <CoreServices/CoreServices.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 std::string core::tools::system::generate_guid()
 {
 	std::string guid_string;
@@ -59,6 +62,19 @@ bool core::tools::system::move_file(const std::wstring& _old_file, const std::ws
 	}
 }
 
+bool core::tools::system::sync_file(const std::wstring& _file_name)
+{
+    const auto fd = ::open(boost::filesystem::path(_file_name).string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    // fsync leaves the data in the drive cache on mac
+    const auto result = (::fcntl(fd, F_FULLFSYNC) != -1 || ::fsync(fd) == 0);
+    ::close(fd);
+
+    return result;
+}
+
 bool core::tools::system::copy_file(const std::wstring& _old_file, const std::wstring& _new_file)
 {
     boost::filesystem::path from(_old_file);
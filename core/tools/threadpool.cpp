@@ -2,6 +2,7 @@
 #include "threadpool.h"
 
 #include "../utils.h"
+#include "../profiling/metrics.h"
 
 #ifdef _WIN32
     #include "../common.shared/win32/crash_handler.h"
@@ -15,8 +16,11 @@ using namespace tools;
 #include <signal.h>
 #endif //__linux__
 
-threadpool::threadpool(const unsigned count, std::function<void()> _on_thread_exit)
+threadpool::threadpool(const unsigned count, std::function<void()> _on_thread_exit, const std::string& _name)
     : stop_(false)
+    , queued_(metrics::get_gauge(_name + "/queued"))
+    , queue_wait_(metrics::get_histogram(_name + "/queue_wait_us"))
+    , task_time_(metrics::get_histogram(_name + "/task_us"))
 {
     creator_thread_id_ = boost::this_thread::get_id();
 
@@ -44,7 +48,10 @@ threadpool::threadpool(const unsigned count, std::function<void()> _on_thread_ex
 
 bool threadpool::run_task_impl()
 {
+    using namespace std::chrono;
+
     task nextTask;
+    steady_clock::time_point queued;
 
     {
         boost::unique_lock<boost::mutex> lock(queue_mutex_);
@@ -59,12 +66,21 @@ bool threadpool::run_task_impl()
             return false;
         }
 
-        nextTask = tasks_.front();
+        nextTask = std::move(tasks_.front().task_);
+        queued = tasks_.front().queued_;
         tasks_.pop_front();
     }
+
+    queued_.add(-1);
+
+    const auto started = steady_clock::now();
+    queue_wait_.record(duration_cast<microseconds>(started - queued).count());
+
     if (nextTask)
     {
         nextTask();
+
+        task_time_.record(duration_cast<microseconds>(steady_clock::now() - started).count());
     }
     else
     {
@@ -145,10 +161,12 @@ bool threadpool::push_back(const task _task)
             {
                 assert(!"threadpool: _task is empty");
             }
-        });
+        }, std::chrono::steady_clock::now());
 #else
-        tasks_.emplace_back(_task);
+        tasks_.emplace_back(_task, std::chrono::steady_clock::now());
 #endif // _WIN32
+
+        queued_.add(1);
     }
 
     condition_.notify_one();
@@ -185,10 +203,12 @@ bool threadpool::push_front(const task _task)
             {
                 assert(!"threadpool: _task is empty");
             }
-        });
+        }, std::chrono::steady_clock::now());
 #else
-        tasks_.emplace_front(_task);
+        tasks_.emplace_front(_task, std::chrono::steady_clock::now());
 #endif // _WIN32
+
+        queued_.add(1);
     }
 
     condition_.notify_one();
@@ -4,6 +4,12 @@
 
 namespace core
 {
+    namespace metrics
+    {
+        class gauge;
+        class histogram;
+    }
+
     namespace tools
     {
         class threadpool : boost::noncopyable
@@ -14,7 +20,8 @@ namespace core
 
             typedef std::function<void()> task;
 
-            explicit threadpool(const unsigned _count, std::function<void()> _on_thread_exit = std::function<void()>());
+            // _name prefixes the metrics of the queue, the pools of one name share them
+            explicit threadpool(const unsigned _count, std::function<void()> _on_thread_exit = std::function<void()>(), const std::string& _name = "threadpool");
 
             virtual ~threadpool();
 
@@ -24,13 +31,25 @@ namespace core
             const std::vector<std::thread::id>& get_threads_ids() const;
 
         protected:
+            struct queued_task
+            {
+                queued_task(task _task, std::chrono::steady_clock::time_point _queued) : task_(std::move(_task)), queued_(_queued) {}
+
+                task task_;
+                std::chrono::steady_clock::time_point queued_;
+            };
+
             std::vector<std::thread> threads_;
             std::vector<std::thread::id> threads_ids_;
             boost::mutex queue_mutex_;
             boost::condition_variable condition_;
-            std::deque<task> tasks_;
+            std::deque<queued_task> tasks_;
             std::atomic<bool> stop_;
 
+            metrics::gauge& queued_;
+            metrics::histogram& queue_wait_;
+            metrics::histogram& task_time_;
+
             bool run_task_impl();
             bool run_task();
 
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "tlv_stream.h"
+
+using namespace core;
+using namespace tools;
+
+namespace
+{
+    const uint32_t tlv_header_size = (sizeof(uint32_t) * 2);
+}
+
+tlv_writer::tlv_writer(binary_stream& _stream)
+    : stream_(_stream)
+{
+}
+
+void tlv_writer::write(const uint32_t _type, const std::string& _value)
+{
+    write(_type, _value.data(), (uint32_t) _value.size());
+}
+
+void tlv_writer::write(const uint32_t _type, const char* _data, const uint32_t _size)
+{
+    stream_.write<uint32_t>(_type);
+    stream_.write<uint32_t>(_size);
+
+    if (_size)
+        stream_.write(_data, _size);
+}
+
+void tlv_writer::write(const uint32_t _type, const tlvpack& _pack)
+{
+    const auto pack_offset = begin_pack(_type);
+
+    _pack.serialize(stream_);
+
+    end_pack(pack_offset);
+}
+
+uint32_t tlv_writer::begin_pack(const uint32_t _type)
+{
+    stream_.write<uint32_t>(_type);
+
+    const auto pack_offset = stream_.get_input();
+
+    // length is patched in end_pack
+    stream_.write<uint32_t>(0);
+
+    return pack_offset;
+}
+
+void tlv_writer::end_pack(const uint32_t _pack_offset)
+{
+    const auto pack_end = stream_.get_input();
+    assert(pack_end >= (_pack_offset + sizeof(uint32_t)));
+
+    const uint32_t length = (pack_end - _pack_offset - sizeof(uint32_t));
+
+    memcpy(stream_.get_data() + _pack_offset, &length, sizeof(length));
+}
+
+tlv_view::tlv_view()
+    : type_(0)
+    , data_(nullptr)
+    , size_(0)
+{
+}
+
+tlv_view::tlv_view(const uint32_t _type, const char* _data, const uint32_t _size)
+    : type_(_type)
+    , data_(_data)
+    , size_(_size)
+{
+}
+
+boost::string_ref tlv_view::get_string_ref() const
+{
+    if (!size_)
+        return boost::string_ref();
+
+    return boost::string_ref(data_, size_);
+}
+
+std::string tlv_view::get_string() const
+{
+    if (!size_)
+        return std::string();
+
+    return std::string(data_, size_);
+}
+
+tlv_reader tlv_view::get_pack() const
+{
+    return tlv_reader(data_, size_);
+}
+
+tlvpack tlv_view::to_pack() const
+{
+    tlvpack pack;
+
+    if (!size_)
+        return pack;
+
+    binary_stream stream;
+    stream.write(data_, size_);
+
+    pack.unserialize(stream);
+
+    return pack;
+}
+
+tlv_reader::tlv_reader(const char* _data, const uint32_t _size)
+    : data_(_data)
+    , size_(_data ? _size : 0)
+    , cursor_(0)
+{
+}
+
+bool tlv_reader::next(Out tlv_view& _item)
+{
+    if ((size_ - cursor_) < tlv_header_size)
+        return false;
+
+    uint32_t type = 0;
+    uint32_t length = 0;
+    memcpy(&type, data_ + cursor_, sizeof(type));
+    memcpy(&length, data_ + cursor_ + sizeof(type), sizeof(length));
+
+    if ((size_ - cursor_ - tlv_header_size) < length)
+        return false;
+
+    Out _item = tlv_view(type, (length ? (data_ + cursor_ + tlv_header_size) : nullptr), length);
+
+    cursor_ += (tlv_header_size + length);
+
+    return true;
+}
+
+bool tlv_reader::find(const uint32_t _type, Out tlv_view& _item) const
+{
+    tlv_reader reader(data_, size_);
+
+    tlv_view item;
+    while (reader.next(Out item))
+    {
+        if (item.get_type() == _type)
+        {
+            Out _item = item;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool tlv_reader::validate() const
+{
+    tlv_reader reader(data_, size_);
+
+    tlv_view item;
+    while (reader.next(Out item))
+    {
+    }
+
+    return (reader.cursor_ == size_);
+}
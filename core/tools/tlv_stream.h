@@ -0,0 +1,110 @@
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+
+#include "binary_stream.h"
+#include "tlv.h"
+
+namespace core
+{
+    namespace tools
+    {
+        // tlv_writer/tlv_reader produce and parse the same bytes as tlvpack,
+        // but work in place over one buffer instead of a list of per-field streams
+
+        class tlv_writer
+        {
+            binary_stream& stream_;
+
+        public:
+
+            explicit tlv_writer(binary_stream& _stream);
+
+            template <class T_>
+            void write(const uint32_t _type, const T_ _value);
+
+            void write(const uint32_t _type, const std::string& _value);
+            void write(const uint32_t _type, const char* _data, const uint32_t _size);
+            void write(const uint32_t _type, const tlvpack& _pack);
+
+            // nested pack: everything written to the stream until end_pack becomes the value of _type
+            uint32_t begin_pack(const uint32_t _type);
+            void end_pack(const uint32_t _pack_offset);
+
+            binary_stream& get_stream() { return stream_; }
+        };
+
+        class tlv_reader;
+
+        class tlv_view
+        {
+            uint32_t type_;
+            const char* data_;
+            uint32_t size_;
+
+        public:
+
+            tlv_view();
+            tlv_view(const uint32_t _type, const char* _data, const uint32_t _size);
+
+            uint32_t get_type() const { return type_; }
+            uint32_t get_size() const { return size_; }
+            const char* get_data() const { return data_; }
+
+            template <class T_>
+            T_ get_value(const T_ _default_value) const;
+
+            boost::string_ref get_string_ref() const;
+            std::string get_string() const;
+
+            tlv_reader get_pack() const;
+            tlvpack to_pack() const;
+        };
+
+        class tlv_reader
+        {
+            const char* data_;
+            uint32_t size_;
+            uint32_t cursor_;
+
+        public:
+
+            tlv_reader(const char* _data, const uint32_t _size);
+
+            bool next(Out tlv_view& _item);
+            bool find(const uint32_t _type, Out tlv_view& _item) const;
+
+            // checks the whole buffer is a sequence of complete tlv fields
+            bool validate() const;
+
+            void rewind() { cursor_ = 0; }
+        };
+
+        template <class T_>
+        void tlv_writer::write(const uint32_t _type, const T_ _value)
+        {
+            static_assert(std::is_scalar<T_>::value, "value should be of scalar type");
+            static_assert(!is_implementaion_defined_fundamental<T_>::value, "Data Structure requires fixed-width types.");
+
+            stream_.write<uint32_t>(_type);
+            stream_.write<uint32_t>((uint32_t) sizeof(T_));
+            stream_.write<T_>(_value);
+        }
+
+        template <class T_>
+        T_ tlv_view::get_value(const T_ _default_value) const
+        {
+            static_assert(std::is_scalar<T_>::value, "value should be of scalar type");
+
+            if (size_ < sizeof(T_))
+            {
+                assert(!"bad tlv length");
+                return _default_value;
+            }
+
+            typename std::remove_const<T_>::type val = _default_value;
+            memcpy(&val, data_, sizeof(T_));
+            return val;
+        }
+    }
+}
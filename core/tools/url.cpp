@@ -4,6 +4,37 @@
 
 #include "url.h"
 
+namespace
+{
+    struct escape_table
+    {
+        escape_table()
+        {
+            unreserved_.fill(false);
+
+            for (auto sym = '0'; sym <= '9'; ++sym)
+                unreserved_[(unsigned char)sym] = true;
+
+            for (auto sym = 'a'; sym <= 'z'; ++sym)
+                unreserved_[(unsigned char)sym] = true;
+
+            for (auto sym = 'A'; sym <= 'Z'; ++sym)
+                unreserved_[(unsigned char)sym] = true;
+
+            for (const auto sym : std::string("-._~"))
+                unreserved_[(unsigned char)sym] = true;
+        }
+
+        std::array<bool, 256> unreserved_;
+    };
+
+    const escape_table& get_escape_table()
+    {
+        static const escape_table table;
+        return table;
+    }
+}
+
 std::string core::tools::encode_url(const std::string& _url)
 {
     std::stringstream result;
@@ -35,3 +66,43 @@ std::string core::tools::encode_url(const std::string& _url)
 
     return result.str();
 }
+
+void core::tools::escape_url_symbols(const char* _data, const size_t _size, std::string& _out)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+
+    const auto& unreserved = get_escape_table().unreserved_;
+
+    _out.reserve(_out.size() + get_escaped_url_size(_data, _size));
+
+    for (size_t i = 0; i < _size; ++i)
+    {
+        const auto sym = (unsigned char)_data[i];
+
+        if (unreserved[sym])
+        {
+            _out += (char)sym;
+        }
+        else
+        {
+            _out += '%';
+            _out += hex_digits[sym >> 4];
+            _out += hex_digits[sym & 0xF];
+        }
+    }
+}
+
+size_t core::tools::get_escaped_url_size(const char* _data, const size_t _size)
+{
+    const auto& unreserved = get_escape_table().unreserved_;
+
+    auto size = _size;
+
+    for (size_t i = 0; i < _size; ++i)
+    {
+        if (!unreserved[(unsigned char)_data[i]])
+            size += 2;
+    }
+
+    return size;
+}
@@ -5,5 +5,10 @@ namespace core
     namespace tools
     {
         std::string encode_url(const std::string& _url);
+
+        // percent-encodes all but the unreserved symbols of rfc 3986 ([A-Za-z0-9-._~]), appending to _out
+        void escape_url_symbols(const char* _data, const size_t _size, std::string& _out);
+
+        size_t get_escaped_url_size(const char* _data, const size_t _size);
     }
 }
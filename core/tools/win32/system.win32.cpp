@@ -64,6 +64,18 @@ bool move_file(const std::wstring& _old_file, const std::wstring& _new_file)
 	return !!::MoveFileEx(_old_file.c_str(), _new_file.c_str(), MOVEFILE_COPY_ALLOWED | MOVEFILE_REPLACE_EXISTING);
 }
 
+bool sync_file(const std::wstring& _file_name)
+{
+    const auto file = ::CreateFile(_file_name.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    const auto result = !!::FlushFileBuffers(file);
+    ::CloseHandle(file);
+
+    return result;
+}
+
 bool copy_file(const std::wstring& _old_file, const std::wstring& _new_file)
 {
     return !!::CopyFile(_old_file.c_str(), _new_file.c_str(), false);
@@ -4,6 +4,8 @@
 
 #include "ivalue.h"
 
+#include "message_table.h"
+
 #include "../common.shared/common_defs.h"
 
 namespace core
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "namespaces.h"
+
+CORE_NS_BEGIN
+
+// core<->gui messages keep their string names on the wire and in the logs,
+// both sides dispatch them by the FNV-1a hash of the name
+typedef uint32_t message_id;
+
+// constexpr, so a literal name folds into a case label or a table key at compile time
+constexpr message_id get_message_id(const char* _name, message_id _hash = 2166136261u)
+{
+    return (*_name == 0) ? _hash : get_message_id(_name + 1, (message_id)((_hash ^ (uint8_t)*_name) * 16777619u));
+}
+
+// message handlers stored densely in the order of registration,
+// with an open addressing index from the message id to the handler
+template <class t_>
+class message_table
+{
+    struct entry
+    {
+        message_id id_;
+        int32_t handler_;
+    };
+
+    std::vector<entry> index_;
+    std::vector<t_> handlers_;
+    std::vector<const char*> names_;
+
+    uint32_t mask() const { return (uint32_t)index_.size() - 1; }
+
+    void rebuild(size_t _size)
+    {
+        index_.assign(_size, entry{ 0, -1 });
+
+        for (int32_t i = 0; i < (int32_t)handlers_.size(); ++i)
+            place(get_message_id(names_[i]), i);
+    }
+
+    void place(message_id _id, int32_t _handler)
+    {
+        auto pos = _id & mask();
+        while (index_[pos].handler_ != -1)
+            pos = (pos + 1) & mask();
+
+        index_[pos] = entry{ _id, _handler };
+    }
+
+public:
+
+    message_table()
+        : index_(16, entry{ 0, -1 })
+    {
+    }
+
+    // _name must be a literal, it is kept for the logs
+    void add(const char* _name, t_ _handler)
+    {
+        const auto id = get_message_id(_name);
+
+        assert(!find(id) && "a message is registered twice or two names share a hash");
+
+        handlers_.push_back(std::move(_handler));
+        names_.push_back(_name);
+
+        // keep the index at most half full
+        if (handlers_.size() * 2 > index_.size())
+            rebuild(index_.size() * 2);
+        else
+            place(id, (int32_t)handlers_.size() - 1);
+    }
+
+    const t_* find(message_id _id) const
+    {
+        for (auto pos = _id & mask(); index_[pos].handler_ != -1; pos = (pos + 1) & mask())
+        {
+            if (index_[pos].id_ == _id)
+                return &handlers_[index_[pos].handler_];
+        }
+
+        return nullptr;
+    }
+
+    const t_* find(const char* _name) const
+    {
+        return find(get_message_id(_name));
+    }
+
+    const char* get_name(message_id _id) const
+    {
+        const auto handler = find(_id);
+        return (handler ? names_[handler - handlers_.data()] : nullptr);
+    }
+
+    size_t size() const { return handlers_.size(); }
+};
+
+CORE_NS_END
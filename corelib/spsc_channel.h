@@ -0,0 +1,334 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "namespaces.h"
+#include "message_table.h"
+
+CORE_NS_BEGIN
+
+class icollection;
+
+// one core<->gui message in flight
+struct channel_message
+{
+    message_id id_;
+    int64_t seq_;
+    icollection* data_;
+
+    // steady clock, microseconds; set by the channel on the sampled pushes, 0 on the others
+    int64_t posted_;
+
+    // the name is kept for the logs only, long names are cut
+    char name_[64];
+
+    channel_message()
+        : id_(0)
+        , seq_(0)
+        , data_(nullptr)
+        , posted_(0)
+    {
+        name_[0] = 0;
+    }
+
+    channel_message(const char* _name, int64_t _seq, icollection* _data)
+        : id_(get_message_id(_name))
+        , seq_(_seq)
+        , data_(_data)
+        , posted_(0)
+    {
+        strncpy(name_, _name, sizeof(name_) - 1);
+        name_[sizeof(name_) - 1] = 0;
+    }
+};
+
+// queue depth and push-to-drain latency of a channel, readable from any thread;
+// latency bucket i counts the sampled messages drained in less than 2^i microseconds
+class channel_stats
+{
+public:
+
+    static const int32_t buckets_count = 24;
+
+private:
+
+    std::atomic<uint64_t> count_;
+    std::atomic<uint32_t> max_depth_;
+    std::atomic<uint64_t> latency_[buckets_count];
+
+public:
+
+    channel_stats()
+        : count_(0)
+        , max_depth_(0)
+    {
+        for (auto& bucket : latency_)
+            bucket = 0;
+    }
+
+    void on_batch(uint32_t _depth)
+    {
+        auto max_depth = max_depth_.load(std::memory_order_relaxed);
+        while (_depth > max_depth && !max_depth_.compare_exchange_weak(max_depth, _depth, std::memory_order_relaxed));
+    }
+
+    void on_deliver(int64_t _latency)
+    {
+        int32_t bucket = 0;
+        while (bucket < buckets_count - 1 && _latency >= ((int64_t)1 << bucket))
+            ++bucket;
+
+        latency_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint32_t max_depth() const { return max_depth_.load(std::memory_order_relaxed); }
+    uint64_t bucket(int32_t _index) const { return latency_[_index].load(std::memory_order_relaxed); }
+
+    // upper bound of the bucket holding the given share of the deliveries, microseconds
+    int64_t latency_percentile(double _share) const
+    {
+        const auto total = count();
+        if (total == 0)
+            return 0;
+
+        uint64_t sum = 0;
+        for (int32_t i = 0; i < buckets_count; ++i)
+        {
+            sum += bucket(i);
+            if (sum >= _share * total)
+                return ((int64_t)1 << i);
+        }
+
+        return ((int64_t)1 << (buckets_count - 1));
+    }
+};
+
+// bounded lock-free ring for one producer and one consumer thread
+template <class t_>
+class spsc_ring
+{
+    std::vector<t_> items_;
+    const size_t mask_;
+
+    // the indices grow forever and are masked on access;
+    // the padding keeps the producer and the consumer off each other's cache line
+    char pad0_[64];
+    std::atomic<size_t> head_;
+    char pad1_[64];
+    std::atomic<size_t> tail_;
+    char pad2_[64];
+
+public:
+
+    // _capacity must be a power of two
+    explicit spsc_ring(size_t _capacity)
+        : items_(_capacity)
+        , mask_(_capacity - 1)
+        , head_(0)
+        , tail_(0)
+    {
+        assert((_capacity & mask_) == 0);
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    // producer thread, _item is left intact when the ring is full
+    bool push(t_& _item)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == items_.size())
+            return false;
+
+        items_[tail & mask_] = std::move(_item);
+        tail_.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // consumer thread
+    bool pop(t_& _item)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+
+        _item = std::move(items_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return items_.size(); }
+};
+
+// one-way message channel between two threads:
+// the producer is bound by bind_producer, the other threads (and all of them before the binding) get false from push
+// and keep their own path;
+// the order holds within the channel only, a message sent by another thread on its own path may overtake the queued ones,
+// so the messages that must keep their order against each other have to come from one thread;
+// the consumer is woken once per batch, not once per message;
+// when the ring is full the messages go to a locked overflow queue, in order, until the consumer drains it
+template <class t_>
+class spsc_channel
+{
+    static const uint32_t latency_sampling = 16;
+
+    spsc_ring<t_> ring_;
+
+    std::function<void()> wakeup_;
+    std::atomic<bool> wakeup_pending_;
+
+    std::atomic<std::thread::id> producer_;
+    uint32_t pushed_;
+
+    std::mutex overflow_mutex_;
+    std::deque<t_> overflow_;
+    std::atomic<bool> overflowed_;
+    std::atomic<size_t> overflow_size_;
+
+    channel_stats stats_;
+
+    static int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool is_producer() const
+    {
+        return (producer_.load(std::memory_order_acquire) == std::this_thread::get_id());
+    }
+
+    // the latency is counted up to the start of the batch, one clock read per batch
+    void deliver(t_& _item, int64_t _batch_start, const std::function<void(t_&)>& _handler)
+    {
+        if (_item.posted_)
+            stats_.on_deliver(_batch_start - _item.posted_);
+
+        _handler(_item);
+    }
+
+public:
+
+    // _wakeup runs on the producer thread and must get the consumer to call drain
+    spsc_channel(size_t _capacity, std::function<void()> _wakeup)
+        : ring_(_capacity)
+        , wakeup_(std::move(_wakeup))
+        , wakeup_pending_(false)
+        , producer_(std::thread::id())
+        , pushed_(0)
+        , overflowed_(false)
+        , overflow_size_(0)
+    {
+    }
+
+    spsc_channel(const spsc_channel&) = delete;
+    spsc_channel& operator=(const spsc_channel&) = delete;
+
+    // the calling thread becomes the producer, once
+    void bind_producer()
+    {
+        assert(producer_.load() == std::thread::id());
+
+        producer_.store(std::this_thread::get_id(), std::memory_order_release);
+    }
+
+    bool push(t_ _item)
+    {
+        if (!is_producer())
+            return false;
+
+        // a clock read costs as much as the push itself, so one message in latency_sampling is timed
+        _item.posted_ = ((pushed_++ % latency_sampling) == 0 ? now() : 0);
+
+        if (overflowed_.load(std::memory_order_acquire) || !ring_.push(_item))
+        {
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            overflow_.push_back(std::move(_item));
+            overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+            overflowed_.store(true, std::memory_order_release);
+        }
+
+        if (!wakeup_pending_.exchange(true))
+            wakeup_();
+
+        return true;
+    }
+
+    // consumer thread, hands every queued message to _handler in the order of push
+    size_t drain(const std::function<void(t_&)>& _handler)
+    {
+        // re-arm first, a push racing with the drain then costs an extra empty wakeup at most
+        wakeup_pending_.store(false);
+
+        size_t count = 0;
+        t_ item;
+
+        for (;;)
+        {
+            const auto batch_start = now();
+
+            stats_.on_batch((uint32_t)depth());
+
+            while (ring_.pop(item))
+            {
+                deliver(item, batch_start, _handler);
+                ++count;
+            }
+
+            if (!overflowed_.load(std::memory_order_acquire))
+                break;
+
+            // the producer does not touch the ring while it overflows,
+            // so whatever the ring holds under the lock was pushed before the overflow began
+            size_t older = 0;
+            std::deque<t_> overflow;
+            {
+                std::lock_guard<std::mutex> lock(overflow_mutex_);
+                older = ring_.size();
+                overflow.swap(overflow_);
+                overflow_size_.store(0, std::memory_order_relaxed);
+                overflowed_.store(false, std::memory_order_release);
+            }
+
+            for (; older > 0 && ring_.pop(item); --older)
+            {
+                deliver(item, batch_start, _handler);
+                ++count;
+            }
+
+            for (auto& overflow_item : overflow)
+            {
+                deliver(overflow_item, batch_start, _handler);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    size_t depth() const
+    {
+        return ring_.size() + overflow_size_.load(std::memory_order_relaxed);
+    }
+
+    const channel_stats& get_stats() const { return stats_; }
+};
+
+CORE_NS_END
@@ -12,17 +12,23 @@ namespace
 {
     QString CreateKey(const QString& _aimId, const int _sizePx);
 
+    qint64 GetPixmapBytes(const QPixmap& _pixmap);
+
     static int CLEANUP_TIMEOUT = 5 * 60 * 1000; //5min
 
     static int CREATE_TIMEOUT = 2 * 60 * 1000; //2min
 
     static int REQUEST_TIMEOUT = 15 * 1000; //15 sec
+
+    static qint64 SECONDARY_CACHES_BUDGET = 64 * 1024 * 1024; //64mb of scaled and rounded avatars
 }
 
 namespace Logic
 {
     AvatarStorage::AvatarStorage()
         : Timer_(new QTimer(this))
+        , SecondaryCachesBytes_(0)
+        , TrimScheduled_(false)
     {
         Timer_->setSingleShot(false);
         Timer_->setInterval(CLEANUP_TIMEOUT);
@@ -52,6 +58,7 @@ namespace Logic
         auto iterByAimIdAndSize = AvatarsByAimIdAndSize_.find(key);
         if (iterByAimIdAndSize != AvatarsByAimIdAndSize_.end())
         {
+            TouchSecondary(AvatarsByAimIdAndSize_, key);
             return iterByAimIdAndSize->second;
         }
 
@@ -84,17 +91,22 @@ namespace Logic
             return Get(_aimId, _displayName, _sizePx, _isDefault, _regenerate);
         }
 
-        int avatarWidth = avatarByAimId.width();
-        int avatarHeight = avatarByAimId.height();
+        const auto &scaleSource = GetScaleSource(_aimId, avatarByAimId, _sizePx);
+        int avatarWidth = scaleSource.width();
+        int avatarHeight = scaleSource.height();
         QPixmap scaledImage;
-        if (avatarHeight >= avatarWidth)
-            scaledImage = avatarByAimId.scaledToWidth(_sizePx, Qt::SmoothTransformation);
+        if (avatarWidth == _sizePx && avatarHeight == _sizePx)
+            scaledImage = scaleSource;
+        else if (avatarHeight >= avatarWidth)
+            scaledImage = scaleSource.scaledToWidth(_sizePx, Qt::SmoothTransformation);
         else
-            scaledImage = avatarByAimId.scaledToHeight(_sizePx, Qt::SmoothTransformation);
+            scaledImage = scaleSource.scaledToHeight(_sizePx, Qt::SmoothTransformation);
 
         const auto result = AvatarsByAimIdAndSize_.emplace(key, std::make_shared<QPixmap>(std::move(scaledImage)));
         assert(result.second);
 
+        TouchSecondary(AvatarsByAimIdAndSize_, key);
+
         if (_aimId == ql1s("mail"))
             return result.first->second;
 
@@ -176,6 +188,28 @@ namespace Logic
         Ui::GetDispatcher()->post_message_to_core(qsl("avatars/get"), collection.get());
     }
 
+    void AvatarStorage::Request(const QString& _aimId, const int _sizePx)
+    {
+        Ui::gui_coll_helper collection(Ui::GetDispatcher()->create_collection(), true);
+        collection.set_value_as_qstring("contact", _aimId);
+        collection.set_value_as_int("size", _sizePx);
+        Ui::GetDispatcher()->post_message_to_core(qsl("avatars/get"), collection.get());
+
+        RequestedAvatars_.insert(_aimId);
+    }
+
+    std::vector<int> AvatarStorage::GetSizes(const QString& _aimId) const
+    {
+        std::vector<int> sizes;
+
+        // the keys of an aimid are adjacent in the map
+        const QString prefix = _aimId % ql1c('/');
+        for (auto iter = AvatarsByAimIdAndSize_.lower_bound(prefix); iter != AvatarsByAimIdAndSize_.end() && iter->first.startsWith(prefix); ++iter)
+            sizes.push_back(iter->first.midRef(prefix.size()).toInt());
+
+        return sizes;
+    }
+
     const QPixmapSCptr& AvatarStorage::GetRounded(const QString& _aimId, const QString& _displayName, const int _sizePx, const QString& _state, bool& _isDefault, bool _regenerate, bool mini_icons)
     {
         assert(_sizePx > 0);
@@ -239,9 +273,14 @@ namespace Logic
         assert(!_aimId.isEmpty());
         LoadedAvatarsFails_.removeAll(_aimId);
 
-        QPixmapSCptr avatar(_pixmap);
-        auto scaledImage = avatar->scaled(_size, _size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        QPixmapSCptr cache = std::make_shared<QPixmap>(std::move(scaledImage));
+        // avatars are decoded at the requested size on the decode pool, scale only what is still larger
+        QPixmapSCptr cache(_pixmap);
+        if (_size > 0 && (_pixmap->width() > _size || _pixmap->height() > _size))
+        {
+            auto scaledImage = _pixmap->scaled(_size, _size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            cache = std::make_shared<QPixmap>(std::move(scaledImage));
+        }
+
         auto iterPixmap = AvatarsByAimId_.find(_aimId);
         if (iterPixmap != AvatarsByAimId_.end())
         {
@@ -327,7 +366,7 @@ namespace Logic
     // TODO : use two-step hash here
     void AvatarStorage::CleanupSecondaryCaches(const QString& _aimId)
     {
-        const auto cleanupSecondaryCache = [&_aimId](CacheMap &cache)
+        const auto cleanupSecondaryCache = [this, &_aimId](CacheMap &cache)
         {
             for (auto i = cache.begin(); i != cache.end(); ++i)
             {
@@ -339,6 +378,7 @@ namespace Logic
 
                 for(;;)
                 {
+                    ForgetSecondary(i->first, *i->second);
                     i = cache.erase(i);
 
                     if (i == cache.end())
@@ -382,9 +422,107 @@ namespace Logic
                 .first;
         }
 
+        TouchSecondary(RoundedAvatarsByAimIdAndSize_, key);
+
         return i->second;
     }
 
+    const QPixmap& AvatarStorage::GetScaleSource(const QString& _aimId, const QPixmap& _avatar, const int _sizePx) const
+    {
+        // scaled variants of the contact form a mip chain, derive the new one from the closest larger level
+        const QString prefix = _aimId % ql1c('/');
+
+        const QPixmap* source = &_avatar;
+
+        for (auto iter = AvatarsByAimIdAndSize_.lower_bound(prefix); iter != AvatarsByAimIdAndSize_.end(); ++iter)
+        {
+            const auto &key = iter->first;
+            if (!key.startsWith(prefix))
+            {
+                break;
+            }
+
+            const auto &level = *iter->second;
+            if (level.isNull() || std::min(level.width(), level.height()) < _sizePx)
+            {
+                continue;
+            }
+
+            if (level.width() < source->width())
+            {
+                source = &level;
+            }
+        }
+
+        return *source;
+    }
+
+    void AvatarStorage::TouchSecondary(CacheMap& _cache, const QString& _key)
+    {
+        auto indexIter = SecondaryLruIndex_.find(_key);
+        if (indexIter != SecondaryLruIndex_.end())
+        {
+            SecondaryLru_.splice(SecondaryLru_.end(), SecondaryLru_, indexIter.value());
+            return;
+        }
+
+        const auto cacheIter = _cache.find(_key);
+        assert(cacheIter != _cache.end());
+
+        SecondaryCachesBytes_ += GetPixmapBytes(*cacheIter->second);
+        SecondaryLruIndex_.insert(_key, SecondaryLru_.emplace(SecondaryLru_.end(), &_cache, _key));
+
+        if (SecondaryCachesBytes_ <= SECONDARY_CACHES_BUDGET || TrimScheduled_)
+        {
+            return;
+        }
+
+        // callers may still hold references into the caches, so trim on the next event loop iteration
+        TrimScheduled_ = true;
+        QTimer::singleShot(0, this, &AvatarStorage::TrimSecondaryCaches);
+    }
+
+    void AvatarStorage::ForgetSecondary(const QString& _key, const QPixmap& _pixmap)
+    {
+        auto indexIter = SecondaryLruIndex_.find(_key);
+        if (indexIter == SecondaryLruIndex_.end())
+        {
+            return;
+        }
+
+        SecondaryLru_.erase(indexIter.value());
+        SecondaryLruIndex_.erase(indexIter);
+
+        SecondaryCachesBytes_ -= GetPixmapBytes(_pixmap);
+        assert(SecondaryCachesBytes_ >= 0);
+    }
+
+    void AvatarStorage::TrimSecondaryCaches()
+    {
+        TrimScheduled_ = false;
+
+        while (SecondaryCachesBytes_ > SECONDARY_CACHES_BUDGET && !SecondaryLru_.empty())
+        {
+            const auto &oldest = SecondaryLru_.front();
+
+            auto &cache = *oldest.first;
+            const auto key = oldest.second;
+
+            const auto cacheIter = cache.find(key);
+            assert(cacheIter != cache.end());
+
+            if (cacheIter == cache.end())
+            {
+                SecondaryLruIndex_.remove(key);
+                SecondaryLru_.pop_front();
+                continue;
+            }
+
+            ForgetSecondary(key, *cacheIter->second);
+            cache.erase(cacheIter);
+        }
+    }
+
     AvatarStorage* GetAvatarStorage()
     {
         static std::unique_ptr<AvatarStorage> storage(new AvatarStorage());
@@ -399,4 +537,9 @@ namespace
         assert(_sizePx > 0);
         return _aimId % ql1c('/') % QString::number(_sizePx);
     }
+
+    qint64 GetPixmapBytes(const QPixmap& _pixmap)
+    {
+        return ((qint64)_pixmap.width() * _pixmap.height() * _pixmap.depth() / 8);
+    }
 }
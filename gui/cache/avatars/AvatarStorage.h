@@ -38,6 +38,12 @@ namespace Logic
         void UpdateDefaultAvatarIfNeed(const QString& _aimId);
         void ForceRequest(const QString& _aimId, const int _sizePx);
 
+        // asks the core for an avatar that was drawn before the im was created, the first request was lost then
+        void Request(const QString& _aimId, const int _sizePx);
+
+        // the sizes the avatar is held at
+        std::vector<int> GetSizes(const QString& _aimId) const;
+
         void SetAvatar(const QString& _aimId, const QPixmap& _pixmap);
 
     private:
@@ -47,6 +53,14 @@ namespace Logic
 
         void CleanupSecondaryCaches(const QString& _aimId);
 
+        const QPixmap& GetScaleSource(const QString& _aimId, const QPixmap& _avatar, const int _sizePx) const;
+
+        void TouchSecondary(CacheMap& _cache, const QString& _key);
+
+        void ForgetSecondary(const QString& _key, const QPixmap& _pixmap);
+
+        void TrimSecondaryCaches();
+
         const QPixmapSCptr& GetRounded(const QPixmap& _avatar, const QString& _aimId, const QString& _state, bool mini_icons, bool _isDefault);
 
         CacheMap AvatarsByAimIdAndSize_;
@@ -66,6 +80,16 @@ namespace Logic
         std::map<QString, QDateTime> TimesCache_;
 
         QTimer* Timer_;
+
+        typedef std::list<std::pair<CacheMap*, QString>> SecondaryLruList;
+
+        SecondaryLruList SecondaryLru_;
+
+        QHash<QString, SecondaryLruList::iterator> SecondaryLruIndex_;
+
+        qint64 SecondaryCachesBytes_;
+
+        bool TrimScheduled_;
     };
 
     AvatarStorage* GetAvatarStorage();
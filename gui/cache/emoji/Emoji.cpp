@@ -3,6 +3,7 @@
 #include "Emoji.h"
 #include "EmojiDb.h"
 
+#include "../../utils/log/log.h"
 #include "../../utils/SChar.h"
 #include "../../utils/utils.h"
 
@@ -31,23 +32,42 @@ namespace
         EmojiSizePx::_64
     };
 
-    QFuture<bool> Loading_;
+    struct EmojiAtlas
+    {
+        explicit EmojiAtlas(const int32_t _sizePx);
+
+        const int32_t SizePx_;
+
+        int32_t Columns_;
+
+        int32_t Count_;
 
-    typedef std::unordered_map<int32_t, const QImage> EmojiSetsMap;
+        QImage Image_;
 
-    typedef EmojiSetsMap::iterator EmojiSetsIter;
+        QFuture<bool> Loading_;
+    };
+
+    typedef std::shared_ptr<EmojiAtlas> EmojiAtlasSptr;
 
-    EmojiSetsMap EmojiSetBySize_;
+    std::unordered_map<int32_t, EmojiAtlasSptr> AtlasBySize_;
 
     std::unordered_map<int64_t, const QImage> EmojiCache_;
 
+    EmojiAtlasNotifier* AtlasNotifier_ = nullptr;
+
     int32_t GetEmojiSizeForCurrentUiScale();
 
     const EmojiSetMeta& GetMetaForCurrentUiScale();
 
     const EmojiSetMeta& GetMetaBySize(const int32_t _sizePx);
 
-    EmojiSetsIter LoadEmojiSetForSizeIfNeeded(const EmojiSetMeta& _meta);
+    const EmojiAtlasSptr& RequestAtlas(const EmojiSetMeta& _meta);
+
+    bool LoadAtlas(EmojiAtlas& _atlas, const QString& _resourceName);
+
+    QRect GetSlotRect(const EmojiAtlas& _atlas, const int32_t _index);
+
+    const QImage& RenderAppleEmoji(const uint32_t _main, const uint32_t _ext, const int32_t _sizePx, const int64_t _key);
 
     int64_t MakeCacheKey(const int32_t _index, const int32_t _sizePx);
 
@@ -56,26 +76,64 @@ namespace
 namespace Emoji
 {
 
-    void InitializeSubsystem()
+    EmojiSprite::EmojiSprite()
     {
-        InitEmojiDb();
+    }
 
-        const auto load = []
+    EmojiSprite::EmojiSprite(std::shared_ptr<const QImage> _atlas, const QRect& _sourceRect)
+        : Atlas_(std::move(_atlas))
+        , SourceRect_(_sourceRect)
+    {
+        assert(Atlas_);
+        assert(!SourceRect_.isEmpty());
+    }
+
+    bool EmojiSprite::isNull() const
+    {
+        return !Atlas_;
+    }
+
+    const QImage& EmojiSprite::atlas() const
+    {
+        assert(Atlas_);
+        return *Atlas_;
+    }
+
+    const QRect& EmojiSprite::sourceRect() const
+    {
+        return SourceRect_;
+    }
+
+    void EmojiSprite::draw(QPainter& _painter, const QRectF& _target) const
+    {
+        assert(Atlas_);
+        if (!Atlas_)
         {
-            const auto &meta = GetMetaForCurrentUiScale();
+            return;
+        }
 
-            LoadEmojiSetForSizeIfNeeded(meta);
+        _painter.drawImage(_target, *Atlas_, SourceRect_);
+    }
 
-            return true;
-        };
+    void InitializeSubsystem()
+    {
+        InitEmojiDb();
 
-        Loading_ = QtConcurrent::run(QThreadPool::globalInstance(), load);
+        if (platform::is_apple())
+        {
+            return;
+        }
+
+        RequestAtlas(GetMetaForCurrentUiScale());
     }
 
     void Cleanup()
     {
         EmojiCache_.clear();
-        EmojiSetBySize_.clear();
+
+        // a worker may still be packing an atlas and the sprites handed out may still be painted,
+        // both own a reference and drop it when done
+        AtlasBySize_.clear();
     }
 
     const QImage& GetEmoji(const uint32_t _main, const uint32_t _ext, const EmojiSizePx _size)
@@ -86,12 +144,6 @@ namespace Emoji
 
         static QImage empty;
 
-        Loading_.waitForFinished();
-        if (!Loading_.result())
-        {
-            return empty;
-        }
-
         const auto sizeToSearch = ((_size == EmojiSizePx::Auto) ? GetEmojiSizeForCurrentUiScale() : (int32_t)_size);
 
         const auto info = GetEmojiInfoByCodepoint(_main, _ext);
@@ -109,50 +161,125 @@ namespace Emoji
             return cacheIter->second;
         }
 
-        QImage image;
+        if (platform::is_apple())
+        {
+            return RenderAppleEmoji(_main, _ext, sizeToSearch, key);
+        }
+
+        // callers of this overload keep the image (QTextDocument resources, avatars, cached event texts),
+        // so they get the real sprite: the strip is a single png row and no sprite can be decoded without
+        // decoding all of it, the load already running is awaited instead (or run here if it has not started)
+        const auto atlas = RequestAtlas(GetMetaBySize(sizeToSearch));
+        if (!atlas->Loading_.result())
+        {
+            return empty;
+        }
+
+        const auto slot = GetSlotRect(*atlas, info->Index_);
+        if (slot.isEmpty())
+        {
+            return empty;
+        }
+
+        const auto result = EmojiCache_.emplace(key, atlas->Image_.copy(slot));
+        assert(result.second);
+
+        return result.first->second;
+    }
+
+    EmojiSprite GetEmojiSprite(const uint32_t _main, const uint32_t _ext, const EmojiSizePx _size)
+    {
+        assert(_main > 0);
+        assert(_size >= EmojiSizePx::Min);
+        assert(_size <= EmojiSizePx::Max);
+
+        const auto sizeToSearch = ((_size == EmojiSizePx::Auto) ? GetEmojiSizeForCurrentUiScale() : (int32_t)_size);
+
+        const auto info = GetEmojiInfoByCodepoint(_main, _ext);
+        if (!info)
+        {
+            return EmojiSprite();
+        }
+        assert(info->Index_ >= 0);
 
         if (platform::is_apple())
         {
-            auto pixelRatio = qApp->primaryScreen()->devicePixelRatio();
+            const auto &image = GetEmoji(_main, _ext, (EmojiSizePx)sizeToSearch);
+            if (image.isNull())
+            {
+                return EmojiSprite();
+            }
+
+            return EmojiSprite(std::make_shared<const QImage>(image), image.rect());
+        }
+
+        const auto &atlas = RequestAtlas(GetMetaBySize(sizeToSearch));
+        if (!atlas->Loading_.isFinished() || !atlas->Loading_.result())
+        {
+            return EmojiSprite();
+        }
+
+        const auto slot = GetSlotRect(*atlas, info->Index_);
+        if (slot.isEmpty())
+        {
+            return EmojiSprite();
+        }
 
-            QFont font(QStringLiteral("AppleColorEmoji"), sizeToSearch - Utils::scale_value(8));
-            QFontMetrics metrics(font);
-            QString s = Utils::SChar(_main, _ext).ToQString();
+        // the sprite owns the atlas through the image, as Cleanup() may drop the atlas while it is painted
+        return EmojiSprite(std::shared_ptr<const QImage>(atlas, &atlas->Image_), slot);
+    }
 
-            QImage imageOut(QSize(sizeToSearch * pixelRatio, sizeToSearch * pixelRatio), QImage::Format_ARGB32);
-            imageOut.fill(Qt::transparent);
-            imageOut.setDevicePixelRatio(pixelRatio);
+    bool DrawEmoji(QPainter& _painter, const QRectF& _target, const uint32_t _main, const uint32_t _ext, const EmojiSizePx _size)
+    {
+        const auto sprite = GetEmojiSprite(_main, _ext, _size);
+        if (sprite.isNull())
+        {
+            static const QColor placeholderColor(0, 0, 0, 20);
 
-            QPainter painter(&imageOut);
-            painter.setFont(font);
-            painter.drawText(QRect(0, 0, sizeToSearch, sizeToSearch), Qt::AlignCenter, s);
-            painter.end();
+            _painter.save();
+            _painter.setPen(Qt::NoPen);
+            _painter.setBrush(placeholderColor);
+            _painter.setRenderHint(QPainter::Antialiasing);
+            _painter.drawEllipse(_target.adjusted(1, 1, -1, -1));
+            _painter.restore();
 
-            image = std::move(imageOut);
+            return false;
         }
-        else
+
+        sprite.draw(_painter, _target);
+
+        return true;
+    }
+
+    EmojiAtlasNotifier* GetAtlasNotifier()
+    {
+        if (!AtlasNotifier_)
         {
-            const auto &meta = GetMetaBySize(sizeToSearch);
+            AtlasNotifier_ = new EmojiAtlasNotifier();
+        }
+
+        return AtlasNotifier_;
+    }
 
-            const auto emojiSetIter = LoadEmojiSetForSizeIfNeeded(meta);
+    qint64 GetAtlasesMemoryUsage()
+    {
+        qint64 result = 0;
 
-            const auto isSetMissing = (emojiSetIter == EmojiSetBySize_.end());
-            if (isSetMissing)
+        for (const auto &pair : AtlasBySize_)
+        {
+            const auto &atlas = pair.second;
+            if (atlas->Loading_.isFinished())
             {
-                return empty;
+                result += atlas->Image_.byteCount();
             }
-
-            QRect r(0, 0, meta.SizePx_, meta.SizePx_);
-            const auto offsetX = (info->Index_ * meta.SizePx_);
-            r.translate(offsetX, 0);
-
-            image = emojiSetIter->second.copy(r);
         }
 
-        const auto result = EmojiCache_.emplace(key, std::move(image));
-        assert(result.second);
+        for (const auto &pair : EmojiCache_)
+        {
+            result += pair.second.byteCount();
+        }
 
-        return result.first->second;
+        return result;
     }
 
     EmojiSizePx GetNearestSizeAvailable(const int32_t _sizePx)
@@ -258,24 +385,129 @@ namespace
         return *info[_sizePx];
     }
 
-    EmojiSetsIter LoadEmojiSetForSizeIfNeeded(const EmojiSetMeta& _meta)
+    EmojiAtlas::EmojiAtlas(const int32_t _sizePx)
+        : SizePx_(_sizePx)
+        , Columns_(0)
+        , Count_(0)
+    {
+        assert(SizePx_ > 0);
+    }
+
+    const EmojiAtlasSptr& RequestAtlas(const EmojiSetMeta& _meta)
     {
         assert(_meta.SizePx_ > 0);
 
-        auto emojiSetIter = EmojiSetBySize_.find(_meta.SizePx_);
-        if (emojiSetIter != EmojiSetBySize_.end())
+        auto atlasIter = AtlasBySize_.find(_meta.SizePx_);
+        if (atlasIter != AtlasBySize_.end())
         {
-            return emojiSetIter;
+            return atlasIter->second;
         }
 
-        QImage setImg;
-        const auto success = setImg.load(_meta.ResourceName_);
-        if (!success)
+        const auto sizePx = _meta.SizePx_;
+        const auto resourceName = _meta.ResourceName_;
+
+        auto atlas = std::make_shared<EmojiAtlas>(sizePx);
+
+        atlas->Loading_ = QtConcurrent::run(
+            QThreadPool::globalInstance(),
+            [atlas, resourceName]
+            {
+                return LoadAtlas(*atlas, resourceName);
+            });
+
+        auto notifier = GetAtlasNotifier();
+
+        auto watcher = new QFutureWatcher<bool>(notifier);
+        QObject::connect(watcher, &QFutureWatcher<bool>::finished, notifier, [watcher, notifier, sizePx]
         {
-            return EmojiSetBySize_.end();
+            watcher->deleteLater();
+
+            __INFO("emoji", "atlas is ready\n" __LOGP(size_px, sizePx) __LOGP(memory_bytes, GetAtlasesMemoryUsage()));
+
+            emit notifier->atlasReady(sizePx);
+        });
+        watcher->setFuture(atlas->Loading_);
+
+        return AtlasBySize_.emplace(sizePx, std::move(atlas)).first->second;
+    }
+
+    bool LoadAtlas(EmojiAtlas& _atlas, const QString& _resourceName)
+    {
+        assert(_atlas.SizePx_ > 0);
+
+        QImage strip;
+        if (!strip.load(_resourceName))
+        {
+            return false;
+        }
+
+        // the resource is a single row of sprites which easily exceeds the maximum texture width,
+        // repack it into a square-ish grid in the premultiplied format the raster engine blends fastest
+        const auto sizePx = _atlas.SizePx_;
+        const auto count = (strip.width() / sizePx);
+        if (count <= 0)
+        {
+            return false;
+        }
+
+        const auto columns = (int32_t)std::ceil(std::sqrt((double)count));
+        const auto rows = ((count + columns - 1) / columns);
+
+        QImage packed(columns * sizePx, rows * sizePx, QImage::Format_ARGB32_Premultiplied);
+        packed.fill(Qt::transparent);
+
+        QPainter painter(&packed);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+        for (auto index = 0; index < count; ++index)
+        {
+            const QPoint target((index % columns) * sizePx, (index / columns) * sizePx);
+            painter.drawImage(target, strip, QRect(index * sizePx, 0, sizePx, sizePx));
+        }
+
+        painter.end();
+
+        _atlas.Columns_ = columns;
+        _atlas.Count_ = count;
+        _atlas.Image_ = std::move(packed);
+
+        return true;
+    }
+
+    QRect GetSlotRect(const EmojiAtlas& _atlas, const int32_t _index)
+    {
+        assert(_index >= 0);
+
+        if ((_index >= _atlas.Count_) || (_atlas.Columns_ <= 0))
+        {
+            return QRect();
         }
 
-        return EmojiSetBySize_.emplace(_meta.SizePx_, std::move(setImg)).first;
+        const auto sizePx = _atlas.SizePx_;
+
+        return QRect((_index % _atlas.Columns_) * sizePx, (_index / _atlas.Columns_) * sizePx, sizePx, sizePx);
+    }
+
+    const QImage& RenderAppleEmoji(const uint32_t _main, const uint32_t _ext, const int32_t _sizePx, const int64_t _key)
+    {
+        auto pixelRatio = qApp->primaryScreen()->devicePixelRatio();
+
+        QFont font(QStringLiteral("AppleColorEmoji"), _sizePx - Utils::scale_value(8));
+        QString s = Utils::SChar(_main, _ext).ToQString();
+
+        QImage imageOut(QSize(_sizePx * pixelRatio, _sizePx * pixelRatio), QImage::Format_ARGB32);
+        imageOut.fill(Qt::transparent);
+        imageOut.setDevicePixelRatio(pixelRatio);
+
+        QPainter painter(&imageOut);
+        painter.setFont(font);
+        painter.drawText(QRect(0, 0, _sizePx, _sizePx), Qt::AlignCenter, s);
+        painter.end();
+
+        const auto result = EmojiCache_.emplace(_key, std::move(imageOut));
+        assert(result.second);
+
+        return result.first->second;
     }
 
     int64_t MakeCacheKey(const int32_t _index, const int32_t _sizePx)
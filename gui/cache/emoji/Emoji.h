@@ -20,12 +20,56 @@ namespace Emoji
         Max = 64
     };
 
+    // reference into the packed per-size atlas, cheap to copy and draw with a source rect;
+    // it shares the ownership of the atlas, so it stays valid after Cleanup()
+    class EmojiSprite
+    {
+    public:
+        EmojiSprite();
+
+        EmojiSprite(std::shared_ptr<const QImage> _atlas, const QRect& _sourceRect);
+
+        bool isNull() const;
+
+        const QImage& atlas() const;
+
+        const QRect& sourceRect() const;
+
+        void draw(QPainter& _painter, const QRectF& _target) const;
+
+    private:
+        std::shared_ptr<const QImage> Atlas_;
+
+        QRect SourceRect_;
+    };
+
+    class EmojiAtlasNotifier : public QObject
+    {
+        Q_OBJECT
+
+    Q_SIGNALS:
+        void atlasReady(const int _sizePx);
+    };
+
     void InitializeSubsystem();
 
     void Cleanup();
 
+    // the callers keep the image, so it waits for the atlas of the size if that is still loading;
+    // painting code that can repaint on EmojiAtlasNotifier::atlasReady uses DrawEmoji instead
     const QImage& GetEmoji(const uint32_t _main, const uint32_t _ext, const EmojiSizePx size = EmojiSizePx::Auto);
 
+    // never blocks: returns a null sprite and schedules the atlas load if it is not ready yet,
+    // EmojiAtlasNotifier::atlasReady is emitted once it is
+    EmojiSprite GetEmojiSprite(const uint32_t _main, const uint32_t _ext, const EmojiSizePx _size = EmojiSizePx::Auto);
+
+    // draws the emoji or a placeholder while its atlas is loading, returns false for the placeholder
+    bool DrawEmoji(QPainter& _painter, const QRectF& _target, const uint32_t _main, const uint32_t _ext, const EmojiSizePx _size = EmojiSizePx::Auto);
+
+    EmojiAtlasNotifier* GetAtlasNotifier();
+
+    qint64 GetAtlasesMemoryUsage();
+
     EmojiSizePx GetFirstLesserOrEqualSizeAvailable(const int32_t _sizePx);
 
     EmojiSizePx GetNearestSizeAvailable(const int32_t _sizePx);
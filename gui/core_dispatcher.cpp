@@ -10,7 +10,9 @@
 #include "main_window/contact_list/RecentsModel.h"
 #include "types/typing.h"
 #include "utils/gui_coll_helper.h"
+#include "utils/ImageDecoder.h"
 #include "utils/InterConnector.h"
+#include "utils/LoadAvatarFromDataTask.h"
 #include "utils/LoadPixmapFromDataTask.h"
 #include "utils/uid.h"
 #include "utils/utils.h"
@@ -31,6 +33,17 @@ int build::is_build_icq;
 
 using namespace Ui;
 
+namespace
+{
+    const size_t channel_capacity = 4096;
+}
+
+Ui::gui_connector::gui_connector()
+    : refCount_(1)
+    , channel_(channel_capacity, [this]() { emit ready(); })
+{
+}
+
 int Ui::gui_connector::addref()
 {
     return ++refCount_;
@@ -49,7 +62,8 @@ int Ui::gui_connector::release()
 
 void Ui::gui_connector::link(iconnector*, const common::core_gui_settings&)
 {
-
+    // called by the core on its thread when it starts
+    channel_.bind_producer();
 }
 
 void Ui::gui_connector::unlink()
@@ -62,7 +76,18 @@ void Ui::gui_connector::receive(const char* _message, int64_t _seq, core::icolle
     if (_messageData)
         _messageData->addref();
 
-    emit received(QString::fromUtf8(_message), _seq, _messageData);
+    if (!channel_.push(core::channel_message(_message, _seq, _messageData)))
+        emit received(core::get_message_id(_message), _seq, _messageData);
+}
+
+size_t Ui::gui_connector::drain(const std::function<void(core::channel_message&)>& _handler)
+{
+    return channel_.drain(_handler);
+}
+
+const core::channel_stats& Ui::gui_connector::getChannelStats() const
+{
+    return channel_.get_stats();
 }
 
 core_dispatcher::core_dispatcher()
@@ -257,6 +282,11 @@ int64_t core_dispatcher::downloadImage(
 
     const auto seq = post_message_to_core(qsl("image/download"), collection.get());
 
+    if (_isPreview)
+    {
+        imageDecodeSizes_.insert(seq, Utils::scale_bitmap(QSize(_previewWidth, _previewHeight)));
+    }
+
     __INFO(
         "snippets",
         "GUI(1): requested image\n"
@@ -441,6 +471,7 @@ bool core_dispatcher::init()
     gui_connector* connector = new gui_connector();
 
     QObject::connect(connector, &gui_connector::received, this, &core_dispatcher::received, Qt::QueuedConnection);
+    QObject::connect(connector, &gui_connector::ready, this, &core_dispatcher::connectorReady, Qt::QueuedConnection);
 
     guiConnector_ = connector;
 
@@ -461,7 +492,7 @@ void core_dispatcher::initMessageMap()
     REGISTER_IM_MESSAGE("im/created", onImCreated);
     REGISTER_IM_MESSAGE("login/complete", onLoginComplete);
     REGISTER_IM_MESSAGE("contactlist", onContactList);
-    REGISTER_IM_MESSAGE("contactlist/diff", onContactList);
+    REGISTER_IM_MESSAGE("contactlist/delta", onContactListDelta);
     REGISTER_IM_MESSAGE("login_get_sms_code_result", onLoginGetSmsCodeResult);
     REGISTER_IM_MESSAGE("login_result", onLoginResult);
     REGISTER_IM_MESSAGE("avatars/get/result", onAvatarsGetResult);
@@ -563,7 +594,22 @@ void core_dispatcher::uninit()
 {
     if (guiConnector_)
     {
+        const auto& stats = guiConnector_->getChannelStats();
+        __INFO("core_dispatcher", "core->gui channel\n"
+            << __LOGP(messages, stats.count())
+            << __LOGP(max_depth, stats.max_depth())
+            << __LOGP(latency_us_p50, stats.latency_percentile(0.5))
+            << __LOGP(latency_us_p99, stats.latency_percentile(0.99)));
+
         coreConnector_->unlink();
+
+        // the messages posted after the last drain
+        guiConnector_->drain([](core::channel_message& _message)
+        {
+            if (_message.data_)
+                _message.data_->release();
+        });
+
         guiConnector_->release();
 
         guiConnector_ = nullptr;
@@ -710,6 +756,7 @@ void core_dispatcher::imageDownloadResult(const int64_t _seq, core::coll_helper
     const auto data = _params.get_value_as_stream("data");
     const auto local = _params.get<QString>("local");
     const auto isVideo = _params.get<bool>("is_video");
+    const auto decodeSize = imageDecodeSizes_.take(_seq);
 
     __INFO(
         "snippets",
@@ -728,7 +775,7 @@ void core_dispatcher::imageDownloadResult(const int64_t _seq, core::coll_helper
     assert(!local.isEmpty());
     assert(!rawUri.isEmpty());
 
-    auto task = new Utils::LoadPixmapFromDataTask(data);
+    auto task = new Utils::LoadPixmapFromDataTask(data, local, decodeSize);
 
     const auto succeeded = QObject::connect(
         task, &Utils::LoadPixmapFromDataTask::loadedSignal,
@@ -747,7 +794,7 @@ void core_dispatcher::imageDownloadResult(const int64_t _seq, core::coll_helper
         Qt::QueuedConnection);
     assert(succeeded);
 
-    QThreadPool::globalInstance()->start(task);
+    Utils::getImageDecodePool()->start(task);
 }
 
 void core_dispatcher::imageDownloadResultMeta(const int64_t _seq, core::coll_helper _params)
@@ -1102,7 +1149,7 @@ qint64 core_dispatcher::post_stats_to_core(core::stats::stats_event_names _event
     return post_message_to_core(qsl("stats"), coll.get());
 }
 
-void core_dispatcher::received(const QString& _receivedMessage, const qint64 _seq, core::icollection* _params)
+void core_dispatcher::received(const quint32 _messageId, const qint64 _seq, core::icollection* _params)
 {
     if (_seq > 0)
     {
@@ -1113,13 +1160,21 @@ void core_dispatcher::received(const QString& _receivedMessage, const qint64 _se
 
     core::coll_helper collParams(_params, true);
 
-    auto iter_handler = messages_map_.find(_receivedMessage.toStdString());
-    if (iter_handler == messages_map_.end())
+    const auto handler = messages_map_.find(_messageId);
+    if (!handler)
     {
         return;
     }
 
-    iter_handler->second(_seq, collParams);
+    (*handler)(_seq, collParams);
+}
+
+void core_dispatcher::connectorReady()
+{
+    guiConnector_->drain([this](core::channel_message& _message)
+    {
+        received(_message.id_, _message.seq_, _message.data_);
+    });
 }
 
 bool core_dispatcher::isImCreated() const
@@ -1253,9 +1308,24 @@ void core_dispatcher::onContactList(const int64_t _seq, core::coll_helper _param
 
     Data::UnserializeContactList(&_params, *cl, type);
 
+    if (_params.is_value_exist("revision"))
+    {
+        emit contactListSnapshot(cl, _params.get_value_as_int64("revision"));
+        return;
+    }
+
     emit contactList(cl, type);
 }
 
+void core_dispatcher::onContactListDelta(const int64_t _seq, core::coll_helper _params)
+{
+    auto delta = std::make_shared<Data::ContactListDelta>();
+
+    Data::UnserializeContactListDelta(&_params, *delta);
+
+    emit contactListDelta(delta);
+}
+
 void core_dispatcher::onLoginGetSmsCodeResult(const int64_t _seq, core::coll_helper _params)
 {
     bool result = _params.get_value_as_bool("result");
@@ -1275,13 +1345,42 @@ void core_dispatcher::onLoginResult(const int64_t _seq, core::coll_helper _param
 
 void core_dispatcher::onAvatarsGetResult(const int64_t _seq, core::coll_helper _params)
 {
-    std::unique_ptr<QPixmap> avatar(Data::UnserializeAvatar(&_params));
-
     const QString contact = QString::fromUtf8(_params.get_value_as_string("contact"));
 
     const int size = _params.get_value_as_int("size");
 
-    emit avatarLoaded(contact, avatar.release(), size);
+    core::istream* stream = (_params.get_value_as_bool("result") ? _params.get_value_as_stream("avatar") : nullptr);
+    if (!stream)
+    {
+        std::unique_ptr<QPixmap> avatar(Data::UnserializeAvatar(&_params));
+
+        emit avatarLoaded(contact, avatar.release(), size);
+        return;
+    }
+
+    // only the latest decode of a contact is delivered, older ones may finish later on the pool
+    const auto generation = ++avatarDecodeGenerations_[contact];
+
+    auto task = new Utils::LoadAvatarFromDataTask(stream, size);
+
+    const auto succeeded = QObject::connect(
+        task, &Utils::LoadAvatarFromDataTask::loadedSignal,
+        this,
+        [this, contact, size, generation]
+        (const QImage& _avatar)
+        {
+            const auto iter = avatarDecodeGenerations_.find(contact);
+            if (iter == avatarDecodeGenerations_.end() || iter.value() != generation)
+                return;
+
+            avatarDecodeGenerations_.erase(iter);
+
+            emit avatarLoaded(contact, new QPixmap(QPixmap::fromImage(_avatar)), size);
+        },
+        Qt::QueuedConnection);
+    assert(succeeded);
+
+    Utils::LoadAvatarFromDataTask::pool()->start(task);
 }
 
 void core_dispatcher::onAvatarsPresenceUpdated(const int64_t _seq, core::coll_helper _params)
@@ -3,6 +3,7 @@
 #include "voip/VoipProxy.h"
 
 #include "../corelib/core_face.h"
+#include "../corelib/spsc_channel.h"
 #include "../corelib/collection_helper.h"
 #include "../corelib/enumerations.h"
 
@@ -53,7 +54,7 @@ namespace Ui
     typedef std::function<void(int64_t, core::coll_helper&)> message_function;
 
     #define REGISTER_IM_MESSAGE(_message_string, _callback) \
-        messages_map_.emplace( \
+        messages_map_.add( \
         _message_string, \
         std::bind(&core_dispatcher::_callback, this, std::placeholders::_1, std::placeholders::_2));
 
@@ -68,7 +69,11 @@ namespace Ui
     public:
 
 Q_SIGNALS:
-        void received(const QString&, const qint64, core::icollection*);
+        // the id of the message name, see core::get_message_id
+        void received(const quint32, const qint64, core::icollection*);
+
+        // the core thread has filled the channel, once per batch
+        void ready();
     };
 
     class gui_connector : public gui_signal, public core::iconnector
@@ -83,8 +88,18 @@ Q_SIGNALS:
         virtual void link(iconnector*, const common::core_gui_settings&) override;
         virtual void unlink() override;
         virtual void receive(const char *, int64_t, core::icollection*) override;
+
+        // messages from the core thread, bound in link; the other threads (voip) go through the received signal,
+        // so a message that must not overtake a core one cannot be sent from them
+        core::spsc_channel<core::channel_message> channel_;
+
     public:
-        gui_connector() : refCount_(1) {}
+        gui_connector();
+
+        // gui thread
+        size_t drain(const std::function<void(core::channel_message&)>& _handler);
+
+        const core::channel_stats& getChannelStats() const;
     };
 
     enum class MessagesBuddiesOpt
@@ -111,6 +126,8 @@ Q_SIGNALS:
 Q_SIGNALS:
         void needLogin(const bool _is_auth_error);
         void contactList(const std::shared_ptr<Data::ContactList>&, const QString&);
+        void contactListDelta(const std::shared_ptr<Data::ContactListDelta>&);
+        void contactListSnapshot(const std::shared_ptr<Data::ContactList>&, qint64);
         void im_created();
         void loginComplete();
         void getImagesResult(const Data::ImageListPtr& images);
@@ -228,7 +245,8 @@ Q_SIGNALS:
         void historyUpdate(const QString&, qint64);
 
     public Q_SLOTS:
-        void received(const QString&, const qint64, core::icollection*);
+        void received(const quint32, const qint64, core::icollection*);
+        void connectorReady();
 
     public:
         core_dispatcher();
@@ -307,6 +325,7 @@ Q_SIGNALS:
         void onImCreated(const int64_t _seq, core::coll_helper _params);
         void onLoginComplete(const int64_t _seq, core::coll_helper _params);
         void onContactList(const int64_t _seq, core::coll_helper _params);
+        void onContactListDelta(const int64_t _seq, core::coll_helper _params);
         void onLoginGetSmsCodeResult(const int64_t _seq, core::coll_helper _params);
         void onLoginResult(const int64_t _seq, core::coll_helper _params);
         void onAvatarsGetResult(const int64_t _seq, core::coll_helper _params);
@@ -427,7 +446,7 @@ Q_SIGNALS:
 
     private:
 
-        std::unordered_map<std::string, message_function> messages_map_;
+        core::message_table<message_function> messages_map_;
 
         core::iconnector* coreConnector_;
         core::icore_interface* coreFace_;
@@ -442,6 +461,11 @@ Q_SIGNALS:
         bool isImCreated_;
 
         bool userStateGoneAway_;
+
+        QHash<QString, quint64> avatarDecodeGenerations_;
+
+        // previews are decoded at the size they are shown at, full images at the genuine one
+        QHash<int64_t, QSize> imageDecodeSizes_;
     };
 
     core_dispatcher* GetDispatcher();
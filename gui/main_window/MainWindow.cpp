@@ -9,6 +9,7 @@
 #include "contact_list/RecentsModel.h"
 #include "contact_list/UnknownsModel.h"
 #include "contact_list/MentionModel.h"
+#include "contact_list/WarmStartSnapshot.h"
 #include "history_control/HistoryControlPage.h"
 #include "history_control/MessagesScrollArea.h"
 #include "history_control/MentionCompleter.h"
@@ -1411,6 +1412,7 @@ void MainWindow::onOpenChat(const std::string& _contact)
         Logic::ResetUnknownsModel();
         Logic::ResetMessagesModel();
         Logic::ResetLiveChatsModel();
+        Logic::ResetWarmStartSnapshot();
 
         Ui::GetDispatcher()->getVoipController().resetMaskManager();
 
@@ -1508,6 +1510,9 @@ void MainWindow::onOpenChat(const std::string& _contact)
 
         hideTitleButtons();
 
+        // the next account is not to see the recents of this one
+        Logic::WarmStartSnapshot::removeFile();
+
         stackedWidget_->setCurrentWidget(loginPage_);
         GetDispatcher()->post_stats_to_core(core::stats::stats_event_names::reg_page_phone);
 
@@ -1523,6 +1528,9 @@ void MainWindow::onOpenChat(const std::string& _contact)
     {
         if (!mainPage_)
         {
+            // the models are filled before the page is, so its first frame shows the last recents
+            Logic::getWarmStartSnapshot()->load();
+
             mainPage_ = MainPage::instance(this);
 
             if (platform::is_linux())
@@ -1744,6 +1752,8 @@ void MainWindow::onOpenChat(const std::string& _contact)
 
     void MainWindow::exit()
     {
+        Logic::getWarmStartSnapshot()->saveOnExit();
+
 #ifdef STRIP_VOIP
         QApplication::exit();
 #else
@@ -17,6 +17,17 @@
 namespace
 {
     const std::chrono::milliseconds sort_timer_timeout = std::chrono::seconds(30);
+    const std::chrono::milliseconds changes_timeout = std::chrono::seconds(2);
+
+    bool isGroupsEnabled()
+    {
+        return Ui::get_gui_settings()->get_value<bool>(settings_cl_groups_enabled, false);
+    }
+
+    bool isShown(const Logic::ContactItem& _item, const bool _groupsEnabled)
+    {
+        return _item.is_visible() && (_groupsEnabled || !_item.is_group());
+    }
 }
 
 namespace Logic
@@ -27,6 +38,7 @@ namespace Logic
         : CustomAbstractListModel(_parent)
         , ref_(new bool(false))
         , gotPageCallback_(nullptr)
+        , revision_(0)
         , sortNeeded_(false)
         , sortTimer_(new QTimer(this))
         , scrollPosition_(0)
@@ -37,6 +49,8 @@ namespace Logic
         , isWithCheckedBox_(false)
     {
         connect(Ui::GetDispatcher(), &Ui::core_dispatcher::contactList,     this, &ContactListModel::contactList);
+        connect(Ui::GetDispatcher(), &Ui::core_dispatcher::contactListDelta, this, &ContactListModel::contactListDelta);
+        connect(Ui::GetDispatcher(), &Ui::core_dispatcher::contactListSnapshot, this, &ContactListModel::contactListSnapshot);
         connect(Ui::GetDispatcher(), &Ui::core_dispatcher::presense,        this, &ContactListModel::presence);
         connect(Ui::GetDispatcher(), &Ui::core_dispatcher::outgoingMsgCount,this, &ContactListModel::outgoingMsgCount);
         connect(Ui::GetDispatcher(), &Ui::core_dispatcher::contactRemoved,  this, &ContactListModel::contactRemoved);
@@ -53,22 +67,21 @@ namespace Logic
 
     int ContactListModel::rowCount(const QModelIndex &) const
     {
-        return visible_indexes_.size();
+        return visible_rank_.count();
     }
 
     int ContactListModel::getAbsIndexByVisibleIndex(const int& _visibleIndex) const
     {
-        if (_visibleIndex >= 0 && _visibleIndex < visible_indexes_.size())
-            return visible_indexes_[_visibleIndex];
+        if (_visibleIndex >= 0 && _visibleIndex < visible_rank_.count())
+            return sorted_index_cl_[visible_rank_.position(_visibleIndex)];
         return 0;
     }
 
     QModelIndex ContactListModel::contactIndex(const QString& _aimId) const
     {
-        const auto orderedIndex = getOrderIndexByAimid(_aimId);
-        const auto visIter = std::find(visible_indexes_.cbegin(), visible_indexes_.cend(), orderedIndex);
-        if (visIter != visible_indexes_.cend())
-            return index(*visIter);
+        const auto visibleIndex = getVisibleIndexByAimid(_aimId);
+        if (visibleIndex != -1)
+            return index(visibleIndex);
         return index(0);
     }
 
@@ -76,7 +89,7 @@ namespace Logic
     {
         int cur = _i.row();
 
-        if (!_i.isValid() || (unsigned)cur >= contacts_.size())
+        if (!_i.isValid() || cur >= visible_rank_.count())
         {
             return QVariant();
         }
@@ -154,11 +167,14 @@ namespace Logic
 
     int ContactListModel::addItem(Data::ContactPtr _contact, const bool _updatePlaceholder)
     {
+        warmContacts_.remove(_contact->AimId_);
+
         auto item = getContactItem(_contact->AimId_);
         if (item != nullptr)
         {
             item->Get()->ApplyBuddy(_contact);
-            setContactVisible(_contact->AimId_, true);
+            item->set_visible(true);
+            visible_rank_.setVisible(getOrderIndexByAimid(_contact->AimId_), isShown(*item, isGroupsEnabled()));
             Logic::GetAvatarStorage()->UpdateDefaultAvatarIfNeed(_contact->AimId_);
 
             const auto ndx = contactIndex(_contact->AimId_).row();
@@ -169,12 +185,14 @@ namespace Logic
             contacts_.emplace_back(_contact);
 
             const auto newNdx = (int)contacts_.size() - 1;
+            const auto newOrderedNdx = (int)sorted_index_cl_.size();
             sorted_index_cl_.emplace_back(newNdx);
-            visible_indexes_.emplace_back(newNdx);
-            sorted_index_recents_.emplace_back(newNdx);
+            ordered_indexes_.emplace_back(newOrderedNdx);
             indexes_.insert(_contact->AimId_, newNdx);
+            visible_rank_.push_back(isShown(contacts_.back(), isGroupsEnabled()));
 
-            emitChanged(newNdx, newNdx);
+            const auto visibleNdx = visible_rank_.rank(newOrderedNdx);
+            emitChanged(visibleNdx, visibleNdx);
         }
 
         sortNeeded_ = true;
@@ -187,26 +205,44 @@ namespace Logic
 
     void ContactListModel::rebuildIndex()
     {
-        int i = 0;
-
-        indexes_.clear();
-        for (const auto &order_index : sorted_index_cl_)
-            indexes_.insert(contacts_[order_index].get_aimid(), i++);
+        ordered_indexes_.resize(sorted_index_cl_.size());
+        for (int i = 0, size = (int)sorted_index_cl_.size(); i < size; ++i)
+            ordered_indexes_[sorted_index_cl_[i]] = i;
 
         rebuildVisibleIndex();
     }
 
     void ContactListModel::rebuildVisibleIndex()
     {
-        const auto groups_enabled = Ui::get_gui_settings()->get_value<bool>(settings_cl_groups_enabled, false);
+        const auto groups_enabled = isGroupsEnabled();
+
+        std::vector<char> visible;
+        visible.reserve(sorted_index_cl_.size());
 
-        visible_indexes_.clear();
         for (const auto &order_index : sorted_index_cl_)
-        {
-            const auto& contact = contacts_[order_index];
+            visible.push_back(isShown(contacts_[order_index], groups_enabled));
 
-            if (contact.is_visible() && (groups_enabled || !contact.is_group()))
-                visible_indexes_.emplace_back(order_index);
+        visible_rank_.assign(std::move(visible));
+    }
+
+    void ContactListModel::updateVisibleRow(int _orderedIndex, bool _visible)
+    {
+        if (visible_rank_.isVisible(_orderedIndex) == _visible)
+            return;
+
+        const auto row = visible_rank_.rank(_orderedIndex);
+
+        if (_visible)
+        {
+            beginInsertRows(QModelIndex(), row, row);
+            visible_rank_.setVisible(_orderedIndex, true);
+            endInsertRows();
+        }
+        else
+        {
+            beginRemoveRows(QModelIndex(), row, row);
+            visible_rank_.setVisible(_orderedIndex, false);
+            endRemoveRows();
         }
     }
 
@@ -217,24 +253,15 @@ namespace Logic
 
         bool needSyncSort = contacts_.empty();
 
-        const bool isDeletedType = _type == ql1s("deleted");
-
         for (auto it = _cl->keyBegin(), end = _cl->keyEnd(); it != end; ++it)
         {
             const auto& iter = *it;
-            if (!isDeletedType)
-            {
-                if (iter->UserType_ != ql1s("sms"))
-                {
-                    addItem(iter, false);
-                    if (iter->IsLiveChat_)
-                        emit liveChatJoined(iter->AimId_);
-                    emit contactChanged(iter->AimId_);
-                }
-            }
-            else
+            if (iter->UserType_ != ql1s("sms"))
             {
-                innerRemoveContact(iter->AimId_);
+                addItem(iter, false);
+                if (iter->IsLiveChat_)
+                    emit liveChatJoined(iter->AimId_);
+                emit contactChanged(iter->AimId_);
             }
         }
 
@@ -244,23 +271,10 @@ namespace Logic
             if (std::find(groupIds.begin(), groupIds.end(), iter->Id_) != groupIds.end())
                 continue;
 
-            if (!isDeletedType)
-            {
-                groupIds.push_back(iter->Id_);
-                auto group = std::make_shared<Data::Group>();
-                group->ApplyBuddy(iter);
-                addItem(group, false);
-            }
-            else if (iter->Removed_)
-            {
-                QVector<QString> toRemove;
-                for (const auto& contact: contacts_)
-                {
-                    if (contact.Get()->GroupId_ == iter->Id_)
-                        toRemove.push_back(contact.get_aimid());
-                }
-                removeContactsFromModel(toRemove);
-            }
+            groupIds.push_back(iter->Id_);
+            auto group = std::make_shared<Data::Group>();
+            group->ApplyBuddy(iter);
+            addItem(group, false);
         }
         endInsertRows();
 
@@ -270,6 +284,151 @@ namespace Logic
 
         if (needSyncSort)
             sort();
+
+        // a full list, whatever of the snapshot it has not confirmed is gone
+        if (_type.isEmpty())
+            dropWarmContacts();
+    }
+
+    void ContactListModel::warmStart(const std::vector<Data::ContactPtr>& _contacts)
+    {
+        assert(contacts_.empty());
+
+        beginResetModel();
+
+        contacts_.reserve(_contacts.size());
+        for (const auto& contact : _contacts)
+        {
+            if (indexes_.contains(contact->AimId_))
+                continue;
+
+            indexes_.insert(contact->AimId_, (int)contacts_.size());
+            contacts_.emplace_back(contact);
+            warmContacts_.insert(contact->AimId_);
+        }
+
+        // saved in the sorted order, so the ordered index is the id
+        sorted_index_cl_.resize(contacts_.size());
+        std::iota(sorted_index_cl_.begin(), sorted_index_cl_.end(), 0);
+        rebuildIndex();
+        sortNeeded_ = false;
+
+        endResetModel();
+
+        updatePlaceholders();
+    }
+
+    std::vector<const Data::Contact*> ContactListModel::getSortedContacts() const
+    {
+        std::vector<const Data::Contact*> contacts;
+        contacts.reserve(sorted_index_cl_.size());
+
+        for (const auto id : sorted_index_cl_)
+            contacts.push_back(contacts_[id].Get());
+
+        return contacts;
+    }
+
+    void ContactListModel::dropWarmContacts()
+    {
+        if (warmContacts_.isEmpty())
+            return;
+
+        const auto warm = warmContacts_;
+        warmContacts_.clear();
+
+        for (const auto& aimId : warm)
+        {
+            if (Logic::getRecentsModel()->getDlgState(aimId).AimId_ != aimId)
+                contactRemoved(aimId);
+        }
+    }
+
+    void ContactListModel::contactListSnapshot(std::shared_ptr<Data::ContactList> _cl, qint64 _revision)
+    {
+        // a resync after a lost delta, the contacts removed meanwhile are only missing from the list
+        if (revision_ != 0)
+        {
+            QSet<QString> aimIds;
+            for (auto it = _cl->cbegin(), end = _cl->cend(); it != end; ++it)
+            {
+                if (it.key()->UserType_ != ql1s("sms"))
+                    aimIds.insert(it.key()->AimId_);
+                aimIds.insert(QString::number(it.value()->Id_));
+            }
+
+            QVector<QString> toRemove;
+            for (const auto& contact : contacts_)
+            {
+                // added from the gui and not authorized, the core has not got them
+                if (contact.Get()->NotAuth_)
+                    continue;
+
+                if (!aimIds.contains(contact.get_aimid()))
+                    toRemove.push_back(contact.get_aimid());
+            }
+
+            for (const auto& aimId : toRemove)
+                contactRemoved(aimId);
+        }
+
+        revision_ = _revision;
+
+        contactList(std::move(_cl), QString());
+    }
+
+    void ContactListModel::contactListDelta(std::shared_ptr<Data::ContactListDelta> _delta)
+    {
+        if (_delta->BaseRevision_ != revision_)
+        {
+            // a delta got lost or the model was reset, ask for the whole list
+            Ui::gui_coll_helper collection(Ui::GetDispatcher()->create_collection(), true);
+            Ui::GetDispatcher()->post_message_to_core(qsl("contactlist/get"), collection.get());
+            return;
+        }
+
+        revision_ = _delta->Revision_;
+
+        if (!_delta->Added_.isEmpty())
+            contactList(std::make_shared<Data::ContactList>(_delta->Added_), QString());
+
+        for (const auto& groupBuddy : _delta->Groups_)
+        {
+            auto group = std::make_shared<Data::Group>();
+            group->ApplyBuddy(groupBuddy);
+            addItem(group, false);
+        }
+
+        for (const auto& changes : _delta->Changed_)
+        {
+            auto contact = getContactItem(changes.Values_.AimId_);
+            if (!contact)
+                continue;
+
+            changes.ApplyTo(*contact->Get());
+            sortNeeded_ = true;
+
+            pushChange(changes.Values_.AimId_);
+            emit contactChanged(changes.Values_.AimId_);
+        }
+
+        for (const auto& aimId : _delta->Removed_)
+            contactRemoved(aimId);
+
+        for (const auto groupId : _delta->RemovedGroups_)
+        {
+            QVector<QString> toRemove;
+            for (const auto& contact : contacts_)
+            {
+                if (contact.Get()->GroupId_ == groupId)
+                    toRemove.push_back(contact.get_aimid());
+            }
+
+            for (const auto& aimId : toRemove)
+                contactRemoved(aimId);
+        }
+
+        updatePlaceholders();
     }
 
     void ContactListModel::updatePlaceholders()
@@ -279,52 +438,60 @@ namespace Logic
             emit Utils::InterConnector::instance().showNoContactsYet();
             emit Utils::InterConnector::instance().showNoRecentsYet();
         }
-        else if (visible_indexes_.empty())
+        else if (visible_rank_.count() == 0)
             emit Utils::InterConnector::instance().hideNoContactsYet();
     }
 
     int ContactListModel::innerRemoveContact(const QString& _aimId)
     {
-        size_t idx = 0;
-        for ( ; idx < contacts_.size(); ++idx)
-        {
-            if (contacts_[idx].Get()->AimId_ == _aimId)
-                break;
-        }
-
-        auto cont = contacts_.begin() + idx;
-        if (cont == contacts_.end())
+        const auto iter = indexes_.find(_aimId);
+        if (iter == indexes_.end())
             return contacts_.size();
 
-        if (cont->is_live_chat())
+        const auto idx = iter.value();
+        indexes_.erase(iter);
+
+        if (contacts_[idx].is_live_chat())
             emit liveChatRemoved(_aimId);
 
-        contacts_.erase(cont);
+        const auto orderedIdx = ordered_indexes_[idx];
+
+        const auto last = (int)contacts_.size() - 1;
+        if (idx != last)
+        {
+            contacts_[idx] = std::move(contacts_[last]);
+            ordered_indexes_[idx] = ordered_indexes_[last];
+            sorted_index_cl_[ordered_indexes_[idx]] = idx;
+            indexes_[contacts_[idx].get_aimid()] = idx;
+        }
+
+        contacts_.pop_back();
+        ordered_indexes_.pop_back();
 
-        updateIndexesListAfterRemoveContact(sorted_index_cl_, idx);
-        updateIndexesListAfterRemoveContact(visible_indexes_, idx);
-        updateIndexesListAfterRemoveContact(sorted_index_recents_, idx);
+        sorted_index_cl_.erase(sorted_index_cl_.begin() + orderedIdx);
+        for (int i = orderedIdx, size = (int)sorted_index_cl_.size(); i < size; ++i)
+            ordered_indexes_[sorted_index_cl_[i]] = i;
+
+        visible_rank_.erase(orderedIdx);
 
         emit contact_removed(_aimId);
         return idx;
     }
 
-    void ContactListModel::updateIndexesListAfterRemoveContact(std::vector<int>& _list, int _index)
+    void ContactListModel::contactRemoved(const QString& _contact)
     {
-        _list.erase(std::remove(_list.begin(), _list.end(), _index), _list.end());
-        for (auto& idx : _list)
+        const auto row = getVisibleIndexByAimid(_contact);
+        if (row != -1)
         {
-            if (idx > _index)
-            {
-                idx -= 1;
-            }
+            beginRemoveRows(QModelIndex(), row, row);
+            innerRemoveContact(_contact);
+            endRemoveRows();
+        }
+        else
+        {
+            innerRemoveContact(_contact);
         }
-    }
 
-    void ContactListModel::contactRemoved(const QString& _contact)
-    {
-        innerRemoveContact(_contact);
-        rebuildIndex();
         updatePlaceholders();
         sortNeeded_ = true;
     }
@@ -341,7 +508,7 @@ namespace Logic
 
     void ContactListModel::avatarLoaded(const QString& _aimId)
     {
-        auto idx = getOrderIndexByAimid(_aimId);
+        auto idx = getVisibleIndexByAimid(_aimId);
         if (idx != -1)
         {
             emitChanged(idx, idx);
@@ -356,24 +523,23 @@ namespace Logic
             contact->Get()->ApplyBuddy(_presence);
             sortNeeded_ = true;
 
-            pushChange(getOrderIndexByAimid(_presence->AimId_));
+            pushChange(_presence->AimId_);
             emit contactChanged(_presence->AimId_);
         }
     }
 
     void ContactListModel::groupClicked(int _groupId)
     {
+        const auto groupsEnabled = isGroupsEnabled();
+
         for (auto& contact: contacts_)
         {
             if (contact.Get()->GroupId_ == _groupId && !contact.is_group())
             {
                 contact.set_visible(!contact.is_visible());
-
-                const auto index = contactIndex(contact.get_aimid()).row();
-                emitChanged(index, index);
+                updateVisibleRow(getOrderIndexByAimid(contact.get_aimid()), isShown(contact, groupsEnabled));
             }
         }
-        rebuildVisibleIndex();
     }
 
     void ContactListModel::scrolled(int _value)
@@ -383,11 +549,26 @@ namespace Logic
         scrollPosition_ = _value;
     }
 
-    void ContactListModel::pushChange(int _i)
+    void ContactListModel::pushChange(const QString& _aimId)
     {
-        updatedItems_.push_back(_i);
-        int scrollPos = scrollPosition_;
-        QTimer::singleShot(2000, this, [this, scrollPos](){ if (scrollPosition_ == scrollPos) processChanges(); });
+        // one pending timer for a burst of presences, not one per presence
+        const auto scheduled = !updatedItems_.isEmpty();
+        updatedItems_.insert(_aimId);
+
+        if (!scheduled)
+            scheduleChanges();
+    }
+
+    void ContactListModel::scheduleChanges()
+    {
+        const auto scrollPos = scrollPosition_;
+        QTimer::singleShot(changes_timeout.count(), this, [this, scrollPos]()
+        {
+            if (scrollPosition_ == scrollPos)
+                processChanges();
+            else
+                scheduleChanges();
+        });
     }
 
     void ContactListModel::processChanges()
@@ -395,9 +576,10 @@ namespace Logic
         if (updatedItems_.empty())
             return;
 
-        for (auto iter : updatedItems_)
+        for (const auto& aimId : updatedItems_)
         {
-            if (iter >= minVisibleIndex_ && iter <= maxVisibleIndex_)
+            const auto iter = getVisibleIndexByAimid(aimId);
+            if (iter != -1 && iter >= minVisibleIndex_ && iter <= maxVisibleIndex_)
                 emitChanged(iter, iter);
         }
 
@@ -552,8 +734,7 @@ namespace Logic
         if (item && item->is_visible() != _visible)
         {
             item->set_visible(_visible);
-            rebuildVisibleIndex();
-            emitChanged(0, indexes_.size());
+            updateVisibleRow(getOrderIndexByAimid(_aimId), isShown(*item, isGroupsEnabled()));
         }
     }
 
@@ -564,14 +745,14 @@ namespace Logic
 
     const ContactItem* ContactListModel::getContactItem(const QString& _aimId) const
     {
-        auto idx = getOrderIndexByAimid(_aimId);
-        if (idx == -1)
+        if (_aimId.isEmpty())
             return nullptr;
 
-        if (idx >= (int) contacts_.size())
+        const auto item = indexes_.find(_aimId);
+        if (item == indexes_.end())
             return nullptr;
 
-        return &contacts_[getIndexByOrderedIndex(idx)];
+        return &contacts_[item.value()];
 	}
 
 	QString ContactListModel::getDisplayName(const QString& _aimId) const
@@ -875,7 +1056,6 @@ namespace Logic
     {
         for (const auto& _aimid : _vcontacts)
             innerRemoveContact(_aimid);
-        rebuildIndex();
         updatePlaceholders();
         sortNeeded_ = true;
     }
@@ -1075,14 +1255,8 @@ namespace Logic
 
         ++current;
 
-        for (auto iter = indexes_.cbegin(), end = indexes_.cend(); iter != end; ++iter)
-        {
-            if (iter.value() == current)
-            {
-                setCurrent(iter.key(), -1, true);
-                break;
-            }
-        }
+        if (current < (int)sorted_index_cl_.size())
+            setCurrent(contacts_[getIndexByOrderedIndex(current)].get_aimid(), -1, true);
     }
 
     void ContactListModel::prev()
@@ -1097,14 +1271,8 @@ namespace Logic
 
         --current;
 
-        for (auto iter = indexes_.cbegin(), end = indexes_.cend(); iter != end; ++iter)
-        {
-            if (iter.value() == current)
-            {
-                setCurrent(iter.key(), -1, true);
-                break;
-            }
-        }
+        if (current >= 0 && current < (int)sorted_index_cl_.size())
+            setCurrent(contacts_[getIndexByOrderedIndex(current)].get_aimid(), -1, true);
     }
 
     int ContactListModel::getIndexByOrderedIndex(int _index) const
@@ -1120,6 +1288,15 @@ namespace Logic
             return -1;
 
         auto item = indexes_.find(_aimId);
-        return item != indexes_.end() ? item.value() : -1;
+        return item != indexes_.end() ? ordered_indexes_[item.value()] : -1;
+    }
+
+    int ContactListModel::getVisibleIndexByAimid(const QString& _aimId) const
+    {
+        const auto orderedIndex = getOrderIndexByAimid(_aimId);
+        if (orderedIndex == -1 || !visible_rank_.isVisible(orderedIndex))
+            return -1;
+
+        return visible_rank_.rank(orderedIndex);
     }
 }
@@ -7,6 +7,7 @@
 #include "../../types/chat.h"
 
 #include "ContactItem.h"
+#include "VisibleRank.h"
 
 namespace core
 {
@@ -139,6 +140,8 @@ namespace Logic
 
     private Q_SLOTS:
         void contactList(std::shared_ptr<Data::ContactList>, const QString&);
+        void contactListDelta(std::shared_ptr<Data::ContactListDelta>);
+        void contactListSnapshot(std::shared_ptr<Data::ContactList>, qint64);
         void avatarLoaded(const QString&);
         void presence(std::shared_ptr<Data::Buddy>);
         void contactRemoved(const QString&);
@@ -220,36 +223,52 @@ namespace Logic
         bool contains(const QString& _aimdId) const;
         void updatePlaceholders();
 
+        // the contacts and groups of the warm start snapshot, in the order they were shown
+        void warmStart(const std::vector<Data::ContactPtr>& _contacts);
+        std::vector<const Data::Contact*> getSortedContacts() const;
+        // removes the snapshot contacts the core has not sent, except the ones of the recents
+        void dropWarmContacts();
+
     private:
         std::shared_ptr<bool>	ref_;
         std::function<void(Ui::HistoryControlPage*)> gotPageCallback_;
         void rebuildIndex();
         void rebuildVisibleIndex();
+        void updateVisibleRow(int _orderedIndex, bool _visible);
         int addItem(Data::ContactPtr _contact, const bool _updatePlaceholder = true);
-        void pushChange(int i);
+        void pushChange(const QString& _aimId);
+        void scheduleChanges();
         void processChanges();
         bool isVisibleItem(const ContactItem& _item) const;
         int getIndexByOrderedIndex(int _index) const;
         int getOrderIndexByAimid(const QString& _aimId) const;
+        int getVisibleIndexByAimid(const QString& _aimId) const;
         void updateSortedIndexesList(std::vector<int>& _list, ContactListSorting::contact_sort_pred _less);
         ContactListSorting::contact_sort_pred getLessFuncCL(const QDateTime& current) const;
-        void updateIndexesListAfterRemoveContact(std::vector<int>& _list, int _index);
         int innerRemoveContact(const QString& _aimId);
 
         int getAbsIndexByVisibleIndex(const int& _visibleIndex) const;
 
+        // an item's index in contacts_ is its id, removal moves the last item into the hole
         std::vector<ContactItem> contacts_;
+        // ordered index -> id and back
         std::vector<int> sorted_index_cl_;
-        std::vector<int> sorted_index_recents_;
+        std::vector<int> ordered_indexes_;
+        // aimid -> id
         QHash<QString, int> indexes_;
-        std::vector<int> visible_indexes_;
+        // visible rows over the ordered indexes
+        VisibleRank visible_rank_;
+        // the snapshot contacts not confirmed by the core yet
+        QSet<QString> warmContacts_;
+        // revision of the core contact list the model has, a delta applies only on top of it
+        qint64 revision_;
         bool sortNeeded_;
         QTimer* sortTimer_;
 
         int scrollPosition_;
         mutable int minVisibleIndex_;
         mutable int maxVisibleIndex_;
-        std::vector<int> updatedItems_;
+        QSet<QString> updatedItems_;
 
         QString currentAimId_;
 
@@ -14,6 +14,7 @@
 #include "../../types/contact.h"
 #include "../../utils/utils.h"
 #include "RecentsItemRenderer.h"
+#include "WarmStartSnapshot.h"
 
 #include "../../gui_settings.h"
 
@@ -235,6 +236,9 @@ namespace Logic
             return;
 
         paint(_painter, _option, dlg, _index == DragIndex_, shouldRenderCompact(_index));
+
+        if (!Logic::getRecentsModel()->isServiceAimId(dlg.AimId_))
+            WarmStartSnapshot::reportFirstPaint();
     }
 
     bool RecentItemDelegate::shouldRenderCompact(const QModelIndex & _index) const
@@ -12,18 +12,28 @@
 #include "../../utils/InterConnector.h"
 #include "../../gui_settings.h"
 
-namespace
-{
-	static const unsigned SORT_TIMEOUT = (build::is_debug() ? 120000 : 100);
-}
-
 namespace Logic
 {
     std::unique_ptr<RecentsModel> g_recents_model;
 
+    bool RecentsLess::operator()(const Data::DlgState& _first, const Data::DlgState& _second) const
+    {
+        if (_first.FavoriteTime_ == -1 && _second.FavoriteTime_ == -1)
+            return _first.Time_ > _second.Time_;
+
+        if (_first.FavoriteTime_ == -1)
+            return false;
+        else if (_second.FavoriteTime_ == -1)
+            return true;
+
+        if (_first.FavoriteTime_ == _second.FavoriteTime_)
+            return _first.AimId_ > _second.AimId_;
+
+        return _first.FavoriteTime_ < _second.FavoriteTime_;
+    }
+
 	RecentsModel::RecentsModel(QObject *parent)
 		: CustomAbstractListModel(parent)
-		, Timer_(new QTimer(this))
         , FavoritesCount_(0)
         , FavoritesVisible_(true)
         , FavoritesHeadVisible_(true)
@@ -34,8 +44,6 @@ namespace Logic
         connect(Ui::GetDispatcher(), &Ui::core_dispatcher::dlgStates, this, &RecentsModel::dlgStates, Qt::QueuedConnection);
         connect(Logic::getContactListModel(), &Logic::ContactListModel::contactChanged, this, &RecentsModel::contactChanged, Qt::QueuedConnection);
         connect(Logic::getContactListModel(), &Logic::ContactListModel::contact_removed, this, &RecentsModel::contactRemoved, Qt::QueuedConnection);
-        Timer_->setSingleShot(true);
-        connect(Timer_, &QTimer::timeout, this, &RecentsModel::sortDialogs);
 	}
 
 	int RecentsModel::rowCount(const QModelIndex &) const
@@ -102,28 +110,35 @@ namespace Logic
 
     void RecentsModel::contactChanged(const QString& aimId)
     {
-        int i = Indexes_[aimId];
-        if (i != -1)
-        {
-            const auto idx = index(i);
+        const auto idx = contactIndex(aimId);
+        if (idx.isValid())
             emit dataChanged(idx, idx);
-        }
     }
 
 	void RecentsModel::activeDialogHide(const QString& aimId)
 	{
-		Data::DlgState state;
-		state.AimId_ = aimId;
-		auto iter = std::find(Dialogs_.begin(), Dialogs_.end(), state);
-		if (iter != Dialogs_.end())
+        WarmDialogs_.remove(aimId);
+
+		const auto pos = Dialogs_.find(aimId);
+		if (pos != -1)
         {
-            if (iter->FavoriteTime_ != -1)
-                --FavoritesCount_;
+            // a recent goes away as one row, the rest changes the service rows as well
+            if (Dialogs_[pos].FavoriteTime_ == -1 && Dialogs_.size() > 1)
+            {
+                const auto row = dialogRow(pos);
+                beginRemoveRows(QModelIndex(), row, row);
+                Dialogs_.erase(pos);
+                endRemoveRows();
+            }
+            else
+            {
+                if (Dialogs_[pos].FavoriteTime_ != -1)
+                    --FavoritesCount_;
+
+                Dialogs_.erase(pos);
+                emit dataChanged(index(0), index(rowCount()));
+            }
 
-            QString hideContact = iter->AimId_;
-            contactChanged(hideContact);
-            Indexes_[iter->AimId_] = -1;
-            Dialogs_.erase(iter);
             if (Logic::getContactListModel()->selectedContact() == aimId)
                 Logic::getContactListModel()->setCurrent(QString(), -1, true);
             if (Dialogs_.empty() && !Logic::getUnknownsModel()->itemsCount())
@@ -136,8 +151,11 @@ namespace Logic
 	void RecentsModel::dlgStates(const QVector<Data::DlgState>& _states)
 	{
         bool syncSort = false;
+        bool moved = false;
         for (const auto& _dlgState : _states)
         {
+            WarmDialogs_.remove(_dlgState.AimId_);
+
             const auto contactItem = Logic::getContactListModel()->getContactItem(_dlgState.AimId_);
 
             if (!contactItem)
@@ -146,10 +164,10 @@ namespace Logic
             if (!_dlgState.Official_ && !_dlgState.Chat_ && (!contactItem || (contactItem && contactItem->is_not_auth())))
                 continue;
 
-            auto iter = std::find(Dialogs_.begin(), Dialogs_.end(), _dlgState);
-            if (iter != Dialogs_.end())
+            const auto pos = Dialogs_.find(_dlgState.AimId_);
+            if (pos != -1)
             {
-                auto &existingDlgState = *iter;
+                auto &existingDlgState = Dialogs_.at(pos);
 
                 if (existingDlgState.FavoriteTime_ != _dlgState.FavoriteTime_)
                 {
@@ -178,15 +196,8 @@ namespace Logic
                     existingDlgState.SetText(existingText);
                 }
 
-                if (!syncSort)
-                {
-                    if (!Timer_->isActive())
-                        Timer_->start(SORT_TIMEOUT);
-
-                    int dist = (int)std::distance(Dialogs_.begin(), iter);
-                    const auto idx = index(dist);
-                    emit dataChanged(idx, idx);
-                }
+                if (!syncSort && moveDialog(pos))
+                    moved = true;
             }
             else if (!_dlgState.GetText().isEmpty() || _dlgState.FavoriteTime_ != -1)
             {
@@ -196,16 +207,15 @@ namespace Logic
                     emit favoriteChanged(_dlgState.AimId_);
                 }
 
-                Dialogs_.push_back(_dlgState);
-
-                if (_dlgState.FavoriteTime_ != -1)
+                if (_dlgState.FavoriteTime_ != -1 || Dialogs_.empty() || syncSort)
                 {
+                    Dialogs_.insert(_dlgState);
                     syncSort = true;
                 }
                 else
                 {
-                    if (!Timer_->isActive())
-                        Timer_->start(SORT_TIMEOUT);
+                    insertDialog(_dlgState);
+                    moved = true;
                 }
 
                 if (Dialogs_.size() == 1)
@@ -226,6 +236,10 @@ namespace Logic
         {
             sortDialogs();
         }
+        else if (moved)
+        {
+            emit orderChanged();
+        }
 
         emit updated();
         emit dlgStatesHandled(_states);
@@ -233,68 +247,98 @@ namespace Logic
 
     void RecentsModel::unknownToRecents(const Data::DlgState& dlgState)
     {
-        auto iter = std::find(Dialogs_.begin(), Dialogs_.end(), dlgState);
-        if (iter == Dialogs_.end() && (!dlgState.GetText().isEmpty() || dlgState.FavoriteTime_ != -1))
+        if (Dialogs_.find(dlgState.AimId_) == -1 && (!dlgState.GetText().isEmpty() || dlgState.FavoriteTime_ != -1))
         {
             if (dlgState.FavoriteTime_ != -1)
             {
                 ++FavoritesCount_;
                 emit favoriteChanged(dlgState.AimId_);
             }
-            Dialogs_.push_back(dlgState);
+            Dialogs_.insert(dlgState);
             sortDialogs();
         }
     }
 
     bool RecentsModel::lessRecents(const QString& _aimid1, const QString& _aimid2)
     {
-        auto first = getDlgState(_aimid1);
-        auto second = getDlgState(_aimid2);
+        return RecentsLess()(getDlgState(_aimid1), getDlgState(_aimid2));
+    }
 
-        if (first.FavoriteTime_ == -1 && second.FavoriteTime_ == -1)
-            return first.Time_ > second.Time_;
+	void RecentsModel::sortDialogs()
+	{
+		Dialogs_.sort();
 
-        if (first.FavoriteTime_ == -1)
-            return false;
-        else if (second.FavoriteTime_ == -1)
-            return true;
+		emit dataChanged(index(0), index(rowCount()));
+		emit orderChanged();
+	}
 
-        if (first.FavoriteTime_ == second.FavoriteTime_)
-            return first.AimId_ > second.AimId_;
+    int RecentsModel::dialogRow(int _pos) const
+    {
+        int row = _pos;
 
-        return first.FavoriteTime_ < second.FavoriteTime_;
+        if (FavoritesCount_)
+        {
+            if (_pos < FavoritesCount_)
+            {
+                if (!FavoritesVisible_)
+                    return -1;
+            }
+            else
+            {
+                ++row;
+                if (!FavoritesVisible_)
+                    row -= FavoritesCount_;
+            }
+
+            if (FavoritesHeadVisible_)
+                ++row;
+        }
+        else
+        {
+            ++row;
+        }
+
+        return row + getSizeOfUnknownBlock();
     }
 
-	void RecentsModel::sortDialogs()
-	{
-		std::sort(Dialogs_.begin(), Dialogs_.end(), [](const Data::DlgState& first, const Data::DlgState& second)
+    bool RecentsModel::moveDialog(int _pos)
+    {
+        const auto to = Dialogs_.sortedPosition(_pos);
+        const auto moved = (to != _pos);
+
+        if (moved)
         {
-            if (first.FavoriteTime_ == -1 && second.FavoriteTime_ == -1)
-                return first.Time_ > second.Time_;
+            const auto rowFrom = dialogRow(_pos);
+            const auto rowTo = dialogRow(to);
+
+            // favorites and recents are sorted apart, so both rows are either visible or hidden
+            if (rowFrom != -1)
+                beginMoveRows(QModelIndex(), rowFrom, rowFrom, QModelIndex(), (rowTo > rowFrom ? rowTo + 1 : rowTo));
 
-            if (first.FavoriteTime_ == -1)
-                return false;
-            else if (second.FavoriteTime_ == -1)
-                return true;
+            Dialogs_.move(_pos, to);
 
-            if (first.FavoriteTime_ == second.FavoriteTime_)
-                return first.AimId_ > second.AimId_;
+            if (rowFrom != -1)
+                endMoveRows();
+        }
 
-            return first.FavoriteTime_ < second.FavoriteTime_;
+        const auto row = dialogRow(to);
+        if (row != -1)
+        {
+            const auto idx = index(row);
+            emit dataChanged(idx, idx);
+        }
 
-        });
+        return moved;
+    }
 
-		Indexes_.clear();
-		int i = 0;
-		for (const auto& iter : Dialogs_)
-		{
-			Indexes_[iter.AimId_] = i;
-			++i;
-		}
+    void RecentsModel::insertDialog(const Data::DlgState& _state)
+    {
+        const auto row = dialogRow(Dialogs_.insertPosition(_state));
 
-		emit dataChanged(index(0), index(rowCount()));
-		emit orderChanged();
-	}
+        beginInsertRows(QModelIndex(), row, row);
+        Dialogs_.insert(_state);
+        endInsertRows();
+    }
 
     void RecentsModel::contactRemoved(const QString& _aimId)
     {
@@ -309,9 +353,9 @@ namespace Logic
 	Data::DlgState RecentsModel::getDlgState(const QString& aimId, bool fromDialog)
 	{
 		Data::DlgState state;
-        auto iter = std::find_if(Dialogs_.begin(), Dialogs_.end(), [&aimId](const Data::DlgState &item) { return item.AimId_ == aimId; });
-		if (iter != Dialogs_.end())
-			state = *iter;
+        const auto pos = Dialogs_.find(aimId);
+		if (pos != -1)
+			state = Dialogs_[pos];
 
 		if (fromDialog)
 			sendLastRead(aimId);
@@ -334,20 +378,22 @@ namespace Logic
 
 	void RecentsModel::sendLastRead(const QString& aimId)
 	{
-		Data::DlgState state;
-		state.AimId_ = aimId.isEmpty() ? Logic::getContactListModel()->selectedContact() : aimId;
-		std::vector<Data::DlgState>::iterator iter = std::find(Dialogs_.begin(), Dialogs_.end(), state);
-		if (iter != Dialogs_.end() && (iter->UnreadCount_ != 0 || iter->YoursLastRead_ < iter->LastMsgId_))
+		const auto contact = aimId.isEmpty() ? Logic::getContactListModel()->selectedContact() : aimId;
+		const auto pos = Dialogs_.find(contact);
+		if (pos == -1)
+			return;
+
+		auto& state = Dialogs_.at(pos);
+		if (state.UnreadCount_ != 0 || state.YoursLastRead_ < state.LastMsgId_)
 		{
-			iter->UnreadCount_ = 0;
+			state.UnreadCount_ = 0;
 
 			Ui::gui_coll_helper collection(Ui::GetDispatcher()->create_collection(), true);
-			collection.set_value_as_qstring("contact", state.AimId_);
-			collection.set_value_as_int64("message", iter->LastMsgId_);
+			collection.set_value_as_qstring("contact", contact);
+			collection.set_value_as_int64("message", state.LastMsgId_);
 			Ui::GetDispatcher()->post_message_to_core(qsl("dlg_state/set_last_read"), collection.get());
 
-			int ind = (int)std::distance(Dialogs_.begin(), iter);
-            const auto idx = index(ind);
+            const auto idx = index(dialogRow(pos));
 			emit dataChanged(idx, idx);
 			emit updated();
 		}
@@ -355,17 +401,17 @@ namespace Logic
 
 	void RecentsModel::markAllRead()
 	{
-		for (std::vector<Data::DlgState>::iterator iter = Dialogs_.begin(); iter != Dialogs_.end(); ++iter)
+		for (int pos = 0; pos < Dialogs_.size(); ++pos)
 		{
-			if (iter->UnreadCount_ != 0 || iter->YoursLastRead_ < iter->LastMsgId_)
+			const auto& state = Dialogs_[pos];
+			if (state.UnreadCount_ != 0 || state.YoursLastRead_ < state.LastMsgId_)
 			{
 				Ui::gui_coll_helper collection(Ui::GetDispatcher()->create_collection(), true);
-				collection.set_value_as_qstring("contact", iter->AimId_);
-				collection.set_value_as_int64("message", iter->LastMsgId_);
+				collection.set_value_as_qstring("contact", state.AimId_);
+				collection.set_value_as_int64("message", state.LastMsgId_);
 				Ui::GetDispatcher()->post_message_to_core(qsl("dlg_state/set_last_read"), collection.get());
 
-				int ind = (int)std::distance(Dialogs_.begin(), iter);
-                const auto idx = index(ind);
+                const auto idx = index(dialogRow(pos));
 				emit dataChanged(idx, idx);
 				emit updated();
 			}
@@ -390,11 +436,9 @@ namespace Logic
 
     bool RecentsModel::isFavorite(const QString& aimid) const
     {
-        Data::DlgState state;
-        state.AimId_ = aimid;
-        std::vector<Data::DlgState>::const_iterator iter = std::find(Dialogs_.begin(), Dialogs_.end(), state);
-        if (iter != Dialogs_.end())
-            return iter->FavoriteTime_ != -1;
+        const auto pos = Dialogs_.find(aimid);
+        if (pos != -1)
+            return Dialogs_[pos].FavoriteTime_ != -1;
 
         return false;
     }
@@ -435,39 +479,15 @@ namespace Logic
 
 	QModelIndex RecentsModel::contactIndex(const QString& aimId) const
 	{
-		int i = 0;
-		for (const auto& iter : Dialogs_)
-		{
-			if (iter.AimId_ == aimId)
-            {
-                break;
-            }
-			++i;
-		}
-
-        if (i < (int)Dialogs_.size())
-        {
-            if (FavoritesCount_)
-            {
-                if (i >= visibleContactsInFavorites())
-                {
-                    ++i;
-                    if (!FavoritesVisible_)
-                        i -= FavoritesCount_;
-                }
-                if (FavoritesHeadVisible_)
-                    ++i;
-            }
-            else
-            {
-                ++i;
-            }
+		const auto pos = Dialogs_.find(aimId);
+		if (pos == -1)
+			return QModelIndex();
 
-            int result = i + getSizeOfUnknownBlock();
-		    return index(result);
-        }
+		const auto row = dialogRow(pos);
+		if (row == -1)
+			return QModelIndex();
 
-		return QModelIndex();
+		return index(row);
 	}
 
     QString RecentsModel::firstContact() const
@@ -528,24 +548,18 @@ namespace Logic
 
     QString RecentsModel::nextAimId(const QString& aimId) const
     {
-        for (size_t i = 0; i < Dialogs_.size(); i++)
-        {
-            const Data::DlgState& iter = Dialogs_.at(i);
-            if (iter.AimId_ == aimId && i < Dialogs_.size() - 1)
-                return Dialogs_.at(i + 1).AimId_;
-        }
+        const auto pos = Dialogs_.find(aimId);
+        if (pos != -1 && pos < Dialogs_.size() - 1)
+            return Dialogs_[pos + 1].AimId_;
 
         return QString();
     }
 
     QString RecentsModel::prevAimId(const QString& aimId) const
     {
-        for (size_t i = 0; i < Dialogs_.size(); i++)
-        {
-            const Data::DlgState& iter = Dialogs_.at(i);
-            if (iter.AimId_ == aimId && i > 0)
-                return Dialogs_.at(i - 1).AimId_;
-        }
+        const auto pos = Dialogs_.find(aimId);
+        if (pos > 0)
+            return Dialogs_[pos - 1].AimId_;
 
         return QString();
     }
@@ -625,6 +639,46 @@ namespace Logic
         return result;
     }
 
+    void RecentsModel::warmStart(std::vector<Data::DlgState> _dialogs)
+    {
+        assert(Dialogs_.empty());
+
+        beginResetModel();
+
+        Dialogs_.assign(std::move(_dialogs));
+
+        FavoritesCount_ = 0;
+        for (const auto& item : Dialogs_)
+        {
+            if (item.FavoriteTime_ != -1)
+                ++FavoritesCount_;
+
+            WarmDialogs_.insert(item.AimId_);
+        }
+
+        endResetModel();
+
+        if (!Dialogs_.empty())
+            emit Utils::InterConnector::instance().hideNoRecentsYet();
+
+        emit orderChanged();
+        emit updated();
+    }
+
+    std::vector<Data::DlgState> RecentsModel::getDialogs() const
+    {
+        return std::vector<Data::DlgState>(Dialogs_.begin(), Dialogs_.end());
+    }
+
+    void RecentsModel::dropWarmDialogs()
+    {
+        const auto warm = WarmDialogs_;
+        for (const auto& aimId : warm)
+            activeDialogHide(aimId);
+
+        WarmDialogs_.clear();
+    }
+
     RecentsModel* getRecentsModel()
     {
         if (!g_recents_model)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CustomAbstractListModel.h"
+#include "SortedItems.h"
 
 #include "../../types/contact.h"
 #include "../../types/message.h"
@@ -12,6 +13,21 @@ namespace Ui
 
 namespace Logic
 {
+    struct RecentsLess
+    {
+        bool operator()(const Data::DlgState& _first, const Data::DlgState& _second) const;
+    };
+
+    struct RecentsAimId
+    {
+        const QString& operator()(const Data::DlgState& _state) const { return _state.AimId_; }
+    };
+
+    struct RecentsAimIdHash
+    {
+        size_t operator()(const QString& _aimId) const { return qHash(_aimId); }
+    };
+
 	class RecentsModel : public CustomAbstractListModel
 	{
 		Q_OBJECT
@@ -79,6 +95,12 @@ namespace Logic
 
         std::vector<QString> getSortedRecentsContacts() const;
 
+        // the dialogs of the warm start snapshot, shown until the core sends the live ones
+        void warmStart(std::vector<Data::DlgState> _dialogs);
+        std::vector<Data::DlgState> getDialogs() const;
+        // hides the snapshot dialogs the core has not sent
+        void dropWarmDialogs();
+
 	private:
         int correctIndex(int i) const;
         int visibleContactsInFavorites() const;
@@ -90,9 +112,12 @@ namespace Logic
         int getRecentsHeaderIndex() const;
         int getVisibleServiceItemInFavorites() const;
 
-		std::vector<Data::DlgState> Dialogs_;
-		QHash<QString, int> Indexes_;
-		QTimer* Timer_;
+        int dialogRow(int _pos) const;
+        bool moveDialog(int _pos);
+        void insertDialog(const Data::DlgState& _state);
+
+		SortedItems<Data::DlgState, QString, RecentsAimId, RecentsLess, RecentsAimIdHash> Dialogs_;
+        QSet<QString> WarmDialogs_;
         quint16 FavoritesCount_;
         bool FavoritesVisible_;
         bool FavoritesHeadVisible_;
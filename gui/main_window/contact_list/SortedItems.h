@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace Logic
+{
+    // Items kept in the order of Less, with a key -> position index.
+    // A changed item is found by its key and moved to its new place with a binary search,
+    // only the positions between the old and the new place are reindexed.
+    // KeyOf returns the key of an item.
+    template<class Item, class Key, class KeyOf, class Less, class Hash = std::hash<Key>>
+    class SortedItems
+    {
+    public:
+        typedef typename std::vector<Item>::const_iterator const_iterator;
+
+        SortedItems(KeyOf _keyOf = KeyOf(), Less _less = Less())
+            : KeyOf_(_keyOf)
+            , Less_(_less)
+        {
+        }
+
+        int size() const { return (int)Items_.size(); }
+        bool empty() const { return Items_.empty(); }
+
+        const Item& operator[](int _pos) const { return Items_[_pos]; }
+        const Item& front() const { return Items_.front(); }
+
+        const_iterator begin() const { return Items_.cbegin(); }
+        const_iterator end() const { return Items_.cend(); }
+
+        int find(const Key& _key) const
+        {
+            const auto iter = Index_.find(_key);
+            return (iter == Index_.end() ? -1 : iter->second);
+        }
+
+        // the item may be changed in place, as long as its key stays the same;
+        // call sortedPosition/move afterwards if the order may have changed
+        Item& at(int _pos)
+        {
+            return Items_[_pos];
+        }
+
+        // the position an item inserted now would take
+        int insertPosition(const Item& _item) const
+        {
+            return (int)std::distance(Items_.begin(), std::upper_bound(Items_.begin(), Items_.end(), _item, Less_));
+        }
+
+        int insert(Item _item)
+        {
+            const auto pos = insertPosition(_item);
+            Items_.insert(Items_.begin() + pos, std::move(_item));
+            reindex(pos, size() - 1);
+
+            return pos;
+        }
+
+        void erase(int _pos)
+        {
+            Index_.erase(KeyOf_(Items_[_pos]));
+            Items_.erase(Items_.begin() + _pos);
+            reindex(_pos, size() - 1);
+        }
+
+        // the position the item at _pos belongs to after it has been changed
+        int sortedPosition(int _pos) const
+        {
+            const auto item = Items_.begin() + _pos;
+
+            if (_pos > 0 && Less_(*item, *(item - 1)))
+                return (int)std::distance(Items_.begin(), std::upper_bound(Items_.begin(), item, *item, Less_));
+
+            if (_pos < size() - 1 && Less_(*(item + 1), *item))
+                return (int)std::distance(Items_.begin(), std::lower_bound(item + 1, Items_.end(), *item, Less_)) - 1;
+
+            return _pos;
+        }
+
+        void move(int _from, int _to)
+        {
+            if (_from == _to)
+                return;
+
+            const auto first = Items_.begin();
+
+            if (_to < _from)
+            {
+                std::rotate(first + _to, first + _from, first + _from + 1);
+                reindex(_to, _from);
+            }
+            else
+            {
+                std::rotate(first + _from, first + _from + 1, first + _to + 1);
+                reindex(_from, _to);
+            }
+        }
+
+        // replaces all the items with ones that are mostly sorted already, e.g. a saved list
+        void assign(std::vector<Item> _items)
+        {
+            Items_ = std::move(_items);
+
+            if (!std::is_sorted(Items_.begin(), Items_.end(), Less_))
+                std::stable_sort(Items_.begin(), Items_.end(), Less_);
+
+            Index_.clear();
+            reindex(0, size() - 1);
+        }
+
+        // full sort, when the ordering itself has changed
+        void sort()
+        {
+            std::stable_sort(Items_.begin(), Items_.end(), Less_);
+            Index_.clear();
+            reindex(0, size() - 1);
+        }
+
+        void clear()
+        {
+            Items_.clear();
+            Index_.clear();
+        }
+
+    private:
+        void reindex(int _first, int _last)
+        {
+            for (auto i = _first; i <= _last; ++i)
+                Index_[KeyOf_(Items_[i])] = i;
+        }
+
+        std::vector<Item> Items_;
+        std::unordered_map<Key, int, Hash> Index_;
+        KeyOf KeyOf_;
+        Less Less_;
+    };
+}
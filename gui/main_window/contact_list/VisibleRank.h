@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+
+namespace Logic
+{
+    // Visibility flags of an ordered list, with a Fenwick tree over them,
+    // so a position converts to its visible row and back in O(log n)
+    class VisibleRank
+    {
+    public:
+        VisibleRank()
+            : tree_(1, 0)
+            , count_(0)
+        {
+        }
+
+        int size() const { return (int)visible_.size(); }
+
+        // number of visible positions
+        int count() const { return count_; }
+
+        bool isVisible(int _pos) const { return visible_[_pos] != 0; }
+
+        void assign(std::vector<char> _visible)
+        {
+            visible_ = std::move(_visible);
+            tree_.assign(visible_.size() + 1, 0);
+            count_ = 0;
+
+            const auto size = (int)visible_.size();
+            for (int i = 1; i <= size; ++i)
+            {
+                tree_[i] += visible_[i - 1];
+                count_ += visible_[i - 1];
+
+                const auto parent = i + (i & -i);
+                if (parent <= size)
+                    tree_[parent] += tree_[i];
+            }
+        }
+
+        void setVisible(int _pos, bool _visible)
+        {
+            if (isVisible(_pos) == _visible)
+                return;
+
+            visible_[_pos] = _visible;
+
+            const auto delta = (_visible ? 1 : -1);
+            count_ += delta;
+
+            for (auto i = _pos + 1; i < (int)tree_.size(); i += (i & -i))
+                tree_[i] += delta;
+        }
+
+        void push_back(bool _visible)
+        {
+            visible_.push_back(_visible);
+            count_ += _visible;
+
+            // the new node covers (i - lowbit(i), i]
+            const auto i = (int)visible_.size();
+            tree_.push_back(prefix(i - 1) - prefix(i - (i & -i)) + _visible);
+        }
+
+        // O(n), the positions after _pos shift down
+        void erase(int _pos)
+        {
+            auto visible = std::move(visible_);
+            visible.erase(visible.begin() + _pos);
+            assign(std::move(visible));
+        }
+
+        // visible row of the position, the number of visible positions before it
+        int rank(int _pos) const
+        {
+            return prefix(_pos);
+        }
+
+        // position of the visible row
+        int position(int _row) const
+        {
+            int pos = 0;
+            int rest = _row + 1;
+
+            auto step = 1;
+            while (step * 2 < (int)tree_.size())
+                step *= 2;
+
+            for (; step > 0; step /= 2)
+            {
+                const auto next = pos + step;
+                if (next < (int)tree_.size() && tree_[next] < rest)
+                {
+                    pos = next;
+                    rest -= tree_[next];
+                }
+            }
+
+            return pos;
+        }
+
+    private:
+        // number of visible positions in [0, _end)
+        int prefix(int _end) const
+        {
+            int sum = 0;
+            for (auto i = _end; i > 0; i -= (i & -i))
+                sum += tree_[i];
+
+            return sum;
+        }
+
+        std::vector<char> visible_;
+        std::vector<int> tree_;
+        int count_;
+    };
+}
@@ -0,0 +1,379 @@
+#include "stdafx.h"
+#include "WarmStartSnapshot.h"
+
+#include "ContactListModel.h"
+#include "RecentsModel.h"
+
+#include "../../cache/avatars/AvatarStorage.h"
+#include "../../core_dispatcher.h"
+#include "../../my_info.h"
+#include "../../utils/gui_coll_helper.h"
+#include "../../utils/log/log.h"
+
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+    const quint32 snapshot_magic = 0x534e5357;
+
+    // bump on any change of the layout, a snapshot of another version is removed
+    const quint32 snapshot_version = 1;
+
+    const auto save_period = std::chrono::minutes(5);
+
+    // the avatars of about a screen of recents
+    const int avatar_keys_dialogs_count = 32;
+
+    QElapsedTimer launch_timer;
+
+    bool first_paint_reported = false;
+
+    bool warm_start_rendered = false;
+
+    QString getFileName()
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) % ql1s("/warm_start.snapshot");
+    }
+
+    void postStartupPhase(const char* _name)
+    {
+        Ui::gui_coll_helper collection(Ui::GetDispatcher()->create_collection(), true);
+        collection.set_value_as_string("name", _name);
+        Ui::GetDispatcher()->post_message_to_core(qsl("profiler/startup_phase"), collection.get());
+    }
+
+    void writeFile(const QString& _fileName, const QByteArray& _bytes)
+    {
+        QDir().mkpath(QFileInfo(_fileName).absolutePath());
+
+        // the old snapshot is replaced only by a complete new one
+        QSaveFile file(_fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+
+        file.write(_bytes);
+        file.commit();
+    }
+
+    void writeDialog(QDataStream& _stream, const Data::DlgState& _dlg)
+    {
+        _stream << _dlg.AimId_ << _dlg.UnreadCount_ << _dlg.LastMsgId_ << _dlg.YoursLastRead_ << _dlg.TheirsLastRead_
+            << _dlg.TheirsLastDelivered_ << _dlg.FavoriteTime_ << _dlg.Time_ << _dlg.Outgoing_ << _dlg.Chat_ << _dlg.Visible_
+            << _dlg.Official_ << _dlg.IsContact_ << _dlg.IsLastMessageDelivered << _dlg.senderAimId_ << _dlg.LastMessageFriendly_
+            << _dlg.senderNick_ << _dlg.Friendly_ << _dlg.MailId_ << _dlg.hasMentionMe_ << (qint32)_dlg.unreadMentionsCount_
+            << _dlg.GetText();
+    }
+
+    Data::DlgState readDialog(QDataStream& _stream)
+    {
+        Data::DlgState dlg;
+        qint32 unreadMentionsCount = 0;
+        QString text;
+
+        _stream >> dlg.AimId_ >> dlg.UnreadCount_ >> dlg.LastMsgId_ >> dlg.YoursLastRead_ >> dlg.TheirsLastRead_
+            >> dlg.TheirsLastDelivered_ >> dlg.FavoriteTime_ >> dlg.Time_ >> dlg.Outgoing_ >> dlg.Chat_ >> dlg.Visible_
+            >> dlg.Official_ >> dlg.IsContact_ >> dlg.IsLastMessageDelivered >> dlg.senderAimId_ >> dlg.LastMessageFriendly_
+            >> dlg.senderNick_ >> dlg.Friendly_ >> dlg.MailId_ >> dlg.hasMentionMe_ >> unreadMentionsCount
+            >> text;
+
+        dlg.unreadMentionsCount_ = unreadMentionsCount;
+        dlg.SetText(text);
+
+        return dlg;
+    }
+
+    void writeContact(QDataStream& _stream, const Data::Contact& _contact)
+    {
+        const bool isGroup = (_contact.GetType() == Data::GROUP);
+
+        _stream << isGroup;
+
+        if (isGroup)
+        {
+            _stream << (qint32)_contact.GroupId_ << static_cast<const Data::Group&>(_contact).Name_;
+            return;
+        }
+
+        _stream << _contact.AimId_ << _contact.Friendly_ << _contact.AbContactName_ << _contact.State_ << _contact.UserType_
+            << _contact.StatusMsg_ << _contact.OtherNumber_ << _contact.LastSeen_ << (qint32)_contact.GroupId_
+            << (qint32)_contact.OutgoingMsgCount_ << _contact.Is_chat_ << _contact.HasLastSeen_ << _contact.NotAuth_
+            << _contact.Muted_ << _contact.IsLiveChat_ << _contact.IsOfficial_ << _contact.iconId_ << _contact.bigIconId_
+            << _contact.largeIconId_;
+    }
+
+    Data::ContactPtr readContact(QDataStream& _stream)
+    {
+        bool isGroup = false;
+        _stream >> isGroup;
+
+        qint32 groupId = -1;
+
+        if (isGroup)
+        {
+            auto buddy = std::make_shared<Data::GroupBuddy>();
+            _stream >> groupId >> buddy->Name_;
+            buddy->Id_ = groupId;
+
+            auto group = std::make_shared<Data::Group>();
+            group->ApplyBuddy(buddy);
+            return group;
+        }
+
+        auto contact = std::make_shared<Data::Contact>();
+        qint32 outgoingMsgCount = 0;
+
+        _stream >> contact->AimId_ >> contact->Friendly_ >> contact->AbContactName_ >> contact->State_ >> contact->UserType_
+            >> contact->StatusMsg_ >> contact->OtherNumber_ >> contact->LastSeen_ >> groupId
+            >> outgoingMsgCount >> contact->Is_chat_ >> contact->HasLastSeen_ >> contact->NotAuth_
+            >> contact->Muted_ >> contact->IsLiveChat_ >> contact->IsOfficial_ >> contact->iconId_ >> contact->bigIconId_
+            >> contact->largeIconId_;
+
+        contact->GroupId_ = groupId;
+        contact->OutgoingMsgCount_ = outgoingMsgCount;
+
+        return contact;
+    }
+}
+
+namespace Logic
+{
+    std::unique_ptr<WarmStartSnapshot> g_warm_start_snapshot;
+
+    WarmStartSnapshot::WarmStartSnapshot()
+        : saveTimer_(new QTimer(this))
+        , isWarm_(false)
+        , isLive_(false)
+    {
+        connect(Ui::GetDispatcher(), &Ui::core_dispatcher::im_created, this, &WarmStartSnapshot::imCreated, Qt::QueuedConnection);
+        connect(Ui::GetDispatcher(), &Ui::core_dispatcher::loginComplete, this, &WarmStartSnapshot::loginComplete, Qt::QueuedConnection);
+        connect(Ui::GetDispatcher(), &Ui::core_dispatcher::myInfo, this, &WarmStartSnapshot::myInfo, Qt::QueuedConnection);
+
+        connect(saveTimer_, &QTimer::timeout, this, &WarmStartSnapshot::save);
+        saveTimer_->setTimerType(Qt::VeryCoarseTimer);
+        saveTimer_->setInterval((int)std::chrono::milliseconds(save_period).count());
+    }
+
+    bool WarmStartSnapshot::load()
+    {
+        QFile file(getFileName());
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        const auto size = file.size();
+        auto data = file.map(0, size);
+        if (!data)
+            return false;
+
+        // the values are copied out of the mapping, nothing refers to it after the parse
+        const auto bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(data), (int)size);
+        QDataStream stream(bytes);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        stream >> magic >> version;
+
+        QString owner;
+        std::vector<Data::DlgState> dialogs;
+        std::vector<Data::ContactPtr> contacts;
+        std::vector<std::pair<QString, int>> avatarKeys;
+
+        const auto isKnown = (magic == snapshot_magic && version == snapshot_version);
+        if (isKnown)
+        {
+            stream >> owner;
+
+            quint32 count = 0;
+
+            stream >> count;
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+                dialogs.push_back(readDialog(stream));
+
+            stream >> count;
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+                contacts.push_back(readContact(stream));
+
+            stream >> count;
+            for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+            {
+                QString aimId;
+                qint32 sizePx = 0;
+                stream >> aimId >> sizePx;
+
+                if (sizePx > 0)
+                    avatarKeys.emplace_back(std::move(aimId), sizePx);
+            }
+        }
+
+        file.unmap(data);
+        file.close();
+
+        if (!isKnown || stream.status() != QDataStream::Ok || owner.isEmpty())
+        {
+            removeFile();
+            return false;
+        }
+
+        ownerAimId_ = owner;
+        avatarKeys_ = std::move(avatarKeys);
+
+        // the contact list first, the recents look their contacts up in it
+        getContactListModel()->warmStart(contacts);
+        getRecentsModel()->warmStart(std::move(dialogs));
+
+        isWarm_ = true;
+        warm_start_rendered = true;
+
+        postStartupPhase("warm_start");
+
+        __INFO("startup", "warm start snapshot is rendered\n"
+            __LOGP(since_launch_ms, launch_timer.elapsed())
+            __LOGP(bytes, size)
+            __LOGP(contacts, contacts.size()));
+
+        if (Ui::GetDispatcher()->isImCreated())
+            requestAvatars();
+
+        return true;
+    }
+
+    QByteArray WarmStartSnapshot::serialize() const
+    {
+        QByteArray bytes;
+
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        stream << snapshot_magic << snapshot_version << Ui::MyInfo()->aimId();
+
+        const auto dialogs = getRecentsModel()->getDialogs();
+        stream << (quint32)dialogs.size();
+        for (const auto& dlg : dialogs)
+            writeDialog(stream, dlg);
+
+        const auto contacts = getContactListModel()->getSortedContacts();
+        stream << (quint32)contacts.size();
+        for (const auto contact : contacts)
+            writeContact(stream, *contact);
+
+        std::vector<std::pair<QString, int>> avatarKeys;
+        for (int i = 0, count = std::min((int)dialogs.size(), avatar_keys_dialogs_count); i < count; ++i)
+        {
+            for (const auto sizePx : GetAvatarStorage()->GetSizes(dialogs[i].AimId_))
+                avatarKeys.emplace_back(dialogs[i].AimId_, sizePx);
+        }
+
+        stream << (quint32)avatarKeys.size();
+        for (const auto& key : avatarKeys)
+            stream << key.first << (qint32)key.second;
+
+        return bytes;
+    }
+
+    void WarmStartSnapshot::save()
+    {
+        if (!isLive_ || Ui::MyInfo()->aimId().isEmpty())
+            return;
+
+        const auto bytes = serialize();
+        const auto fileName = getFileName();
+
+        QtConcurrent::run([fileName, bytes]()
+        {
+            writeFile(fileName, bytes);
+        });
+    }
+
+    void WarmStartSnapshot::saveOnExit()
+    {
+        if (!isLive_ || Ui::MyInfo()->aimId().isEmpty())
+            return;
+
+        writeFile(getFileName(), serialize());
+    }
+
+    void WarmStartSnapshot::removeFile()
+    {
+        QFile::remove(getFileName());
+    }
+
+    void WarmStartSnapshot::imCreated()
+    {
+        if (isWarm_)
+            requestAvatars();
+    }
+
+    void WarmStartSnapshot::loginComplete()
+    {
+        // the core has sent what it had cached and the first fetch is in, the snapshot dialogs left are stale
+        if (isWarm_)
+        {
+            getRecentsModel()->dropWarmDialogs();
+            isWarm_ = false;
+        }
+
+        isLive_ = true;
+        saveTimer_->start();
+    }
+
+    void WarmStartSnapshot::myInfo()
+    {
+        if (isWarm_ && !Ui::MyInfo()->aimId().isEmpty() && Ui::MyInfo()->aimId() != ownerAimId_)
+        {
+            drop();
+            removeFile();
+        }
+    }
+
+    void WarmStartSnapshot::requestAvatars()
+    {
+        // the rows painted before the im was created asked for their avatars in vain
+        for (const auto& key : avatarKeys_)
+            GetAvatarStorage()->Request(key.first, key.second);
+
+        avatarKeys_.clear();
+    }
+
+    void WarmStartSnapshot::drop()
+    {
+        getRecentsModel()->dropWarmDialogs();
+        getContactListModel()->dropWarmContacts();
+
+        avatarKeys_.clear();
+        isWarm_ = false;
+    }
+
+    void WarmStartSnapshot::startLaunchTimer()
+    {
+        launch_timer.start();
+    }
+
+    void WarmStartSnapshot::reportFirstPaint()
+    {
+        if (first_paint_reported)
+            return;
+
+        first_paint_reported = true;
+
+        postStartupPhase("first_paint");
+
+        __INFO("startup", "first recents row is painted\n"
+            __LOGP(since_launch_ms, launch_timer.elapsed())
+            __LOGP(warm_start, warm_start_rendered));
+    }
+
+    WarmStartSnapshot* getWarmStartSnapshot()
+    {
+        if (!g_warm_start_snapshot)
+            g_warm_start_snapshot = std::make_unique<WarmStartSnapshot>();
+
+        return g_warm_start_snapshot.get();
+    }
+
+    void ResetWarmStartSnapshot()
+    {
+        g_warm_start_snapshot.reset();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Logic
+{
+    // The recents, the contact list and the avatar keys as they were shown last time.
+    // They are rendered at launch, before the core has loaded its caches and sent the live state,
+    // then each model drops whatever of the snapshot the core has not confirmed.
+    class WarmStartSnapshot : public QObject
+    {
+        Q_OBJECT
+
+    private Q_SLOTS:
+        void imCreated();
+        void loginComplete();
+        void myInfo();
+        void save();
+
+    public:
+        WarmStartSnapshot();
+
+        // fills the empty models from the file, false if there is no snapshot of a known version
+        bool load();
+
+        // written on exit and periodically, once the models hold the live state
+        void saveOnExit();
+
+        static void removeFile();
+
+        // the first painted recents row is timed from the launch
+        static void startLaunchTimer();
+        static void reportFirstPaint();
+
+    private:
+        QByteArray serialize() const;
+        void requestAvatars();
+        void drop();
+
+        QTimer* saveTimer_;
+        QString ownerAimId_;
+        std::vector<std::pair<QString, int>> avatarKeys_;
+        bool isWarm_;
+        bool isLive_;
+    };
+
+    WarmStartSnapshot* getWarmStartSnapshot();
+    void ResetWarmStartSnapshot();
+}
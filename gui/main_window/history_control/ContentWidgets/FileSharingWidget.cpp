@@ -27,6 +27,7 @@
 #include "../../../gui_settings.h"
 #include "../../../themes/ThemePixmap.h"
 #include "../../../themes/ResourceIds.h"
+#include "../../../utils/ImageDecoder.h"
 #include "../../../utils/InterConnector.h"
 #include "../../../utils/LoadMovieFromFileTask.h"
 #include "../../../utils/LoadPixmapFromFileTask.h"
@@ -1103,7 +1104,7 @@ namespace HistoryControl
 
         if (Utils::is_image_extension(ext))
         {
-            auto task = new Utils::LoadPixmapFromFileTask(FsInfo_->GetLocalPath());
+            auto task = new Utils::LoadPixmapFromFileTask(FsInfo_->GetLocalPath(), getPreviewDecodeSize());
 
             QObject::connect(
                 task,
@@ -1111,7 +1112,7 @@ namespace HistoryControl
                 this,
                 &FileSharingWidget::localPreviewLoaded);
 
-            QThreadPool::globalInstance()->start(task);
+            Utils::getImageDecodePool()->start(task);
         }
         else if (Utils::is_video_extension(ext))
         {
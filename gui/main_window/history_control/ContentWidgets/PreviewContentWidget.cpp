@@ -155,7 +155,7 @@ namespace HistoryControl
 
                 if (videoPlayer_->state() == QMovie::MovieState::Paused && videoPlayer_->isGif())
                 {
-                    p.drawPixmap(imageRect, videoPlayer_->getActiveImage());
+                    p.drawImage(imageRect, videoPlayer_->getActiveFrame());
                 }
             }
         }
@@ -604,7 +604,7 @@ namespace HistoryControl
 
         Utils::check_pixel_ratio(Preview_);
 
-        const auto scaledSize = Utils::scale_bitmap(getMaxPreviewSize().toSize());
+        const auto scaledSize = getPreviewDecodeSize();
 
         auto task = new ResizePixmapTask(Preview_, scaledSize);
 
@@ -617,6 +617,11 @@ namespace HistoryControl
         QThreadPool::globalInstance()->start(task);
     }
 
+    QSize PreviewContentWidget::getPreviewDecodeSize()
+    {
+        return Utils::scale_bitmap(getMaxPreviewSize().toSize());
+    }
+
     void PreviewContentWidget::invalidateSizes()
     {
         // invalidate size-dependent children
@@ -71,6 +71,9 @@ namespace HistoryControl
 
         void setPreviewGenuineSize(const QSize &size);
 
+        // a local picture is decoded at this size rather than scaled down after decoding
+        static QSize getPreviewDecodeSize();
+
         void setTextVisible(const bool isVisible);
 
         QRect updateWidgetSize();
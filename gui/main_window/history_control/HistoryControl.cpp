@@ -9,6 +9,7 @@
 #include "../../core_dispatcher.h"
 #include "../../utils/gui_coll_helper.h"
 #include "../../utils/log/log.h"
+#include "../../utils/profiling/auto_stop_watch.h"
 #include "../contact_list/RecentsModel.h"
 #include "../../gui_settings.h"
 
@@ -136,6 +137,9 @@ namespace Ui
     {
         assert(!_aimId.isEmpty());
 
+        // the gui part of opening a dialog, the core part is "dialog/open"
+        Profiling::auto_stop_watch watch("gui/dialog/open");
+
         const bool contactChanged = (_aimId != current_);
 
         const Data::DlgState data = Logic::getRecentsModel()->getDlgState(_aimId);
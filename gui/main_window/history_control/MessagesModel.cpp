@@ -34,6 +34,9 @@
 
 namespace
 {
+    // core prefetches the next older page once the shown history is this close to the oldest loaded message
+    const auto prefetchDistance = Data::MORE_MESSAGES_COUNT;
+
     QString NormalizeAimId(const QString& _aimId)
     {
         const int pos = _aimId.indexOf(ql1s("@uin.icq"));
@@ -2780,6 +2783,44 @@ namespace Logic
             dialog.setLastRequestedMessage(lastId);
     }
 
+    void MessagesModel::prefetchOlderMessages(const QString& _aimId)
+    {
+        CHECK_THREAD
+        auto& dialog = getContactDialog(_aimId);
+        auto& dialogMessages = dialog.getMessages();
+
+        if (dialogMessages.empty() || dialog.getLastKey().isEmpty() || dialog.getLastKey().isPending())
+            return;
+
+        const auto oldest = dialogMessages.cbegin()->second.getBuddy();
+
+        // the beginning of the history, nothing older to load
+        if (oldest->Prev_ == -1)
+            return;
+
+        auto distance = 0;
+        for (auto iter = dialogMessages.cbegin(); iter != dialogMessages.cend() && iter->first < dialog.getLastKey(); ++iter)
+        {
+            if (++distance > prefetchDistance)
+                return;
+        }
+
+        const auto prefetched = prefetchedFrom_.find(_aimId);
+        if (prefetched != prefetchedFrom_.end() && prefetched.value() == oldest->Id_)
+            return;
+
+        prefetchedFrom_[_aimId] = oldest->Id_;
+
+        // the same page requestMessages asks for towards older messages, so core serves it from the warm cache
+        Ui::gui_coll_helper collection(Ui::GetDispatcher()->create_collection(), true);
+        collection.set_value_as_qstring("contact", _aimId);
+        collection.set_value_as_int64("from", oldest->Id_);
+        collection.set_value_as_int64("count_early", Data::PRELOAD_MESSAGES_COUNT);
+        collection.set_value_as_int64("count_later", 0);
+
+        Ui::GetDispatcher()->post_message_to_core(qsl("archive/messages/prefetch"), collection.get());
+    }
+
     Ui::HistoryControlPageItem* MessagesModel::makePageItem(const Data::MessageBuddy& _msg, QWidget* _parent) const
     {
         CHECK_THREAD
@@ -3325,6 +3366,9 @@ namespace Logic
         dialog.setLastKey(key);
         dialog.setFirstKey(firstKey);
 
+        if (_isMoveToBottomIfNeed)
+            prefetchOlderMessages(aimId);
+
         if (
             dialog.getLastKey().isEmpty() ||
             dialog.getLastKey().isPending() ||
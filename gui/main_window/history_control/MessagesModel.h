@@ -510,6 +510,7 @@ namespace Logic
         Data::MessageBuddy item(const Message& _index);
         void requestMessages(const QString& _aimId, qint64 _messageId, RequestDirection _direction, Prefetch _prefetch, JumpToBottom _jump_to_bottom, FirstRequest _firstRequest, Reason _reason);
         void requestLastNewMessages(const QString& _aimId, const QVector<qint64>& _ids);
+        void prefetchOlderMessages(const QString& _aimId);
 
         Ui::HistoryControlPageItem* makePageItem(const Data::MessageBuddy& _msg, QWidget* _parent) const;
         Ui::HistoryControlPageItem* fillItemById(const QString& _aimId, const MessageKey& _key, QWidget* _parent);
@@ -602,6 +603,9 @@ namespace Logic
         QHash<qint64, int64_t> seqAndToOlder_;
         QHash<qint64, int64_t> seqAndJumpBottom_;
 
+        // the oldest loaded message the next older page was last prefetched from, by contact
+        QHash<QString, qint64> prefetchedFrom_;
+
         MentionsMe mentionsMe_;
         MentionsMe pendingMentionsMe_;
 
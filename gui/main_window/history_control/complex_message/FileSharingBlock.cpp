@@ -558,7 +558,7 @@ void FileSharingBlock::drawPreview(QPainter &p, const QRect &previewRect, QPaint
 
                 if (videoplayer_->state() == QMovie::MovieState::Paused)
                 {
-                    p.drawPixmap(previewRect, videoplayer_->getActiveImage());
+                    p.drawImage(previewRect, videoplayer_->getActiveFrame());
                 }
             }
         }
@@ -442,7 +442,7 @@ void ImagePreviewBlock::drawBlock(QPainter &p, const QRect& _rect, const QColor&
 
                 if (videoPlayer_->state() == QMovie::MovieState::Paused && videoPlayer_->isGif())
                 {
-                    p.drawPixmap(imageRect, videoPlayer_->getActiveImage());
+                    p.drawImage(imageRect, videoPlayer_->getActiveFrame());
                 }
             }
         }
@@ -27,6 +27,12 @@ namespace Ui
 
     const int64_t empty_pts = -1000000;
 
+    // caps the cores spent on decoding previews, no matter how many are playing
+    const int32_t max_video_decode_threads = 4;
+
+    // free buffers kept per media, frames in flight to the gui are not counted
+    const size_t max_pooled_frames = 4;
+
     bool ThreadMessagesQueue::getMessage(ThreadMessage& _message, std::function<bool()> _isQuit, int32_t _wait_timeout)
     {
         condition_.tryAcquire(1, _wait_timeout);
@@ -60,7 +66,23 @@ namespace Ui
                 const auto id = _message.videoId_;
                 messages_.remove_if([id](const auto& x) { return x.videoId_ == id; });
             }
-            messages_.splice(_forward ? messages_.begin() : messages_.end(), tmpList, tmpList.begin());
+
+            auto position = (_forward ? messages_.begin() : messages_.end());
+
+            // let visible media overtake queued background requests, but never reorder messages of the same media
+            if (!_forward && _message.priority_ != dp_background)
+            {
+                while (position != messages_.begin())
+                {
+                    const auto prev = std::prev(position);
+                    if (prev->videoId_ == _message.videoId_ || prev->priority_ >= _message.priority_)
+                        break;
+
+                    position = prev;
+                }
+            }
+
+            messages_.splice(position, tmpList, tmpList.begin());
         }
 
         condition_.release(1);
@@ -76,6 +98,91 @@ namespace Ui
     }
 
 
+    //////////////////////////////////////////////////////////////////////////
+    // VideoFramePool
+    //////////////////////////////////////////////////////////////////////////
+    VideoFramePool::~VideoFramePool()
+    {
+        clear();
+    }
+
+    int32_t VideoFramePool::getBytesPerLine(const QSize& _size)
+    {
+        // keep rows aligned for the simd paths of sws_scale
+        const int32_t align = 64;
+
+        return (((_size.width() * 4) + align - 1) / align) * align;
+    }
+
+    void VideoFramePool::clear()
+    {
+        for (auto buffer : free_)
+        {
+            ffmpeg::av_free(buffer->data_);
+            delete buffer;
+        }
+
+        free_.clear();
+    }
+
+    QImage VideoFramePool::acquire(const QSize& _size)
+    {
+        assert(!_size.isEmpty());
+
+        PooledBuffer* buffer = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (size_ != _size)
+            {
+                clear();
+                size_ = _size;
+            }
+
+            if (!free_.empty())
+            {
+                buffer = free_.back();
+                free_.pop_back();
+            }
+        }
+
+        const auto bytesPerLine = getBytesPerLine(_size);
+
+        if (!buffer)
+        {
+            buffer = new PooledBuffer();
+            buffer->data_ = (uchar*) ffmpeg::av_malloc(bytesPerLine * _size.height());
+            buffer->size_ = _size;
+        }
+
+        buffer->pool_ = shared_from_this();
+
+        return QImage(buffer->data_, _size.width(), _size.height(), bytesPerLine, QImage::Format_RGBA8888, &VideoFramePool::release, buffer);
+    }
+
+    void VideoFramePool::release(void* _buffer)
+    {
+        auto buffer = (PooledBuffer*) _buffer;
+
+        auto pool = std::move(buffer->pool_);
+        assert(pool);
+
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex_);
+
+            if (pool->size_ == buffer->size_ && pool->free_.size() < max_pooled_frames)
+            {
+                pool->free_.push_back(buffer);
+                return;
+            }
+        }
+
+        ffmpeg::av_free(buffer->data_);
+        delete buffer;
+    }
+
+
     //////////////////////////////////////////////////////////////////////////
     // PacketQueue
     //////////////////////////////////////////////////////////////////////////
@@ -168,7 +275,7 @@ namespace Ui
         , audioQueue_(QSharedPointer<PacketQueue>::create())
         , needUpdateSwsContext_(false)
         , swsContext_(nullptr)
-        , frameRGB_(nullptr)
+        , framePool_(std::make_shared<VideoFramePool>())
         , width_(0)
         , height_(0)
         , rotation_(0)
@@ -201,6 +308,10 @@ namespace Ui
         : quit_(false)
         , curr_id_(0)
     {
+        const auto threadsCount = std::max(1, std::min(max_video_decode_threads, QThread::idealThreadCount() / 2));
+        for (auto i = 0; i < threadsCount; ++i)
+            videoThreadMessagesQueues_.push_back(std::make_unique<ThreadMessagesQueue>());
+
         QObject::connect(this, &VideoContext::audioQuit, this, &VideoContext::onAudioQuit);
         QObject::connect(this, &VideoContext::videoQuit, this, &VideoContext::onVideoQuit);
         QObject::connect(this, &VideoContext::demuxQuit, this, &VideoContext::onDemuxQuit);
@@ -1264,7 +1375,17 @@ namespace Ui
 
     void VideoContext::postVideoThreadMessage(const ThreadMessage& _message, bool _forward, bool _clear_others)
     {
-        videoThreadMessagesQueue_.pushMessage(_message, _forward, _clear_others);
+        if (_message.message_ == thread_message_type::tmt_wake_up)
+        {
+            for (auto& queue : videoThreadMessagesQueues_)
+                queue->pushMessage(_message, _forward, _clear_others);
+
+            return;
+        }
+
+        const auto index = (_message.videoId_ % videoThreadMessagesQueues_.size());
+
+        videoThreadMessagesQueues_[index]->pushMessage(_message, _forward, _clear_others);
     }
 
     void VideoContext::postDemuxThreadMessage(const ThreadMessage& _message, bool _forward, bool _clear_others)
@@ -1289,7 +1410,9 @@ namespace Ui
 
     void VideoContext::clearMessageQueue()
     {
-        videoThreadMessagesQueue_.clear();
+        for (auto& queue : videoThreadMessagesQueues_)
+            queue->clear();
+
         audioThreadMessageQueue_.clear();
         demuxThreadMessageQueue_.clear();
     }
@@ -1304,9 +1427,16 @@ namespace Ui
         _media.audioData_.state_ = _state;
     }
 
-    bool VideoContext::getVideoThreadMessage(ThreadMessage& _message, int32_t _waitTimeout)
+    bool VideoContext::getVideoThreadMessage(ThreadMessage& _message, int32_t _waitTimeout, int32_t _threadIndex)
+    {
+        assert(_threadIndex >= 0 && _threadIndex < (int32_t) videoThreadMessagesQueues_.size());
+
+        return videoThreadMessagesQueues_[_threadIndex]->getMessage(_message, [this]{return isQuit();}, _waitTimeout);
+    }
+
+    int32_t VideoContext::getVideoDecodeThreadsCount() const
     {
-        return videoThreadMessagesQueue_.getMessage(_message, [this]{return isQuit();}, _waitTimeout);
+        return (int32_t) videoThreadMessagesQueues_.size();
     }
 
     bool VideoContext::updateScaleContext(MediaData& _media, const QSize _sz)
@@ -1325,14 +1455,6 @@ namespace Ui
 
     void VideoContext::freeScaleContext(MediaData& _media)
     {
-        if (_media.frameRGB_)
-        {
-            ffmpeg::av_frame_unref(_media.frameRGB_);
-            ffmpeg::av_frame_free(&_media.frameRGB_);
-        }
-
-        _media.frameRGB_ = 0;
-
         sws_freeContext(_media.swsContext_);
     }
 
@@ -1881,8 +2003,9 @@ namespace Ui
     //////////////////////////////////////////////////////////////////////////
     // VideoDecodeThread
     //////////////////////////////////////////////////////////////////////////
-    VideoDecodeThread::VideoDecodeThread(VideoContext& _ctx)
+    VideoDecodeThread::VideoDecodeThread(VideoContext& _ctx, int32_t _index)
         :   ctx_(_ctx)
+        ,   index_(_index)
     {
 
     }
@@ -1910,7 +2033,7 @@ namespace Ui
 
         while (!ctx_.isQuit())
         {
-            if (ctx_.getVideoThreadMessage(msg, waitMsgTimeout))
+            if (ctx_.getVideoThreadMessage(msg, waitMsgTimeout, index_))
             {
                 auto videoId = msg.videoId_;
 
@@ -2055,45 +2178,21 @@ namespace Ui
                             // update scale context
                             if ((media.needUpdateSwsContext_) || (frame->format != -1 && frame->format != media.codecContext_->pix_fmt) || !media.swsContext_)
                             {
-                                if (media.frameRGB_)
-                                {
-                                    ffmpeg::av_frame_unref(media.frameRGB_);
-                                    ffmpeg::av_frame_free(&media.frameRGB_);
-
-                                    media.frameRGB_ = 0;
-                                }
-
                                 media.needUpdateSwsContext_ = false;
                                 media.swsContext_ = sws_getCachedContext(
                                     media.swsContext_,
                                     frame->width,
                                     frame->height,
                                     ffmpeg::AVPixelFormat(frame->format), scaledSize.width(), scaledSize.height(), ffmpeg::AV_PIX_FMT_RGBA, SWS_POINT, 0, 0, 0);
-
-                                int align = 256;
-                                while (1)
-                                {
-                                    if (frame->linesize[0] % align == 0)
-                                        break;
-
-                                    align = align / 2;
-                                }
-
-                                media.frameRGB_ = ffmpeg::av_frame_alloc();
-                                int numBytes = ffmpeg::av_image_get_buffer_size(ffmpeg::AV_PIX_FMT_RGBA, scaledSize.width(), scaledSize.height(), align);
-                                media.scaledBuffer_.resize(numBytes);
-                                av_image_fill_arrays(media.frameRGB_->data, media.frameRGB_->linesize, &media.scaledBuffer_[0], ffmpeg::AV_PIX_FMT_RGBA, scaledSize.width(), scaledSize.height(), align);
-
                             }
 
-                            ffmpeg::sws_scale(media.swsContext_, frame->data, frame->linesize, 0, frame->height, media.frameRGB_->data, media.frameRGB_->linesize);
+                            // scale straight into a pooled buffer which the gui paints from without copying
+                            QImage lastFrame = media.framePool_->acquire(scaledSize);
 
-                            QImage lastFrame(scaledSize.width(), scaledSize.height(), QImage::Format_RGBA8888);
+                            uint8_t* dstData[4] = { lastFrame.bits(), nullptr, nullptr, nullptr };
+                            int dstLinesize[4] = { lastFrame.bytesPerLine(), 0, 0, 0 };
 
-                            for (int32_t y = 0; y < scaledSize.height(); ++y)
-                            {
-                                memcpy(lastFrame.scanLine(y), media.frameRGB_->data[0] + y*media.frameRGB_->linesize[0], scaledSize.width()*4);
-                            }
+                            ffmpeg::sws_scale(media.swsContext_, frame->data, frame->linesize, 0, frame->height, dstData, dstLinesize);
 
                             std::unique_ptr<QTransform> imageTransform;
 
@@ -2443,21 +2542,31 @@ namespace Ui
         auto t2 = std::chrono::system_clock::now();
 
         if (fillClient_)
-            _painter.drawPixmap(drawRect, activeImage_, sourceRect);
+            _painter.drawImage(drawRect, activeImage_, sourceRect);
         else
-            _painter.drawPixmap(drawRect, activeImage_);
+            _painter.drawImage(drawRect, activeImage_);
 
         //auto t3 = std::chrono::system_clock::now();
 
         //qDebug() << "fill time " << (t2 - t1)/std::chrono::milliseconds(1) << "draw frame time " << (t3 - t2)/std::chrono::milliseconds(1);
     }
 
-    void FrameRenderer::updateFrame(QPixmap _image)
+    void FrameRenderer::updateFrame(QImage _image)
+    {
+        activeImage_ = std::move(_image);
+    }
+
+    void FrameRenderer::updateFrame(const QPixmap& _image)
     {
-        activeImage_ = _image;
+        activeImage_ = _image.toImage();
     }
 
     QPixmap FrameRenderer::getActiveImage() const
+    {
+        return QPixmap::fromImage(activeImage_);
+    }
+
+    const QImage& FrameRenderer::getActiveFrame() const
     {
         return activeImage_;
     }
@@ -2753,13 +2862,11 @@ namespace Ui
 
         if (!_eof)
         {
-            QPixmap frame = QPixmap::fromImage(_image);
-
-            decodedFrames_.emplace_back(frame, _pts);
+            decodedFrames_.emplace_back(_image, _pts);
 
             if (!firstFrame_)
             {
-                firstFrame_ = std::make_unique<DecodedFrame>(frame, _pts);
+                firstFrame_ = std::make_unique<DecodedFrame>(_image, _pts);
 
                 emit firstFrameReady();
             }
@@ -2941,7 +3048,7 @@ namespace Ui
             if (getStarted())
                 timer_->start(100);
 
-            getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_get_next_video_frame), false);
+            getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_get_next_video_frame, getDecodePriority()), false);
 
             return;
         }
@@ -3007,7 +3114,7 @@ namespace Ui
             return;
         }
         //qDebug() << "send "<< QTime::currentTime() <<"get next id onTimer2 " << mediaId_;
-        getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_get_next_video_frame), false);
+        getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_get_next_video_frame, getDecodePriority()), false);
 
         active_renderer_->updateFrame(frame.image_);
 
@@ -3128,7 +3235,7 @@ namespace Ui
             getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_init), false);
 
             //qDebug() << "send get next id play " << mediaId_;
-            getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_get_next_video_frame), false);
+            getMediaContainer()->postVideoThreadMessage(ThreadMessage(mediaId_, thread_message_type::tmt_get_next_video_frame, getDecodePriority()), false);
 
             getMediaContainer()->resetFrameTimer(media);
         }
@@ -3166,6 +3273,13 @@ namespace Ui
         return !active_renderer_->isActiveImageNull();
     }
 
+    decode_priority FFMpegPlayer::getDecodePriority() const
+    {
+        const auto widget = active_renderer_->getWidget();
+
+        return ((widget->isVisible() && !widget->visibleRegion().isEmpty()) ? dp_visible : dp_background);
+    }
+
     void FFMpegPlayer::pause()
     {
         qDebug() << "void FFMpegPlayer::pause()";
@@ -3370,6 +3484,11 @@ namespace Ui
         return active_renderer_->getActiveImage();
     }
 
+    const QImage& FFMpegPlayer::getActiveFrame() const
+    {
+        return active_renderer_->getActiveFrame();
+    }
+
     bool FFMpegPlayer::getStarted() const
     {
         return started_;
@@ -3454,7 +3573,7 @@ namespace Ui
                 opengl_renderer_->filterEvents(this);
             }
 
-            opengl_renderer_->updateFrame(active_renderer_->getActiveImage());
+            opengl_renderer_->updateFrame(active_renderer_->getActiveFrame());
 
             active_renderer_ = opengl_renderer_;
         }
@@ -3481,7 +3600,7 @@ namespace Ui
                 gdi_renderer_->filterEvents(this);
             }
 
-            gdi_renderer_->updateFrame(active_renderer_->getActiveImage());
+            gdi_renderer_->updateFrame(active_renderer_->getActiveFrame());
 
             active_renderer_ = gdi_renderer_;
 
@@ -3591,9 +3710,11 @@ namespace Ui
         : is_decods_inited_(false)
         , is_demux_inited_(false)
         , demuxThread_(ctx_)
-        , videoDecodeThread_(ctx_)
         , audioDecodeThread_(ctx_)
-    {}
+    {
+        for (auto i = 0; i < ctx_.getVideoDecodeThreadsCount(); ++i)
+            videoDecodeThreads_.push_back(std::make_unique<VideoDecodeThread>(ctx_, i));
+    }
 
     MediaContainer::~MediaContainer()
     {
@@ -3617,7 +3738,8 @@ namespace Ui
 
     void MediaContainer::VideoDecodeThreadStart(uint32_t _mediaId)
     {
-        videoDecodeThread_.start();
+        for (auto& thread : videoDecodeThreads_)
+            thread->start();
     }
 
     void MediaContainer::AudioDecodeThreadStart(uint32_t _mediaId)
@@ -3795,7 +3917,8 @@ namespace Ui
 
     void MediaContainer::VideoDecodeThreadWait()
     {
-        videoDecodeThread_.wait();
+        for (auto& thread : videoDecodeThreads_)
+            thread->wait();
     }
 
     void MediaContainer::AudioDecodeThreadWait()
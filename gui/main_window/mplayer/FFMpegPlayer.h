@@ -47,6 +47,12 @@ namespace Ui
         tmt_get_first_frame = 16
     };
 
+    enum decode_priority
+    {
+        dp_background = 0,
+        dp_visible = 1
+    };
+
     struct ThreadMessage
     {
         thread_message_type message_;
@@ -55,12 +61,14 @@ namespace Ui
         int32_t y_;
         uint32_t videoId_;
         QString str_;
+        decode_priority priority_;
 
-        ThreadMessage(uint32_t _videoId = UINT32_MAX, const thread_message_type _message = thread_message_type::tmt_unknown)
+        ThreadMessage(uint32_t _videoId = UINT32_MAX, const thread_message_type _message = thread_message_type::tmt_unknown, const decode_priority _priority = dp_background)
             : message_(_message)
             , x_(0)
             , y_(0)
             , videoId_(_videoId)
+            , priority_(_priority)
         {
         }
     };
@@ -85,6 +93,40 @@ namespace Ui
     };
 
 
+    //////////////////////////////////////////////////////////////////////////
+    // VideoFramePool
+    //////////////////////////////////////////////////////////////////////////
+    // recycles decoded frame buffers, images handed out wrap the buffers directly
+    // and give them back to the pool once the last copy of the image is released
+    class VideoFramePool : public std::enable_shared_from_this<VideoFramePool>
+    {
+        struct PooledBuffer
+        {
+            std::shared_ptr<VideoFramePool> pool_;
+            uchar* data_;
+            QSize size_;
+        };
+
+        std::mutex mutex_;
+
+        QSize size_;
+
+        std::vector<PooledBuffer*> free_;
+
+        static void release(void* _buffer);
+
+        static int32_t getBytesPerLine(const QSize& _size);
+
+        void clear();
+
+    public:
+
+        ~VideoFramePool();
+
+        QImage acquire(const QSize& _size);
+    };
+
+
     //////////////////////////////////////////////////////////////////////////
     // PacketQueue
     //////////////////////////////////////////////////////////////////////////
@@ -187,8 +229,7 @@ namespace Ui
 
         bool needUpdateSwsContext_;
         ffmpeg::SwsContext* swsContext_;
-        std::vector<uint8_t> scaledBuffer_;
-        ffmpeg::AVFrame* frameRGB_;
+        std::shared_ptr<VideoFramePool> framePool_;
         DecodeAudioData audioData_;
 
         std::map<int32_t, QImage> frames_;
@@ -292,7 +333,8 @@ namespace Ui
         mutable std::unordered_map<uint32_t, bool> activeVideos_;
         mutable std::mutex activeVideosMutex_;
 
-        ThreadMessagesQueue videoThreadMessagesQueue_;
+        // media are sharded between the decode threads by id, a media always stays on the same thread
+        std::vector<std::unique_ptr<ThreadMessagesQueue>> videoThreadMessagesQueues_;
         ThreadMessagesQueue demuxThreadMessageQueue_;
         ThreadMessagesQueue audioThreadMessageQueue_;
 
@@ -384,7 +426,9 @@ namespace Ui
         void updateScaledVideoSize(uint32_t _videoId, const QSize& _sz);
 
         void postVideoThreadMessage(const ThreadMessage& _message, bool _forward, bool _clear_others = false);
-        bool getVideoThreadMessage(ThreadMessage& _message, int32_t _waitTimeout);
+        bool getVideoThreadMessage(ThreadMessage& _message, int32_t _waitTimeout, int32_t _threadIndex);
+
+        int32_t getVideoDecodeThreadsCount() const;
 
         void postDemuxThreadMessage(const ThreadMessage& _message, bool _forward, bool _clear_others = false);
         bool getDemuxThreadMessage(ThreadMessage& _message, int32_t _waitTimeout);
@@ -452,13 +496,15 @@ namespace Ui
 
         VideoContext& ctx_;
 
+        const int32_t index_;
+
     protected:
 
         virtual void run() override;
 
     public:
 
-        explicit VideoDecodeThread(VideoContext& _ctx);
+        VideoDecodeThread(VideoContext& _ctx, int32_t _index);
 
         void prepareCtx(MediaData& _media);
     };
@@ -483,7 +529,7 @@ namespace Ui
 
     class FrameRenderer
     {
-        QPixmap activeImage_;
+        QImage activeImage_;
         QColor fillColor_;
 
         std::function<void(const QSize _sz)> sizeCallback_;
@@ -502,8 +548,10 @@ namespace Ui
 
     public:
 
-        void updateFrame(QPixmap _image);
+        void updateFrame(QImage _image);
+        void updateFrame(const QPixmap& _image);
         QPixmap getActiveImage() const;
+        const QImage& getActiveFrame() const;
 
         bool isActiveImageNull() const;
 
@@ -632,7 +680,7 @@ namespace Ui
         std::unordered_set<uint32_t> active_video_ids_;
 
         DemuxThread demuxThread_;
-        VideoDecodeThread videoDecodeThread_;
+        std::vector<std::unique_ptr<VideoDecodeThread>> videoDecodeThreads_;
         AudioDecodeThread audioDecodeThread_;
 
         void DemuxThreadWait();
@@ -674,13 +722,13 @@ namespace Ui
 
         struct DecodedFrame
         {
-            QPixmap image_;
+            QImage image_;
 
             double pts_;
 
             bool eof_;
 
-            DecodedFrame(const QPixmap& _image, const double _pts) : image_(_image), pts_(_pts), eof_(false) {}
+            DecodedFrame(const QImage& _image, const double _pts) : image_(_image), pts_(_pts), eof_(false) {}
             DecodedFrame(bool _eof) : eof_(_eof) {}
         };
 
@@ -720,6 +768,7 @@ namespace Ui
 
         void updateVideoPosition(const DecodedFrame& _frame);
         bool canPause() const;
+        decode_priority getDecodePriority() const;
 
         FrameRenderer* CreateRenderer(QWidget* _parent, bool _openGL);
 
@@ -796,6 +845,7 @@ namespace Ui
 
         void setPreview(QPixmap _preview);
         QPixmap getActiveImage() const;
+        const QImage& getActiveFrame() const;
 
         bool getStarted() const;
         void setStarted(bool _started);
@@ -1060,6 +1060,11 @@ namespace Ui
         return ffplayer_->getActiveImage();
     }
 
+    const QImage& DialogPlayer::getActiveFrame() const
+    {
+        return ffplayer_->getActiveFrame();
+    }
+
     void DialogPlayer::onLoaded()
     {
         emit loaded();
@@ -192,6 +192,7 @@ namespace Ui
 
         void setPreview(QPixmap _preview);
         QPixmap getActiveImage() const;
+        const QImage& getActiveFrame() const;
 
         void setLoadingState(bool _isLoad);
 
@@ -17,6 +17,7 @@
 #include "../../utils/gui_coll_helper.h"
 #include "../../utils/InterConnector.h"
 #include "../../utils/utils.h"
+#include "../../utils/profiling/auto_stop_watch.h"
 
 namespace Ui
 {
@@ -147,27 +148,6 @@ namespace Ui
         return nullptr;
     }
 
-    QVariant EmojiViewItemModel::data(const QModelIndex& _idx, int _role) const
-    {
-        if (_role == Qt::DecorationRole)
-        {
-            int index = _idx.row() * columnCount() + _idx.column();
-            if (index < getEmojisCount())
-            {
-                auto emoji = getEmoji(_idx.column(), _idx.row());
-                if (emoji)
-                {
-                    auto emoji_ = Emoji::GetEmoji(emoji->Codepoint_, emoji->ExtendedCodepoint_, getPickerEmojiSize());
-                    QPixmap emojiPixmap = QPixmap::fromImage(emoji_);
-                    Utils::check_pixel_ratio(emojiPixmap);
-                    return emojiPixmap;
-                }
-            }
-        }
-
-        return QVariant();
-    }
-
     int EmojiViewItemModel::addCategory(const QString& _category)
     {
         const Emoji::EmojiRecordSptrVec& emojisVector = Emoji::GetEmojiInfoByCategory(_category);
@@ -267,7 +247,7 @@ namespace Ui
     // TableView class
     //////////////////////////////////////////////////////////////////////////
     EmojiTableView::EmojiTableView(QWidget* _parent, EmojiViewItemModel* _model)
-        : QTableView(_parent), model_(_model), itemDelegate_(new EmojiTableItemDelegate(this))
+        : QTableView(_parent), model_(_model), itemDelegate_(new EmojiTableItemDelegate(this)), firstPaintDone_(false)
     {
         setModel(model_);
         setItemDelegate(itemDelegate_);
@@ -281,12 +261,32 @@ namespace Ui
         setFocusPolicy(Qt::NoFocus);
         setSelectionMode(QAbstractItemView::NoSelection);
         setCursor(QCursor(Qt::PointingHandCursor));
+
+        connect(Emoji::GetAtlasNotifier(), &Emoji::EmojiAtlasNotifier::atlasReady, this, [this](const int _sizePx)
+        {
+            if (_sizePx == (int)getPickerEmojiSize())
+                viewport()->update();
+        });
     }
 
     EmojiTableView::~EmojiTableView()
     {
     }
 
+    void EmojiTableView::paintEvent(QPaintEvent* _e)
+    {
+        if (!firstPaintDone_)
+        {
+            firstPaintDone_ = true;
+
+            Profiling::auto_stop_watch watch("smiles_menu/emoji/first_paint");
+            QTableView::paintEvent(_e);
+            return;
+        }
+
+        QTableView::paintEvent(_e);
+    }
+
     void EmojiTableView::resizeEvent(QResizeEvent * _e)
     {
         if (model_->resize(_e->size()))
@@ -352,9 +352,15 @@ namespace Ui
     void EmojiTableItemDelegate::paint(QPainter* _painter, const QStyleOptionViewItem&, const QModelIndex& _index) const
     {
         const EmojiViewItemModel *itemModel = (EmojiViewItemModel *)_index.model();
-        QPixmap data = _index.data(Qt::DecorationRole).value<QPixmap>();
         int col = _index.column();
         int row = _index.row();
+        if ((row * itemModel->columnCount() + col) >= itemModel->getEmojisCount())
+            return;
+
+        const auto emoji = itemModel->getEmoji(col, row);
+        if (!emoji)
+            return;
+
         int spacing = itemModel->spacing();
         int size = (int)getPickerEmojiSize() / Utils::scale_bitmap(1);
         int smileSize = size;
@@ -365,7 +371,8 @@ namespace Ui
             addSize = (smileSize - size) / 2;
         }
 
-        _painter->drawPixmap(col * (smileSize + Utils::scale_value(spacing)) + addSize, row * (smileSize + Utils::scale_value(spacing)) + addSize, size, size, data);
+        const QRect target(col * (smileSize + Utils::scale_value(spacing)) + addSize, row * (smileSize + Utils::scale_value(spacing)) + addSize, size, size);
+        Emoji::DrawEmoji(*_painter, target, emoji->Codepoint_, emoji->ExtendedCodepoint_, getPickerEmojiSize());
     }
 
     QSize EmojiTableItemDelegate::sizeHint(const QStyleOptionViewItem&, const QModelIndex&) const
@@ -65,8 +65,6 @@ namespace Ui
 
             std::vector<emoji_category> emojiCategories_;
 
-            QVariant data(const QModelIndex& _idx, int _role) const;
-
         public:
 
             EmojiViewItemModel(QWidget* _parent, bool _singleLine = false);
@@ -120,6 +118,11 @@ namespace Ui
         {
             EmojiViewItemModel* model_;
             EmojiTableItemDelegate* itemDelegate_;
+            bool firstPaintDone_;
+
+        protected:
+
+            void paintEvent(QPaintEvent* _e) override;
 
         public:
 
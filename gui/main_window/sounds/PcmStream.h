@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ui
+{
+    typedef std::vector<char> PcmChunk;
+
+    // A fixed ring of device buffers: a buffer is filled and queued, and comes back once it has been played.
+    // The openal one is in SoundsManager.cpp.
+    class AudioBackend
+    {
+    public:
+        virtual ~AudioBackend() {}
+
+        virtual int buffersCount() const = 0;
+
+        // takes the played buffers back, returns their number
+        virtual int unqueueProcessed() = 0;
+
+        virtual void queue(const PcmChunk& _pcm) = 0;
+
+        // the device has played all the queued buffers and stopped
+        virtual bool isStopped() const = 0;
+
+        virtual void play() = 0;
+    };
+
+    // plays nothing and instantly: every buffer queued is processed by the next unqueue
+    class NullAudioBackend : public AudioBackend
+    {
+    public:
+        explicit NullAudioBackend(const int _buffersCount)
+            : BuffersCount_(_buffersCount)
+            , Queued_(0)
+            , MaxQueued_(0)
+            , PlayedBytes_(0)
+            , PlayCount_(0)
+        {
+        }
+
+        int buffersCount() const override { return BuffersCount_; }
+
+        int unqueueProcessed() override
+        {
+            const auto processed = Queued_;
+            Queued_ = 0;
+            return processed;
+        }
+
+        void queue(const PcmChunk& _pcm) override
+        {
+            if (KeepPlayed_)
+                Played_.insert(Played_.end(), _pcm.begin(), _pcm.end());
+
+            PlayedBytes_ += _pcm.size();
+
+            ++Queued_;
+            MaxQueued_ = std::max(MaxQueued_, Queued_);
+        }
+
+        bool isStopped() const override { return true; }
+
+        void play() override { ++PlayCount_; }
+
+        int maxQueued() const { return MaxQueued_; }
+
+        size_t playedBytes() const { return PlayedBytes_; }
+
+        int playCount() const { return PlayCount_; }
+
+        // the played data is kept only when asked to, a long stream would hold all of it otherwise
+        void keepPlayed(const bool _keep) { KeepPlayed_ = _keep; }
+
+        const PcmChunk& played() const { return Played_; }
+
+    private:
+        const int BuffersCount_;
+        int Queued_;
+        int MaxQueued_;
+        size_t PlayedBytes_;
+        int PlayCount_;
+        bool KeepPlayed_ = false;
+        PcmChunk Played_;
+    };
+
+    // Decoded pcm on its way from the decoding thread to the player. It holds a few chunks at most,
+    // so a voice message of any length takes the same memory; the decoder waits while the queue is full.
+    class PcmStream
+    {
+    public:
+        // appends the next decoded portion, false at the end of the data or on an error
+        typedef std::function<bool(PcmChunk& _pcm)> DecodeFunction;
+
+        PcmStream(const size_t _chunkSize, const size_t _maxChunks)
+            : ChunkSize_(_chunkSize)
+            , MaxChunks_(_maxChunks)
+            , MaxQueued_(0)
+            , Decoded_(false)
+            , Cancelled_(false)
+        {
+        }
+
+        // decodes a chunk and queues it, false once there is nothing more to decode
+        bool decodeChunk(const DecodeFunction& _decode)
+        {
+            PcmChunk pcm;
+            pcm.reserve(ChunkSize_);
+
+            auto hasMore = true;
+            while (pcm.size() < ChunkSize_ && (hasMore = _decode(pcm)));
+
+            std::unique_lock<std::mutex> lock(Mutex_);
+
+            if (!pcm.empty())
+            {
+                Space_.wait(lock, [this]() { return Cancelled_ || Chunks_.size() < MaxChunks_; });
+
+                if (!Cancelled_)
+                {
+                    Chunks_.push_back(std::move(pcm));
+                    MaxQueued_ = std::max(MaxQueued_, Chunks_.size());
+                }
+            }
+
+            if (!hasMore || Cancelled_)
+            {
+                Decoded_ = true;
+                return false;
+            }
+
+            return true;
+        }
+
+        void decode(const DecodeFunction& _decode)
+        {
+            while (decodeChunk(_decode));
+        }
+
+        void cancel()
+        {
+            std::lock_guard<std::mutex> lock(Mutex_);
+            Cancelled_ = true;
+            Chunks_.clear();
+            Space_.notify_all();
+        }
+
+        // never waits for the decoder
+        bool pop(PcmChunk& _pcm)
+        {
+            std::lock_guard<std::mutex> lock(Mutex_);
+
+            if (Chunks_.empty())
+                return false;
+
+            _pcm = std::move(Chunks_.front());
+            Chunks_.pop_front();
+            Space_.notify_one();
+
+            return true;
+        }
+
+        // everything has been decoded and taken by the player
+        bool isFinished() const
+        {
+            std::lock_guard<std::mutex> lock(Mutex_);
+            return Decoded_ && Chunks_.empty();
+        }
+
+        size_t maxQueued() const
+        {
+            std::lock_guard<std::mutex> lock(Mutex_);
+            return MaxQueued_;
+        }
+
+    private:
+        const size_t ChunkSize_;
+        const size_t MaxChunks_;
+
+        mutable std::mutex Mutex_;
+        std::condition_variable Space_;
+        std::deque<PcmChunk> Chunks_;
+        size_t MaxQueued_;
+        bool Decoded_;
+        bool Cancelled_;
+    };
+
+    // Decodes on its own thread and keeps the backend ring filled; pump() is called periodically by the player.
+    // The first chunk is decoded right away, so the playback starts without waiting for the rest.
+    class PcmPlayer
+    {
+    public:
+        PcmPlayer(std::unique_ptr<AudioBackend> _backend, const size_t _chunkSize, const size_t _maxChunks)
+            : Backend_(std::move(_backend))
+            , Stream_(_chunkSize, _maxChunks)
+            , FreeBuffers_(Backend_->buffersCount())
+        {
+        }
+
+        ~PcmPlayer()
+        {
+            Stream_.cancel();
+
+            if (Decoder_.joinable())
+                Decoder_.join();
+        }
+
+        PcmPlayer(const PcmPlayer&) = delete;
+        PcmPlayer& operator=(const PcmPlayer&) = delete;
+
+        void start(const PcmStream::DecodeFunction& _decode)
+        {
+            if (Stream_.decodeChunk(_decode))
+                Decoder_ = std::thread([this, _decode]() { Stream_.decode(_decode); });
+
+            pump();
+        }
+
+        void pump()
+        {
+            FreeBuffers_ += Backend_->unqueueProcessed();
+
+            auto queued = false;
+
+            PcmChunk pcm;
+            while (FreeBuffers_ > 0 && Stream_.pop(pcm))
+            {
+                Backend_->queue(pcm);
+                --FreeBuffers_;
+                queued = true;
+            }
+
+            // the device stops once it runs out of buffers, it is started again when the decoder catches up
+            if (queued && Started_ && Backend_->isStopped())
+                Backend_->play();
+        }
+
+        // a stop of the device while this is true is an underrun, not the end of the data
+        bool isBuffering() const
+        {
+            return !Stream_.isFinished();
+        }
+
+        // the device is restarted on underruns only once it has been started by the player
+        void setStarted()
+        {
+            Started_ = true;
+        }
+
+        AudioBackend& backend() { return *Backend_; }
+
+        const PcmStream& stream() const { return Stream_; }
+
+    private:
+        std::unique_ptr<AudioBackend> Backend_;
+        PcmStream Stream_;
+        int FreeBuffers_;
+        bool Started_ = false;
+        std::thread Decoder_;
+    };
+}
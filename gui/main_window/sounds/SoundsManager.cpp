@@ -6,6 +6,7 @@
 #include "../../utils/InterConnector.h"
 
 #include "MpegLoader.h"
+#include "PcmStream.h"
 
 namespace openal
 {
@@ -17,6 +18,123 @@ const int IncomingMessageInterval = 3000;
 const int PttCheckInterval = 100;
 const int DeviceCheckInterval = 60 * 1000;
 
+// a voice message is played from a ring of buffers, about a third of a second of 48 kHz stereo each,
+// with as many chunks decoded ahead
+const int PttBuffersCount = 4;
+const size_t PttChunkSize = 64 * 1024;
+const size_t PttDecodedChunks = 4;
+
+namespace
+{
+    struct DecodedSound
+    {
+        DecodedSound()
+            : Frequency_(0)
+            , Format_(0)
+        {
+        }
+
+        QByteArray Pcm_;
+        qint64 Frequency_;
+        qint64 Format_;
+    };
+
+    // the notification sounds are decoded once, a device change only reloads them to the new buffers
+    const DecodedSound& getDecodedSound(const QString& _resource)
+    {
+        static QHash<QString, DecodedSound> sounds;
+
+        const auto iter = sounds.constFind(_resource);
+        if (iter != sounds.constEnd())
+            return *iter;
+
+        DecodedSound sound;
+
+        Ui::MpegLoader l(_resource, true);
+        if (l.open())
+        {
+            sound.Frequency_ = l.frequency();
+            sound.Format_ = l.format();
+
+            qint64 samplesAdded = 0;
+            while (l.readMore(sound.Pcm_, samplesAdded) >= 0);
+        }
+
+        return *sounds.insert(_resource, sound);
+    }
+
+    class OpenAlBackend : public Ui::AudioBackend
+    {
+    public:
+        OpenAlBackend(openal::ALuint _source, openal::ALenum _format, openal::ALsizei _frequency)
+            : Source_(_source)
+            , Format_(_format)
+            , Frequency_(_frequency)
+            , Buffers_(PttBuffersCount, 0)
+        {
+            openal::alGenBuffers((openal::ALsizei)Buffers_.size(), Buffers_.data());
+            Free_ = Buffers_;
+        }
+
+        ~OpenAlBackend()
+        {
+            openal::alSourceStop(Source_);
+            openal::alSourcei(Source_, AL_BUFFER, 0);
+            openal::alDeleteBuffers((openal::ALsizei)Buffers_.size(), Buffers_.data());
+        }
+
+        int buffersCount() const override
+        {
+            return (int)Buffers_.size();
+        }
+
+        int unqueueProcessed() override
+        {
+            openal::ALint processed = 0;
+            openal::alGetSourcei(Source_, AL_BUFFERS_PROCESSED, &processed);
+
+            for (auto i = 0; i < processed; ++i)
+            {
+                openal::ALuint buffer = 0;
+                openal::alSourceUnqueueBuffers(Source_, 1, &buffer);
+                Free_.push_back(buffer);
+            }
+
+            return processed;
+        }
+
+        void queue(const Ui::PcmChunk& _pcm) override
+        {
+            assert(!Free_.empty());
+
+            const auto buffer = Free_.back();
+            Free_.pop_back();
+
+            openal::alBufferData(buffer, Format_, _pcm.data(), (openal::ALsizei)_pcm.size(), Frequency_);
+            openal::alSourceQueueBuffers(Source_, 1, &buffer);
+        }
+
+        bool isStopped() const override
+        {
+            openal::ALint state = AL_NONE;
+            openal::alGetSourcei(Source_, AL_SOURCE_STATE, &state);
+            return (state == AL_STOPPED);
+        }
+
+        void play() override
+        {
+            Ui::GetSoundsManager()->sourcePlay(Source_);
+        }
+
+    private:
+        const openal::ALuint Source_;
+        const openal::ALenum Format_;
+        const openal::ALsizei Frequency_;
+        std::vector<openal::ALuint> Buffers_;
+        std::vector<openal::ALuint> Free_;
+    };
+}
+
 namespace Ui
 {
     void PlayingData::init()
@@ -36,13 +154,36 @@ namespace Ui
         openal::alSourcei(Source_, AL_BUFFER, Buffer_);
     }
 
+    void PlayingData::setStream(std::shared_ptr<PcmPlayer> stream, int duration)
+    {
+        Stream_ = std::move(stream);
+        Duration_ = duration;
+    }
+
+    void PlayingData::pump()
+    {
+        if (Stream_)
+            Stream_->pump();
+    }
+
+    bool PlayingData::isBuffering() const
+    {
+        return Stream_ && Stream_->isBuffering();
+    }
+
     int PlayingData::play()
     {
         if (isEmpty())
             return 0;
 
         auto duration = calcDuration();
+
+        pump();
         GetSoundsManager()->sourcePlay(Source_);
+
+        if (Stream_)
+            Stream_->setStarted();
+
         return duration;
     }
 
@@ -60,6 +201,10 @@ namespace Ui
             return;
 
         openal::alSourceStop(Source_);
+
+        // the streamed buffers are detached and deleted with the stream
+        Stream_.reset();
+
         if (openal::alIsBuffer(Buffer_))
         {
             openal::alSourcei(Source_, AL_BUFFER, 0);
@@ -72,6 +217,8 @@ namespace Ui
         Buffer_ = 0;
         Source_ = 0;
         Id_ = -1;
+        Stream_.reset();
+        Duration_ = 0;
     }
 
     void PlayingData::free()
@@ -98,6 +245,9 @@ namespace Ui
 
     int PlayingData::calcDuration()
     {
+        if (Stream_)
+            return Duration_;
+
         openal::ALint sizeInBytes;
         openal::ALint channels;
         openal::ALint bits;
@@ -183,9 +333,15 @@ namespace Ui
     {
         if (CurPlay_.Source_ != 0)
         {
+            CurPlay_.pump();
+
             openal::ALenum state;
             openal::alGetSourcei(CurPlay_.Source_, AL_SOURCE_STATE, &state);
-            if (state == AL_PLAYING || state == AL_INITIAL)
+
+            // a source that ran out of buffers while the message is still being decoded is restarted by the pump
+            const auto isUnderrun = (state == AL_STOPPED && CurPlay_.isBuffering());
+
+            if (state == AL_PLAYING || state == AL_INITIAL || isUnderrun)
             {
                 PttTimer_->start();
             }
@@ -326,20 +482,35 @@ namespace Ui
 
         CurPlay_.init();
 
-        MpegLoader l(file, false);
-        if (!l.open())
+        auto loader = std::make_shared<MpegLoader>(file, false);
+        if (!loader->open())
             return -1;
 
-        QByteArray result;
-        qint64 samplesAdded = 0, frequency = l.frequency(), format = l.format();
-        while (1)
+        const auto frequency = loader->frequency();
+        const auto pttDuration = (frequency > 0 ? (int)(loader->duration() * 1000 / frequency) : 0);
+
+        auto stream = std::make_shared<PcmPlayer>(
+            std::make_unique<OpenAlBackend>(CurPlay_.Source_, loader->format(), frequency),
+            PttChunkSize,
+            PttDecodedChunks);
+
+        // the first chunk is decoded here, the rest is decoded on the stream thread while playing
+        stream->start([loader](PcmChunk& _pcm)
         {
-            int res = l.readMore(result, samplesAdded);
-            if (res < 0)
-                break;
-        }
+            QByteArray decoded;
+            qint64 samplesAdded = 0;
+
+            while (decoded.isEmpty())
+            {
+                if (loader->readMore(decoded, samplesAdded) < 0)
+                    return false;
+            }
 
-        CurPlay_.setBuffer(result, frequency, format);
+            _pcm.insert(_pcm.end(), decoded.constData(), decoded.constData() + decoded.size());
+            return true;
+        });
+
+        CurPlay_.setStream(std::move(stream), pttDuration);
 
         CurPlay_.Id_ = ++AlId;
         duration = CurPlay_.play();
@@ -401,97 +572,37 @@ namespace Ui
 
     void SoundsManager::initIncomig()
     {
-        if (!AlInited_)
-            initOpenAl();
-
-        if (!Incoming_.isEmpty())
-            return;
-
-        Incoming_.init();
-
-        MpegLoader l(build::is_icq() ? qsl(":/sounds/incoming") : qsl(":/sounds/incoming_agent"), true);
-        if (!l.open())
-            return;
-
-        QByteArray result;
-        qint64 samplesAdded = 0, frequency = l.frequency(), format = l.format();
-        while (1)
-        {
-            int res = l.readMore(result, samplesAdded);
-            if (res < 0)
-                break;
-        }
-
-        Incoming_.setBuffer(result, frequency, format);
-
-        int err;
-        if ((err = openal::alGetError()) == AL_NO_ERROR)
-        {
-            Incoming_.Id_ = ++AlId;
-        }
+        initSound(Incoming_, build::is_icq() ? qsl(":/sounds/incoming") : qsl(":/sounds/incoming_agent"));
     }
 
     void SoundsManager::initMail()
     {
-        if (!AlInited_)
-            initOpenAl();
-
-        if (!Mail_.isEmpty())
-            return;
-
-        Mail_.init();
-
-        MpegLoader l(qsl(":/sounds/mail"), true);
-        if (!l.open())
-            return;
-
-        QByteArray result;
-        qint64 samplesAdded = 0, frequency = l.frequency(), format = l.format();
-        while (1)
-        {
-            int res = l.readMore(result, samplesAdded);
-            if (res < 0)
-                break;
-        }
-
-        Mail_.setBuffer(result, frequency, format);
-
-        int err;
-        if ((err = openal::alGetError()) == AL_NO_ERROR)
-        {
-            Mail_.Id_ = ++AlId;
-        }
+        initSound(Mail_, qsl(":/sounds/mail"));
     }
 
     void SoundsManager::initOutgoing()
+    {
+        initSound(Outgoing_, qsl(":/sounds/outgoing"));
+    }
+
+    void SoundsManager::initSound(PlayingData& _sound, const QString& _resource)
     {
         if (!AlInited_)
             initOpenAl();
 
-        if (!Outgoing_.isEmpty())
+        if (!_sound.isEmpty())
             return;
 
-        Outgoing_.init();
-
-        MpegLoader l(qsl(":/sounds/outgoing"), true);
-        if (!l.open())
+        const auto& decoded = getDecodedSound(_resource);
+        if (decoded.Pcm_.isEmpty())
             return;
 
-        QByteArray result;
-        qint64 samplesAdded = 0, frequency = l.frequency(), format = l.format();
-        while (1)
-        {
-            int res = l.readMore(result, samplesAdded);
-            if (res < 0)
-                break;
-        }
-
-        Outgoing_.setBuffer(result, frequency, format);
+        _sound.init();
+        _sound.setBuffer(decoded.Pcm_, decoded.Frequency_, decoded.Format_);
 
-        int err;
-        if ((err = openal::alGetError()) == AL_NO_ERROR)
+        if (openal::alGetError() == AL_NO_ERROR)
         {
-            Outgoing_.Id_ = ++AlId;
+            _sound.Id_ = ++AlId;
         }
     }
 
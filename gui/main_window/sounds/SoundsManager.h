@@ -2,17 +2,23 @@
 
 namespace Ui
 {
+    class PcmPlayer;
+
     struct PlayingData
     {
         PlayingData()
             : Source_(0)
             , Buffer_(0)
             , Id_(-1)
+            , Duration_(0)
         {
         }
 
         void init();
         void setBuffer(const QByteArray& data, qint64 freq, qint64 fmt);
+        void setStream(std::shared_ptr<PcmPlayer> stream, int duration);
+        void pump();
+        bool isBuffering() const;
         int play();
         void pause();
         void stop();
@@ -26,6 +32,10 @@ namespace Ui
         openal::ALuint Source_;
         openal::ALuint Buffer_;
         int Id_;
+
+        // a voice message is streamed to the source instead of the single buffer
+        std::shared_ptr<PcmPlayer> Stream_;
+        int Duration_;
     };
 
     class SoundsManager : public QObject
@@ -68,6 +78,8 @@ Q_SIGNALS:
         void updateDeviceTimer();
 
     private:
+        void initSound(PlayingData& _sound, const QString& _resource);
+
         bool CallInProgress_;
         bool CanPlayIncoming_;
 
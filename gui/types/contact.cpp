@@ -4,6 +4,20 @@
 #include "../../corelib/collection_helper.h"
 
 
+namespace
+{
+    void UnserializeState(const core::coll_helper& value, Data::Buddy& buddy)
+    {
+        const qlonglong lastSeen = value.get_value_as_int("lastseen");
+        const QString state = QString::fromUtf8(value.get_value_as_string("state"));
+        buddy.State_ = (lastSeen <= 0 || state == ql1s("mobile")) ? state : qsl("offline");
+        if (buddy.State_ == ql1s("mobile") && lastSeen == 0)
+            buddy.State_ = qsl("online");
+        buddy.HasLastSeen_ = lastSeen != -1;
+        buddy.LastSeen_ = lastSeen > 0 ? QDateTime::fromTime_t(uint(lastSeen)) : QDateTime();
+    }
+}
+
 namespace Data
 {
 
@@ -30,20 +44,14 @@ namespace Data
 			for (int icontacts = 0; icontacts < contacts->size(); ++icontacts)
 			{
 				core::coll_helper value(contacts->get_at(icontacts)->get_as_collection(), false);
-                qlonglong lastSeen = value.get_value_as_int("lastseen");
                 auto contact = std::make_shared<Contact>();
 				contact->AimId_ = QString::fromUtf8(value.get_value_as_string("aimId"));
 				contact->Friendly_ = QString::fromUtf8(value.get_value_as_string("friendly"));
 				contact->AbContactName_ = QString::fromUtf8(value.get_value_as_string("abContactName"));
-                const QString state = QString::fromUtf8(value.get_value_as_string("state"));
-                contact->State_ = (lastSeen <= 0 || state == ql1s("mobile")) ? state : qsl("offline");
-                if (contact->State_ == ql1s("mobile") && lastSeen == 0)
-                    contact->State_ = qsl("online");
+                UnserializeState(value, *contact);
 				contact->UserType_ = QString::fromUtf8(value.get_value_as_string("userType"));
 				contact->StatusMsg_ = QString::fromUtf8(value.get_value_as_string("statusMsg"));
 				contact->OtherNumber_ = QString::fromUtf8(value.get_value_as_string("otherNumber"));
-				contact->HasLastSeen_ = lastSeen != -1;
-                contact->LastSeen_ = lastSeen > 0 ? QDateTime::fromTime_t(uint(lastSeen)) : QDateTime();
 				contact->Is_chat_ = value.get_value_as_bool("is_chat");
 				contact->GroupId_ = group->Id_;
 				contact->Muted_ = value.get_value_as_bool("mute");
@@ -59,6 +67,169 @@ namespace Data
 		}
 	}
 
+    void BuddyChanges::ApplyTo(Buddy& buddy) const
+    {
+        if (Fields_ & GroupId)
+            buddy.GroupId_ = Values_.GroupId_;
+        if (Fields_ & Friendly)
+            buddy.Friendly_ = Values_.Friendly_;
+        if (Fields_ & AbContactName)
+            buddy.AbContactName_ = Values_.AbContactName_;
+        if (Fields_ & State)
+        {
+            buddy.State_ = Values_.State_;
+            buddy.HasLastSeen_ = Values_.HasLastSeen_;
+            buddy.LastSeen_ = Values_.LastSeen_;
+        }
+        if (Fields_ & UserType)
+            buddy.UserType_ = Values_.UserType_;
+        if (Fields_ & StatusMsg)
+            buddy.StatusMsg_ = Values_.StatusMsg_;
+        if (Fields_ & OtherNumber)
+            buddy.OtherNumber_ = Values_.OtherNumber_;
+        if (Fields_ & IsChat)
+            buddy.Is_chat_ = Values_.Is_chat_;
+        if (Fields_ & Muted)
+            buddy.Muted_ = Values_.Muted_;
+        if (Fields_ & IsLiveChat)
+            buddy.IsLiveChat_ = Values_.IsLiveChat_;
+        if (Fields_ & IsOfficial)
+            buddy.IsOfficial_ = Values_.IsOfficial_;
+        if (Fields_ & IconId)
+            buddy.iconId_ = Values_.iconId_;
+        if (Fields_ & BigIconId)
+            buddy.bigIconId_ = Values_.bigIconId_;
+        if (Fields_ & LargeIconId)
+            buddy.largeIconId_ = Values_.largeIconId_;
+        if (Fields_ & OutgoingMsgCount)
+            buddy.OutgoingMsgCount_ = Values_.OutgoingMsgCount_;
+    }
+
+    void UnserializeContactListDelta(core::coll_helper* helper, ContactListDelta& delta)
+    {
+        delta.Revision_ = helper->get_value_as_int64("revision");
+        delta.BaseRevision_ = helper->get_value_as_int64("base_revision");
+
+        std::map<int, GroupBuddyPtr> groups;
+
+        core::iarray* groupsArray = helper->get_value_as_array("groups");
+        for (int i = 0; i < groupsArray->size(); ++i)
+        {
+            core::coll_helper group_coll(groupsArray->get_at(i)->get_as_collection(), false);
+            auto group = std::make_shared<GroupBuddy>();
+            group->Id_ = group_coll.get_value_as_int("group_id");
+            group->Name_ = QString::fromUtf8(group_coll.get_value_as_string("group_name"));
+            group->Added_ = true;
+            groups[group->Id_] = group;
+            delta.Groups_.push_back(group);
+        }
+
+        core::iarray* added = helper->get_value_as_array("added");
+        for (int i = 0; i < added->size(); ++i)
+        {
+            core::coll_helper value(added->get_at(i)->get_as_collection(), false);
+
+            auto& group = groups[value.get_value_as_int("group_id")];
+            if (!group)
+            {
+                group = std::make_shared<GroupBuddy>();
+                group->Id_ = value.get_value_as_int("group_id");
+            }
+
+            auto contact = std::make_shared<Contact>();
+            contact->AimId_ = QString::fromUtf8(value.get_value_as_string("aimId"));
+            contact->Friendly_ = QString::fromUtf8(value.get_value_as_string("friendly"));
+            contact->AbContactName_ = QString::fromUtf8(value.get_value_as_string("abContactName"));
+            UnserializeState(value, *contact);
+            contact->UserType_ = QString::fromUtf8(value.get_value_as_string("userType"));
+            contact->StatusMsg_ = QString::fromUtf8(value.get_value_as_string("statusMsg"));
+            contact->OtherNumber_ = QString::fromUtf8(value.get_value_as_string("otherNumber"));
+            contact->Is_chat_ = value.get_value_as_bool("is_chat");
+            contact->GroupId_ = group->Id_;
+            contact->Muted_ = value.get_value_as_bool("mute");
+            contact->IsLiveChat_ = value.get_value_as_bool("livechat");
+            contact->IsOfficial_ = value.get_value_as_bool("official");
+            contact->iconId_ = QString::fromUtf8(value.get_value_as_string("iconId"));
+            contact->bigIconId_ = QString::fromUtf8(value.get_value_as_string("bigIconId"));
+            contact->largeIconId_ = QString::fromUtf8(value.get_value_as_string("largeIconId"));
+            contact->OutgoingMsgCount_ = value.get_value_as_int("outgoingCount");
+
+            delta.Added_.insert(contact, group);
+        }
+
+        core::iarray* changed = helper->get_value_as_array("changed");
+        delta.Changed_.reserve(changed->size());
+        for (int i = 0; i < changed->size(); ++i)
+        {
+            core::coll_helper value(changed->get_at(i)->get_as_collection(), false);
+
+            BuddyChanges changes;
+            auto& buddy = changes.Values_;
+            buddy.AimId_ = QString::fromUtf8(value.get_value_as_string("aimId"));
+
+            const auto readString = [&value, &changes](const char* name, BuddyChanges::Field field, QString& result)
+            {
+                if (!value.is_value_exist(name))
+                    return;
+
+                result = QString::fromUtf8(value.get_value_as_string(name));
+                changes.Fields_ |= field;
+            };
+
+            const auto readBool = [&value, &changes](const char* name, BuddyChanges::Field field, bool& result)
+            {
+                if (!value.is_value_exist(name))
+                    return;
+
+                result = value.get_value_as_bool(name);
+                changes.Fields_ |= field;
+            };
+
+            if (value.is_value_exist("group_id"))
+            {
+                buddy.GroupId_ = value.get_value_as_int("group_id");
+                changes.Fields_ |= BuddyChanges::GroupId;
+            }
+
+            if (value.is_value_exist("state"))
+            {
+                UnserializeState(value, buddy);
+                changes.Fields_ |= BuddyChanges::State;
+            }
+
+            if (value.is_value_exist("outgoingCount"))
+            {
+                buddy.OutgoingMsgCount_ = value.get_value_as_int("outgoingCount");
+                changes.Fields_ |= BuddyChanges::OutgoingMsgCount;
+            }
+
+            readString("friendly", BuddyChanges::Friendly, buddy.Friendly_);
+            readString("abContactName", BuddyChanges::AbContactName, buddy.AbContactName_);
+            readString("userType", BuddyChanges::UserType, buddy.UserType_);
+            readString("statusMsg", BuddyChanges::StatusMsg, buddy.StatusMsg_);
+            readString("otherNumber", BuddyChanges::OtherNumber, buddy.OtherNumber_);
+            readString("iconId", BuddyChanges::IconId, buddy.iconId_);
+            readString("bigIconId", BuddyChanges::BigIconId, buddy.bigIconId_);
+            readString("largeIconId", BuddyChanges::LargeIconId, buddy.largeIconId_);
+            readBool("is_chat", BuddyChanges::IsChat, buddy.Is_chat_);
+            readBool("mute", BuddyChanges::Muted, buddy.Muted_);
+            readBool("livechat", BuddyChanges::IsLiveChat, buddy.IsLiveChat_);
+            readBool("official", BuddyChanges::IsOfficial, buddy.IsOfficial_);
+
+            delta.Changed_.push_back(changes);
+        }
+
+        core::iarray* removed = helper->get_value_as_array("removed");
+        delta.Removed_.reserve(removed->size());
+        for (int i = 0; i < removed->size(); ++i)
+            delta.Removed_.push_back(QString::fromUtf8(removed->get_at(i)->get_as_string()));
+
+        core::iarray* removedGroups = helper->get_value_as_array("removed_groups");
+        delta.RemovedGroups_.reserve(removedGroups->size());
+        for (int i = 0; i < removedGroups->size(); ++i)
+            delta.RemovedGroups_.push_back(removedGroups->get_at(i)->get_as_int());
+    }
+
 	QPixmap* UnserializeAvatar(core::coll_helper* helper)
 	{
 		if (helper->get_value_as_bool("result"))
@@ -198,8 +198,63 @@ namespace Data
 
 	typedef QMap<ContactPtr, GroupBuddyPtr> ContactList;
 
+    // fields of a buddy changed since the previous revision of the contact list
+    class BuddyChanges
+    {
+    public:
+        enum Field
+        {
+            GroupId = 1 << 0,
+            Friendly = 1 << 1,
+            AbContactName = 1 << 2,
+            State = 1 << 3,
+            UserType = 1 << 4,
+            StatusMsg = 1 << 5,
+            OtherNumber = 1 << 6,
+            IsChat = 1 << 7,
+            Muted = 1 << 8,
+            IsLiveChat = 1 << 9,
+            IsOfficial = 1 << 10,
+            IconId = 1 << 11,
+            BigIconId = 1 << 12,
+            LargeIconId = 1 << 13,
+            OutgoingMsgCount = 1 << 14
+        };
+
+        BuddyChanges()
+            : Fields_(0)
+        {
+        }
+
+        void ApplyTo(Buddy& buddy) const;
+
+        int Fields_;
+        Buddy Values_;
+    };
+
+    class ContactListDelta
+    {
+    public:
+        ContactListDelta()
+            : Revision_(0)
+            , BaseRevision_(0)
+        {
+        }
+
+        qint64 Revision_;
+        qint64 BaseRevision_;
+
+        ContactList Added_;
+        QVector<GroupBuddyPtr> Groups_;
+        QVector<BuddyChanges> Changed_;
+        QVector<QString> Removed_;
+        QVector<int> RemovedGroups_;
+    };
+
 	void UnserializeContactList(core::coll_helper* helper, ContactList& cl, QString& type);
 
+    void UnserializeContactListDelta(core::coll_helper* helper, ContactListDelta& delta);
+
 	QPixmap* UnserializeAvatar(core::coll_helper* helper);
 
 	BuddyPtr UnserializePresence(core::coll_helper* helper);
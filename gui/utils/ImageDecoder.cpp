@@ -0,0 +1,157 @@
+#include "stdafx.h"
+
+#include <QtCore/qcache.h>
+
+#include "exif.h"
+
+#include "ImageDecoder.h"
+
+namespace
+{
+    const int decodedImagesBudget = 64 * 1024 * 1024;
+
+    // a picture shown at full size would wash the previews out of the cache
+    const int decodedImageMaxCost = decodedImagesBudget / 8;
+
+    struct DecodedImages
+    {
+        DecodedImages()
+            : Images_(decodedImagesBudget)
+        {
+        }
+
+        QMutex Mutex_;
+
+        QCache<QString, QPixmap> Images_;
+    };
+
+    DecodedImages& getDecodedImages()
+    {
+        static DecodedImages images;
+        return images;
+    }
+
+    QString makeKey(const QString& _path, const QSize& _maxSize)
+    {
+        // a file rewritten under the same name gets a new key
+        const QFileInfo fileInfo(_path);
+
+        return _path % ql1c('|') %
+            QString::number(fileInfo.lastModified().toMSecsSinceEpoch()) % ql1c('|') %
+            QString::number(_maxSize.width()) % ql1c('x') % QString::number(_maxSize.height());
+    }
+
+    QSize getScaledSize(const QSize& _genuineSize, const QSize& _maxSize)
+    {
+        const auto maxWidth = (_maxSize.width() > 0 ? _maxSize.width() : _genuineSize.width());
+        const auto maxHeight = (_maxSize.height() > 0 ? _maxSize.height() : _genuineSize.height());
+
+        if (_genuineSize.width() <= maxWidth && _genuineSize.height() <= maxHeight)
+        {
+            return _genuineSize;
+        }
+
+        return _genuineSize.scaled(maxWidth, maxHeight, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    }
+}
+
+namespace Utils
+{
+    QImage decodeImage(const QByteArray& _data, const QSize& _maxSize)
+    {
+        if (_data.isEmpty())
+        {
+            return QImage();
+        }
+
+        QBuffer buffer;
+        buffer.setData(_data);
+        buffer.open(QIODevice::ReadOnly);
+
+        QImageReader reader(&buffer);
+        reader.setDecideFormatFromContent(true);
+
+        const auto orientation = Exif::getExifOrientation(_data.constData(), (size_t)_data.size());
+
+        const auto genuineSize = reader.size();
+        if (genuineSize.isValid())
+        {
+            // the reader works on the picture as stored, not as shown
+            auto maxSize = _maxSize;
+            if (Exif::isTransposed(orientation))
+            {
+                maxSize.transpose();
+            }
+
+            // the jpeg plugin decodes at the smallest 1/2, 1/4 or 1/8 scale still covering scaledSize, then resizes to it
+            const auto scaledSize = getScaledSize(genuineSize, maxSize);
+            if (scaledSize != genuineSize)
+            {
+                reader.setScaledSize(scaledSize);
+            }
+        }
+
+        QImage image;
+        if (!reader.read(&image))
+        {
+            return QImage();
+        }
+
+        Exif::applyExifOrientation(orientation, InOut image);
+
+        return image;
+    }
+
+    bool findDecodedImage(const QString& _path, const QSize& _maxSize, Out QPixmap& _pixmap)
+    {
+        assert(!_path.isEmpty());
+
+        const auto key = makeKey(_path, _maxSize);
+
+        auto &images = getDecodedImages();
+
+        QMutexLocker lock(&images.Mutex_);
+
+        const auto image = images.Images_.object(key);
+        if (!image)
+        {
+            return false;
+        }
+
+        _pixmap = *image;
+
+        return true;
+    }
+
+    void cacheDecodedImage(const QString& _path, const QSize& _maxSize, const QPixmap& _pixmap)
+    {
+        assert(!_path.isEmpty());
+        assert(!_pixmap.isNull());
+
+        const auto cost = (_pixmap.width() * _pixmap.height() * (_pixmap.depth() / 8));
+        if (cost > decodedImageMaxCost)
+        {
+            return;
+        }
+
+        const auto key = makeKey(_path, _maxSize);
+
+        auto &images = getDecodedImages();
+
+        QMutexLocker lock(&images.Mutex_);
+
+        images.Images_.insert(key, new QPixmap(_pixmap), cost);
+    }
+
+    QThreadPool* getImageDecodePool()
+    {
+        static QThreadPool *pool = nullptr;
+        if (!pool)
+        {
+            pool = new QThreadPool(qApp);
+            pool->setMaxThreadCount(std::max(2, QThread::idealThreadCount() / 2));
+        }
+
+        return pool;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace Utils
+{
+    // decodes a picture straight to the size it is shown at: the format is sniffed from the content once,
+    // jpeg is downscaled in the dct domain and the exif orientation is applied to the small image;
+    // _maxSize is the box for the picture as shown, a non-positive side is not limited.
+    // The downscale saves the inverse dct, the upsampling and the memory of the full picture, not the huffman
+    // decoding, which stays proportional to the file size; so the decoded pictures are cached as well
+    QImage decodeImage(const QByteArray& _data, const QSize& _maxSize);
+
+    // the decoded pictures are kept by (file, size) until the least recently used ones
+    // no longer fit the memory budget; safe to call from the decode tasks
+    bool findDecodedImage(const QString& _path, const QSize& _maxSize, Out QPixmap& _pixmap);
+
+    void cacheDecodedImage(const QString& _path, const QSize& _maxSize, const QPixmap& _pixmap);
+
+    // the pictures of a chat are decoded here, so a screen of photos can not occupy the global pool
+    QThreadPool* getImageDecodePool();
+}
@@ -0,0 +1,80 @@
+#include "stdafx.h"
+
+#include "../../corelib/collection_helper.h"
+
+#include "LoadAvatarFromDataTask.h"
+
+namespace
+{
+    const int maxDecodeThreads = 2;
+}
+
+namespace Utils
+{
+    LoadAvatarFromDataTask::LoadAvatarFromDataTask(core::istream *_stream, const int _sizePx)
+        : Stream_(_stream)
+        , SizePx_(_sizePx)
+    {
+        assert(Stream_);
+
+        Stream_->addref();
+    }
+
+    LoadAvatarFromDataTask::~LoadAvatarFromDataTask()
+    {
+        Stream_->release();
+    }
+
+    void LoadAvatarFromDataTask::run()
+    {
+        const auto size = Stream_->size();
+        if (size <= 0)
+        {
+            emit loadedSignal(QImage());
+            return;
+        }
+
+        // the stream stays owned by the collection, decode from it without a copy
+        const auto data = QByteArray::fromRawData((const char *)Stream_->read(size), (int)size);
+        Stream_->reset();
+
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+
+        QImageReader reader(&buffer);
+
+        const auto originalSize = reader.size();
+        if (SizePx_ > 0 && originalSize.isValid() && (originalSize.width() > SizePx_ || originalSize.height() > SizePx_))
+        {
+            // jpeg is downscaled in the dct domain, other formats are scaled right after decoding
+            reader.setScaledSize(originalSize.scaled(SizePx_, SizePx_, Qt::KeepAspectRatio));
+        }
+
+        QImage avatar;
+        if (!reader.read(&avatar))
+        {
+            emit loadedSignal(QImage());
+            return;
+        }
+
+        if (avatar.format() != QImage::Format_ARGB32_Premultiplied)
+        {
+            avatar = avatar.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        }
+
+        emit loadedSignal(avatar);
+    }
+
+    QThreadPool* LoadAvatarFromDataTask::pool()
+    {
+        static QThreadPool *pool = nullptr;
+        if (!pool)
+        {
+            pool = new QThreadPool(qApp);
+            pool->setMaxThreadCount(maxDecodeThreads);
+        }
+
+        return pool;
+    }
+}
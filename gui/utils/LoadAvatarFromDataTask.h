@@ -0,0 +1,36 @@
+#pragma once
+
+namespace core
+{
+    struct istream;
+}
+
+namespace Utils
+{
+    // decodes an avatar straight to the requested size off the gui thread
+    class LoadAvatarFromDataTask
+        : public QObject
+        , public QRunnable
+    {
+        Q_OBJECT
+
+    Q_SIGNALS:
+        void loadedSignal(const QImage& _avatar);
+
+    public:
+        LoadAvatarFromDataTask(core::istream *_stream, const int _sizePx);
+
+        virtual ~LoadAvatarFromDataTask();
+
+        void run();
+
+        static QThreadPool* pool();
+
+    private:
+        core::istream *Stream_;
+
+        const int SizePx_;
+
+    };
+
+}
@@ -4,12 +4,16 @@
 
 #include "../utils/utils.h"
 
+#include "ImageDecoder.h"
+
 #include "LoadPixmapFromDataTask.h"
 
 namespace Utils
 {
-    LoadPixmapFromDataTask::LoadPixmapFromDataTask(core::istream *stream)
+    LoadPixmapFromDataTask::LoadPixmapFromDataTask(core::istream *stream, const QString& localPath, const QSize& maxSize)
         : Stream_(stream)
+        , LocalPath_(localPath)
+        , MaxSize_(maxSize)
     {
         assert(Stream_);
 
@@ -23,13 +27,23 @@ namespace Utils
 
     void LoadPixmapFromDataTask::run()
     {
+        const auto useCache = !LocalPath_.isEmpty();
+
+        QPixmap preview;
+        if (useCache && Utils::findDecodedImage(LocalPath_, MaxSize_, Out preview))
+        {
+            emit loadedSignal(preview);
+            return;
+        }
+
         const auto size = Stream_->size();
         assert(size > 0);
 
-        QByteArray data((const char *)Stream_->read(size), (int)size);
+        // the decoded picture does not refer to the data, so the stream is not copied
+        const auto data = QByteArray::fromRawData((const char *)Stream_->read(size), (int)size);
+        Stream_->reset();
 
-        QPixmap preview;
-        Utils::loadPixmap(data, Out preview);
+        Utils::loadPixmap(data, Out preview, MaxSize_);
 
         if (preview.isNull())
         {
@@ -37,6 +51,11 @@ namespace Utils
             return;
         }
 
+        if (useCache)
+        {
+            Utils::cacheDecodedImage(LocalPath_, MaxSize_, preview);
+        }
+
         emit loadedSignal(preview);
     }
 }
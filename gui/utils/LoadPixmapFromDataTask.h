@@ -17,7 +17,8 @@ namespace Utils
         void loadedSignal(const QPixmap& pixmap);
 
     public:
-        LoadPixmapFromDataTask(core::istream *stream);
+        // the picture is cached under the local path of the downloaded file, if it is given
+        LoadPixmapFromDataTask(core::istream *stream, const QString& localPath = QString(), const QSize& maxSize = QSize());
 
         virtual ~LoadPixmapFromDataTask();
 
@@ -26,6 +27,10 @@ namespace Utils
     private:
         core::istream *Stream_;
 
+        const QString LocalPath_;
+
+        const QSize MaxSize_;
+
     };
 
 }
@@ -1,13 +1,15 @@
 #include "stdafx.h"
 
+#include "ImageDecoder.h"
 #include "utils.h"
 
 #include "LoadPixmapFromFileTask.h"
 
 namespace Utils
 {
-    LoadPixmapFromFileTask::LoadPixmapFromFileTask(const QString& path)
+    LoadPixmapFromFileTask::LoadPixmapFromFileTask(const QString& path, const QSize& maxSize)
         : Path_(path)
+        , MaxSize_(maxSize)
     {
         assert(!Path_.isEmpty());
         assert(QFile::exists(Path_));
@@ -19,6 +21,13 @@ namespace Utils
 
     void LoadPixmapFromFileTask::run()
     {
+        QPixmap preview;
+        if (Utils::findDecodedImage(Path_, MaxSize_, Out preview))
+        {
+            emit loadedSignal(preview);
+            return;
+        }
+
         if (!QFile::exists(Path_))
         {
             emit loadedSignal(QPixmap());
@@ -34,8 +43,7 @@ namespace Utils
 
         const auto data = file.readAll();
 
-        QPixmap preview;
-        Utils::loadPixmap(data, Out preview);
+        Utils::loadPixmap(data, Out preview, MaxSize_);
 
         if (preview.isNull())
         {
@@ -44,6 +52,7 @@ namespace Utils
         }
 
         assert(!preview.isNull());
+        Utils::cacheDecodedImage(Path_, MaxSize_, preview);
         emit loadedSignal(preview);
     }
 }
\ No newline at end of file
@@ -12,7 +12,7 @@ namespace Utils
         void loadedSignal(QPixmap pixmap);
 
     public:
-        explicit LoadPixmapFromFileTask(const QString& path);
+        explicit LoadPixmapFromFileTask(const QString& path, const QSize& maxSize = QSize());
 
         virtual ~LoadPixmapFromFileTask();
 
@@ -21,5 +21,7 @@ namespace Utils
     private:
         const QString Path_;
 
+        const QSize MaxSize_;
+
     };
 }
\ No newline at end of file
@@ -43,66 +43,39 @@ namespace
     uint16_t peekUnsignedShort(const char *buf, const bool isBigEndian);
 
     ExifOrientation searchForOrientationTag(const ExifTagInfo &exifInfo);
+
+    bool getOrientationMatrix(const ExifOrientation orientation, Out QMatrix &matrix);
 }
 
 void applyExifOrientation(const ExifOrientation orientation, InOut QPixmap &pixmap)
 {
     assert(!pixmap.isNull());
 
-    const auto isOrientationValid = (
-        (orientation > ExifOrientation::Min) &&
-        (orientation < ExifOrientation::Max));
-    if (!isOrientationValid)
+    QMatrix modelMatrix;
+    if (getOrientationMatrix(orientation, Out modelMatrix))
     {
-        assert(!"invalid orientation value");
-        return;
+        pixmap = pixmap.transformed(modelMatrix);
     }
+}
 
-    if (orientation == ExifOrientation::Normal)
-    {
-        return;
-    }
+void applyExifOrientation(const ExifOrientation orientation, InOut QImage &image)
+{
+    assert(!image.isNull());
 
     QMatrix modelMatrix;
-
-    switch(orientation)
+    if (getOrientationMatrix(orientation, Out modelMatrix))
     {
-        case ExifOrientation::FlipX:
-            modelMatrix.scale(-1, 1);
-            break;
-
-        case ExifOrientation::FlipY:
-            modelMatrix.scale(1, -1);
-            break;
-
-        case ExifOrientation::Rotate180C:
-            modelMatrix.rotate(180);
-            break;
-
-        case ExifOrientation::Rotate90A:
-            modelMatrix.rotate(-90);
-            break;
-
-        case ExifOrientation::Rotate90AFlipX:
-            modelMatrix.rotate(-90);
-            modelMatrix.scale(-1, 1);
-            break;
-
-        case ExifOrientation::Rotate90C:
-            modelMatrix.rotate(90);
-            break;
-
-        case ExifOrientation::Rotate90CFlipX:
-            modelMatrix.rotate(90);
-            modelMatrix.scale(-1, 1);
-            break;
-
-        default:
-            assert(!"IP is not expected to be here");
-            return;
+        image = image.transformed(modelMatrix);
     }
+}
 
-    pixmap = pixmap.transformed(modelMatrix);
+bool isTransposed(const ExifOrientation orientation)
+{
+    return (
+        (orientation == ExifOrientation::Rotate90CFlipX) ||
+        (orientation == ExifOrientation::Rotate90C) ||
+        (orientation == ExifOrientation::Rotate90AFlipX) ||
+        (orientation == ExifOrientation::Rotate90A));
 }
 
 ExifOrientation getExifOrientation(const char *buf, const size_t bufSize)
@@ -315,6 +288,66 @@ namespace
 
         return ExifOrientation::Normal;
     }
+
+    bool getOrientationMatrix(const ExifOrientation orientation, Out QMatrix &matrix)
+    {
+        const auto isOrientationValid = (
+            (orientation > ExifOrientation::Min) &&
+            (orientation < ExifOrientation::Max));
+        if (!isOrientationValid)
+        {
+            assert(!"invalid orientation value");
+            return false;
+        }
+
+        if (orientation == ExifOrientation::Normal)
+        {
+            return false;
+        }
+
+        QMatrix modelMatrix;
+
+        switch(orientation)
+        {
+            case ExifOrientation::FlipX:
+                modelMatrix.scale(-1, 1);
+                break;
+
+            case ExifOrientation::FlipY:
+                modelMatrix.scale(1, -1);
+                break;
+
+            case ExifOrientation::Rotate180C:
+                modelMatrix.rotate(180);
+                break;
+
+            case ExifOrientation::Rotate90A:
+                modelMatrix.rotate(-90);
+                break;
+
+            case ExifOrientation::Rotate90AFlipX:
+                modelMatrix.rotate(-90);
+                modelMatrix.scale(-1, 1);
+                break;
+
+            case ExifOrientation::Rotate90C:
+                modelMatrix.rotate(90);
+                break;
+
+            case ExifOrientation::Rotate90CFlipX:
+                modelMatrix.rotate(90);
+                modelMatrix.scale(-1, 1);
+                break;
+
+            default:
+                assert(!"IP is not expected to be here");
+                return false;
+        }
+
+        matrix = modelMatrix;
+
+        return true;
+    }
 }
 
 UTILS_EXIF_NS_END
\ No newline at end of file
@@ -22,6 +22,11 @@ enum class ExifOrientation
 
 void applyExifOrientation(const ExifOrientation orientation, InOut QPixmap &pixmap);
 
+void applyExifOrientation(const ExifOrientation orientation, InOut QImage &image);
+
+// the width and the height are swapped once the orientation is applied
+bool isTransposed(const ExifOrientation orientation);
+
 ExifOrientation getExifOrientation(const char *buf, const size_t bufSize);
 
 UTILS_EXIF_NS_END
\ No newline at end of file
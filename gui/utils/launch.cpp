@@ -9,6 +9,7 @@
 #include "../types/typing.h"
 #include "../cache/stickers/stickers.h"
 #include "../main_window/contact_list/ContactListModel.h"
+#include "../main_window/contact_list/WarmStartSnapshot.h"
 #include "../main_window/history_control/MessagesModel.h"
 #include "../main_window/tray/RecentMessagesAlert.h"
 
@@ -87,6 +88,8 @@ int launch::main(int _argc, char* _argv[])
         return 0;
     isLaunched = true;
 
+    Logic::WarmStartSnapshot::startLaunchTimer();
+
     Utils::Application app(_argc, _argv);
 
     CommandLineParser cmd_parser(_argc, _argv);
@@ -107,6 +110,7 @@ int launch::main(int _argc, char* _argv[])
     {
         qRegisterMetaType<Data::ImageListPtr>("Data::ImageListPtr");
         qRegisterMetaType<std::shared_ptr<Data::ContactList>>("std::shared_ptr<Data::ContactList>");
+        qRegisterMetaType<std::shared_ptr<Data::ContactListDelta>>("std::shared_ptr<Data::ContactListDelta>");
         qRegisterMetaType<std::shared_ptr<Data::Buddy>>("std::shared_ptr<Data::Buddy>");
         qRegisterMetaType<Data::MessageBuddies>("Data::MessageBuddies");
         qRegisterMetaType<std::shared_ptr<Data::ChatInfo>>("std::shared_ptr<Data::ChatInfo>");
@@ -1,6 +1,6 @@
 #include "stdafx.h"
 
-#include "exif.h"
+#include "ImageDecoder.h"
 #include "utils.h"
 
 #include "gui_coll_helper.h"
@@ -1663,25 +1663,13 @@ namespace Utils
         return loadPixmap(file.readAll(), _pixmap);
     }
 
-    bool loadPixmap(const QByteArray& _data, Out QPixmap& _pixmap)
+    bool loadPixmap(const QByteArray& _data, Out QPixmap& _pixmap, const QSize& _maxSize)
     {
         assert(!_data.isEmpty());
 
-        static const char *availableFormats[] = { nullptr, "PNG", "JPG" };
+        _pixmap = QPixmap::fromImage(decodeImage(_data, _maxSize));
 
-        for (auto fmt : availableFormats)
-        {
-            _pixmap.loadFromData(_data, fmt);
-
-            if (!_pixmap.isNull())
-            {
-                const auto orientation = Exif::getExifOrientation(_data.data(), _data.size());
-                Exif::applyExifOrientation(orientation, InOut _pixmap);
-                return true;
-            }
-        }
-
-        return false;
+        return !_pixmap.isNull();
     }
 
     bool dragUrl(QWidget* _parent, const QPixmap& _preview, const QString& _url)
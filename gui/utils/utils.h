@@ -236,7 +236,8 @@ namespace Utils
 
     bool loadPixmap(const QString& _path, Out QPixmap& _pixmap);
 
-    bool loadPixmap(const QByteArray& _data, Out QPixmap& _pixmap);
+    // an empty _maxSize keeps the genuine size, see decodeImage
+    bool loadPixmap(const QByteArray& _data, Out QPixmap& _pixmap, const QSize& _maxSize = QSize());
 
     bool dragUrl(QWidget* _parent, const QPixmap& _preview, const QString& _url);
 
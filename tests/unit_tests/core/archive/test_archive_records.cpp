@@ -0,0 +1,361 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <set>
+
+#include <rapidjson/document.h>
+
+#include <common.shared/common.h>
+#include <common.shared/typedefs.h>
+#include <core/tools/binary_stream.h>
+#include <core/tools/tlv.h>
+#include <core/archive/history_message.h>
+#include <core/archive/dlg_state.h>
+#include <core/tools/tlv_stream.h>
+
+namespace
+{
+    // the field ids of history_message.cpp, dlg_state.cpp and archive_index.cpp
+    enum message_fields : uint32_t
+    {
+        mf_msg_id = 1,
+        mf_flags = 2,
+        mf_time = 3,
+        mf_wimid = 4,
+        mf_text = 5,
+        mf_sticker = 7,
+        mf_prev_msg_id = 13,
+        mf_internal_id = 14,
+        mf_sender_friendly = 21,
+        mf_mention = 48,
+        mf_mention_sn = 49,
+        mf_mention_friendly = 50
+    };
+
+    enum dlg_state_fields : uint32_t
+    {
+        unreads_count = 1,
+        last_msg_id = 2,
+        yours_last_read = 3,
+        theirs_last_read = 4,
+        theirs_last_delivered = 5,
+        last_message = 7,
+        visible = 8,
+        last_message_friendly = 9,
+        patch_version = 10,
+        del_up_to = 11,
+        friendly = 12,
+        official = 13,
+        fake = 14,
+        hidden_msg_id = 15,
+        unread_mentions_count = 16
+    };
+
+    const uint32_t archive_index_header = 1;
+
+    const std::string sticker_text = "ext:2:sticker:15";
+
+    // the tlvpack serialization the archive records used before tlv_writer
+
+    void serialize_message_with_tlvpack(const core::archive::history_message& _message, core::tools::binary_stream& _data)
+    {
+        core::tools::tlvpack msg_pack;
+
+        msg_pack.push_child(core::tools::tlv(mf_text, (std::string) _message.get_text()));
+        msg_pack.push_child(core::tools::tlv(mf_msg_id, (int64_t) _message.get_msgid()));
+        msg_pack.push_child(core::tools::tlv(mf_prev_msg_id, (int64_t) _message.get_prev_msgid()));
+        msg_pack.push_child(core::tools::tlv(mf_flags, (uint32_t) _message.get_flags().value_));
+        msg_pack.push_child(core::tools::tlv(mf_time, (uint64_t) _message.get_time()));
+        msg_pack.push_child(core::tools::tlv(mf_wimid, (std::string) _message.get_wimid()));
+        msg_pack.push_child(core::tools::tlv(mf_internal_id, (std::string) _message.get_internal_id()));
+        msg_pack.push_child(core::tools::tlv(mf_sender_friendly, (std::string) _message.get_sender_friendly()));
+
+        if (_message.is_sticker())
+        {
+            core::archive::sticker_data sticker(sticker_text);
+
+            core::tools::tlvpack sticker_pack;
+            sticker.serialize(sticker_pack);
+            msg_pack.push_child(core::tools::tlv(mf_sticker, sticker_pack));
+        }
+
+        for (const auto& p : _message.get_mentions())
+        {
+            core::tools::tlvpack pack;
+            pack.push_child(core::tools::tlv(mf_mention_sn, p.first));
+            pack.push_child(core::tools::tlv(mf_mention_friendly, p.second));
+            msg_pack.push_child(core::tools::tlv(mf_mention, pack));
+        }
+
+        msg_pack.serialize(_data);
+    }
+
+    void serialize_state_with_tlvpack(const core::archive::dlg_state& _state, core::tools::binary_stream& _data)
+    {
+        core::tools::tlvpack state_pack;
+
+        state_pack.push_child(core::tools::tlv(unreads_count, _state.get_unread_count()));
+        state_pack.push_child(core::tools::tlv(last_msg_id, _state.get_last_msgid()));
+        state_pack.push_child(core::tools::tlv(yours_last_read, _state.get_yours_last_read()));
+        state_pack.push_child(core::tools::tlv(theirs_last_read, _state.get_theirs_last_read()));
+        state_pack.push_child(core::tools::tlv(theirs_last_delivered, _state.get_theirs_last_delivered()));
+        state_pack.push_child(core::tools::tlv(visible, _state.get_visible()));
+        state_pack.push_child(core::tools::tlv(last_message_friendly, _state.get_last_message_friendly()));
+        state_pack.push_child(core::tools::tlv(friendly, _state.get_friendly()));
+        state_pack.push_child(core::tools::tlv(official, _state.get_official()));
+        state_pack.push_child(core::tools::tlv(fake, _state.get_fake()));
+        state_pack.push_child(core::tools::tlv(hidden_msg_id, _state.get_hidden_msg_id()));
+        state_pack.push_child(core::tools::tlv(unread_mentions_count, _state.get_unread_mentions_count()));
+
+        if (_state.has_history_patch_version())
+            state_pack.push_child(core::tools::tlv(patch_version, _state.get_history_patch_version()));
+
+        if (_state.has_del_up_to())
+            state_pack.push_child(core::tools::tlv(del_up_to, _state.get_del_up_to()));
+
+        core::tools::binary_stream bs_message;
+        serialize_message_with_tlvpack(_state.get_last_message(), bs_message);
+        state_pack.push_child(core::tools::tlv(last_message, bs_message));
+
+        state_pack.serialize(_data);
+    }
+
+    void serialize_headers_with_tlvpack(const std::vector<core::archive::message_header>& _headers, core::tools::binary_stream& _data)
+    {
+        core::tools::tlvpack tlv_headers;
+
+        core::tools::binary_stream header_data;
+
+        for (const auto& hdr : _headers)
+        {
+            header_data.reset();
+            hdr.serialize(header_data);
+
+            tlv_headers.push_child(core::tools::tlv(archive_index_header, header_data));
+        }
+
+        tlv_headers.serialize(_data);
+    }
+
+    // archive_index::serialize_block
+    void serialize_headers_with_writer(const std::vector<core::archive::message_header>& _headers, core::tools::binary_stream& _data)
+    {
+        core::tools::tlv_writer headers_writer(_data);
+
+        for (const auto& hdr : _headers)
+        {
+            const auto header_offset = headers_writer.begin_pack(archive_index_header);
+            hdr.serialize(_data);
+            headers_writer.end_pack(header_offset);
+        }
+    }
+
+    core::archive::history_message make_message(const int64_t _id)
+    {
+        core::archive::history_message message;
+        message.set_msgid(_id);
+        message.set_prev_msgid(_id - 1);
+        message.set_time(1500000000 + _id);
+        message.set_outgoing(true);
+        message.set_text("the quick brown fox jumps over the lazy dog");
+        message.set_wimid("wim-" + std::to_string(_id));
+        message.set_internal_id("internal-" + std::to_string(_id));
+        message.set_sender_friendly("Sender");
+        message.set_mentions({ { "123456789", "Mentioned One" }, { "987654321", "Mentioned Two" } });
+
+        return message;
+    }
+
+    core::archive::dlg_state make_state()
+    {
+        core::archive::dlg_state state;
+        state.set_unread_count(3);
+        state.set_last_msgid(100);
+        state.set_yours_last_read(97);
+        state.set_theirs_last_read(96);
+        state.set_theirs_last_delivered(98);
+        state.set_visible(true);
+        state.set_friendly("Friend");
+        state.set_official(true);
+        state.set_hidden_msg_id(12);
+        state.set_unread_mentions_count(1);
+        state.set_history_patch_version("patch-7");
+        state.set_del_up_to(10);
+        state.set_last_message(make_message(100));
+        state.set_last_message_friendly("Friend");
+
+        return state;
+    }
+
+    std::string to_string(const core::tools::binary_stream& _data)
+    {
+        core::tools::binary_stream copy(_data);
+
+        const auto size = copy.available();
+        return std::string(copy.read(size), size);
+    }
+
+    void check_messages_equal(const core::archive::history_message& _lhs, const core::archive::history_message& _rhs)
+    {
+        BOOST_CHECK_EQUAL(_lhs.get_msgid(), _rhs.get_msgid());
+        BOOST_CHECK_EQUAL(_lhs.get_prev_msgid(), _rhs.get_prev_msgid());
+        BOOST_CHECK_EQUAL(_lhs.get_time(), _rhs.get_time());
+        BOOST_CHECK_EQUAL(_lhs.get_flags().value_, _rhs.get_flags().value_);
+        BOOST_CHECK_EQUAL(_lhs.get_text(), _rhs.get_text());
+        BOOST_CHECK_EQUAL(_lhs.get_wimid(), _rhs.get_wimid());
+        BOOST_CHECK_EQUAL(_lhs.get_internal_id(), _rhs.get_internal_id());
+        BOOST_CHECK_EQUAL(_lhs.get_sender_friendly(), _rhs.get_sender_friendly());
+        BOOST_CHECK_EQUAL(_lhs.is_sticker(), _rhs.is_sticker());
+        BOOST_CHECK(_lhs.get_mentions() == _rhs.get_mentions());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(archive)
+
+BOOST_AUTO_TEST_SUITE(test_archive_records)
+
+BOOST_AUTO_TEST_CASE(test_history_message_bytes)
+{
+    auto message = make_message(42);
+
+    core::tools::binary_stream old_data;
+    serialize_message_with_tlvpack(message, old_data);
+
+    core::tools::binary_stream new_data;
+    message.serialize(new_data);
+
+    BOOST_CHECK(to_string(old_data) == to_string(new_data));
+
+    // a sticker message keeps the sticker id as its text
+    message.set_text(sticker_text);
+    message.init_sticker_from_text(sticker_text);
+
+    core::tools::binary_stream old_sticker_data;
+    serialize_message_with_tlvpack(message, old_sticker_data);
+
+    core::tools::binary_stream new_sticker_data;
+    message.serialize(new_sticker_data);
+
+    BOOST_CHECK(to_string(old_sticker_data) == to_string(new_sticker_data));
+
+    core::archive::history_message loaded;
+    BOOST_REQUIRE_EQUAL(loaded.unserialize(old_sticker_data), 0);
+
+    check_messages_equal(loaded, message);
+}
+
+BOOST_AUTO_TEST_CASE(test_nested_data_on_demand)
+{
+    auto message = make_message(43);
+    message.set_text(sticker_text);
+    message.init_sticker_from_text(sticker_text);
+    message.attach_quotes({ core::archive::quote(), core::archive::quote() });
+
+    core::tools::binary_stream data;
+    message.serialize(data);
+
+    const auto bytes = to_string(data);
+
+    core::archive::history_message loaded;
+    BOOST_REQUIRE_EQUAL(loaded.unserialize(data), 0);
+
+    // not parsed yet, the nested fields are copied and written back as they were read
+    core::archive::history_message copy(loaded);
+
+    core::tools::binary_stream copy_data;
+    copy.serialize(copy_data);
+
+    BOOST_CHECK(to_string(copy_data) == bytes);
+
+    BOOST_CHECK(loaded.is_sticker());
+    BOOST_CHECK(!loaded.is_voip_event());
+    BOOST_CHECK_EQUAL(loaded.get_quotes().size(), 2u);
+    check_messages_equal(loaded, message);
+
+    core::tools::binary_stream parsed_data;
+    loaded.serialize(parsed_data);
+
+    BOOST_CHECK(to_string(parsed_data) == bytes);
+}
+
+BOOST_AUTO_TEST_CASE(test_dlg_state_bytes)
+{
+    const auto state = make_state();
+
+    core::tools::binary_stream old_data;
+    serialize_state_with_tlvpack(state, old_data);
+
+    core::tools::binary_stream new_data;
+    state.serialize(new_data);
+
+    BOOST_CHECK(to_string(old_data) == to_string(new_data));
+
+    core::archive::dlg_state loaded;
+    BOOST_REQUIRE(loaded.unserialize(old_data));
+
+    BOOST_CHECK_EQUAL(loaded.get_unread_count(), state.get_unread_count());
+    BOOST_CHECK_EQUAL(loaded.get_last_msgid(), state.get_last_msgid());
+    BOOST_CHECK_EQUAL(loaded.get_yours_last_read(), state.get_yours_last_read());
+    BOOST_CHECK_EQUAL(loaded.get_theirs_last_read(), state.get_theirs_last_read());
+    BOOST_CHECK_EQUAL(loaded.get_theirs_last_delivered(), state.get_theirs_last_delivered());
+    BOOST_CHECK_EQUAL(loaded.get_visible(), state.get_visible());
+    BOOST_CHECK_EQUAL(loaded.get_friendly(), state.get_friendly());
+    BOOST_CHECK_EQUAL(loaded.get_official(), state.get_official());
+    BOOST_CHECK_EQUAL(loaded.get_fake(), state.get_fake());
+    BOOST_CHECK_EQUAL(loaded.get_hidden_msg_id(), state.get_hidden_msg_id());
+    BOOST_CHECK_EQUAL(loaded.get_unread_mentions_count(), state.get_unread_mentions_count());
+    BOOST_CHECK_EQUAL(loaded.get_history_patch_version(), state.get_history_patch_version());
+    BOOST_CHECK_EQUAL(loaded.get_del_up_to(), state.get_del_up_to());
+    BOOST_CHECK_EQUAL(loaded.get_last_message_friendly(), state.get_last_message_friendly());
+
+    check_messages_equal(loaded.get_last_message(), state.get_last_message());
+}
+
+BOOST_AUTO_TEST_CASE(test_message_header_bytes)
+{
+    std::vector<core::archive::message_header> headers;
+
+    for (int64_t id = 1; id <= 3; ++id)
+    {
+        core::archive::message_flags flags;
+        flags.value_ = (uint32_t) id;
+
+        headers.emplace_back(flags, 1500000000 + id, id, id - 1, id * 1000, (uint32_t) id * 10);
+    }
+
+    core::tools::binary_stream old_data;
+    serialize_headers_with_tlvpack(headers, old_data);
+
+    core::tools::binary_stream new_data;
+    serialize_headers_with_writer(headers, new_data);
+
+    BOOST_CHECK(to_string(old_data) == to_string(new_data));
+
+    // archive_index::unserialize_block
+    for (const auto& hdr : headers)
+    {
+        BOOST_REQUIRE(old_data.available() >= sizeof(uint32_t) * 2);
+        BOOST_CHECK_EQUAL(old_data.read<uint32_t>(), archive_index_header);
+        old_data.read<uint32_t>();
+
+        core::archive::message_header loaded;
+        BOOST_REQUIRE(loaded.unserialize(old_data));
+
+        BOOST_CHECK_EQUAL(loaded.get_id(), hdr.get_id());
+        BOOST_CHECK_EQUAL(loaded.get_prev_msgid(), hdr.get_prev_msgid());
+        BOOST_CHECK_EQUAL(loaded.get_time(), hdr.get_time());
+        BOOST_CHECK_EQUAL(loaded.get_flags().value_, hdr.get_flags().value_);
+        BOOST_CHECK_EQUAL(loaded.get_data_offset(), hdr.get_data_offset());
+        BOOST_CHECK_EQUAL(loaded.get_data_size(), hdr.get_data_size());
+    }
+
+    BOOST_CHECK_EQUAL(old_data.available(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,265 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+
+#include <common.shared/common.h>
+#include <core/tools/binary_stream.h>
+#include <core/archive/storage.h>
+#include <core/tools/system.h>
+
+namespace
+{
+    const char* words[] = { "hello", "how", "are", "you", "today", "see", "you", "at", "the", "meeting", "ok", "thanks", "lol", "sure", "tomorrow" };
+
+    std::string make_message(const int32_t _index, std::mt19937& _random)
+    {
+        std::string message = "msg:" + std::to_string(_index) + ":";
+
+        const auto words_count = 5 + (_random() % 40);
+        for (uint32_t i = 0; i < words_count; ++i)
+        {
+            message += words[_random() % (sizeof(words) / sizeof(words[0]))];
+            message += ' ';
+        }
+
+        return message;
+    }
+
+    class temp_storage_files
+    {
+        boost::filesystem::path dir_;
+
+    public:
+
+        temp_storage_files()
+            : dir_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+        {
+            boost::filesystem::create_directories(dir_);
+        }
+
+        ~temp_storage_files()
+        {
+            boost::system::error_code error;
+            boost::filesystem::remove_all(dir_, error);
+        }
+
+        std::wstring file(const wchar_t* _name) const
+        {
+            return (dir_ / _name).wstring();
+        }
+    };
+
+    bool open_storage(core::archive::storage& _storage, const bool _write)
+    {
+        core::archive::storage_mode mode;
+        if (_write)
+            mode.flags_.write_ = mode.flags_.truncate_ = true;
+        else
+            mode.flags_.read_ = true;
+
+        return _storage.open(mode);
+    }
+
+    std::string read_block(core::archive::storage& _storage, const int64_t _offset)
+    {
+        core::tools::binary_stream data;
+        if (!_storage.read_data_block(_offset, data))
+            return std::string();
+
+        const auto size = data.available();
+        return (size ? std::string(data.read(size), size) : std::string());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(archive)
+
+BOOST_AUTO_TEST_SUITE(test_storage_frames)
+
+BOOST_AUTO_TEST_CASE(test_compact_and_random_access)
+{
+    const int32_t messages_count = 2000;
+
+    temp_storage_files files;
+    const auto raw_file = files.file(L"db");
+    const auto compacted_file = files.file(L"db.tmp");
+
+    std::mt19937 random(42);
+
+    std::vector<std::string> messages;
+    std::vector<int64_t> offsets;
+
+    {
+        core::archive::storage raw(raw_file);
+        BOOST_REQUIRE(open_storage(raw, true));
+
+        for (int32_t i = 0; i < messages_count; ++i)
+        {
+            messages.push_back(make_message(i, random));
+
+            // a few big blocks stay out of frames
+            if (i % 500 == 0)
+                messages.back().append(40 * 1024, 'x');
+
+            core::tools::binary_stream data;
+            data.write(messages.back().data(), (uint32_t) messages.back().size());
+
+            int64_t offset = 0;
+            BOOST_REQUIRE(raw.write_data_block(data, offset));
+            offsets.push_back(offset);
+        }
+
+        raw.close();
+    }
+
+    core::archive::data_offsets_map remap;
+
+    {
+        core::archive::storage raw(raw_file);
+        core::archive::storage compacted(compacted_file);
+        BOOST_REQUIRE(open_storage(raw, false));
+        BOOST_REQUIRE(open_storage(compacted, true));
+
+        BOOST_REQUIRE(raw.compact_to(compacted, offsets, remap));
+
+        raw.close();
+        compacted.close();
+    }
+
+    BOOST_REQUIRE_EQUAL(remap.size(), offsets.size());
+
+    std::vector<int32_t> order(messages_count);
+    for (int32_t i = 0; i < messages_count; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+
+    core::archive::storage compacted(compacted_file);
+    BOOST_REQUIRE(open_storage(compacted, false));
+
+    int32_t mismatches = 0;
+    for (int32_t i = 0; i < messages_count; ++i)
+    {
+        if (read_block(compacted, remap[offsets[i]]) != messages[i])
+            ++mismatches;
+    }
+
+    // the frame cache must not hand out a slot of the previous frame
+    for (const auto index : order)
+    {
+        if (read_block(compacted, remap[offsets[index]]) != messages[index])
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK(core::archive::storage::is_frame_offset(remap[offsets[1]]));
+    BOOST_CHECK(!core::archive::storage::is_frame_offset(remap[offsets[0]]));
+
+    BOOST_CHECK(core::tools::system::get_file_size(compacted_file) < core::tools::system::get_file_size(raw_file));
+}
+
+BOOST_AUTO_TEST_CASE(test_recompact_keeps_frames)
+{
+    temp_storage_files files;
+
+    std::mt19937 random(7);
+
+    std::vector<std::string> messages;
+    std::vector<int64_t> offsets;
+
+    core::archive::storage raw(files.file(L"db"));
+    BOOST_REQUIRE(open_storage(raw, true));
+
+    for (int32_t i = 0; i < 2000; ++i)
+    {
+        messages.push_back(make_message(i, random));
+
+        core::tools::binary_stream data;
+        data.write(messages.back().data(), (uint32_t) messages.back().size());
+
+        int64_t offset = 0;
+        BOOST_REQUIRE(raw.write_data_block(data, offset));
+        offsets.push_back(offset);
+    }
+    raw.close();
+
+    core::archive::data_offsets_map first_remap;
+    core::archive::storage first(files.file(L"db1"));
+    BOOST_REQUIRE(open_storage(raw, false));
+    BOOST_REQUIRE(open_storage(first, true));
+    BOOST_REQUIRE(raw.compact_to(first, offsets, first_remap));
+    raw.close();
+    first.close();
+
+    std::vector<int64_t> first_offsets;
+    for (const auto& iter : first_remap)
+        first_offsets.push_back(iter.second);
+    std::sort(first_offsets.begin(), first_offsets.end());
+
+    core::archive::data_offsets_map second_remap;
+    core::archive::storage second(files.file(L"db2"));
+    BOOST_REQUIRE(open_storage(first, false));
+    BOOST_REQUIRE(open_storage(second, true));
+    BOOST_REQUIRE(first.compact_to(second, first_offsets, second_remap));
+    first.close();
+    second.close();
+
+    BOOST_CHECK(core::tools::system::get_file_size(files.file(L"db2")) <= core::tools::system::get_file_size(files.file(L"db1")));
+
+    BOOST_REQUIRE(open_storage(second, false));
+
+    int32_t mismatches = 0;
+    for (size_t i = 0; i < offsets.size(); ++i)
+    {
+        if (read_block(second, second_remap[first_remap[offsets[i]]]) != messages[i])
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_failed_commit_keeps_pending_blocks)
+{
+    temp_storage_files files;
+
+    // a file in place of the folder of the db, so the append can not be opened
+    const auto blocker = boost::filesystem::path(files.file(L"blocked"));
+    boost::filesystem::ofstream(blocker) << "x";
+
+    core::archive::storage storage((blocker / L"db").wstring());
+    storage.set_write_behind(true);
+
+    core::archive::storage_mode mode;
+    mode.flags_.write_ = mode.flags_.append_ = true;
+
+    int64_t offset = -1;
+    BOOST_REQUIRE(storage.open(mode));
+
+    core::tools::binary_stream block;
+    block.write("hello", 5);
+    BOOST_REQUIRE(storage.write_data_block(block, offset));
+    storage.close();
+
+    BOOST_CHECK(!storage.commit_pending());
+    BOOST_CHECK(storage.has_pending());
+
+    boost::filesystem::remove(blocker);
+
+    BOOST_CHECK(storage.commit_pending());
+    BOOST_CHECK(!storage.has_pending());
+
+    BOOST_REQUIRE(open_storage(storage, false));
+    BOOST_CHECK_EQUAL(read_block(storage, offset), "hello");
+    storage.close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,181 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <rapidjson/document.h>
+
+typedef rapidjson::MemoryPoolAllocator<rapidjson::CrtAllocator> rapidjson_allocator;
+
+#include <common.shared/common.h>
+#include <corelib/core_face.h>
+#include <corelib/collection.h>
+#include <corelib/collection_helper.h>
+#include <core/connections/wim/wim_contactlist_cache.h>
+
+namespace
+{
+    using namespace core::wim;
+
+    void load(contactlist& _cl, const char* _json)
+    {
+        rapidjson::Document doc;
+        doc.Parse(_json);
+
+        contactlist loaded;
+        loaded.unserialize(doc);
+
+        _cl.update_cl(loaded);
+    }
+
+    const char* const roster =
+        "{\"groups\":["
+        "{\"name\":\"General\",\"id\":1,\"buddies\":["
+        "{\"aimId\":\"100\",\"friendly\":\"Anna\",\"state\":\"online\"},"
+        "{\"aimId\":\"200\",\"friendly\":\"Boris\",\"state\":\"offline\"}]},"
+        "{\"name\":\"Work\",\"id\":2,\"buddies\":["
+        "{\"aimId\":\"300\",\"friendly\":\"Clara\",\"state\":\"online\"}]}]}";
+
+    // the same, without 200
+    const char* const roster_without_200 =
+        "{\"groups\":["
+        "{\"name\":\"General\",\"id\":1,\"buddies\":["
+        "{\"aimId\":\"100\",\"friendly\":\"Anna\",\"state\":\"online\"}]},"
+        "{\"name\":\"Work\",\"id\":2,\"buddies\":["
+        "{\"aimId\":\"300\",\"friendly\":\"Clara\",\"state\":\"online\"}]}]}";
+
+    std::set<std::string> full_aimids(core::coll_helper& _coll)
+    {
+        std::set<std::string> aimids;
+
+        auto groups = _coll.get_value_as_array("groups");
+        for (int32_t i = 0; i < groups->size(); ++i)
+        {
+            core::coll_helper group(groups->get_at(i)->get_as_collection(), false);
+
+            auto contacts = group.get_value_as_array("contacts");
+            for (int32_t j = 0; j < contacts->size(); ++j)
+            {
+                core::coll_helper contact(contacts->get_at(j)->get_as_collection(), false);
+                aimids.insert(contact.get_value_as_string("aimId"));
+            }
+        }
+
+        return aimids;
+    }
+
+    std::set<std::string> removed_aimids(core::coll_helper& _coll)
+    {
+        std::set<std::string> aimids;
+
+        auto removed = _coll.get_value_as_array("removed");
+        for (int32_t i = 0; i < removed->size(); ++i)
+            aimids.insert(removed->get_at(i)->get_as_string());
+
+        return aimids;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(connections)
+
+BOOST_AUTO_TEST_SUITE(test_contactlist_gui_state)
+
+BOOST_AUTO_TEST_CASE(test_delta)
+{
+    contactlist cl;
+    load(cl, roster);
+
+    contactlist_gui_state state;
+    BOOST_CHECK(!state.is_sent());
+
+    core::coll_helper full(new core::collection(), true);
+    state.serialize_full(cl, full.get());
+
+    BOOST_CHECK(state.is_sent());
+    BOOST_CHECK_EQUAL(full.get_value_as_int64("revision"), 1);
+    BOOST_CHECK(full_aimids(full) == std::set<std::string>({ "100", "200", "300" }));
+
+    // nothing changed, nothing to send and the revision stays
+    core::coll_helper empty(new core::collection(), true);
+    BOOST_CHECK(!state.serialize_delta(cl, empty.get()));
+    BOOST_CHECK_EQUAL(state.get_revision(), 1);
+
+    cl.get_presence("100")->friendly_ = "Anna K.";
+
+    core::coll_helper delta(new core::collection(), true);
+    BOOST_REQUIRE(state.serialize_delta(cl, delta.get()));
+
+    BOOST_CHECK_EQUAL(delta.get_value_as_int64("base_revision"), 1);
+    BOOST_CHECK_EQUAL(delta.get_value_as_int64("revision"), 2);
+
+    auto changed = delta.get_value_as_array("changed");
+    BOOST_REQUIRE_EQUAL(changed->size(), 1);
+
+    core::coll_helper buddy(changed->get_at(0)->get_as_collection(), false);
+    BOOST_CHECK_EQUAL(std::string(buddy.get_value_as_string("aimId")), "100");
+    BOOST_CHECK_EQUAL(std::string(buddy.get_value_as_string("friendly")), "Anna K.");
+    // the group has not changed
+    BOOST_CHECK(!buddy.is_value_exist("group_id"));
+
+    BOOST_CHECK_EQUAL(delta.get_value_as_array("added")->size(), 0);
+    BOOST_CHECK(removed_aimids(delta).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_resync_after_gap)
+{
+    contactlist cl;
+    load(cl, roster);
+
+    contactlist_gui_state state;
+
+    core::coll_helper full(new core::collection(), true);
+    state.serialize_full(cl, full.get());
+
+    // 200 is removed, the gui loses this delta and stays at revision 1
+    load(cl, roster_without_200);
+
+    core::coll_helper lost(new core::collection(), true);
+    BOOST_REQUIRE(state.serialize_delta(cl, lost.get()));
+    BOOST_CHECK(removed_aimids(lost) == std::set<std::string>({ "200" }));
+
+    cl.get_presence("300")->state_ = "offline";
+
+    core::coll_helper next(new core::collection(), true);
+    BOOST_REQUIRE(state.serialize_delta(cl, next.get()));
+
+    // the base revision does not match the gui one, so the gui asks for the whole list
+    BOOST_CHECK_EQUAL(next.get_value_as_int64("base_revision"), 2);
+    BOOST_CHECK_NE(next.get_value_as_int64("base_revision"), full.get_value_as_int64("revision"));
+
+    core::coll_helper resync(new core::collection(), true);
+    state.serialize_full(cl, resync.get());
+
+    // the list is authoritative, 200 is only missing from it
+    BOOST_CHECK_EQUAL(resync.get_value_as_int64("revision"), 4);
+    BOOST_CHECK(full_aimids(resync) == std::set<std::string>({ "100", "300" }));
+
+    // the deltas go on from the resync
+    core::coll_helper empty(new core::collection(), true);
+    BOOST_CHECK(!state.serialize_delta(cl, empty.get()));
+
+    load(cl, roster);
+
+    core::coll_helper added(new core::collection(), true);
+    BOOST_REQUIRE(state.serialize_delta(cl, added.get()));
+    BOOST_CHECK_EQUAL(added.get_value_as_int64("base_revision"), 4);
+    BOOST_CHECK_EQUAL(added.get_value_as_array("added")->size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,216 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include <common.shared/common.h>
+#include <core/tools/binary_stream.h>
+#include <core/connections/wim/log_replace_functor.h>
+
+namespace
+{
+    const int fetch_events_count = 300;
+
+    // the scan the functor did before the automaton: every marker at every position
+    class plain_replace
+    {
+    public:
+        void add_marker(const std::string& _marker)
+        {
+            markers_.push_back(_marker + '=');
+        }
+
+        void add_json_marker(const std::string& _marker)
+        {
+            markers_json_.push_back(_marker + "\":\"");
+            markers_json_.push_back(_marker + "\": \"");
+            markers_json_escaped_.push_back(_marker + "%22%3A%22");
+        }
+
+        void operator()(std::string& _data) const
+        {
+            const auto sz = _data.size();
+            auto data = &_data[0];
+
+            size_t i = 0;
+            while (sz > 1 && i < sz - 1)
+            {
+                const std::string* value_end = nullptr;
+                const std::string* marker = find(data, sz, i, value_end, markers_, nullptr);
+                if (!marker)
+                    marker = find(data, sz, i, value_end, markers_json_, &json_value_end_);
+                if (!marker)
+                    marker = find(data, sz, i, value_end, markers_json_escaped_, &json_value_end_escaped_);
+
+                if (!marker)
+                {
+                    ++i;
+                    continue;
+                }
+
+                i += marker->size();
+
+                if (!value_end)
+                {
+                    for (; i < sz && data[i] != '&'; ++i)
+                        data[i] = '*';
+                }
+                else
+                {
+                    for (; i < sz && _data.compare(i, value_end->size(), *value_end) != 0; ++i)
+                        data[i] = '*';
+                }
+            }
+        }
+
+    private:
+        static const std::string* find(const char* _data, size_t _sz, size_t _i, const std::string*& _value_end,
+            const std::vector<std::string>& _markers, const std::string* _marker_value_end)
+        {
+            for (const auto& m : _markers)
+            {
+                if (_sz - _i > m.size() && strncmp(_data + _i, m.c_str(), m.size()) == 0)
+                {
+                    _value_end = _marker_value_end;
+                    return &m;
+                }
+            }
+
+            return nullptr;
+        }
+
+        std::vector<std::string> markers_;
+        std::vector<std::string> markers_json_;
+        std::vector<std::string> markers_json_escaped_;
+
+        const std::string json_value_end_ = "\"";
+        const std::string json_value_end_escaped_ = "%22";
+    };
+
+    template <class t_functor>
+    void add_markers(t_functor& _functor)
+    {
+        _functor.add_marker("aimsid");
+        _functor.add_marker("a");
+        _functor.add_json_marker("aimSid");
+        _functor.add_json_marker("text");
+        _functor.add_json_marker("message");
+        _functor.add_json_marker("authToken");
+    }
+
+    std::string replace_with_functor(const std::string& _data)
+    {
+        core::log_replace_functor functor;
+        add_markers(functor);
+
+        core::tools::binary_stream bs;
+        bs.write(_data.data(), _data.size());
+
+        functor(bs);
+
+        return std::string(bs.get_data(), bs.available());
+    }
+
+    std::string replace_plain(std::string _data)
+    {
+        plain_replace replace;
+        add_markers(replace);
+
+        replace(_data);
+
+        return _data;
+    }
+
+    // a fetch response as it comes from the server: events with messages, tokens and a fetch url
+    std::string make_fetch_response(std::mt19937& _random)
+    {
+        std::stringstream response;
+        response << "{\"response\": {\"statusCode\": 200, \"data\": {\"fetchBaseURL\": \"https://api.icq.net/fetchEvents?aimsid=011.0123456789.abcdef:123456789&first=1\", \"events\": [";
+
+        for (int i = 0; i < fetch_events_count; ++i)
+        {
+            if (i != 0)
+                response << ", ";
+
+            response << "{\"type\": \"histDlgState\", \"eventData\": {\"sn\": \"" << (100000 + _random() % 1000) << "\", \"lastMsgId\": " << _random()
+                << ", \"messages\": [{\"msgId\": " << _random() << ", \"time\": 1500000000, \"wid\": \"0c7b5c9c-44c4-4c45-a1c3-0c1b1b1b1b1b\", "
+                << "\"text\": \"hello, how are you doing today? message number " << i << "\", \"outgoing\": false}]";
+
+            if (i % 100 == 0)
+                response << ", \"authToken\":\"" << _random() << _random() << "\"";
+
+            response << "}, \"seqNum\": " << i << "}";
+        }
+
+        response << "]}}}";
+
+        return response.str();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(connections)
+
+BOOST_AUTO_TEST_SUITE(test_log_replace_functor)
+
+BOOST_AUTO_TEST_CASE(test_masks_values)
+{
+    BOOST_CHECK_EQUAL(
+        replace_with_functor("GET /fetchEvents?aimsid=011.secret:123&timeout=60000&r=1"),
+        "GET /fetchEvents?aimsid=**************&timeout=60000&r=1");
+
+    BOOST_CHECK_EQUAL(
+        replace_with_functor("{\"text\": \"secret\", \"authToken\":\"token\", \"sn\": \"1\"}"),
+        "{\"text\": \"******\", \"authToken\":\"*****\", \"sn\": \"1\"}");
+
+    BOOST_CHECK_EQUAL(
+        replace_with_functor("r=%7B%22message%22%3A%22secret%22%7D"),
+        "r=%7B%22message%22%3A%22******%22%7D");
+
+    // a marker at the very end has no value to mask
+    BOOST_CHECK_EQUAL(replace_with_functor("x&aimsid="), "x&aimsid=");
+
+    BOOST_CHECK_EQUAL(replace_with_functor(""), "");
+}
+
+BOOST_AUTO_TEST_CASE(test_random_against_plain_scan)
+{
+    std::mt19937 random(11);
+
+    const std::vector<std::string> pieces = {
+        "aimsid=", "a=", "ima", "sid", "=", "&", "\"", "\":\"", "\": \"", "%22", "%22%3A%22", "text", "message", "authToken", "aimSid", "x", " " };
+
+    for (int round = 0; round < 5000; ++round)
+    {
+        std::string data;
+        const auto count = random() % 30;
+        for (size_t i = 0; i < count; ++i)
+            data += pieces[random() % pieces.size()];
+
+        BOOST_REQUIRE_EQUAL(replace_with_functor(data), replace_plain(data));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_fetch_response)
+{
+    std::mt19937 random(5);
+
+    const auto response = make_fetch_response(random);
+
+    const auto plain = replace_plain(response);
+    const auto replaced = replace_with_functor(response);
+
+    BOOST_CHECK(replaced == plain);
+    BOOST_CHECK(replaced.find("hello, how are you") == std::string::npos);
+    BOOST_CHECK(replaced.find("011.0123456789") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
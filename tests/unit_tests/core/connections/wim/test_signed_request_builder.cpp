@@ -0,0 +1,184 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+
+#include <core/tools/hmac_sha_base64.h>
+#include <core/connections/wim/signed_request_builder.h>
+
+namespace
+{
+    // the signing the packets did before the builder: a stream per escape, a map and the copies for the hmac
+    std::string plain_escape(const std::string& _data)
+    {
+        std::stringstream ss_out;
+
+        char buffer[8];
+
+        for (auto sym : _data)
+        {
+            // strchr finds the terminator, so a zero byte went unescaped before
+            if ((sym >= 'a' && sym <= 'z') || (sym >= 'A' && sym <= 'Z') || (sym >= '0' && sym <= '9') || (sym != 0 && strchr("-._~", sym)))
+            {
+                ss_out << sym;
+            }
+            else
+            {
+                sprintf(buffer, "%%%.2X", (unsigned char) sym);
+                ss_out << buffer;
+            }
+        }
+
+        return ss_out.str();
+    }
+
+    std::string plain_query(const std::map<std::string, std::string>& _params)
+    {
+        std::stringstream ss_out;
+
+        auto first = true;
+
+        for (const auto& it : _params)
+        {
+            if (!first)
+                ss_out << '&';
+
+            first = false;
+
+            ss_out << it.first << '=' << it.second;
+        }
+
+        return ss_out.str();
+    }
+
+    std::string plain_sign_url(const std::string& _host, std::map<std::string, std::string> _params, const std::string& _session_key)
+    {
+        const std::string hash_data = "GET&" + plain_escape(_host) + '&' + plain_escape(plain_query(_params));
+
+        std::vector<uint8_t> hash_data_vector(hash_data.begin(), hash_data.end());
+        std::vector<uint8_t> session_key_vector(_session_key.begin(), _session_key.end());
+
+        _params["sig_sha256"] = plain_escape(core::tools::base64::hmac_base64(hash_data_vector, session_key_vector));
+
+        return _host + '?' + plain_query(_params);
+    }
+
+    const std::string host = "https://api.icq.net/im/sendIM";
+    const std::string session_key = "Zm9vYmFyYmF6cXV4c2Vzc2lvbmtleTEyMzQ1Njc4OTA=";
+    const std::string a_token = "%2FwQAAAAAAAAA0123456789ABCDEF%2Bkt%3D%3D";
+
+    std::map<std::string, std::string> make_params(const int64_t _ts, const std::string& _text)
+    {
+        std::map<std::string, std::string> params;
+
+        params["a"] = a_token;
+        params["f"] = "json";
+        params["k"] = "ic1nmMjqg7Yu-0hL";
+        params["ts"] = std::to_string(_ts);
+        params["r"] = "8ef3a4b1-0c0e-4f8e-9d3a-1b2c3d4e5f60";
+        params["t"] = "123456789";
+        params["message"] = plain_escape(_text);
+        params["offlineIM"] = "true";
+
+        return params;
+    }
+
+    void fill_builder(core::wim::signed_request_builder& _builder, const int64_t _ts, const std::string& _text)
+    {
+        _builder.clear();
+
+        _builder.set_param("ts", _ts);
+        _builder.set_param("a", a_token);
+        _builder.set_param("k", "ic1nmMjqg7Yu-0hL");
+        _builder.set_param("f", "json");
+        _builder.set_param("r", "8ef3a4b1-0c0e-4f8e-9d3a-1b2c3d4e5f60");
+        _builder.set_param_escaped("message", _text);
+        _builder.set_param("t", "123456789");
+        _builder.set_param("offlineIM", "true");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(connections)
+
+BOOST_AUTO_TEST_SUITE(test_signed_request_builder)
+
+BOOST_AUTO_TEST_CASE(test_hmac_sha256)
+{
+    using namespace core::tools;
+
+    // rfc 4231, test cases 2 and 6
+    std::string digest;
+    hmac_sha256 hmac("Jefe", 4);
+    hmac.update("what do ya ", 11);
+    hmac.update("want for nothing?", 17);
+    hmac.final_base64(digest);
+
+    BOOST_CHECK_EQUAL(digest, "W9zBRr9gdU5qBCQmCJV1x1oAPwidJzmDnexYuWTsOEM=");
+
+    const std::string long_key(131, '\xaa');
+    std::vector<uint8_t> key(long_key.begin(), long_key.end());
+
+    const std::string text = "Test Using Larger Than Block-Size Key - Hash Key First";
+    std::vector<uint8_t> data(text.begin(), text.end());
+
+    BOOST_CHECK_EQUAL(base64::hmac_base64(data, key), "YOQxWR7gtn8Niiaqy/W3f44LxiE3KMUUBUYEDw7jf1Q=");
+}
+
+BOOST_AUTO_TEST_CASE(test_same_url_as_plain_signing)
+{
+    core::wim::signed_request_builder builder;
+
+    std::mt19937 random(5);
+
+    for (int round = 0; round < 200; ++round)
+    {
+        std::string text;
+        const auto size = random() % 64;
+        for (size_t i = 0; i < size; ++i)
+            text += (char)(random() % 256);
+
+        const int64_t ts = 1500000000 + round;
+
+        fill_builder(builder, ts, text);
+        builder.sign(host, session_key, false);
+
+        BOOST_REQUIRE_EQUAL(builder.get_url(host), plain_sign_url(host, make_params(ts, text), session_key));
+    }
+
+    // a param set twice keeps the last value
+    builder.clear();
+    builder.set_param("b", "1");
+    builder.set_param("a", "2");
+    builder.set_param("b", "3");
+
+    BOOST_CHECK_EQUAL(builder.get_query(), "a=2&b=3");
+    BOOST_CHECK_EQUAL(builder.get_params_count(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(test_sign_twice)
+{
+    core::wim::signed_request_builder builder;
+
+    fill_builder(builder, 1500000000, "Hello");
+    builder.sign(host, session_key, false);
+
+    const auto once = builder.get_url(host);
+
+    // the signature of the first sign() is not hashed by the second one
+    builder.sign(host, session_key, false);
+
+    BOOST_CHECK_EQUAL(builder.get_url(host), once);
+    BOOST_CHECK_EQUAL(builder.get_url(host), plain_sign_url(host, make_params(1500000000, "Hello"), session_key));
+    BOOST_CHECK_EQUAL(builder.get_params_count(), 9u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
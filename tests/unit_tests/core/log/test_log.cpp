@@ -0,0 +1,134 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/format.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <sstream>
+
+// the test writes through the macros, which are compiled in the debug builds only
+#ifndef __ENABLE_LOG
+#define __ENABLE_LOG
+#endif
+
+#include <common.shared/common.h>
+#include <core/log/log.h>
+
+namespace
+{
+    const int32_t records_count = 1000;
+
+    const char* const enabled_area = "test";
+    const char* const disabled_area = "test_disabled";
+
+    class temp_logs_dir
+    {
+        boost::filesystem::path dir_;
+
+    public:
+
+        temp_logs_dir()
+            : dir_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+        {
+            boost::filesystem::create_directories(dir_);
+
+            boost::filesystem::ofstream areas(dir_ / L"!enabled");
+            areas << "# the test area\n" << enabled_area << "\n";
+        }
+
+        ~temp_logs_dir()
+        {
+            boost::system::error_code error;
+            boost::filesystem::remove_all(dir_, error);
+        }
+
+        const boost::filesystem::path& get() const { return dir_; }
+
+        std::string read_area(const std::string& _area) const
+        {
+            boost::filesystem::ifstream file(dir_ / ("000000." + _area + ".txt"));
+
+            std::stringstream text;
+            text << file.rdbuf();
+            return text.str();
+        }
+    };
+
+    int32_t count_lines(const std::string& _text, const std::string& _prefix)
+    {
+        int32_t count = 0;
+        for (auto pos = _text.find(_prefix); pos != std::string::npos; pos = _text.find(_prefix, pos + 1))
+            ++count;
+
+        return count;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(log)
+
+BOOST_AUTO_TEST_SUITE(test_log)
+
+BOOST_AUTO_TEST_CASE(test_records)
+{
+    temp_logs_dir dir;
+
+    core::log::init(dir.get().wstring(), false);
+
+    BOOST_CHECK(core::log::is_enabled(core::log::level::info, enabled_area));
+    BOOST_CHECK(!core::log::is_enabled(core::log::level::info, disabled_area));
+
+    const std::string contact = "1234567890";
+    const std::string url = "https://files.icq.net/get/0abcDEFghiJKLmnoPQRstu";
+
+    for (int32_t index = 0; index < records_count; ++index)
+    {
+        __INFO(enabled_area,
+            "binary record\n"
+            "    contact=<%1%>\n"
+            "    url=<%2%>\n"
+            "    index=<%3%>\n"
+            "    progress=<%4%>",
+            contact % url % index % (index * 0.5));
+
+        __INFO(disabled_area, "disabled record, index=<%1%>", index);
+    }
+
+    // the string records go through the queue and are merged with the rings
+    boost::format format("formatted record\n    index=<%1%>");
+    format % records_count;
+    core::log::info(enabled_area, format);
+
+    core::log::flush();
+
+    const auto text = dir.read_area(enabled_area);
+
+    BOOST_CHECK_EQUAL(count_lines(text, "binary record"), records_count);
+    BOOST_CHECK_EQUAL(count_lines(text, "index=<999>"), 1);
+    BOOST_CHECK_EQUAL(count_lines(text, "progress=<499.5>"), 1);
+    BOOST_CHECK(text.find("url=<" + url + ">") != std::string::npos);
+    BOOST_CHECK_EQUAL(count_lines(text, "formatted record"), 1);
+    BOOST_CHECK(dir.read_area(disabled_area).empty());
+
+    // an area switched on at runtime
+    core::log::enable_area(disabled_area, true);
+    BOOST_CHECK(core::log::is_enabled(core::log::level::info, disabled_area));
+
+    __INFO(disabled_area, "enabled record, index=<%1%>", records_count);
+
+    core::log::flush();
+
+    BOOST_CHECK_EQUAL(count_lines(dir.read_area(disabled_area), "enabled record, index=<1000>"), 1);
+
+    core::log::enable_area(disabled_area, false);
+    BOOST_CHECK(!core::log::is_enabled(core::log::level::info, disabled_area));
+
+    core::log::shutdown();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
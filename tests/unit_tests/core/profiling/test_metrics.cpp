@@ -0,0 +1,94 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include <core/profiling/metrics.h>
+
+namespace
+{
+    const int32_t threads_count = 4;
+    const int64_t hits_count = 100000;
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(profiling)
+
+BOOST_AUTO_TEST_SUITE(test_metrics)
+
+BOOST_AUTO_TEST_CASE(test_histogram_buckets)
+{
+    typedef core::metrics::histogram histogram;
+
+    // every value falls into a bucket whose upper bound is within 12.5% above it
+    for (int64_t value = 0; value < (1 << 20); value += 1 + value / 64)
+    {
+        const auto bucket = histogram::get_bucket(value);
+        const auto upper = histogram::get_bucket_upper_bound(bucket);
+
+        BOOST_REQUIRE(upper >= value);
+        BOOST_REQUIRE(upper - value <= value / histogram::sub_buckets_count);
+
+        if (bucket > 0)
+            BOOST_REQUIRE(histogram::get_bucket_upper_bound(bucket - 1) < value);
+    }
+
+    BOOST_CHECK_EQUAL(histogram::get_bucket(INT64_MAX), histogram::buckets_count - 1);
+
+    histogram latency;
+    for (int64_t value = 1; value <= 1000; ++value)
+        latency.record(value);
+
+    BOOST_CHECK_EQUAL(latency.count(), 1000);
+    BOOST_CHECK_EQUAL(latency.get_max(), 1000);
+    BOOST_CHECK_EQUAL(latency.get_sum(), 500500);
+    BOOST_CHECK(latency.percentile(0.5) >= 500 && latency.percentile(0.5) <= 500 * 9 / 8);
+    BOOST_CHECK(latency.percentile(0.99) >= 990 && latency.percentile(0.99) <= 1000);
+}
+
+BOOST_AUTO_TEST_CASE(test_registry_and_threads)
+{
+    auto& hits = core::metrics::get_counter("test/hits");
+    auto& depth = core::metrics::get_gauge("test/depth");
+    auto& latency = core::metrics::get_histogram("test/latency_us");
+
+    // the same name is the same metric
+    BOOST_CHECK_EQUAL(&hits, &core::metrics::get_counter("test/hits"));
+
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < threads_count; ++i)
+    {
+        threads.emplace_back([&hits, &depth, &latency]
+        {
+            for (int64_t hit = 0; hit < hits_count; ++hit)
+            {
+                hits.add();
+                depth.add(1);
+                latency.record(hit % 100);
+                depth.add(-1);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    BOOST_CHECK_EQUAL(hits.get(), threads_count * hits_count);
+    BOOST_CHECK_EQUAL(depth.get(), 0);
+    BOOST_CHECK(depth.get_max() >= 1 && depth.get_max() <= threads_count);
+    BOOST_CHECK_EQUAL(latency.count(), threads_count * hits_count);
+    BOOST_CHECK_EQUAL(latency.get_max(), 99);
+
+    const auto text = core::metrics::format();
+    BOOST_CHECK(text.find("counter test/hits = 400000\n") != std::string::npos);
+    BOOST_CHECK(text.find("gauge test/depth = 0 max=") != std::string::npos);
+    BOOST_CHECK(text.find("histogram test/latency_us count=400000 avg=49") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <core/profiling/profiler.h>
+
+namespace
+{
+    // a few times the span buffer of a thread
+    const int32_t spans_count = 3000;
+
+    int32_t count_of(const std::string& _text, const std::string& _pattern)
+    {
+        int32_t count = 0;
+        for (auto pos = _text.find(_pattern); pos != std::string::npos; pos = _text.find(_pattern, pos + 1))
+            ++count;
+
+        return count;
+    }
+
+    std::string export_trace()
+    {
+        const auto file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+        BOOST_REQUIRE(core::profiler::export_trace(file.wstring()));
+
+        std::stringstream text;
+        {
+            boost::filesystem::ifstream stream(file);
+            text << stream.rdbuf();
+        }
+
+        boost::system::error_code error;
+        boost::filesystem::remove(file, error);
+
+        return text.str();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(profiling)
+
+BOOST_AUTO_TEST_SUITE(test_profiler)
+
+BOOST_AUTO_TEST_CASE(test_timeline_export)
+{
+    core::profiler::enable(true);
+    core::profiler::flush_logs();
+
+    {
+        core::profiler::auto_stop_watch outer("test/outer");
+        core::profiler::auto_stop_watch inner("test/inner");
+    }
+
+    // started on one thread, stopped on another
+    const auto request = core::profiler::process_started("test/request");
+    BOOST_CHECK(request > 0);
+    std::thread([request] { core::profiler::process_stopped(request); }).join();
+
+    // the gui stamps its spans with ms since the epoch
+    const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    core::profiler::process_started("gui/\"quoted\"", (int64_t)INT32_MAX + 1, now);
+    core::profiler::process_stopped((int64_t)INT32_MAX + 1, now + 5);
+
+    core::profiler::startup_phase("test_phase");
+
+    core::profiler::process_stopped(-1);
+
+    const auto trace = export_trace();
+
+    BOOST_CHECK(trace.find("{\"traceEvents\":[") == 0);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"name\":\"test/outer\",\"ph\":\"X\""), 1);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"name\":\"test/inner\",\"ph\":\"X\""), 1);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"name\":\"test/request\",\"cat\":\"async\",\"ph\":\"b\""), 1);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"name\":\"test/request\",\"cat\":\"async\",\"ph\":\"e\""), 1);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"name\":\"gui/\\\"quoted\\\"\",\"ph\":\"X\",\"pid\":2,\"tid\":1"), 1);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"dur\":5000}"), 1);
+    BOOST_CHECK_EQUAL(count_of(trace, "\"name\":\"test_phase\",\"ph\":\"i\""), 1);
+
+    core::profiler::flush_logs();
+
+    BOOST_CHECK_EQUAL(count_of(export_trace(), "test/"), 0);
+
+    core::profiler::enable(false);
+}
+
+BOOST_AUTO_TEST_CASE(test_spans)
+{
+    core::profiler::enable(true);
+    core::profiler::flush_logs();
+
+    for (int32_t i = 0; i < spans_count; ++i)
+        core::profiler::auto_stop_watch watch("test/span");
+
+    // none is lost when the buffer of the thread fills
+    BOOST_CHECK_EQUAL(count_of(export_trace(), "\"name\":\"test/span\""), spans_count);
+
+    core::profiler::flush_logs();
+    core::profiler::enable(false);
+
+    {
+        core::profiler::auto_stop_watch watch("test/disabled");
+    }
+
+    BOOST_CHECK_EQUAL(count_of(export_trace(), "test/disabled"), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
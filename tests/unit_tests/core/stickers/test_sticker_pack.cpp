@@ -0,0 +1,186 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include <common.shared/common.h>
+#include <corelib/core_face.h>
+#include <corelib/enumerations.h>
+#include <corelib/ifptr.h>
+#include <core/tools/binary_stream.h>
+#include <core/stickers/sticker_pack.h>
+
+namespace
+{
+    const int32_t stickers_count = 50;
+
+    class temp_set_folder
+    {
+        boost::filesystem::path dir_;
+
+    public:
+
+        temp_set_folder()
+            : dir_(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() / "1000")
+        {
+            boost::filesystem::create_directories(dir_);
+        }
+
+        ~temp_set_folder()
+        {
+            boost::system::error_code error;
+            boost::filesystem::remove_all(dir_.parent_path(), error);
+        }
+
+        std::wstring path() const
+        {
+            return dir_.wstring();
+        }
+    };
+
+    std::string make_image(const int32_t _sticker_id, const core::sticker_size _size)
+    {
+        std::mt19937 random(_sticker_id * 10 + (int32_t) _size);
+
+        std::string image(2048 + (random() % 4096), '\0');
+        for (auto& byte : image)
+            byte = (char) random();
+
+        return image;
+    }
+
+    std::wstring sticker_file(const std::wstring& _set_path, const int32_t _sticker_id, const core::sticker_size _size)
+    {
+        std::wstringstream ss_out;
+        ss_out << _set_path << L"/" << _sticker_id << L"/" << _size << L".png";
+
+        return ss_out.str();
+    }
+
+    void write_loose_files(const std::wstring& _set_path)
+    {
+        for (int32_t sticker_id = 1; sticker_id <= stickers_count; ++sticker_id)
+        {
+            const auto image = make_image(sticker_id, core::sticker_size::small);
+
+            core::tools::binary_stream data;
+            data.write(image.data(), (uint32_t) image.size());
+            data.save_2_file(sticker_file(_set_path, sticker_id, core::sticker_size::small));
+        }
+
+        core::tools::binary_stream icon;
+        icon.write("icon", 4);
+        icon.save_2_file(_set_path + L"/icons/_icon_32.png");
+    }
+
+    std::string read_stream(const core::stickers::image_data& _data)
+    {
+        core::ifptr<core::istream> stream(_data.create_stream(), true);
+
+        const auto size = stream->size();
+        return std::string((const char*) stream->read(size), size);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(stickers)
+
+BOOST_AUTO_TEST_SUITE(test_sticker_pack)
+
+BOOST_AUTO_TEST_CASE(test_pack_loose_files)
+{
+    temp_set_folder folder;
+    write_loose_files(folder.path());
+
+    size_t files_bytes = 0;
+    for (int32_t sticker_id = 1; sticker_id <= stickers_count; ++sticker_id)
+    {
+        core::tools::binary_stream data;
+        BOOST_REQUIRE(data.load_from_file(sticker_file(folder.path(), sticker_id, core::sticker_size::small)));
+        files_bytes += data.available();
+    }
+
+    core::stickers::pack_builder builder;
+    builder.add_set_files(folder.path());
+    BOOST_CHECK_EQUAL(builder.get_files().size(), stickers_count + 1);
+    BOOST_REQUIRE(builder.save(core::stickers::pack::get_file_name(folder.path(), 0)));
+
+    auto set_pack = core::stickers::pack::open_latest(folder.path());
+    BOOST_REQUIRE(set_pack);
+
+    size_t pack_bytes = 0;
+    std::vector<core::stickers::image_data> images;
+
+    for (int32_t sticker_id = 1; sticker_id <= stickers_count; ++sticker_id)
+    {
+        images.push_back(set_pack->get_image(core::stickers::pack::sticker_key(sticker_id, core::sticker_size::small)));
+        pack_bytes += read_stream(images.back()).size();
+    }
+
+    int32_t mismatches = 0;
+    for (int32_t sticker_id = 1; sticker_id <= stickers_count; ++sticker_id)
+    {
+        if (read_stream(images[sticker_id - 1]) != make_image(sticker_id, core::sticker_size::small))
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK_EQUAL(files_bytes, pack_bytes);
+    BOOST_CHECK_EQUAL(set_pack->get_count(), stickers_count + 1);
+    BOOST_CHECK_EQUAL(read_stream(set_pack->get_image(core::stickers::pack::icon_key(32))), "icon");
+    BOOST_CHECK(set_pack->get_image(core::stickers::pack::sticker_key(1, core::sticker_size::large)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_rebuild_keeps_views_alive)
+{
+    temp_set_folder folder;
+    write_loose_files(folder.path());
+
+    core::stickers::pack_builder first_builder;
+    first_builder.add_set_files(folder.path());
+    BOOST_REQUIRE(first_builder.save(core::stickers::pack::get_file_name(folder.path(), 0)));
+
+    auto first = core::stickers::pack::open_latest(folder.path());
+    BOOST_REQUIRE(first);
+
+    const auto view = first->get_image(core::stickers::pack::sticker_key(1, core::sticker_size::small));
+
+    const auto large = make_image(1, core::sticker_size::large);
+    core::tools::binary_stream data;
+    data.write(large.data(), (uint32_t) large.size());
+    data.save_2_file(sticker_file(folder.path(), 1, core::sticker_size::large));
+
+    core::stickers::pack_builder second_builder;
+    first->enumerate([&second_builder](uint64_t _key, const char* _data, uint32_t _size)
+    {
+        second_builder.add_data(_key, _data, _size);
+    });
+    second_builder.add_set_files(folder.path());
+    BOOST_REQUIRE(second_builder.save(core::stickers::pack::get_file_name(folder.path(), 1)));
+
+    first->set_obsolete();
+    first.reset();
+
+    // the view still maps the first pack
+    BOOST_CHECK(read_stream(view) == make_image(1, core::sticker_size::small));
+
+    auto second = core::stickers::pack::open_latest(folder.path());
+    BOOST_REQUIRE(second);
+    BOOST_CHECK_EQUAL(second->get_generation(), 1u);
+    BOOST_CHECK(read_stream(second->get_image(core::stickers::pack::sticker_key(1, core::sticker_size::large))) == large);
+    BOOST_CHECK(read_stream(second->get_image(core::stickers::pack::sticker_key(2, core::sticker_size::small))) == make_image(2, core::sticker_size::small));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
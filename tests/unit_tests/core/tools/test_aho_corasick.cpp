@@ -0,0 +1,107 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <random>
+
+#include <core/tools/aho_corasick.h>
+
+namespace
+{
+    // the first pattern occurrence by its end, the longest one there, found the plain way
+    size_t find_plain(const std::vector<std::string>& _patterns, const std::string& _data, int32_t& _pattern)
+    {
+        for (size_t end = 1; end <= _data.size(); ++end)
+        {
+            _pattern = -1;
+
+            for (int32_t index = 0; index < (int32_t)_patterns.size(); ++index)
+            {
+                const auto& pattern = _patterns[index];
+                if (pattern.size() > end || _data.compare(end - pattern.size(), pattern.size(), pattern) != 0)
+                    continue;
+
+                if (_pattern == -1 || pattern.size() > _patterns[_pattern].size())
+                    _pattern = index;
+            }
+
+            if (_pattern != -1)
+                return end;
+        }
+
+        _pattern = -1;
+        return _data.size();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(tools)
+
+BOOST_AUTO_TEST_SUITE(test_aho_corasick)
+
+BOOST_AUTO_TEST_CASE(test_overlapping_patterns)
+{
+    const std::vector<std::string> patterns = { "he", "she", "his", "hers" };
+
+    core::tools::aho_corasick matcher(patterns);
+
+    int32_t pattern = -1;
+
+    const std::string ushers = "ushers";
+    BOOST_CHECK_EQUAL(matcher.find(ushers.data(), ushers.size(), pattern), 4u);
+    BOOST_CHECK_EQUAL(matcher.get_pattern(pattern), "she");
+
+    const std::string this_text = "this";
+    BOOST_CHECK_EQUAL(matcher.find(this_text.data(), this_text.size(), pattern), 4u);
+    BOOST_CHECK_EQUAL(matcher.get_pattern(pattern), "his");
+
+    const std::string none = "hxsxrs";
+    BOOST_CHECK_EQUAL(matcher.find(none.data(), none.size(), pattern), none.size());
+    BOOST_CHECK_EQUAL(pattern, -1);
+
+    BOOST_CHECK_EQUAL(matcher.get_max_pattern_size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(test_random_against_plain_search)
+{
+    std::mt19937 random(7);
+
+    const std::string alphabet = "ab\"=:%";
+
+    for (int round = 0; round < 200; ++round)
+    {
+        std::vector<std::string> patterns(1 + random() % 6);
+        for (auto& pattern : patterns)
+        {
+            const auto size = 1 + random() % 5;
+            for (size_t i = 0; i < size; ++i)
+                pattern += alphabet[random() % alphabet.size()];
+        }
+
+        core::tools::aho_corasick matcher(patterns);
+
+        for (int text = 0; text < 20; ++text)
+        {
+            std::string data;
+            const auto size = random() % 40;
+            for (size_t i = 0; i < size; ++i)
+                data += (random() % 8 == 0 ? 'z' : alphabet[random() % alphabet.size()]);
+
+            int32_t expected_pattern = -1;
+            const auto expected = find_plain(patterns, data, expected_pattern);
+
+            int32_t pattern = -1;
+            const auto found = matcher.find(data.data(), data.size(), pattern);
+
+            BOOST_REQUIRE_EQUAL(found, expected);
+            BOOST_REQUIRE_EQUAL((pattern == -1 ? std::string() : matcher.get_pattern(pattern)), (expected_pattern == -1 ? std::string() : patterns[expected_pattern]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,141 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <rapidjson/document.h>
+
+typedef rapidjson::MemoryPoolAllocator<rapidjson::CrtAllocator> rapidjson_allocator;
+
+#include <common.shared/common.h>
+#include <corelib/core_face.h>
+#include <core/tools/string_pool.h>
+#include <core/connections/wim/wim_contactlist_cache.h>
+
+namespace
+{
+    std::shared_ptr<core::wim::cl_buddy> make_buddy(const std::string& _aimid, const std::string& _friendly, const std::string& _ab)
+    {
+        auto buddy = std::make_shared<core::wim::cl_buddy>();
+        buddy->aimid_ = _aimid;
+        buddy->presence_->friendly_ = _friendly;
+        buddy->presence_->ab_contact_name_ = _ab;
+        return buddy;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(tools)
+
+BOOST_AUTO_TEST_SUITE(test_string_pool)
+
+BOOST_AUTO_TEST_CASE(test_intern)
+{
+    const core::tools::interned_string empty;
+    BOOST_CHECK(empty.empty());
+    BOOST_CHECK(empty == std::string());
+
+    const core::tools::interned_string online("online");
+    const core::tools::interned_string online_copy(std::string("onl") + "ine");
+    const core::tools::interned_string offline = "offline";
+
+    BOOST_CHECK(online == online_copy);
+    BOOST_CHECK(&online.str() == &online_copy.str());
+    BOOST_CHECK(online != offline);
+    BOOST_CHECK(online == "online");
+    BOOST_CHECK(offline != "online");
+    BOOST_CHECK(offline < online);
+
+    core::tools::interned_string state;
+    state = online.str();
+    BOOST_CHECK(state == online);
+
+    const std::string& value = state;
+    BOOST_CHECK_EQUAL(value, "online");
+}
+
+BOOST_AUTO_TEST_CASE(test_presence)
+{
+    core::wim::cl_presence first;
+    core::wim::cl_presence second;
+
+    first.state_ = "online";
+    second.state_ = std::string("on") + "line";
+
+    // one pooled string for both
+    BOOST_CHECK(first.state_ == second.state_);
+    BOOST_CHECK(&first.state_.str() == &second.state_.str());
+
+    first.add_capability("0946134E4C7F11D18222444553540000");
+    first.add_capability("094613421234567890ABCDEF00000000");
+    first.add_capability("0946134E4C7F11D18222444553540000");
+
+    second.add_capability("094613421234567890ABCDEF00000000");
+    second.add_capability("0946134E4C7F11D18222444553540000");
+
+    // sorted and without duplicates, whatever the order they came in
+    BOOST_REQUIRE_EQUAL(first.capabilities_.size(), 2u);
+    BOOST_CHECK(first.capabilities_ == second.capabilities_);
+    BOOST_CHECK(first.capabilities_[0] < first.capabilities_[1]);
+    BOOST_CHECK(&first.capabilities_[0].str() == &second.capabilities_[0].str());
+}
+
+BOOST_AUTO_TEST_CASE(test_search_texts)
+{
+    core::wim::search_texts texts;
+
+    auto anna = make_buddy("100", "Anna Karenina", "");
+    auto boris = make_buddy("boris@mail.ru", "Boris", "Boris Godunov");
+
+    const auto anna_slot = texts.get(*anna);
+    BOOST_CHECK_EQUAL(anna->search_slot_, anna_slot);
+    BOOST_CHECK_EQUAL(texts.get(*anna), anna_slot);
+
+    BOOST_CHECK_EQUAL(texts.friendly(anna_slot), "ANNA KARENINA");
+    BOOST_CHECK(texts.friendly_words(anna_slot) == std::vector<std::string>({ "ANNA", "KARENINA" }));
+    BOOST_CHECK(texts.ab_words(anna_slot).empty());
+
+    const auto boris_slot = texts.get(*boris);
+    BOOST_CHECK_NE(boris_slot, anna_slot);
+    BOOST_CHECK_EQUAL(texts.aimid(boris_slot), "BORIS@MAIL.RU");
+    BOOST_CHECK_EQUAL(texts.ab(boris_slot), "BORIS GODUNOV");
+    BOOST_CHECK_EQUAL(texts.size(), 2u);
+
+    // a released slot is emptied and taken by the next buddy
+    texts.release(*anna);
+    BOOST_CHECK_EQUAL(anna->search_slot_, -1);
+    BOOST_CHECK_EQUAL(texts.size(), 1u);
+    BOOST_CHECK(texts.friendly(anna_slot).empty());
+
+    texts.release(*anna);
+    BOOST_CHECK_EQUAL(texts.size(), 1u);
+
+    auto clara = make_buddy("300", "Clara", "");
+    BOOST_CHECK_EQUAL(texts.get(*clara), anna_slot);
+    BOOST_CHECK_EQUAL(texts.friendly(anna_slot), "CLARA");
+    BOOST_CHECK_EQUAL(texts.size(), 2u);
+
+    // a changed name is seen after the release only
+    boris->presence_->friendly_ = "Boris B.";
+    BOOST_CHECK_EQUAL(texts.friendly(texts.get(*boris)), "BORIS");
+    texts.release(*boris);
+    BOOST_CHECK_EQUAL(texts.friendly(texts.get(*boris)), "BORIS B.");
+
+    texts.release(*boris);
+    texts.release(*clara);
+    texts.clear();
+    BOOST_CHECK_EQUAL(texts.size(), 0u);
+
+    BOOST_CHECK_EQUAL(texts.get(*anna), 0);
+    BOOST_CHECK_EQUAL(texts.friendly(0), "ANNA KARENINA");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+#include <boost/test/unit_test.hpp>
+
+#include <common.shared/common.h>
+#include <core/tools/tlv.h>
+#include <core/tools/tlv_stream.h>
+
+namespace
+{
+    enum test_fields : uint32_t
+    {
+        tf_text = 1,
+        tf_msg_id = 2,
+        tf_flags = 3,
+        tf_wimid = 4,
+        tf_mention = 5,
+        tf_mention_sn = 6
+    };
+
+    const std::string test_text = "the quick brown fox jumps over the lazy dog";
+
+    void write_message_pack(const int64_t _id, core::tools::binary_stream& _data)
+    {
+        core::tools::tlvpack mention;
+        mention.push_child(core::tools::tlv(tf_mention_sn, std::string("123456789")));
+
+        core::tools::tlvpack pack;
+        pack.push_child(core::tools::tlv(tf_text, test_text));
+        pack.push_child(core::tools::tlv(tf_msg_id, _id));
+        pack.push_child(core::tools::tlv(tf_flags, (uint32_t) 7));
+        pack.push_child(core::tools::tlv(tf_wimid, std::string()));
+        pack.push_child(core::tools::tlv(tf_mention, mention));
+        pack.serialize(_data);
+    }
+
+    void write_message_flat(const int64_t _id, core::tools::binary_stream& _data)
+    {
+        core::tools::tlv_writer writer(_data);
+        writer.write(tf_text, test_text);
+        writer.write<int64_t>(tf_msg_id, _id);
+        writer.write<uint32_t>(tf_flags, 7);
+        writer.write(tf_wimid, std::string());
+
+        const auto mention_offset = writer.begin_pack(tf_mention);
+        writer.write(tf_mention_sn, std::string("123456789"));
+        writer.end_pack(mention_offset);
+    }
+
+    std::string to_string(const core::tools::binary_stream& _data)
+    {
+        core::tools::binary_stream copy(_data);
+
+        const auto size = copy.available();
+        return std::string(copy.read(size), size);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(core)
+
+BOOST_AUTO_TEST_SUITE(tools)
+
+BOOST_AUTO_TEST_SUITE(test_tlv_stream)
+
+BOOST_AUTO_TEST_CASE(test_writer_matches_tlvpack)
+{
+    core::tools::binary_stream pack_data;
+    write_message_pack(42, pack_data);
+
+    core::tools::binary_stream flat_data;
+    write_message_flat(42, flat_data);
+
+    BOOST_CHECK(to_string(pack_data) == to_string(flat_data));
+}
+
+BOOST_AUTO_TEST_CASE(test_reader_fields)
+{
+    core::tools::binary_stream data;
+    write_message_flat(42, data);
+
+    const auto size = data.available();
+    core::tools::tlv_reader reader(data.read(size), size);
+
+    BOOST_CHECK(reader.validate());
+
+    core::tools::tlv_view field;
+
+    BOOST_REQUIRE(reader.find(tf_text, field));
+    BOOST_CHECK_EQUAL(field.get_string(), test_text);
+
+    BOOST_REQUIRE(reader.find(tf_msg_id, field));
+    BOOST_CHECK_EQUAL(field.get_value<int64_t>(-1), 42);
+
+    BOOST_REQUIRE(reader.find(tf_wimid, field));
+    BOOST_CHECK(field.get_string_ref().empty());
+
+    BOOST_REQUIRE(reader.find(tf_mention, field));
+
+    core::tools::tlv_view sn;
+    BOOST_REQUIRE(field.get_pack().find(tf_mention_sn, sn));
+    BOOST_CHECK_EQUAL(sn.get_string(), "123456789");
+}
+
+BOOST_AUTO_TEST_CASE(test_reader_truncated)
+{
+    core::tools::binary_stream data;
+    write_message_flat(42, data);
+
+    const auto size = data.available();
+    core::tools::tlv_reader reader(data.read(size), (size - 1));
+
+    BOOST_CHECK(!reader.validate());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
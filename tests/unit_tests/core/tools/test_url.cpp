@@ -17,6 +17,23 @@ BOOST_AUTO_TEST_CASE(test_encode_url)
         encode_url("http://img0.joyreactor.cc/pics/post/гифки-слов-нет-только-боль-3735838.gif"));
 }
 
+BOOST_AUTO_TEST_CASE(test_escape_url_symbols)
+{
+    using namespace core::tools;
+
+    const std::string data = "aZ09-._~ &=/?%\x01\xFF";
+
+    std::string escaped = "x=";
+    escape_url_symbols(data.data(), data.size(), escaped);
+
+    BOOST_CHECK_EQUAL("x=aZ09-._~%20%26%3D%2F%3F%25%01%FF", escaped);
+    BOOST_CHECK_EQUAL(escaped.size() - 2, get_escaped_url_size(data.data(), data.size()));
+
+    std::string empty;
+    escape_url_symbols("", 0, empty);
+    BOOST_CHECK(empty.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
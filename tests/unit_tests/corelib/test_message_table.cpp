@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+
+#include <functional>
+
+#include <corelib/message_table.h>
+
+namespace
+{
+    // a part of the im_container messages
+    const char* const messages[] =
+    {
+        "message/typing",
+        "archive/messages/get",
+        "dlg_state/set_last_read",
+        "avatars/get",
+        "send_message",
+        "contacts/search",
+        "set_state",
+        "files/download/metainfo",
+        "image/download",
+        "stickers/sticker/get",
+        "login_by_password",
+        "login_by_password_for_attach_uin",
+        "login_get_sms_code",
+        "login_by_phone",
+        "logout",
+        "connect_after_migration",
+        "avatars/show",
+        "feedback/send",
+        "archive/images/get",
+        "archive/images/repair",
+        "archive/index/get",
+        "archive/buddies/get",
+        "archive/messages/delete",
+        "archive/messages/delete_from",
+        "history_search",
+        "history_search_ended",
+        "dialogs/add",
+        "dialogs/remove",
+        "dialogs/set_first_message",
+        "dialogs/hide",
+        "dialogs/mute",
+        "voip_call",
+        "files/upload",
+        "files/upload/abort",
+        "files/download/preview_size",
+        "files/download",
+        "files/download/abort",
+        "image/download/cancel",
+        "link_metainfo/download",
+        "download/raise_priority",
+        "stickers/meta/get",
+        "contacts/get_ignore",
+        "contactlist/get",
+        "themes/meta/get",
+        "themes/theme/get"
+    };
+
+    const int32_t messages_count = (int32_t)(sizeof(messages) / sizeof(messages[0]));
+
+    typedef std::function<void(int64_t)> handler;
+
+    // the names are spelled out, so they are folded at compile time
+    static_assert(core::get_message_id("") == 2166136261u, "FNV-1a offset basis");
+    static_assert(core::get_message_id("log") != core::get_message_id("logout"), "distinct names");
+}
+
+BOOST_AUTO_TEST_SUITE(corelib)
+
+BOOST_AUTO_TEST_SUITE(test_message_table)
+
+BOOST_AUTO_TEST_CASE(test_find)
+{
+    core::message_table<int32_t> table;
+
+    for (int32_t i = 0; i < messages_count; ++i)
+        table.add(messages[i], i);
+
+    BOOST_CHECK_EQUAL(table.size(), (size_t)messages_count);
+
+    int32_t mismatches = 0;
+    for (int32_t i = 0; i < messages_count; ++i)
+    {
+        const std::string name = messages[i];
+
+        const auto value = table.find(name.c_str());
+        if (!value || *value != i || std::string(table.get_name(core::get_message_id(messages[i]))) != name)
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK(!table.find("contactlist/diff"));
+    BOOST_CHECK(!table.get_name(core::get_message_id("log")));
+
+    switch (core::get_message_id(std::string("voip_call").c_str()))
+    {
+    case core::get_message_id("voip_call"):
+        break;
+    default:
+        BOOST_ERROR("the runtime and compile time ids differ");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_dispatch)
+{
+    std::vector<int64_t> calls(messages_count);
+
+    core::message_table<handler> table;
+    for (int32_t i = 0; i < messages_count; ++i)
+        table.add(messages[i], [&calls, i](int64_t _seq){ calls[i] += _seq; });
+
+    // each name reaches its own handler, by the id of a runtime string
+    for (int32_t i = 0; i < messages_count; ++i)
+    {
+        const std::string name = messages[i];
+
+        const auto message_handler = table.find(core::get_message_id(name.c_str()));
+        BOOST_REQUIRE(message_handler);
+        (*message_handler)(i + 1);
+    }
+
+    for (int32_t i = 0; i < messages_count; ++i)
+        BOOST_CHECK_EQUAL(calls[i], i + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
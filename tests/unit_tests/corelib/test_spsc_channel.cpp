@@ -0,0 +1,149 @@
+#include <boost/test/unit_test.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <corelib/spsc_channel.h>
+
+namespace
+{
+    const int64_t messages_count = 20000;
+
+    // a consumer thread with an event loop: woken by a flag, then drains
+    class event_loop
+    {
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool woken_ = false;
+        int64_t wakeups_ = 0;
+
+    public:
+
+        void wakeup()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                woken_ = true;
+                ++wakeups_;
+            }
+
+            condition_.notify_one();
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return woken_; });
+            woken_ = false;
+        }
+
+        int64_t wakeups()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return wakeups_;
+        }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(corelib)
+
+BOOST_AUTO_TEST_SUITE(test_spsc_channel)
+
+BOOST_AUTO_TEST_CASE(test_order_and_overflow)
+{
+    int32_t wakeups = 0;
+    core::spsc_channel<core::channel_message> channel(8, [&wakeups] { ++wakeups; });
+
+    // no producer until it is bound
+    BOOST_CHECK(!channel.push(core::channel_message("log", 0, nullptr)));
+    BOOST_CHECK_EQUAL(wakeups, 0);
+
+    channel.bind_producer();
+
+    // twice the capacity, the tail goes to the overflow
+    for (int64_t seq = 1; seq <= 16; ++seq)
+        BOOST_CHECK(channel.push(core::channel_message("archive/messages/get", seq, nullptr)));
+
+    BOOST_CHECK_EQUAL(wakeups, 1);
+    BOOST_CHECK_EQUAL(channel.depth(), (size_t)16);
+
+    // the other threads are not the producer
+    bool pushed = true;
+    std::thread([&channel, &pushed] { pushed = channel.push(core::channel_message("log", 0, nullptr)); }).join();
+    BOOST_CHECK(!pushed);
+
+    int64_t expected = 1;
+    int32_t mismatches = 0;
+    const auto drained = channel.drain([&expected, &mismatches](core::channel_message& _message)
+    {
+        if (_message.seq_ != expected++ || _message.id_ != core::get_message_id("archive/messages/get") || std::string(_message.name_) != "archive/messages/get")
+            ++mismatches;
+    });
+
+    BOOST_CHECK_EQUAL(drained, (size_t)16);
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK_EQUAL(channel.depth(), (size_t)0);
+    // one message in 16 is timed
+    BOOST_CHECK_EQUAL(channel.get_stats().count(), (uint64_t)1);
+    BOOST_CHECK_EQUAL(channel.get_stats().max_depth(), (uint32_t)16);
+
+    // the drain re-arms the wakeup, the ring works again after the overflow
+    BOOST_CHECK(channel.push(core::channel_message("log", 17, nullptr)));
+    BOOST_CHECK_EQUAL(wakeups, 2);
+    BOOST_CHECK_EQUAL(channel.drain([](core::channel_message&) {}), (size_t)1);
+}
+
+BOOST_AUTO_TEST_CASE(test_threads)
+{
+    // the producer pushes, the consumer drains a batch per wakeup
+    event_loop loop;
+    core::spsc_channel<core::channel_message> channel(256, [&loop] { loop.wakeup(); });
+
+    int64_t sum = 0;
+    int64_t last_seq = 0;
+    int32_t reordered = 0;
+
+    std::thread consumer([&]
+    {
+        for (bool stop = false; !stop; )
+        {
+            loop.wait();
+
+            channel.drain([&](core::channel_message& _message)
+            {
+                if (_message.seq_ < 0)
+                {
+                    stop = true;
+                    return;
+                }
+
+                if (_message.seq_ != last_seq + 1)
+                    ++reordered;
+
+                last_seq = _message.seq_;
+                sum += _message.seq_;
+            });
+        }
+    });
+
+    std::thread producer([&channel]
+    {
+        channel.bind_producer();
+
+        for (int64_t seq = 1; seq <= messages_count; ++seq)
+            channel.push(core::channel_message("message/typing", seq, nullptr));
+        channel.push(core::channel_message("message/typing", -1, nullptr));
+    });
+
+    producer.join();
+    consumer.join();
+
+    BOOST_CHECK_EQUAL(reordered, 0);
+    BOOST_CHECK_EQUAL(sum, messages_count * (messages_count + 1) / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
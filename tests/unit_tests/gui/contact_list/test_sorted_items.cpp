@@ -0,0 +1,159 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+
+#include <gui/main_window/contact_list/SortedItems.h>
+
+namespace
+{
+    const int dialogs_count = 300;
+    const int updates_count = 1000;
+
+    struct dlg_state
+    {
+        std::string aimid_;
+        int64_t time_;
+        int64_t favorite_time_;
+    };
+
+    struct dlg_state_aimid
+    {
+        const std::string& operator()(const dlg_state& _state) const { return _state.aimid_; }
+    };
+
+    // the same order as Logic::RecentsLess
+    struct dlg_state_less
+    {
+        bool operator()(const dlg_state& _first, const dlg_state& _second) const
+        {
+            if (_first.favorite_time_ == -1 && _second.favorite_time_ == -1)
+                return _first.time_ > _second.time_;
+
+            if (_first.favorite_time_ == -1)
+                return false;
+            else if (_second.favorite_time_ == -1)
+                return true;
+
+            if (_first.favorite_time_ == _second.favorite_time_)
+                return _first.aimid_ > _second.aimid_;
+
+            return _first.favorite_time_ < _second.favorite_time_;
+        }
+    };
+
+    typedef Logic::SortedItems<dlg_state, std::string, dlg_state_aimid, dlg_state_less> sorted_dialogs;
+
+    struct update
+    {
+        std::string aimid_;
+        int64_t time_;
+    };
+
+    std::vector<dlg_state> make_dialogs(std::mt19937& _random)
+    {
+        std::vector<dlg_state> dialogs;
+
+        for (int i = 0; i < dialogs_count; ++i)
+            dialogs.push_back({ std::to_string(100000 + i) + "@uin.icq", (int64_t)(_random() % 1000) * dialogs_count + i, (i % 100 == 0 ? i : -1) });
+
+        return dialogs;
+    }
+
+    // most of the updates come from a few busy dialogs, always with a newer time
+    std::vector<update> make_updates(const std::vector<dlg_state>& _dialogs, std::mt19937& _random)
+    {
+        std::vector<update> updates;
+
+        int64_t time = 1000 * dialogs_count;
+        for (int i = 0; i < updates_count; ++i)
+        {
+            const auto busy = (_random() % 4 != 0);
+            const auto index = (busy ? _random() % 50 : _random() % _dialogs.size());
+            updates.push_back({ _dialogs[index].aimid_, ++time });
+        }
+
+        return updates;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(gui)
+
+BOOST_AUTO_TEST_SUITE(contact_list)
+
+BOOST_AUTO_TEST_SUITE(test_sorted_items)
+
+BOOST_AUTO_TEST_CASE(test_replay_dlg_states)
+{
+    std::mt19937 random(42);
+
+    const auto dialogs = make_dialogs(random);
+    const auto updates = make_updates(dialogs, random);
+
+    sorted_dialogs sorted;
+    for (const auto& dialog : dialogs)
+        sorted.insert(dialog);
+
+    std::vector<dlg_state> plain(dialogs);
+
+    for (const auto& update : updates)
+    {
+        auto iter = std::find_if(plain.begin(), plain.end(), [&update](const dlg_state& _state){ return _state.aimid_ == update.aimid_; });
+        iter->time_ = update.time_;
+
+        const auto pos = sorted.find(update.aimid_);
+        sorted.at(pos).time_ = update.time_;
+        sorted.move(pos, sorted.sortedPosition(pos));
+    }
+
+    // the times are unique, so a full sort gives the only valid order
+    std::sort(plain.begin(), plain.end(), dlg_state_less());
+
+    BOOST_REQUIRE_EQUAL(sorted.size(), (int)plain.size());
+
+    int mismatches = 0;
+    for (int i = 0; i < sorted.size(); ++i)
+    {
+        if (sorted[i].aimid_ != plain[i].aimid_ || sorted.find(sorted[i].aimid_) != i)
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_insert_erase)
+{
+    sorted_dialogs sorted;
+
+    sorted.insert({ "a", 10, -1 });
+    sorted.insert({ "b", 30, -1 });
+    sorted.insert({ "c", 20, -1 });
+    sorted.insert({ "fav", 1, 5 });
+
+    BOOST_CHECK_EQUAL(sorted.find("fav"), 0);
+    BOOST_CHECK_EQUAL(sorted.find("b"), 1);
+    BOOST_CHECK_EQUAL(sorted.find("c"), 2);
+    BOOST_CHECK_EQUAL(sorted.find("a"), 3);
+
+    BOOST_CHECK_EQUAL(sorted.insertPosition({ "d", 25, -1 }), 2);
+
+    sorted.at(3).time_ = 40;
+    BOOST_CHECK_EQUAL(sorted.sortedPosition(3), 1);
+    sorted.move(3, 1);
+    BOOST_CHECK_EQUAL(sorted.find("a"), 1);
+    BOOST_CHECK_EQUAL(sorted.find("c"), 3);
+
+    sorted.at(1).time_ = 0;
+    BOOST_CHECK_EQUAL(sorted.sortedPosition(1), 3);
+
+    sorted.erase(sorted.find("b"));
+    BOOST_CHECK_EQUAL(sorted.find("b"), -1);
+    BOOST_CHECK_EQUAL(sorted.find("c"), 2);
+    BOOST_CHECK_EQUAL(sorted.size(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
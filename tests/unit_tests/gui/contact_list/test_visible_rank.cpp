@@ -0,0 +1,106 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+
+#include <gui/main_window/contact_list/VisibleRank.h>
+
+namespace
+{
+    const int roster_size = 1000;
+
+    std::vector<char> make_visibility(std::mt19937& _random)
+    {
+        std::vector<char> visible(roster_size);
+        for (auto& flag : visible)
+            flag = (_random() % 10 != 0);
+
+        return visible;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(gui)
+
+BOOST_AUTO_TEST_SUITE(contact_list)
+
+BOOST_AUTO_TEST_SUITE(test_visible_rank)
+
+BOOST_AUTO_TEST_CASE(test_rank_and_position)
+{
+    std::mt19937 random(1);
+
+    auto visible = make_visibility(random);
+
+    Logic::VisibleRank rank;
+    for (const auto flag : visible)
+        rank.push_back(flag != 0);
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto pos = (int)(random() % visible.size());
+
+        if (i % 100 == 99)
+        {
+            visible.erase(visible.begin() + pos);
+            rank.erase(pos);
+            continue;
+        }
+
+        visible[pos] = !visible[pos];
+        rank.setVisible(pos, visible[pos] != 0);
+    }
+
+    BOOST_REQUIRE_EQUAL(rank.size(), (int)visible.size());
+
+    int row = 0;
+    int mismatches = 0;
+
+    for (int pos = 0; pos < (int)visible.size(); ++pos)
+    {
+        if (rank.rank(pos) != row || rank.isVisible(pos) != (visible[pos] != 0))
+            ++mismatches;
+
+        if (visible[pos])
+        {
+            if (rank.position(row) != pos)
+                ++mismatches;
+
+            ++row;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK_EQUAL(rank.count(), row);
+}
+
+BOOST_AUTO_TEST_CASE(test_assign)
+{
+    std::mt19937 random(2);
+
+    const auto visible = make_visibility(random);
+
+    Logic::VisibleRank assigned;
+    assigned.assign(visible);
+
+    Logic::VisibleRank pushed;
+    for (const auto flag : visible)
+        pushed.push_back(flag != 0);
+
+    BOOST_REQUIRE_EQUAL(assigned.size(), pushed.size());
+    BOOST_CHECK_EQUAL(assigned.count(), pushed.count());
+
+    int mismatches = 0;
+    for (int pos = 0; pos < assigned.size(); ++pos)
+    {
+        if (assigned.rank(pos) != pushed.rank(pos) || assigned.isVisible(pos) != pushed.isVisible(pos))
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+#include <gui/main_window/sounds/PcmStream.h>
+
+namespace
+{
+    const int buffers_count = 4;
+    const size_t chunk_size = 64 * 1024;
+    const size_t decoded_chunks = 4;
+
+    const size_t frame_size = 4608;
+
+    // a minute of 48 kHz stereo, as a long voice message decodes to
+    const size_t message_size = 48000 * 4 * 60;
+
+    // hands out the bytes of a message of the given size frame by frame, as MpegLoader::readMore does
+    struct fake_decoder
+    {
+        explicit fake_decoder(const size_t _size)
+            : size_(_size)
+            , position_(0)
+        {
+        }
+
+        bool operator()(Ui::PcmChunk& _pcm)
+        {
+            if (position_ >= size_)
+                return false;
+
+            const auto frame = std::min(frame_size, size_ - position_);
+            for (size_t i = 0; i < frame; ++i)
+                _pcm.push_back((char)((position_ + i) % 251));
+
+            position_ += frame;
+            return true;
+        }
+
+        const size_t size_;
+        size_t position_;
+    };
+
+    void play_to_the_end(Ui::PcmPlayer& _player)
+    {
+        while (_player.isBuffering())
+        {
+            _player.pump();
+            std::this_thread::yield();
+        }
+
+        _player.pump();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(gui)
+
+BOOST_AUTO_TEST_SUITE(sounds)
+
+BOOST_AUTO_TEST_SUITE(test_pcm_stream)
+
+BOOST_AUTO_TEST_CASE(test_plays_everything_in_order)
+{
+    auto backend = new Ui::NullAudioBackend(buffers_count);
+    backend->keepPlayed(true);
+
+    Ui::PcmPlayer player(std::unique_ptr<Ui::AudioBackend>(backend), chunk_size, decoded_chunks);
+
+    const size_t size = 3 * 1024 * 1024 + 123;
+    player.start(fake_decoder(size));
+    player.setStarted();
+
+    play_to_the_end(player);
+
+    BOOST_REQUIRE_EQUAL(backend->playedBytes(), size);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (backend->played()[i] != (char)(i % 251))
+            ++mismatches;
+    }
+
+    BOOST_CHECK_EQUAL(mismatches, 0u);
+    BOOST_CHECK_LE(backend->maxQueued(), buffers_count);
+    BOOST_CHECK_LE(player.stream().maxQueued(), decoded_chunks);
+}
+
+BOOST_AUTO_TEST_CASE(test_first_chunk_is_queued_before_play)
+{
+    auto backend = new Ui::NullAudioBackend(buffers_count);
+
+    Ui::PcmPlayer player(std::unique_ptr<Ui::AudioBackend>(backend), chunk_size, decoded_chunks);
+    player.start(fake_decoder(message_size));
+
+    // nothing is played until the player starts the device, the first buffer is ready by then
+    BOOST_CHECK_GE(backend->playedBytes(), chunk_size);
+    BOOST_CHECK_EQUAL(backend->playCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_stop_in_the_middle)
+{
+    auto backend = new Ui::NullAudioBackend(buffers_count);
+
+    {
+        Ui::PcmPlayer player(std::unique_ptr<Ui::AudioBackend>(backend), chunk_size, decoded_chunks);
+
+        // an endless message, the decoder is waiting for space in the queue when the player goes
+        player.start([](Ui::PcmChunk& _pcm) { _pcm.resize(_pcm.size() + frame_size); return true; });
+        player.setStarted();
+
+        for (int i = 0; i < 100; ++i)
+            player.pump();
+
+        BOOST_CHECK(player.isBuffering());
+        BOOST_CHECK_LE(player.stream().maxQueued(), decoded_chunks);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_long_message_is_bounded)
+{
+    auto backend = new Ui::NullAudioBackend(buffers_count);
+    Ui::PcmPlayer player(std::unique_ptr<Ui::AudioBackend>(backend), chunk_size, decoded_chunks);
+    player.start(fake_decoder(message_size));
+
+    // the first buffer is there before the device starts, not the whole message
+    BOOST_CHECK_GT(backend->playedBytes(), 0u);
+    BOOST_CHECK_LT(backend->playedBytes(), message_size);
+
+    player.setStarted();
+    play_to_the_end(player);
+
+    BOOST_CHECK_EQUAL(backend->playedBytes(), message_size);
+
+    // a minute of sound never takes more than the queued buffers and the decoded chunks
+    BOOST_CHECK_LE(backend->maxQueued(), buffers_count);
+    BOOST_CHECK_LE(player.stream().maxQueued(), decoded_chunks);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()